@@ -8,7 +8,7 @@ r                   : line+ end_directive? EOF;         // non empty sequence of
 
 line                : label? (directive | statement);
 
-directive           : byte_directive | word_directive | dbyte_directive | org_directive | ass_directive;
+directive           : byte_directive | word_directive | dbyte_directive | org_directive | ass_directive | gen_directive | incbin_directive | export_directive | segment_directive | res_directive | var_directive | zppool_directive;
 statement           : dir_statement | imm_statement | rel_statement | idx_statement | idr_statement | idx_idr_statement | idr_idx_statement;
 
 dir_statement       : dir_opcode;
@@ -16,7 +16,8 @@ dir_opcode          : ('BRK' | 'PHP' | 'ASL' | 'CLC' | 'PLP' | 'ROL' | 'SEC' | '
                     |  'DEY' | 'TXA' | 'TYA' | 'TXS' | 'TAY' | 'TAX' | 'CLV' | 'TSX' | 'INY' | 'DEX' | 'CLD' | 'INX' | 'NOP' | 'SED');
 
 imm_statement       : imm_opcode imm_operand;
-imm_opcode          : ('ORA' | 'AND' | 'EOR' | 'ADC' | 'LDY' | 'LDX' | 'LDA'  | 'CPY' | 'CMP' | 'CPX' | 'SBC');
+imm_opcode          : ('ORA' | 'AND' | 'EOR' | 'ADC' | 'LDY' | 'LDX' | 'LDA'  | 'CPY' | 'CMP' | 'CPX' | 'SBC'
+                    |  'ANC' | 'ALR' | 'ARR' | 'SBX'); // undocumented
 imm_operand         : POUND (numerical_byte | expression);
 
 rel_statement       : rel_opcode symbol;
@@ -31,10 +32,13 @@ idx_y_statement     : idy_opcode idxy_operand idx_y;
 idx_abs_statement   : idabs_opcode idxy_operand;
                     
                     
-idx_opcode          : ('ORA' | 'ASL' | 'AND' | 'ROL' | 'EOR' | 'LSR' | 'ADC' | 'ROR' | 'STY' | 'STA' | 'LDY' | 'LDA' | 'CMP' | 'DEC' | 'SBC' | 'INC' );
-idy_opcode          : ('ORA' | 'AND' | 'EOR' | 'ADC' | 'STX' | 'STA' | 'LDX' | 'LDA' | 'CMP' | 'SBC' );
+idx_opcode          : ('ORA' | 'ASL' | 'AND' | 'ROL' | 'EOR' | 'LSR' | 'ADC' | 'ROR' | 'STY' | 'STA' | 'LDY' | 'LDA' | 'CMP' | 'DEC' | 'SBC' | 'INC'
+                    |  'SLO' | 'RLA' | 'SRE' | 'RRA' | 'DCP' | 'ISC' ); // undocumented
+idy_opcode          : ('ORA' | 'AND' | 'EOR' | 'ADC' | 'STX' | 'STA' | 'LDX' | 'LDA' | 'CMP' | 'SBC'
+                    |  'SLO' | 'RLA' | 'SRE' | 'RRA' | 'DCP' | 'ISC' | 'SAX' | 'LAX' ); // undocumented
 idabs_opcode        : ('ORA' | 'ASL' | 'JSR' | 'BIT' | 'AND' | 'ROL' | 'JMP' | 'EOR' | 'LSR' | 'ADC' | 'ROR' | 'STY' | 'STA' | 'STX' | 'LDY' | 'LDA' 
-                    |  'LDX' | 'CPY' | 'CMP' | 'DEC' | 'CPX' | 'SBC' | 'INC' );
+                    |  'LDX' | 'CPY' | 'CMP' | 'DEC' | 'CPX' | 'SBC' | 'INC'
+                    |  'SLO' | 'RLA' | 'SRE' | 'RRA' | 'DCP' | 'ISC' | 'SAX' | 'LAX' ); // undocumented
 idxy_operand        : (dec8 | dec | char8 | bin8 | hex8 | hex16 | expression);
 idx_x               : IDX_X;
 idx_y               : IDX_Y;
@@ -46,7 +50,8 @@ idr_operand         : (dec8 | dec | char8 | bin8 | hex8 | hex16 | expression);
 
 idx_idr_statement   : idx_idr_idx_opcode LBRAKET idx_idr_idx_operand IDX_X RBRAKET;
 idr_idx_statement   : idx_idr_idx_opcode LBRAKET idx_idr_idx_operand RBRAKET IDX_Y;
-idx_idr_idx_opcode  : ('ORA' | 'AND' | 'EOR' | 'ADC' | 'STA' | 'LDA' | 'CMP' | 'SBC');
+idx_idr_idx_opcode  : ('ORA' | 'AND' | 'EOR' | 'ADC' | 'STA' | 'LDA' | 'CMP' | 'SBC'
+                    |  'SLO' | 'RLA' | 'SRE' | 'RRA' | 'DCP' | 'ISC' | 'SAX' | 'LAX'); // undocumented
 idx_idr_idx_operand : (dec8 | dec | char8 | bin8 | hex8 | hex16 | expression) ;
 
 
@@ -60,6 +65,7 @@ dec                 : DEC;
 
 expression          : expression (DIV | MUL | PERCENT) expression
                     | expression (SUB | ADD) expression
+                    | ID LPAREN expression RPAREN    // function call, LO() or HI(), the names are no keywords
                     | symbol
                     | numerical 
                     | LPAREN expression RPAREN;
@@ -76,10 +82,18 @@ dbyte_directive     : DOT 'DBYTE' data_list; // leaves data bytes in given order
 end_directive       : DOT 'END'; // indicates end of source file
 org_directive       : DOT 'ORG' expression;
 ass_directive       : ID EQUALS expression;
+gen_directive       : DOT gen_type ID COMMA expression COMMA expression; // index variable, count, value per index
+gen_type            : ('GENBYTE' | 'GENWORD');
+incbin_directive    : DOT 'INCBIN' STRING (COMMA expression (COMMA expression)?)?; // file name, optional offset and length
+export_directive    : DOT 'EXPORT' ID (COMMA ID)*; // symbols visible to other modules when linking
+segment_directive   : DOT 'SEGMENT' ID; // the following code is placed in segment ID when linking
+res_directive       : DOT 'RES' expression; // reserves a number of bytes
+var_directive       : DOT 'VAR' ID (COMMA expression)?; // variable of 1 or the given number of bytes, allocated by the assembler
+zppool_directive    : DOT 'ZPPOOL' expression COMMA expression; // first and last zero page address available to variables
 
 
 data_list           : data (COMMA data)*;
-data                : (expression | data_string); // anything that can be put into memory
+data                : (numerical | expression | data_string); // anything that can be put into memory, plain literals are stored directly
 data_string         : STRING;
 
 fragment STRING_CH  : [\u0000-\u0021\u0023-\u00ff]; // anything in ascii except QUOTE
@@ -117,5 +131,5 @@ COLON               : ':';
 ID                  : [_a-zA-Z][_a-zA-Z0-9]* ;             // C style identifier
 
 // skip everything between semicolon and newline, skip any other kind of WS
-COMMENT             : ';' .*? '\n' -> skip;
+COMMENT             : ';' ~[\n]* -> skip;
 WS                  : [ \t\r\n]+ -> skip ;
@@ -1,5 +1,11 @@
 
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
 
 #include <ANTLRInputStream.h>
@@ -7,8 +13,13 @@
 #include <MOS6502Parser.h>
 
 #include "ASM6502.h"
+#include "listener/IncludeTokenSource.h"
+#include "listener/MacroTokenSource.h"
 #include "listener/MOS6502ErrorListener.h"
 #include "listener/MOS6502Listener.h"
+#include "listener/PeepholeOptimizer.h"
+#include "listener/SymbolSnapshot.h"
+#include "listener/VariableAllocator.h"
 
 using namespace std;
 using namespace antlr4;
@@ -16,44 +27,187 @@ using namespace antlr4;
 namespace asm6502
 {
 
-void assembleStream(std::istream &stream, char const *fileName, AssemblyStatus &ret)
+// upper limit of re-assembly passes, each pass may enable further rewrites
+static size_t const MAX_OPTIMIZER_PASSES = 8;
+
+// zeroPageVariables is nullopt in the first pass, see MOS6502Listener::setZeroPageVariables()
+static auto assemblePass(string const &source, char const *fileName, AssemblyOptions const &options, map<size_t, StatementRewrite> const &rewrites,
+                         optional<map<string, uint32_t>> const &zeroPageVariables) -> unique_ptr<MOS6502Listener>
 {
-    ANTLRInputStream input(stream);
+    auto listener = make_unique<MOS6502Listener>(fileName);
+    listener->setPrelude(options.prelude, options.preludeName);
+    listener->setStatementRewrites(rewrites);
+    listener->setObjectMode(options.objectMode);
+    listener->setUndocumentedOpcodes(options.undocumentedOpcodes);
+    listener->setErrorLimit(options.errorLimit);
+    listener->setExpressionDepthLimit(options.expressionDepthLimit);
+    if (zeroPageVariables.has_value())
+    {
+        listener->setZeroPageVariables(zeroPageVariables.value());
+    }
+
+    asm6502::MOS6502ErrorListener errorListener(fileName, listener.get());
+    ANTLRInputStream input(source);
     MOS6502Lexer lexer(&input);
-    CommonTokenStream tokens(&lexer);
+    lexer.removeErrorListeners();
+    lexer.addErrorListener(&errorListener);
+    IncludeTokenSource includeTokenSource(lexer, fileName, options.includePaths, *listener);
+    MacroTokenSource macroTokenSource(includeTokenSource, fileName, *listener);
+    CommonTokenStream tokens(&macroTokenSource);
     MOS6502Parser parser(&tokens);
-    asm6502::MOS6502Listener listener(fileName);
 
-    parser.addParseListener(&listener);
+    parser.addParseListener(listener.get());
 
     parser.removeErrorListeners();
-    asm6502::MOS6502ErrorListener errorListener(fileName, &listener);
     parser.addErrorListener(&errorListener);
 
     parser.r();
-    listener.resolveDeferredExpressions();
-    listener.resolveBranchTargets();
+    listener->resolvePendingAssignments();
+    listener->resolveDeferredExpressions();
+    listener->resolveBranchTargets();
+    listener->resolveExports();
+
+    return listener;
+}
 
-    bool errorsDetected = listener.detectedErrors();
+void assembleStream(std::istream &stream, char const *fileName, AssemblyStatus &ret)
+{
+    assembleStream(stream, fileName, AssemblyOptions{}, ret);
+}
 
-    if (errorsDetected)
+// a variable used with indirect addressing must get a zero page address
+static void addVariableErrors(VariableAllocator const &allocator, AssemblyStatus &ret)
+{
+    for (auto const &allocation : allocator.getAllocations())
     {
-        for (auto const &pe : listener.getParseErrors())
+        if (allocation.requiresZeroPage && !allocation.zeroPage)
         {
-            ret.errors.push_back(pe);
+            VariableDeclaration const &variable = allocation.variable;
+            ret.errors.errors.push_back(SemanticError{ErrorCode::ZeroPagePoolExhausted, variable.fileId, variable.srcLine, variable.srcCol, {variable.name}});
         }
-        for (auto const &se : listener.getSemanticErrors())
+    }
+}
+
+static void reportVariables(VariableAllocator const &allocator, MOS6502Listener const &listener, AssemblyStatus &ret)
+{
+    uint32_t bytesSaved = 0;
+    uint32_t cyclesSaved = 0;
+    size_t numZeroPage = 0;
+
+    for (auto const &allocation : allocator.getAllocations())
+    {
+        VariableDeclaration const &variable = allocation.variable;
+        optional<Sym> optSym = listener.getSymbolTable().resolveSymbol(variable.name);
+        stringstream strm;
+
+        strm << listener.getSourceFile(variable.fileId) << ":" << variable.srcLine << ": variable " << variable.name << ": ";
+        if (allocation.zeroPage)
         {
-            ret.errors.push_back(se.getErrorMessage());
+            strm << "zero page $" << hex << setw(2) << setfill('0') << allocation.address << dec;
         }
+        else if ((optSym != std::nullopt) && !optSym.value().relocatable)
+        {
+            strm << "absolute $" << hex << setw(4) << setfill('0') << optSym.value().val << dec;
+        }
+        else
+        {
+            strm << "relocatable";
+        }
+        strm << ", " << allocation.references << " reference(s), weight " << allocation.weight;
+        if (allocation.zeroPage)
+        {
+            strm << ", saves " << allocation.bytesSaved << " byte(s), " << allocation.cyclesSaved << " cycle(s)";
+        }
+        ret.variables.push_back(strm.str());
+
+        numZeroPage += allocation.zeroPage ? 1 : 0;
+        bytesSaved += allocation.bytesSaved;
+        cyclesSaved += allocation.cyclesSaved;
     }
-    else
+
+    stringstream strm;
+    strm
+        << listener.getSourceFile(0) << ": variables: " << numZeroPage << " of " << allocator.getAllocations().size()
+        << " in the zero page, saves " << bytesSaved << " byte(s), " << cyclesSaved << " cycle(s)";
+    ret.variables.push_back(strm.str());
+}
+
+void assembleStream(std::istream &stream, char const *fileName, AssemblyOptions const &options, AssemblyStatus &ret)
+{
+    // the source is parsed once per pass
+    string source{istreambuf_iterator<char>(stream), istreambuf_iterator<char>()};
+    PeepholeOptimizer optimizer;
+    VariableAllocator allocator;
+    optional<map<string, uint32_t>> zeroPageVariables = std::nullopt;
+    unique_ptr<MOS6502Listener> listener = assemblePass(source, fileName, options, optimizer.getStatementRewrites(), zeroPageVariables);
+
+    // variables are allocated by their references in the first pass
+    if (!listener->detectedErrors() && !listener->getVariables().empty())
+    {
+        allocator.allocate(listener->getVariables(), listener->getSymbolReferences(), listener->getInstructions(), listener->getZeroPagePool());
+        ret.errors = listener->getDiagnostics();
+        addVariableErrors(allocator, ret);
+
+        if (!ret.errors.empty())
+        {
+            return;
+        }
+
+        zeroPageVariables = allocator.getZeroPageAddresses();
+        listener = assemblePass(source, fileName, options, optimizer.getStatementRewrites(), zeroPageVariables);
+    }
+
+    // the optimizer would shorten operands the linker patches
+    if (options.optimize && !options.objectMode)
+    {
+        for (size_t pass = 0; (pass < MAX_OPTIMIZER_PASSES) && !listener->detectedErrors() && optimizer.optimize(listener->getInstructions()); pass++)
+        {
+            listener = assemblePass(source, fileName, options, optimizer.getStatementRewrites(), zeroPageVariables);
+        }
+    }
+
+    if (!listener->detectedErrors())
+    {
+        for (auto const &rewrite : optimizer.getRewrites())
+        {
+            stringstream strm;
+            strm
+                << fileName << ":" << rewrite.srcLine << ": optimization: " << rewrite.description
+                << ", saves " << rewrite.bytesSaved << " byte(s), " << rewrite.cyclesSaved << " cycle(s)";
+            ret.optimizations.push_back(strm.str());
+        }
+
+        if (zeroPageVariables.has_value())
+        {
+            allocator.account(listener->getSymbolReferences(), listener->getInstructions());
+            reportVariables(allocator, *listener, ret);
+        }
+    }
+
+    // the listener of the last pass is done, its result is moved instead of copied
+    AssemblyResult result = std::move(*listener).takeResult();
+    ret.errors = std::move(result.errors);
+    ret.assembledProgram = std::move(result.assembledProgram);
+    ret.symbols = std::move(result.symbols);
+    ret.object = std::move(result.object);
+}
+
+// an error of the whole file, the assembled file has file id 0
+static void addFileError(char const *fileName, ErrorCode code, string const &arg, AssemblyStatus &ret)
+{
+    if (ret.errors.sourceFiles.empty())
     {
-        ret.assembledProgram = listener.getAssembledMemBlocks();
+        ret.errors.sourceFiles.push_back(fileName);
     }
+    ret.errors.errors.push_back(SemanticError{code, 0, 0, 0, {arg}});
 }
 
 auto assembleFile(char const *fileName) -> AssemblyStatus
+{
+    return assembleFile(fileName, AssemblyOptions{});
+}
+
+auto assembleFile(char const *fileName, AssemblyOptions const &options) -> AssemblyStatus
 {
     AssemblyStatus ret;
 
@@ -64,32 +218,24 @@ auto assembleFile(char const *fileName) -> AssemblyStatus
     {
         try
         {
-            assembleStream(stream, fileName, ret);
+            assembleStream(stream, fileName, options, ret);
         }
         catch (logic_error const &e)
         {
-            std::stringstream strm;
-            strm << "Error: " << e.what();
-            ret.errors.push_back(strm.str());
+            addFileError(fileName, ErrorCode::Exception, e.what(), ret);
         }
         catch (RecognitionException &e)
         {
-            std::stringstream strm;
-            strm << "Error: " << e.what();
-            ret.errors.push_back(strm.str());
+            addFileError(fileName, ErrorCode::Exception, e.what(), ret);
         }
         catch (...)
         {
-            std::stringstream strm;
-            strm << "Unknown error occurred." << std::endl;
-            ret.errors.push_back(strm.str());
+            addFileError(fileName, ErrorCode::Exception, "Unknown error occurred.", ret);
         }
     }
     else
     {
-        std::stringstream strm;
-        strm << "Could not open file: " << fileName << endl;
-        ret.errors.push_back(strm.str());        
+        addFileError(fileName, ErrorCode::FileNotOpened, "", ret);
     }
 
     return ret;
@@ -102,4 +248,107 @@ void writeProgFile(char const *pProgFilePath, MemBlocks const &memBlocks)
     progFile.close();
 }
 
+bool writeLoaderFile(char const *pLoaderFilePath, MemBlocks const &memBlocks, uint16_t entryAddress)
+{
+    std::optional<std::vector<uint8_t>> optLoader = memBlocks.getLoaderProgram(entryAddress);
+    bool ret = false;
+
+    if (optLoader != std::nullopt)
+    {
+        std::ofstream loaderFile(pLoaderFilePath, std::ios::binary | std::ios::out | std::ios::trunc);
+        loaderFile.write(reinterpret_cast<char const *>(optLoader.value().data()), optLoader.value().size());
+        loaderFile.close();
+        ret = !loaderFile.fail();
+    }
+
+    return ret;
+}
+
+auto writePackedFile(char const *pPackedFilePath, MemBlocks const &memBlocks, uint16_t entryAddress, size_t numThreads)
+    -> std::optional<PackedProgram>
+{
+    std::optional<PackedProgram> ret = LzPacker(numThreads).getPackedProgram(memBlocks, entryAddress);
+
+    if (ret != std::nullopt)
+    {
+        std::ofstream packedFile(pPackedFilePath, std::ios::binary | std::ios::out | std::ios::trunc);
+        packedFile.write(reinterpret_cast<char const *>(ret.value().prg.data()), ret.value().prg.size());
+        packedFile.close();
+        if (packedFile.fail())
+        {
+            ret = std::nullopt;
+        }
+    }
+
+    return ret;
+}
+
+bool writeDiskImageFile(char const *pDiskImageFilePath, D64Image const &diskImage)
+{
+    std::ofstream diskImageFile(pDiskImageFilePath, std::ios::binary | std::ios::out | std::ios::trunc);
+    diskImage.write(diskImageFile);
+    diskImageFile.close();
+
+    return !diskImageFile.fail();
+}
+
+bool writeDebugInfoFile(char const *pDebugInfoFilePath, DebugInfo const &debugInfo)
+{
+    std::ofstream debugInfoFile(pDebugInfoFilePath, std::ios::binary | std::ios::out | std::ios::trunc);
+    writeDebugInfo(debugInfoFile, debugInfo);
+    debugInfoFile.close();
+
+    return !debugInfoFile.fail();
+}
+
+bool writeDebugInfoTextFile(char const *pDebugInfoFilePath, DebugInfo const &debugInfo)
+{
+    std::ofstream debugInfoFile(pDebugInfoFilePath, std::ios::out | std::ios::trunc);
+    writeDebugInfoText(debugInfoFile, debugInfo);
+    debugInfoFile.close();
+
+    return !debugInfoFile.fail();
+}
+
+bool writeViceLabelFile(char const *pLabelFilePath, DebugInfo const &debugInfo)
+{
+    std::ofstream labelFile(pLabelFilePath, std::ios::out | std::ios::trunc);
+    writeViceLabels(labelFile, debugInfo);
+    labelFile.close();
+
+    return !labelFile.fail();
+}
+
+bool writeSymbolFile(char const *pSymbolFilePath, SymbolTable const &symbols)
+{
+    std::ofstream symbolFile(pSymbolFilePath, std::ios::binary | std::ios::out | std::ios::trunc);
+    writeSymbolSnapshot(symbolFile, symbols);
+    symbolFile.close();
+
+    return !symbolFile.fail();
+}
+
+auto readSymbolFile(char const *pSymbolFilePath) -> std::optional<SymbolTable>
+{
+    std::ifstream symbolFile(pSymbolFilePath, std::ios::binary | std::ios::in);
+
+    return symbolFile.fail() ? std::nullopt : readSymbolSnapshot(symbolFile);
+}
+
+bool writeObjectFile(char const *pObjectFilePath, ObjectModule const &module)
+{
+    std::ofstream objectFile(pObjectFilePath, std::ios::binary | std::ios::out | std::ios::trunc);
+    writeObjectModule(objectFile, module);
+    objectFile.close();
+
+    return !objectFile.fail();
+}
+
+auto readObjectFile(char const *pObjectFilePath) -> std::optional<ObjectModule>
+{
+    std::ifstream objectFile(pObjectFilePath, std::ios::binary | std::ios::in);
+
+    return objectFile.fail() ? std::nullopt : readObjectModule(objectFile);
+}
+
 }
@@ -1,25 +1,69 @@
 #ifndef ASM6502_H
 #define ASM6502_H
 
+#include <optional>
+#include <string>
 #include <vector>
 #include <iostream>
 
+#include "linker/ObjectModule.h"
+#include "listener/D64Image.h"
+#include "listener/DebugInfo.h"
+#include "listener/LzPacker.h"
 #include "listener/MemBlocks.h"
+#include "listener/SemanticError.h"
+#include "listener/SymbolTable.h"
 
 namespace asm6502
 {
     typedef struct
     {
-        std::vector<std::string> errors;
+        Diagnostics errors;                     // formatted when printed, see Diagnostics::writeText() and writeJson()
         MemBlocks assembledProgram;
+        SymbolTable symbols;
+        std::vector<std::string> optimizations; // applied peephole optimizations, one message each
+        std::vector<std::string> variables;     // allocation of the .VAR variables, one message each, then the total
+        ObjectModule object;                    // only assembled with AssemblyOptions::objectMode
     } AssemblyStatus;
-    
+
+    class AssemblyOptions
+    {
+    public:
+        bool optimize = false;  // apply peephole optimizations, re-assembling the program until no more are found
+        std::vector<std::string> includePaths;  // searched for .INCLUDE files not found next to the including file
+        SymbolTable prelude;                    // predefined symbols, see readSymbolFile()
+        std::string preludeName = "prelude";    // names the prelude in error messages
+        bool objectMode = false;                // leave undefined symbols to the linker, see AssemblyStatus::object
+        bool undocumentedOpcodes = false;       // accept the stable undocumented NMOS opcodes
+        size_t errorLimit = 0;                  // stop assembling after this many errors, 0 for no limit
+        size_t expressionDepthLimit = 256;      // depth of the expression evaluation stack, deeper is an error, 0 for no limit
+    };
+
 
     // API for clients passing an assemble file
     AssemblyStatus assembleFile(char const *fileName);
+    AssemblyStatus assembleFile(char const *fileName, AssemblyOptions const &options);
     // API for tests
     void assembleStream(std::istream &stream, char const *fileName, AssemblyStatus &ret);
+    void assembleStream(std::istream &stream, char const *fileName, AssemblyOptions const &options, AssemblyStatus &ret);
     void writeProgFile(char const *pProgFilePath, MemBlocks const &memBlocks);
+    // a self-starting .PRG which copies the mem blocks in place, see MemBlocks::getLoaderProgram()
+    bool writeLoaderFile(char const *pLoaderFilePath, MemBlocks const &memBlocks, uint16_t entryAddress);
+    // a self-extracting .PRG packed with numThreads threads, see LzPacker::getPackedProgram(), nullopt if not written
+    auto writePackedFile(char const *pPackedFilePath, MemBlocks const &memBlocks, uint16_t entryAddress, size_t numThreads)
+        -> std::optional<PackedProgram>;
+    // a .D64 disk image, see D64Image::write()
+    bool writeDiskImageFile(char const *pDiskImageFilePath, D64Image const &diskImage);
+    // source maps for emulators and profilers, see writeDebugInfo(), writeDebugInfoText() and writeViceLabels()
+    bool writeDebugInfoFile(char const *pDebugInfoFilePath, DebugInfo const &debugInfo);
+    bool writeDebugInfoTextFile(char const *pDebugInfoFilePath, DebugInfo const &debugInfo);
+    bool writeViceLabelFile(char const *pLabelFilePath, DebugInfo const &debugInfo);
+    // symbol snapshots, e.g. of a file with shared equates, assembled once and loaded as prelude
+    bool writeSymbolFile(char const *pSymbolFilePath, SymbolTable const &symbols);
+    auto readSymbolFile(char const *pSymbolFilePath) -> std::optional<SymbolTable>;
+    // object files, linked by LINK6502
+    bool writeObjectFile(char const *pObjectFilePath, ObjectModule const &module);
+    auto readObjectFile(char const *pObjectFilePath) -> std::optional<ObjectModule>;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "Disassembler.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+uint32_t const BYTES_PER_DATA_LINE = 8;
+uint32_t const LABEL_WIDTH = 12;
+
+auto hex(uint32_t value, int digits) -> std::string
+{
+    std::stringstream strm;
+    strm << "$" << std::uppercase << std::hex << std::setw(digits) << std::setfill('0') << value;
+    return strm.str();
+}
+
+auto symbolName(char const *prefix, uint32_t address) -> std::string
+{
+    return prefix + hex(address, 4).substr(1);
+}
+
+}
+
+Disassembler::Disassembler(bool undocumentedOpcodes_) :
+    undocumentedOpcodes{undocumentedOpcodes_}
+{
+}
+
+auto Disassembler::decode(MemBlock const &memBlock) const -> std::vector<DisassembledInstruction>
+{
+    std::vector<DisassembledInstruction> ret;
+    std::vector<uint8_t> const &bytes = memBlock.getBytes();
+    size_t idx = 0;
+
+    while (idx < bytes.size())
+    {
+        std::optional<OpcodeInfo> const &optInfo = getOpcodeInfos()[bytes[idx]];
+        uint32_t address = memBlock.getStartAddress() + idx;
+
+        if ((optInfo != std::nullopt) && (undocumentedOpcodes || !optInfo.value().undocumented) &&
+            (idx + getOperandBytes(optInfo.value().mode) < bytes.size()))
+        {
+            size_t length = 1 + getOperandBytes(optInfo.value().mode);
+            ret.push_back(DisassembledInstruction{address, {begin(bytes) + idx, begin(bytes) + idx + length}, optInfo});
+            idx += length;
+        }
+        else
+        {
+            ret.push_back(DisassembledInstruction{address, {bytes[idx]}, std::nullopt});
+            idx++;
+        }
+    }
+
+    return ret;
+}
+
+auto Disassembler::getBranchTarget(DisassembledInstruction const &instr) -> uint32_t
+{
+    return (instr.address + 2 + static_cast<uint32_t>(static_cast<int8_t>(instr.bytes[1]))) & 0xffffU;
+}
+
+auto Disassembler::formatOperand(DisassembledInstruction const &instr) const -> std::string
+{
+    std::string ret;
+    uint32_t word = (instr.bytes.size() > 2) ? (instr.bytes[1] | (static_cast<uint32_t>(instr.bytes[2]) << 8U)) : 0;
+    std::string absolute = (word > 0xffU) ? hex(word, 4) : symbolName("A_", word);
+
+    switch (instr.opcode.value().mode)
+    {
+        case AddressingMode::Implied:
+            break;
+        case AddressingMode::Immediate:
+            ret = "#" + hex(instr.bytes[1], 2);
+            break;
+        case AddressingMode::Relative:
+            ret = symbolName("L_", getBranchTarget(instr));
+            break;
+        case AddressingMode::AbsoluteX:
+            ret = absolute + ",X";
+            break;
+        case AddressingMode::ZeroPageX:
+            ret = hex(instr.bytes[1], 2) + ",X";
+            break;
+        case AddressingMode::AbsoluteY:
+            ret = absolute + ",Y";
+            break;
+        case AddressingMode::ZeroPageY:
+            ret = hex(instr.bytes[1], 2) + ",Y";
+            break;
+        case AddressingMode::Absolute:
+            ret = absolute;
+            break;
+        case AddressingMode::ZeroPage:
+            ret = hex(instr.bytes[1], 2);
+            break;
+        case AddressingMode::IndexedIndirect:
+            ret = "[" + hex(instr.bytes[1], 2) + ",X]";
+            break;
+        case AddressingMode::IndirectIndexed:
+            ret = "[" + hex(instr.bytes[1], 2) + "],Y";
+            break;
+        case AddressingMode::Indirect:
+            // JMP has no zero page form
+            ret = "[" + hex(word, 4) + "]";
+            break;
+    }
+
+    return ret;
+}
+
+auto Disassembler::disassemble(MemBlocks const &memBlocks) const -> std::string
+{
+    std::vector<std::vector<DisassembledInstruction>> blocks;
+    std::set<uint32_t> instructionAddresses;
+    std::set<uint32_t> branchTargets;
+    std::set<uint32_t> zeroPageSymbols;
+
+    for (uint32_t blockIdx = 0; blockIdx < memBlocks.getNumMemBlocks(); blockIdx++)
+    {
+        blocks.push_back(decode(memBlocks.getMemBlockAt(blockIdx)));
+
+        for (auto const &instr : blocks.back())
+        {
+            instructionAddresses.insert(instr.address);
+
+            if ((instr.opcode != std::nullopt) && (instr.opcode.value().mode == AddressingMode::Relative))
+            {
+                branchTargets.insert(getBranchTarget(instr));
+            }
+            else if ((instr.bytes.size() == 3) && (instr.bytes[2] == 0) && (instr.opcode.value().mode != AddressingMode::Indirect))
+            {
+                zeroPageSymbols.insert(instr.bytes[1]);
+            }
+        }
+    }
+
+    std::stringstream strm;
+
+    for (auto const &block : blocks)
+    {
+        strm << std::string(LABEL_WIDTH, ' ') << ".ORG " << hex(block.front().address, 4) << std::endl;
+
+        for (size_t idx = 0; idx < block.size(); idx++)
+        {
+            DisassembledInstruction const &instr = block[idx];
+            std::string label = (branchTargets.count(instr.address) > 0) ? symbolName("L_", instr.address) + ":" : "";
+            strm << std::left << std::setw(LABEL_WIDTH) << label << std::right;
+
+            if (instr.opcode != std::nullopt)
+            {
+                std::string operand = formatOperand(instr);
+                strm << instr.opcode.value().mnemonic << (operand.empty() ? "" : " ") << operand << std::endl;
+            }
+            else
+            {
+                // consecutive data bytes share a line up to the next label
+                strm << ".BYTE " << hex(instr.bytes[0], 2);
+                for (uint32_t count = 1; (count < BYTES_PER_DATA_LINE) && (idx + 1 < block.size()) &&
+                     (block[idx + 1].opcode == std::nullopt) && (branchTargets.count(block[idx + 1].address) == 0); count++)
+                {
+                    strm << ", " << hex(block[++idx].bytes[0], 2);
+                }
+                strm << std::endl;
+            }
+        }
+    }
+
+    // targets outside of the program or within an instruction
+    for (uint32_t target : branchTargets)
+    {
+        if (instructionAddresses.count(target) == 0)
+        {
+            strm << symbolName("L_", target) << " = " << hex(target, 4) << std::endl;
+        }
+    }
+
+    for (uint32_t address : zeroPageSymbols)
+    {
+        strm << symbolName("A_", address) << " = " << hex(address, 2) << std::endl;
+    }
+
+    return strm.str();
+}
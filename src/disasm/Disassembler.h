@@ -0,0 +1,47 @@
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "listener/MemBlocks.h"
+#include "listener/OpcodeTables.h"
+
+namespace asm6502
+{
+
+// An instruction, or data if opcode is nullopt
+class DisassembledInstruction
+{
+public:
+    uint32_t address;
+    std::vector<uint8_t> bytes;
+    std::optional<OpcodeInfo> opcode;
+};
+
+// Decodes machine code with the opcode tables of the assembler, see getOpcodeInfos(). Bytes
+// which are no known opcode, or instructions cut off at the end of a mem block, become data.
+class Disassembler
+{
+public:
+    explicit Disassembler(bool undocumentedOpcodes_);
+
+    auto decode(MemBlock const &memBlock) const -> std::vector<DisassembledInstruction>;
+
+    // source assembling to the same mem blocks. Branch targets get labels L_xxxx, absolute
+    // operands below $100 the symbols A_xxxx, defined at the end so the assembler keeps the
+    // absolute form instead of using the zero page.
+    auto disassemble(MemBlocks const &memBlocks) const -> std::string;
+
+    static auto getBranchTarget(DisassembledInstruction const &instr) -> uint32_t;
+
+private:
+    auto formatOperand(DisassembledInstruction const &instr) const -> std::string;
+
+    bool undocumentedOpcodes;
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <sstream>
+
+#include "Disassembler.h"
+#include "RoundTripChecker.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+auto formatBytes(MemBlocks const &memBlocks, uint32_t address) -> std::string
+{
+    std::stringstream strm;
+
+    for (uint32_t blockIdx = 0; blockIdx < memBlocks.getNumMemBlocks(); blockIdx++)
+    {
+        MemBlock const &memBlock = memBlocks.getMemBlockAt(blockIdx);
+
+        for (auto const &instr : Disassembler(true).decode(memBlock))
+        {
+            if ((instr.address <= address) && (address < instr.address + instr.bytes.size()))
+            {
+                for (uint8_t byte : instr.bytes)
+                {
+                    strm << " 0x" << std::hex << static_cast<uint32_t>(byte);
+                }
+            }
+        }
+    }
+
+    return strm.str().empty() ? " none" : strm.str();
+}
+
+}
+
+auto asm6502::checkRoundTrip(MemBlocks const &program, AssemblyOptions const &options) -> std::optional<std::string>
+{
+    std::optional<std::string> ret = std::nullopt;
+    std::stringstream source(Disassembler(options.undocumentedOpcodes).disassemble(program));
+    AssemblyOptions reassemblyOptions;
+    AssemblyStatus reassembled;
+
+    reassemblyOptions.undocumentedOpcodes = options.undocumentedOpcodes;
+    assembleStream(source, "disassembly", reassemblyOptions, reassembled);
+
+    if (!reassembled.errors.empty())
+    {
+        std::stringstream strm;
+        strm << "Reassembling the disassembly failed:";
+        for (auto const &error : reassembled.errors.getMessages())
+        {
+            strm << std::endl << error;
+        }
+        ret = strm.str();
+    }
+    else if (reassembled.assembledProgram != program)
+    {
+        // the first address at which the programs differ, the disassembly keeps the mem blocks
+        MemBlocks const &other = reassembled.assembledProgram;
+        uint32_t address = 0;
+        uint32_t blockIdx = 0;
+
+        while ((blockIdx < program.getNumMemBlocks()) && (blockIdx < other.getNumMemBlocks()) &&
+               (program.getMemBlockAt(blockIdx) == other.getMemBlockAt(blockIdx)))
+        {
+            blockIdx++;
+        }
+
+        if ((blockIdx < program.getNumMemBlocks()) && (blockIdx < other.getNumMemBlocks()))
+        {
+            MemBlock const &memBlock = program.getMemBlockAt(blockIdx);
+            MemBlock const &otherMemBlock = other.getMemBlockAt(blockIdx);
+            uint32_t idx = 0;
+
+            while ((idx < memBlock.getLengthBytes()) && (idx < otherMemBlock.getLengthBytes()) &&
+                   (memBlock.getByteAt(idx) == otherMemBlock.getByteAt(idx)))
+            {
+                idx++;
+            }
+            address = std::min(memBlock.getStartAddress(), otherMemBlock.getStartAddress()) +
+                      ((memBlock.getStartAddress() == otherMemBlock.getStartAddress()) ? idx : 0);
+        }
+        else
+        {
+            address = ((blockIdx < program.getNumMemBlocks()) ? program : other).getMemBlockAt(blockIdx).getStartAddress();
+        }
+
+        std::stringstream strm;
+        strm << "Round trip differs at $" << std::hex << address << ": assembled" << formatBytes(program, address)
+             << ", reassembled" << formatBytes(reassembled.assembledProgram, address);
+        ret = strm.str();
+    }
+
+    return ret;
+}
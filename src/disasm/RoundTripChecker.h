@@ -0,0 +1,19 @@
+#ifndef ROUND_TRIP_CHECKER_H
+#define ROUND_TRIP_CHECKER_H
+
+#include <optional>
+#include <string>
+
+#include "ASM6502.h"
+
+namespace asm6502
+{
+
+// Disassembles an assembled program and reassembles the disassembly, which must result in the
+// same bytes. nullopt if it does, otherwise what differs: errors of the reassembly, or the
+// first differing address with both instructions.
+auto checkRoundTrip(MemBlocks const &program, AssemblyOptions const &options) -> std::optional<std::string>;
+
+} // namespace
+
+#endif
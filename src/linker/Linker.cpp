@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "Linker.h"
+
+using namespace asm6502;
+
+void Linker::addModule(ObjectModule const &module, std::string const &name)
+{
+    modules.push_back(ModuleEntry{module, name, {}});
+}
+
+auto Linker::link() -> LinkStatus
+{
+    placeSections();
+    collectExports();
+    copySections();
+    applyPatches();
+
+    // contiguous bytes form a memory block
+    std::vector<MemBlock> memBlocks;
+    std::vector<uint8_t> bytes;
+    uint32_t startAddress = 0;
+
+    for (auto const &addressByte : payload)
+    {
+        if (!bytes.empty() && (addressByte.first != startAddress + bytes.size()))
+        {
+            memBlocks.emplace_back(startAddress, std::move(bytes));
+            bytes.clear();
+        }
+
+        if (bytes.empty())
+        {
+            startAddress = addressByte.first;
+        }
+
+        bytes.push_back(addressByte.second);
+    }
+
+    if (!bytes.empty())
+    {
+        memBlocks.emplace_back(startAddress, std::move(bytes));
+    }
+
+    if (status.errors.empty())
+    {
+        status.linkedProgram = MemBlocks(std::move(memBlocks));
+    }
+
+    for (auto const &entry : modules)
+    {
+        status.sectionBases.push_back(entry.sectionBases);
+    }
+
+    return status;
+}
+
+// absolute sections first, the relocatable sections fill the gaps between them
+void Linker::placeSections()
+{
+    for (auto const &name : {"CODE", "DATA", "BSS"})
+    {
+        segments.emplace(name, Segment{name, baseAddress, 0x10000U});
+    }
+    segments.emplace("ZEROPAGE", Segment{"ZEROPAGE", 0x02, 0x100U});
+
+    for (size_t moduleIdx = 0; moduleIdx < modules.size(); moduleIdx++)
+    {
+        for (auto const &section : modules[moduleIdx].module.sections)
+        {
+            uint32_t address = section.getStartAddress();
+            std::optional<AddressRange> overlap = occupied.insert(address, address + section.getLengthBytes());
+
+            if (overlap != std::nullopt)
+            {
+                std::stringstream strm;
+                strm
+                    << std::hex << std::setfill('0') << "The section at 0x" << std::setw(4) << address
+                    << " overlaps the section at 0x" << std::setw(4) << overlap.value().first << ".";
+                addError(moduleIdx, strm.str());
+            }
+            else if (address + section.getLengthBytes() > 0x10000U)
+            {
+                std::stringstream strm;
+                strm << "The section at 0x" << std::hex << std::setw(4) << std::setfill('0') << address << " exceeds the 64k address space.";
+                addError(moduleIdx, strm.str());
+            }
+        }
+    }
+
+    for (size_t moduleIdx = 0; moduleIdx < modules.size(); moduleIdx++)
+    {
+        for (auto const &section : modules[moduleIdx].module.relocatableSections)
+        {
+            modules[moduleIdx].sectionBases.push_back(placeSection(moduleIdx, section));
+        }
+    }
+}
+
+// first fit, O(number of occupied ranges of the segment)
+auto Linker::placeSection(size_t moduleIdx, RelocatableSection const &section) -> uint32_t
+{
+    uint32_t ret = 0;
+    auto segment = segments.find(section.segment);
+    std::optional<uint32_t> optAddress = std::nullopt;
+
+    if (segment == end(segments))
+    {
+        addError(moduleIdx, "Segment \"" + section.segment + "\" is not defined.");
+    }
+    else if ((optAddress = occupied.findFirstFit(segment->second.start, segment->second.end, section.size)) == std::nullopt)
+    {
+        std::stringstream strm;
+        strm << "A section of " << section.size << " byte(s) does not fit into segment \"" << section.segment << "\".";
+        addError(moduleIdx, strm.str());
+    }
+    else
+    {
+        ret = optAddress.value();
+        occupied.insert(ret, ret + section.size);
+    }
+
+    return ret;
+}
+
+void Linker::collectExports()
+{
+    for (size_t moduleIdx = 0; moduleIdx < modules.size(); moduleIdx++)
+    {
+        for (auto const &symbol : modules[moduleIdx].module.symbols)
+        {
+            localSymbols[{moduleIdx, symbol.name}] = &symbol;
+
+            if (symbol.exported)
+            {
+                auto pos = exports.find(symbol.name);
+
+                if (pos == end(exports))
+                {
+                    exports[symbol.name] = {moduleIdx, &symbol};
+                }
+                else
+                {
+                    addError(moduleIdx, symbol.fileId, symbol.line, symbol.col,
+                             "Symbol \"" + symbol.name + "\" is exported by " + modules[pos->second.first].name + " already.");
+                }
+            }
+        }
+    }
+
+    for (auto const &exported : exports)
+    {
+        std::optional<uint32_t> optVal = evaluateSymbol(exported.second.first, *exported.second.second);
+        ObjectSymbol const &symbol = *exported.second.second;
+
+        if (optVal != std::nullopt)
+        {
+            status.symbols.addSymbol(symbol.name, symbol.line, symbol.col, optVal.value());
+        }
+        else
+        {
+            addError(exported.second.first, symbol.fileId, symbol.line, symbol.col, "Symbol \"" + symbol.name + "\" could not be resolved.");
+        }
+    }
+}
+
+// the sections have been placed without overlaps
+void Linker::copySections()
+{
+    for (auto const &entry : modules)
+    {
+        for (auto const &section : entry.module.sections)
+        {
+            for (uint32_t idx = 0; idx < section.getLengthBytes(); idx++)
+            {
+                payload[section.getStartAddress() + idx] = section.getByteAt(idx);
+            }
+        }
+
+        for (size_t sectionIdx = 0; sectionIdx < entry.module.relocatableSections.size(); sectionIdx++)
+        {
+            std::vector<uint8_t> const &bytes = entry.module.relocatableSections[sectionIdx].bytes;
+
+            for (size_t idx = 0; idx < bytes.size(); idx++)
+            {
+                payload[entry.sectionBases[sectionIdx] + static_cast<uint32_t>(idx)] = bytes[idx];
+            }
+        }
+    }
+}
+
+void Linker::applyPatches()
+{
+    for (size_t moduleIdx = 0; moduleIdx < modules.size(); moduleIdx++)
+    {
+        ModuleEntry const &entry = modules[moduleIdx];
+        auto lookup = [this, moduleIdx](std::string const &symName) { return resolveSymbol(moduleIdx, symName); };
+
+        for (auto const &patch : entry.module.patches)
+        {
+            bool absolute = (patch.section == ABSOLUTE_SECTION) || (patch.section >= entry.sectionBases.size());
+            uint32_t address = (absolute ? 0 : entry.sectionBases[patch.section]) + patch.address;
+            std::optional<uint32_t> optVal = evalPostfix(patch.expr, entry.sectionBases, lookup);
+
+            if (optVal == std::nullopt)
+            {
+                std::vector<std::string> missing = getPostfixSymbols(patch.expr);
+                missing.erase(std::remove_if(begin(missing), end(missing),
+                    [&lookup](std::string const &symName) { return lookup(symName) != std::nullopt; }), end(missing));
+
+                addError(moduleIdx, patch.fileId, patch.line, patch.col,
+                         missing.empty() ? "Expression could not be evaluated." : "Symbol \"" + missing.front() + "\" could not be resolved.");
+            }
+            else
+            {
+                applyPatch(moduleIdx, patch, address, optVal.value());
+            }
+        }
+    }
+}
+
+void Linker::applyPatch(size_t moduleIdx, ObjectPatch const &patch, uint32_t address, uint32_t val)
+{
+    auto relOffset = static_cast<int32_t>(val - (address + 1));
+    std::stringstream strm;
+
+    switch (patch.kind)
+    {
+        case PatchKind::Byte:
+            if (val > 0xffU)
+            {
+                strm << "Value \"" << val << "\" is out of its supported value range: [0,255].";
+            }
+            else
+            {
+                payload[address] = static_cast<uint8_t>(val);
+            }
+            break;
+
+        case PatchKind::Word:
+        case PatchKind::DByte:
+            if (val > 0xffffU)
+            {
+                strm << "Value \"" << val << "\" is out of its supported value range: [0,65535].";
+            }
+            else
+            {
+                payload[address] = static_cast<uint8_t>((patch.kind == PatchKind::Word) ? (val & 0xffU) : (val >> 8U));
+                payload[address + 1] = static_cast<uint8_t>((patch.kind == PatchKind::Word) ? (val >> 8U) : (val & 0xffU));
+            }
+            break;
+
+        case PatchKind::Relative:
+            if ((relOffset < -128) || (relOffset > 127))
+            {
+                strm
+                    << "Branch at address 0x" << std::hex << std::setfill('0') << (address + 1)
+                    << " is too far away from the branch target at address 0x" << val << ".";
+            }
+            else
+            {
+                payload[address] = static_cast<uint8_t>(relOffset & 0xff);
+            }
+            break;
+    }
+
+    if (!strm.str().empty())
+    {
+        addError(moduleIdx, patch.fileId, patch.line, patch.col, strm.str());
+    }
+}
+
+auto Linker::resolveSymbol(size_t moduleIdx, std::string const &symName) -> std::optional<uint32_t>
+{
+    std::optional<uint32_t> ret = std::nullopt;
+    auto local = localSymbols.find({moduleIdx, symName});
+
+    if (local != end(localSymbols))
+    {
+        ret = evaluateSymbol(moduleIdx, *local->second);
+    }
+    else
+    {
+        auto exported = exports.find(symName);
+
+        if (exported != end(exports))
+        {
+            ret = evaluateSymbol(exported->second.first, *exported->second.second);
+        }
+    }
+
+    return ret;
+}
+
+// symbols may refer to other symbols, a symbol referring to itself is not resolved
+auto Linker::evaluateSymbol(size_t moduleIdx, ObjectSymbol const &symbol) -> std::optional<uint32_t>
+{
+    std::pair<size_t, std::string> key{moduleIdx, symbol.name};
+    auto pos = values.find(key);
+
+    if (pos == end(values))
+    {
+        values[key] = std::nullopt;
+        values[key] = evalPostfix(symbol.expr, modules[moduleIdx].sectionBases,
+            [this, moduleIdx](std::string const &symName) { return resolveSymbol(moduleIdx, symName); });
+        pos = values.find(key);
+    }
+
+    return pos->second;
+}
+
+void Linker::addError(size_t moduleIdx, std::string const &msg)
+{
+    status.errors.push_back(modules[moduleIdx].name + ": error: " + msg);
+}
+
+void Linker::addError(size_t moduleIdx, size_t fileId, size_t line, size_t col, std::string const &msg)
+{
+    ObjectModule const &module = modules[moduleIdx].module;
+    std::string file = (fileId < module.sourceFiles.size()) ? module.sourceFiles[fileId] : modules[moduleIdx].name;
+
+    std::stringstream strm;
+    strm << file << ":" << line << ":" << col << ": error: " << msg;
+    status.errors.push_back(strm.str());
+}
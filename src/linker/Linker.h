@@ -0,0 +1,85 @@
+#ifndef LINKER_H
+#define LINKER_H
+
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ObjectModule.h"
+#include "listener/IntervalIndex.h"
+#include "listener/MemBlocks.h"
+#include "listener/SymbolTable.h"
+
+namespace asm6502
+{
+
+class LinkStatus
+{
+public:
+    std::vector<std::string> errors;
+    MemBlocks linkedProgram;
+    SymbolTable symbols;                // the exported symbols
+    std::vector<std::vector<uint32_t>> sectionBases;  // per module, where its relocatable sections have been placed
+};
+
+// named address range [start, end) relocatable sections are placed in
+class Segment
+{
+public:
+    std::string name;
+    uint32_t start;
+    uint32_t end;
+};
+
+// Places the absolute sections of all modules at their addresses, then each relocatable
+// section at the lowest free address of its segment, in the given order of the modules,
+// and fills in the patches of all modules. The symbols a patch refers to are looked up
+// in its own module first, then in the symbols exported by all modules.
+// The segments CODE, DATA and BSS span from baseAddress to the end of memory, ZEROPAGE
+// spans the zero page without the processor port, unless they are added.
+class Linker
+{
+public:
+    explicit Linker(uint32_t baseAddress_) : baseAddress{baseAddress_} {}
+
+    void addSegment(Segment const &segment) { segments[segment.name] = segment; }
+    // name identifies the module in error messages, e.g. its object file
+    void addModule(ObjectModule const &module, std::string const &name);
+    auto link() -> LinkStatus;
+
+private:
+    class ModuleEntry
+    {
+    public:
+        ObjectModule module;
+        std::string name;
+        std::vector<uint32_t> sectionBases;
+    };
+
+    auto resolveSymbol(size_t moduleIdx, std::string const &symName) -> std::optional<uint32_t>;
+    auto evaluateSymbol(size_t moduleIdx, ObjectSymbol const &symbol) -> std::optional<uint32_t>;
+    void placeSections();
+    auto placeSection(size_t moduleIdx, RelocatableSection const &section) -> uint32_t;
+    void collectExports();
+    void copySections();
+    void applyPatches();
+    void applyPatch(size_t moduleIdx, ObjectPatch const &patch, uint32_t address, uint32_t val);
+    void addError(size_t moduleIdx, std::string const &msg);
+    void addError(size_t moduleIdx, size_t fileId, size_t line, size_t col, std::string const &msg);
+
+    uint32_t baseAddress;
+    std::map<std::string, Segment> segments;
+    std::vector<ModuleEntry> modules;
+    IntervalIndex occupied;                                                     // by the placed sections
+    std::map<std::string, std::pair<size_t, ObjectSymbol const *>> exports;    // to module index and symbol
+    std::map<std::pair<size_t, std::string>, std::optional<uint32_t>> values;  // evaluated symbols per module, nullopt while in evaluation
+    std::map<std::pair<size_t, std::string>, ObjectSymbol const *> localSymbols;
+    std::map<uint32_t, uint8_t> payload;
+    LinkStatus status;
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,266 @@
+#include <iterator>
+
+#include "ObjectModule.h"
+#include "listener/BinaryIO.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+std::string const OBJECT_MAGIC = "A65OBJ";
+uint8_t const OBJECT_VERSION = 2;
+
+// left-associative expressions of any length need 2 entries
+size_t const EVAL_STACK_CAPACITY = 16;
+
+void writeExpression(std::ostream &os, PostfixExpression const &expr)
+{
+    writeNumber(os, static_cast<uint32_t>(expr.size()), 2);
+
+    for (auto const &item : expr)
+    {
+        os.put(static_cast<char>(item.op));
+
+        if ((item.op == PostfixOp::Value) || (item.op == PostfixOp::SectionBase))
+        {
+            writeNumber(os, item.value, 4);
+        }
+        else if (item.op == PostfixOp::Symbol)
+        {
+            writeString(os, item.symbol);
+        }
+    }
+}
+
+auto readExpression(BinaryReader &reader) -> PostfixExpression
+{
+    PostfixExpression ret;
+    uint32_t numItems = reader.readNumber(2);
+
+    for (uint32_t idx = 0; !reader.hasFailed() && (idx < numItems); idx++)
+    {
+        uint32_t op = reader.readNumber(1);
+        if (op > static_cast<uint32_t>(PostfixOp::Hi))
+        {
+            reader.fail();
+        }
+
+        PostfixItem item{static_cast<PostfixOp>(op), 0, ""};
+        item.value = ((item.op == PostfixOp::Value) || (item.op == PostfixOp::SectionBase)) ? reader.readNumber(4) : 0;
+        item.symbol = (item.op == PostfixOp::Symbol) ? reader.readString() : "";
+        ret.push_back(item);
+    }
+
+    return ret;
+}
+
+}
+
+auto asm6502::evalPostfix(PostfixExpression const &expr, std::vector<uint32_t> const &sectionBases, std::function<std::optional<uint32_t>(std::string const &)> const &lookup) -> std::optional<uint32_t>
+{
+    ScratchBuffer<uint32_t> stack{EVAL_STACK_CAPACITY};
+    return evalPostfix(expr.data(), expr.data() + expr.size(), sectionBases, lookup, stack);
+}
+
+auto asm6502::evalPostfix(PostfixItem const *first, PostfixItem const *last, std::vector<uint32_t> const &sectionBases, std::function<std::optional<uint32_t>(std::string const &)> const &lookup,
+                          ScratchBuffer<uint32_t> &stack) -> std::optional<uint32_t>
+{
+    bool valid = true;
+    stack.clear();
+
+    for (auto item = first; valid && (item != last); ++item)
+    {
+        switch (item->op)
+        {
+            case PostfixOp::Value:
+                stack.push_back(item->value);
+                break;
+
+            case PostfixOp::SectionBase:
+                valid = (item->value < sectionBases.size());
+                stack.push_back(valid ? sectionBases[item->value] : 0);
+                break;
+
+            case PostfixOp::Symbol:
+            {
+                std::optional<uint32_t> optVal = lookup(item->symbol);
+                valid = (optVal != std::nullopt);
+                stack.push_back(optVal.value_or(0));
+                break;
+            }
+
+            case PostfixOp::Lo:
+            case PostfixOp::Hi:
+                valid = !stack.empty();
+                if (valid)
+                {
+                    stack.back() = (item->op == PostfixOp::Lo) ? (stack.back() & 0xffU) : ((stack.back() >> 8U) & 0xffU);
+                }
+                break;
+
+            default:
+            {
+                valid = (stack.size() >= 2);
+                uint32_t arg2 = valid ? stack.back() : 0;
+                valid = valid && !(((item->op == PostfixOp::Div) || (item->op == PostfixOp::Mod)) && (arg2 == 0));
+
+                if (valid)
+                {
+                    stack.pop_back();
+                    uint32_t &arg1 = stack.back();
+
+                    switch (item->op)
+                    {
+                        case PostfixOp::Add: arg1 += arg2; break;
+                        case PostfixOp::Sub: arg1 -= arg2; break;
+                        case PostfixOp::Mul: arg1 *= arg2; break;
+                        case PostfixOp::Div: arg1 /= arg2; break;
+                        default:             arg1 %= arg2; break;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    return (valid && (stack.size() == 1)) ? std::optional<uint32_t>(stack.back()) : std::nullopt;
+}
+
+auto asm6502::getPostfixSymbols(PostfixExpression const &expr) -> std::vector<std::string>
+{
+    std::vector<std::string> ret;
+
+    for (auto const &item : expr)
+    {
+        if (item.op == PostfixOp::Symbol)
+        {
+            ret.push_back(item.symbol);
+        }
+    }
+
+    return ret;
+}
+
+void asm6502::writeObjectModule(std::ostream &os, ObjectModule const &module)
+{
+    os << OBJECT_MAGIC;
+    os.put(static_cast<char>(OBJECT_VERSION));
+
+    writeNumber(os, static_cast<uint32_t>(module.sourceFiles.size()), 4);
+    for (auto const &sourceFile : module.sourceFiles)
+    {
+        writeString(os, sourceFile);
+    }
+
+    writeNumber(os, static_cast<uint32_t>(module.sections.size()), 4);
+    for (auto const &section : module.sections)
+    {
+        writeNumber(os, section.getStartAddress(), 4);
+        writeNumber(os, section.getLengthBytes(), 4);
+
+        for (uint32_t idx = 0; idx < section.getLengthBytes(); idx++)
+        {
+            os.put(static_cast<char>(section.getByteAt(idx)));
+        }
+    }
+
+    writeNumber(os, static_cast<uint32_t>(module.relocatableSections.size()), 4);
+    for (auto const &section : module.relocatableSections)
+    {
+        writeString(os, section.segment);
+        writeNumber(os, section.size, 4);
+        writeNumber(os, static_cast<uint32_t>(section.bytes.size()), 4);
+        os.write(reinterpret_cast<char const *>(section.bytes.data()), static_cast<std::streamsize>(section.bytes.size()));
+    }
+
+    writeNumber(os, static_cast<uint32_t>(module.symbols.size()), 4);
+    for (auto const &symbol : module.symbols)
+    {
+        writeString(os, symbol.name);
+        writeExpression(os, symbol.expr);
+        os.put(static_cast<char>(symbol.exported ? 1 : 0));
+        writeNumber(os, static_cast<uint32_t>(symbol.fileId), 4);
+        writeNumber(os, static_cast<uint32_t>(symbol.line), 4);
+        writeNumber(os, static_cast<uint32_t>(symbol.col), 4);
+    }
+
+    writeNumber(os, static_cast<uint32_t>(module.patches.size()), 4);
+    for (auto const &patch : module.patches)
+    {
+        os.put(static_cast<char>(patch.kind));
+        writeNumber(os, patch.section, 4);
+        writeNumber(os, patch.address, 4);
+        writeExpression(os, patch.expr);
+        writeNumber(os, static_cast<uint32_t>(patch.fileId), 4);
+        writeNumber(os, static_cast<uint32_t>(patch.line), 4);
+        writeNumber(os, static_cast<uint32_t>(patch.col), 4);
+    }
+}
+
+auto asm6502::readObjectModule(std::istream &is) -> std::optional<ObjectModule>
+{
+    std::vector<char> data{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+    BinaryReader reader(data);
+    ObjectModule module;
+
+    bool valid = (reader.readString(OBJECT_MAGIC.length()) == OBJECT_MAGIC) && (reader.readNumber(1) == OBJECT_VERSION);
+
+    uint32_t numSourceFiles = reader.readNumber(4);
+    for (uint32_t idx = 0; valid && !reader.hasFailed() && (idx < numSourceFiles); idx++)
+    {
+        module.sourceFiles.push_back(reader.readString());
+    }
+
+    uint32_t numSections = reader.readNumber(4);
+    for (uint32_t idx = 0; valid && !reader.hasFailed() && (idx < numSections); idx++)
+    {
+        uint32_t address = reader.readNumber(4);
+        std::vector<uint8_t> bytes = reader.readBytes(reader.readNumber(4));
+        module.sections.emplace_back(MemBlock(address, bytes));
+    }
+
+    uint32_t numRelocatableSections = reader.readNumber(4);
+    for (uint32_t idx = 0; valid && !reader.hasFailed() && (idx < numRelocatableSections); idx++)
+    {
+        RelocatableSection section;
+        section.segment = reader.readString();
+        section.size = reader.readNumber(4);
+        section.bytes = reader.readBytes(reader.readNumber(4));
+        valid = (section.bytes.size() <= section.size);
+        module.relocatableSections.push_back(section);
+    }
+
+    uint32_t numSymbols = reader.readNumber(4);
+    for (uint32_t idx = 0; valid && !reader.hasFailed() && (idx < numSymbols); idx++)
+    {
+        ObjectSymbol symbol;
+        symbol.name = reader.readString();
+        symbol.expr = readExpression(reader);
+        symbol.exported = ((reader.readNumber(1) & 1U) != 0);
+        symbol.fileId = reader.readNumber(4);
+        symbol.line = reader.readNumber(4);
+        symbol.col = reader.readNumber(4);
+        module.symbols.push_back(symbol);
+    }
+
+    uint32_t numPatches = reader.readNumber(4);
+    for (uint32_t idx = 0; valid && !reader.hasFailed() && (idx < numPatches); idx++)
+    {
+        ObjectPatch patch;
+        uint32_t kind = reader.readNumber(1);
+        valid = (kind <= static_cast<uint32_t>(PatchKind::Relative));
+        patch.kind = static_cast<PatchKind>(kind);
+        patch.section = reader.readNumber(4);
+        patch.address = reader.readNumber(4);
+        patch.expr = readExpression(reader);
+        patch.fileId = reader.readNumber(4);
+        patch.line = reader.readNumber(4);
+        patch.col = reader.readNumber(4);
+        module.patches.push_back(patch);
+    }
+
+    valid = valid && !reader.hasFailed() && reader.isAtEnd();
+
+    return valid ? std::optional<ObjectModule>(module) : std::nullopt;
+}
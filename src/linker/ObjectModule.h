@@ -0,0 +1,126 @@
+#ifndef OBJECT_MODULE_H
+#define OBJECT_MODULE_H
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "listener/MemBlocks.h"
+#include "listener/ScratchBuffer.h"
+
+namespace asm6502
+{
+
+// Expressions that could not be evaluated by the assembler, in postfix order
+enum class PostfixOp : uint8_t
+{
+    Value,          // pushes value
+    Symbol,         // pushes the value of symbol, known to the linker
+    SectionBase,    // pushes the address the linker placed the relocatable section with index value at
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Lo,
+    Hi
+};
+
+class PostfixItem
+{
+public:
+    PostfixOp op;
+    uint32_t value;
+    std::string symbol;
+};
+
+typedef std::vector<PostfixItem> PostfixExpression;
+
+// nullopt if a symbol is not known or the expression is malformed
+auto evalPostfix(PostfixExpression const &expr, std::vector<uint32_t> const &sectionBases, std::function<std::optional<uint32_t>(std::string const &)> const &lookup) -> std::optional<uint32_t>;
+// the same for the items [first, last), e.g. a part of the expressions of a line, on a stack
+// reused by the evaluations
+auto evalPostfix(PostfixItem const *first, PostfixItem const *last, std::vector<uint32_t> const &sectionBases, std::function<std::optional<uint32_t>(std::string const &)> const &lookup,
+                 ScratchBuffer<uint32_t> &stack) -> std::optional<uint32_t>;
+
+// the symbols of an expression which are left to the linker
+auto getPostfixSymbols(PostfixExpression const &expr) -> std::vector<std::string>;
+
+// how the linker stores the value of a patch
+enum class PatchKind : uint8_t
+{
+    Byte,
+    Word,       // little endian
+    DByte,      // big endian
+    Relative    // branch offset to the value, from the address after the patched byte
+};
+
+// a symbol defined by the module whose value is left to the linker
+class ObjectSymbol
+{
+public:
+    std::string name;
+    PostfixExpression expr;
+    bool exported;      // visible to the other modules, otherwise only used by the patches of its own module
+    size_t fileId;      // index into ObjectModule::sourceFiles
+    size_t line;
+    size_t col;
+};
+
+// section index of absolute addresses
+uint32_t const ABSOLUTE_SECTION = 0xffffffffU;
+
+// bytes at address to be filled in by the linker
+class ObjectPatch
+{
+public:
+    PatchKind kind;
+    uint32_t section;   // index into ObjectModule::relocatableSections, or ABSOLUTE_SECTION
+    uint32_t address;   // offset into the section
+    PostfixExpression expr;
+    size_t fileId;
+    size_t line;
+    size_t col;
+};
+
+// Code and data of a segment, placed by the linker. Space reserved by .RES at the end of
+// a section has no bytes, e.g. a section of variables in the BSS segment has no bytes at all.
+class RelocatableSection
+{
+public:
+    std::string segment;
+    uint32_t size;
+    std::vector<uint8_t> bytes;     // from offset 0 on, up to size bytes
+};
+
+// The result of assembling a source file as object: its code and data, the symbols
+// it exports and the patches for operands referring to other modules or to its own
+// relocatable labels. Code after .ORG is absolute, code after .SEGMENT or before
+// the first .ORG is relocatable.
+class ObjectModule
+{
+public:
+    std::vector<MemBlock> sections;         // absolute code and data
+    std::vector<RelocatableSection> relocatableSections;
+    std::vector<ObjectSymbol> symbols;
+    std::vector<ObjectPatch> patches;
+    std::vector<std::string> sourceFiles;   // the assembled file first, then its included files
+};
+
+// Compact binary format, all numbers little endian, strings with a 2 byte length:
+//   "A65OBJ", version byte,
+//   source files: count (4 bytes), names,
+//   sections: count (4 bytes), per section address (4 bytes), length (4 bytes), bytes,
+//   relocatable sections: count (4 bytes), per section segment name, size (4 bytes), length (4 bytes), bytes,
+//   symbols: count (4 bytes), per symbol name, expression, flags byte (bit 0: exported), file, line, column (4 bytes each),
+//   patches: count (4 bytes), per patch kind byte, section, address (4 bytes each), expression, file, line, column (4 bytes each)
+// Expressions are stored as number of items (2 bytes), per item op byte, then a value or section index (4 bytes) or symbol name
+void writeObjectModule(std::ostream &os, ObjectModule const &module);
+auto readObjectModule(std::istream &is) -> std::optional<ObjectModule>;
+
+} // namespace
+
+#endif
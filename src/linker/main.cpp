@@ -0,0 +1,211 @@
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ASM6502.h"
+#include "getopt.hpp"
+#include "linker/Linker.h"
+
+using namespace std;
+using namespace asm6502;
+
+static int const RET_OK = 0;
+static int const RET_ERR = 1;
+
+static uint32_t const DEFAULT_BASE_ADDRESS = 0xC000;
+
+void usage(char const *argv0)
+{
+    cerr
+        << "Usage: " << endl
+        << argv0 << " <objfile>... [-o <progfile>] [-b <base>] [-s <name>=<first>-<last>]... [-a]" << endl
+        << "    -o <progfile>: write the linked machine code into a progfile (C64 .PRG)" << endl
+        << "    -b <base>: start of the default segments CODE, DATA and BSS, hex ($c000) or decimal" << endl
+        << "    -s <name>=<first>-<last>: place the sections of segment <name> from address <first> up to <last>" << endl
+        << "    -a: output the linked machine code bytes and the exported symbols" << endl;
+}
+
+// 8 bytes per line, prefixed with their address
+static void printMachineCode(MemBlocks const &memBlocks)
+{
+    for (uint32_t blockIdx = 0; blockIdx < memBlocks.getNumMemBlocks(); blockIdx++)
+    {
+        MemBlock const &memBlock = memBlocks.getMemBlockAt(blockIdx);
+
+        for (uint32_t idx = 0; idx < memBlock.getLengthBytes(); idx++)
+        {
+            if ((idx % 8) == 0)
+            {
+                cout << ((idx == 0) ? "" : "\n") << std::hex << std::setw(4) << std::setfill('0') << (memBlock.getStartAddress() + idx) << ":";
+            }
+            cout << " " << std::setw(2) << static_cast<uint32_t>(memBlock.getByteAt(idx));
+        }
+        cout << std::dec << std::endl;
+    }
+}
+
+static auto parseAddress(std::string const &address) -> std::optional<uint32_t>
+{
+    std::stringstream ss;
+    uint32_t ret = 0;
+
+    if (!address.empty() && (address[0] == '$'))
+    {
+        ss << std::hex << address.substr(1);
+    }
+    else
+    {
+        ss << address;
+    }
+
+    return ((ss >> ret) && ss.eof() && (ret <= 0xffff)) ? std::optional<uint32_t>(ret) : std::nullopt;
+}
+
+// name=first-last, the addresses as accepted by parseAddress
+static auto parseSegment(std::string const &segment) -> std::optional<Segment>
+{
+    std::optional<Segment> ret = std::nullopt;
+    size_t equalsPos = segment.find('=');
+    size_t dashPos = segment.find('-', equalsPos);
+
+    if ((equalsPos != std::string::npos) && (equalsPos > 0) && (dashPos != std::string::npos))
+    {
+        std::optional<uint32_t> optFirst = parseAddress(segment.substr(equalsPos + 1, dashPos - equalsPos - 1));
+        std::optional<uint32_t> optLast = parseAddress(segment.substr(dashPos + 1));
+
+        if ((optFirst != std::nullopt) && (optLast != std::nullopt) && (optFirst.value() <= optLast.value()))
+        {
+            ret = Segment{segment.substr(0, equalsPos), optFirst.value(), optLast.value() + 1};
+        }
+    }
+
+    return ret;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    int ret = RET_OK;
+
+    bool machineCodeOut = false;
+    std::string progFilePath = "";
+    uint32_t baseAddress = DEFAULT_BASE_ADDRESS;
+    std::vector<std::string> objectFilePaths;
+    std::vector<Segment> segments;
+
+    auto options = get_opt::getopt(argc, argv, "o:b:s:a");
+    for (auto const &option : options)
+    {
+        switch(option.opt)
+        {
+            case 'o':
+                progFilePath = option.optarg;
+                break;
+            case 'b':
+            {
+                std::optional<uint32_t> optBase = parseAddress(option.optarg);
+                if (optBase != std::nullopt)
+                {
+                    baseAddress = optBase.value();
+                }
+                else
+                {
+                    cerr << "Invalid base address: " << option.optarg << std::endl;
+                    ret = RET_ERR;
+                }
+                break;
+            }
+            case 's':
+            {
+                std::optional<Segment> optSegment = parseSegment(option.optarg);
+                if (optSegment != std::nullopt)
+                {
+                    segments.push_back(optSegment.value());
+                }
+                else
+                {
+                    cerr << "Invalid segment: " << option.optarg << std::endl;
+                    ret = RET_ERR;
+                }
+                break;
+            }
+            case 'a':
+                machineCodeOut = true;
+                break;
+            case '!': // no preceding dash
+                objectFilePaths.push_back(option.optarg);
+                break;
+            case '?':
+                usage(argv[0]);
+                ret = RET_ERR;
+                break;
+
+            default:
+                assert(0);
+        }
+    }
+
+    if ((ret == RET_OK) && objectFilePaths.empty())
+    {
+        usage(argv[0]);
+        ret = RET_ERR;
+    }
+
+    Linker linker(baseAddress);
+
+    for (auto const &segment : segments)
+    {
+        linker.addSegment(segment);
+    }
+
+    for (auto const &objectFilePath : (ret == RET_OK) ? objectFilePaths : std::vector<std::string>())
+    {
+        std::optional<ObjectModule> optModule = readObjectFile(objectFilePath.c_str());
+        if (optModule != std::nullopt)
+        {
+            linker.addModule(optModule.value(), objectFilePath);
+        }
+        else
+        {
+            cerr << "Could not read object file: " << objectFilePath << std::endl;
+            ret = RET_ERR;
+        }
+    }
+
+    if (ret == RET_OK)
+    {
+        LinkStatus linkStatus = linker.link();
+
+        if (linkStatus.errors.empty())
+        {
+            if (machineCodeOut)
+            {
+                cout << "--- 6502 Machine Code ---" << std::endl;
+                printMachineCode(linkStatus.linkedProgram);
+                cout << "--- Exported Symbols ---" << std::endl;
+                for (auto const &sym : linkStatus.symbols.getSymbols())
+                {
+                    cout << sym.first << " = $" << std::hex << sym.second.val << std::dec << std::endl;
+                }
+            }
+
+            if (!progFilePath.empty())
+            {
+                writeProgFile(progFilePath.c_str(), linkStatus.linkedProgram);
+            }
+        }
+        else
+        {
+            for (auto const &errMsg : linkStatus.errors)
+            {
+                cerr << errMsg << std::endl;
+            }
+            ret = RET_ERR;
+        }
+    }
+
+    return ret;
+}
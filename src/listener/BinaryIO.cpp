@@ -0,0 +1,75 @@
+#include "BinaryIO.h"
+
+using namespace asm6502;
+
+void asm6502::writeNumber(std::ostream &os, uint32_t value, size_t numberOfBytes)
+{
+    for (size_t idx = 0; idx < numberOfBytes; idx++)
+    {
+        os.put(static_cast<char>((value >> (8U * idx)) & 0xffU));
+    }
+}
+
+void asm6502::writeString(std::ostream &os, std::string const &str)
+{
+    writeNumber(os, static_cast<uint32_t>(str.length()), 2);
+    os << str;
+}
+
+auto BinaryReader::readNumber(size_t numberOfBytes) -> uint32_t
+{
+    uint32_t ret = 0;
+
+    if (pos + numberOfBytes <= data.size())
+    {
+        for (size_t idx = 0; idx < numberOfBytes; idx++)
+        {
+            ret |= static_cast<uint32_t>(static_cast<uint8_t>(data[pos++])) << (8U * idx);
+        }
+    }
+    else
+    {
+        failed = true;
+    }
+
+    return ret;
+}
+
+auto BinaryReader::readBytes(size_t length) -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> ret;
+
+    if (pos + length <= data.size())
+    {
+        ret.assign(data.data() + pos, data.data() + pos + length);
+        pos += length;
+    }
+    else
+    {
+        failed = true;
+    }
+
+    return ret;
+}
+
+auto BinaryReader::readString(size_t length) -> std::string
+{
+    std::string ret;
+
+    if (pos + length <= data.size())
+    {
+        ret.assign(data.data() + pos, length);
+        pos += length;
+    }
+    else
+    {
+        failed = true;
+    }
+
+    return ret;
+}
+
+auto BinaryReader::readString() -> std::string
+{
+    return readString(readNumber(2));
+}
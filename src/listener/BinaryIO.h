@@ -0,0 +1,43 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace asm6502
+{
+
+// little endian numbers and strings prefixed with their 2 byte length, the format of the
+// object modules, symbol snapshots and debug info files
+void writeNumber(std::ostream &os, uint32_t value, size_t numberOfBytes);
+void writeString(std::ostream &os, std::string const &str);
+
+// reads from a buffer with bounds checking, once out of data all reads fail
+class BinaryReader
+{
+public:
+    explicit BinaryReader(std::vector<char> const &data_) : data{data_}, pos{0}, failed{false} {}
+
+    auto readNumber(size_t numberOfBytes) -> uint32_t;
+    auto readBytes(size_t length) -> std::vector<uint8_t>;
+    auto readString(size_t length) -> std::string;
+    auto readString() -> std::string; // written by writeString
+
+    // content read successfully but not valid, e.g. an unknown enum value
+    void fail() { failed = true; }
+
+    auto hasFailed() const -> bool { return failed; }
+    auto isAtEnd() const -> bool { return pos == data.size(); }
+
+private:
+    std::vector<char> const &data;
+    size_t pos;
+    bool failed;
+};
+
+}
+
+#endif
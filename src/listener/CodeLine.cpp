@@ -2,10 +2,14 @@
 #include <iostream>
 
 #include "CodeLine.h"
+#include "MacroTokenSource.h"
 #include "MemBlocks.h"
 
 using namespace asm6502;
 
+// number of bytes listed for summarized lines
+static uint32_t const SUMMARY_BYTES = 8;
+
 // private helper class to get all terminal nodes of a given production rule
 class TerminalNodeVisitor : public antlr4::tree::ParseTreeVisitor
 {
@@ -28,17 +32,23 @@ private:
     auto visitTerminal(antlr4::tree::TerminalNode *node) -> std::any override { return 0; }
     auto visitErrorNode(antlr4::tree::ErrorNode *node) -> std::any override { return 0; }
 
+    // with an explicit stack, long expressions are deep trees
     auto visitChildren(antlr4::tree::ParseTree *node) -> std::any override
     {
-        if (node->children.empty())
-        {
-            terminalNodes.push_back(node);
-        }
-        else
+        std::vector<antlr4::tree::ParseTree *> pending{node};
+
+        while (!pending.empty())
         {
-            for (antlr4::tree::ParseTree *child : node->children)
+            antlr4::tree::ParseTree *next = pending.back();
+            pending.pop_back();
+
+            if (next->children.empty())
+            {
+                terminalNodes.push_back(next);
+            }
+            else
             {
-                visitChildren(child);
+                pending.insert(end(pending), next->children.rbegin(), next->children.rend());
             }
         }
 
@@ -64,8 +74,11 @@ auto CodeLine::get(asm6502::MemBlocks const &mb, bool addAssembly) const -> std:
             column++;
         }
 
-        strm << label;
-        column += label.length();
+        if (!label.empty())
+        {
+            strm << label << ":";
+            column += label.length() + 1;
+        }
 
         while (column < 36)
         {
@@ -74,6 +87,16 @@ auto CodeLine::get(asm6502::MemBlocks const &mb, bool addAssembly) const -> std:
         }
 
         strm << assembly;
+
+        if (!macroName.empty())
+        {
+            strm << "    ; expanded from " << macroName;
+        }
+
+        if (!replacedMnemonic.empty())
+        {
+            strm << "    ; optimized from " << replacedMnemonic;
+        }
     }
 
     strm << std::endl;
@@ -81,6 +104,14 @@ auto CodeLine::get(asm6502::MemBlocks const &mb, bool addAssembly) const -> std:
 }
 
 
+void CodeLine::replaceMnemonic(std::string const &mnemonic)
+{
+    // statements start with their mnemonic, the label is kept apart
+    size_t end = assembly.find(' ');
+    replacedMnemonic = assembly.substr(0, end);
+    assembly = mnemonic + ((end != std::string::npos) ? assembly.substr(end) : "");
+}
+
 auto CodeLine::getMachineCode(MemBlocks const &mb) const -> std::string
 {
     std::stringstream strm;
@@ -89,7 +120,8 @@ auto CodeLine::getMachineCode(MemBlocks const &mb) const -> std::string
     {
         strm << "0x" << std::hex << std::setw(4) << std::setfill('0') << startAddress << ":";
 
-        uint32_t lastByteAddr = startAddress + (lengthBytes - 1);
+        bool isShortened = summarized && (lengthBytes > SUMMARY_BYTES);
+        uint32_t lastByteAddr = startAddress + ((isShortened ? SUMMARY_BYTES : lengthBytes) - 1);
 
         for (uint32_t addr = startAddress; addr < lastByteAddr; addr++)
         {
@@ -97,19 +129,25 @@ auto CodeLine::getMachineCode(MemBlocks const &mb) const -> std::string
         }
 
         strm << "0x" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(mb.getByteAt(lastByteAddr));
+
+        if (isShortened)
+        {
+            strm << ",... (" << std::dec << lengthBytes << " bytes)";
+        }
+
         strm << " ";
     }
 
     return strm.str();
 }
 
-auto CodeLine::getLabel(MOS6502Parser::LineContext *ctx) -> std::string
+auto CodeLine::extractLabel(MOS6502Parser::LineContext *ctx) -> std::string
 {
     MOS6502Parser::LabelContext *labelCtx = ctx->label();
-    return labelCtx != nullptr ? labelCtx->getText() : "";
+    return labelCtx != nullptr ? labelCtx->ID()->getText() : "";
 }
 
-auto CodeLine::getAssembly(MOS6502Parser::LineContext *ctx) -> std::string
+auto CodeLine::extractAssembly(MOS6502Parser::LineContext *ctx) -> std::string
 {
     antlr4::RuleContext *dirOrStatementCtx = (ctx->directive() != nullptr) ? 
         static_cast<antlr4::RuleContext *>(ctx->directive()) : 
@@ -118,6 +156,21 @@ auto CodeLine::getAssembly(MOS6502Parser::LineContext *ctx) -> std::string
     return prettyPrintDirOrStatement(dirOrStatementCtx);
 }
 
+auto CodeLine::isBinaryInclude(MOS6502Parser::LineContext *ctx) -> bool
+{
+    return (ctx->directive() != nullptr) && (ctx->directive()->incbin_directive() != nullptr);
+}
+
+auto CodeLine::extractMacroName(MOS6502Parser::LineContext *ctx) -> std::string
+{
+    // the label of the line may precede the macro call
+    antlr4::ParserRuleContext *dirOrStatementCtx = (ctx->directive() != nullptr) ?
+        static_cast<antlr4::ParserRuleContext *>(ctx->directive()) :
+        static_cast<antlr4::ParserRuleContext *>(ctx->statement());
+    auto const *pExpanded = (dirOrStatementCtx != nullptr) ? dynamic_cast<ExpandedToken const *>(dirOrStatementCtx->getStart()) : nullptr;
+    return (pExpanded != nullptr) ? pExpanded->macroName : "";
+}
+
 auto CodeLine::prettyPrintDirOrStatement(antlr4::RuleContext *dirOrStatementCtx) -> std::string
 {
     std::stringstream strm;
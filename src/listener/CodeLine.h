@@ -14,29 +14,50 @@ class MemBlocks;
 class CodeLine
 {
 public:
-    CodeLine(MOS6502Parser::LineContext *_ctx, uint32_t _startAddress, uint32_t _lengthBytes) :
+    CodeLine(MOS6502Parser::LineContext *_ctx, uint32_t _startAddress, uint32_t _lengthBytes, std::string const &_fileName, size_t _srcLine, size_t _srcCol) :
         startAddress {_startAddress },
         lengthBytes {_lengthBytes},
-        label { getLabel(_ctx) },
-        assembly { getAssembly(_ctx) }
+        fileName {_fileName},
+        srcLine {_srcLine},
+        srcCol {_srcCol},
+        label { extractLabel(_ctx) },
+        assembly { extractAssembly(_ctx) },
+        summarized { isBinaryInclude(_ctx) },
+        macroName { extractMacroName(_ctx) }
     {};
 
     std::string get(asm6502::MemBlocks const &mb, bool addAssembly) const;
+    // the optimizer gave the statement another opcode, the listing shows it and the original
+    void replaceMnemonic(std::string const &mnemonic);
     uint32_t getStartAddress() const { return startAddress; }
     uint32_t getLengthBytes() const { return lengthBytes; }
+    std::string const &getLabel() const { return label; }   // w/o the colon
+    std::string const &getAssembly() const { return assembly; }
+    std::string const &getMacroName() const { return macroName; }
+    std::string const &getFileName() const { return fileName; }
+    size_t getSrcLine() const { return srcLine; }
+    size_t getSrcCol() const { return srcCol; }
 
 private:
     auto getMachineCode(asm6502::MemBlocks const &mb) const -> std::string;
 
-    static auto getLabel(MOS6502Parser::LineContext *_ctx) -> std::string;
-    static auto getAssembly(MOS6502Parser::LineContext *_ctx) -> std::string;
+    static auto extractLabel(MOS6502Parser::LineContext *_ctx) -> std::string;
+    static auto extractAssembly(MOS6502Parser::LineContext *_ctx) -> std::string;
+    static auto isBinaryInclude(MOS6502Parser::LineContext *_ctx) -> bool;
+    static auto extractMacroName(MOS6502Parser::LineContext *_ctx) -> std::string;
     static auto prettyPrintDirOrStatement(antlr4::RuleContext *dirOrStatementCtx) -> std::string;
     static auto getWhitespaceBetweenTokens(antlr4::tree::ParseTree *terminalNode, antlr4::tree::ParseTree *prevTerminalNode) -> std::string;
 
     uint32_t startAddress;
     uint32_t lengthBytes;
+    std::string fileName;   // source position of the line, as in error messages
+    size_t srcLine;
+    size_t srcCol;
     std::string label;
     std::string assembly;
+    bool summarized;    // only the first bytes are listed, e.g. for included binary files
+    std::string macroName;  // macro the line was expanded from, empty for source lines
+    std::string replacedMnemonic;   // the mnemonic in the source if the optimizer replaced it
 };
 
 }
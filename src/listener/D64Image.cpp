@@ -0,0 +1,283 @@
+#include <algorithm>
+
+#include "D64Image.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+uint32_t const NUM_SECTORS = 683;
+uint32_t const BAM_SECTOR = 0;
+uint32_t const FIRST_FILE_TRACK = 17;
+uint8_t const FILE_TYPE_PRG = 0x82;         // closed PRG
+uint8_t const PADDING = 0xA0;               // shifted space, pads names and the header
+uint8_t const DOS_VERSION = 0x41;           // 'A'
+uint32_t const BAM_ENTRIES = 0x04;
+uint32_t const BAM_DISK_NAME = 0x90;
+uint32_t const BAM_DISK_ID = 0xA2;
+uint32_t const BAM_DOS_TYPE = 0xA5;
+uint32_t const ENTRY_SIZE = 32;
+uint32_t const ENTRY_TYPE = 0x02;
+uint32_t const ENTRY_NAME = 0x05;
+uint32_t const ENTRY_BLOCKS = 0x1E;
+
+// the DOS order 1, 4, ..., 16, 2, 5, ..., 17, 3, 6, ..., 18
+auto getDirectorySectorAt(uint32_t dirIdx) -> uint32_t
+{
+    return 1 + (dirIdx % 6) * D64Image::DIRECTORY_INTERLEAVE + dirIdx / 6;
+}
+
+// the inverse of getDirectorySectorAt()
+auto getDirectoryIndex(uint32_t sector) -> uint32_t
+{
+    return ((sector - 1) % D64Image::DIRECTORY_INTERLEAVE) * 6 + (sector - 1) / D64Image::DIRECTORY_INTERLEAVE;
+}
+
+// from the directory track outwards, first down to track 1, then up to track 35
+auto getNextTrack(uint32_t track) -> uint32_t
+{
+    uint32_t ret = 0;
+
+    if (track > D64Image::DIRECTORY_TRACK)
+    {
+        ret = (track < D64Image::NUM_TRACKS) ? track + 1 : 0;
+    }
+    else
+    {
+        ret = (track > 1) ? track - 1 : D64Image::DIRECTORY_TRACK + 1;
+    }
+
+    return ret;
+}
+
+void putString(std::vector<uint8_t> &sector, uint32_t offset, std::string const &str, uint32_t length)
+{
+    for (uint32_t idx = 0; idx < length; idx++)
+    {
+        sector[offset + idx] = (idx < str.length()) ? static_cast<uint8_t>(str[idx]) : PADDING;
+    }
+}
+
+}
+
+D64Image::D64Image(std::string const &diskName_, std::string const &diskId_) :
+    diskName{toPetscii(diskName_)},
+    diskId{toPetscii(diskId_).substr(0, 2)},
+    used(NUM_SECTORS, false),
+    owners(NUM_SECTORS),
+    track{0},
+    sector{0}
+{
+}
+
+auto D64Image::getNumSectors(uint32_t track) -> uint32_t
+{
+    return (track <= 17) ? 21 : (track <= 24) ? 19 : (track <= 30) ? 18 : 17;
+}
+
+auto D64Image::getSectorNumber(uint32_t track, uint32_t sector) -> uint32_t
+{
+    uint32_t ret = sector;
+
+    for (uint32_t prevTrack = 1; prevTrack < track; prevTrack++)
+    {
+        ret += getNumSectors(prevTrack);
+    }
+
+    return ret;
+}
+
+auto D64Image::toPetscii(std::string const &name) -> std::string
+{
+    std::string ret = name.substr(0, MAX_NAME_LENGTH);
+    std::transform(begin(ret), end(ret), begin(ret), [](char ch) { return ((ch >= 'a') && (ch <= 'z')) ? ch - 'a' + 'A' : ch; });
+
+    return ret;
+}
+
+auto D64Image::getFreeBlocks() const -> uint32_t
+{
+    uint32_t ret = 0;
+
+    for (uint32_t trk = 1; trk <= NUM_TRACKS; trk++)
+    {
+        for (uint32_t sec = 0; (trk != DIRECTORY_TRACK) && (sec < getNumSectors(trk)); sec++)
+        {
+            ret += used[getSectorNumber(trk, sec)] ? 0 : 1;
+        }
+    }
+
+    return ret;
+}
+
+// the next free sector FILE_INTERLEAVE sectors after the last one, or on the next track
+auto D64Image::allocateSector() -> std::optional<std::pair<uint32_t, uint32_t>>
+{
+    std::optional<std::pair<uint32_t, uint32_t>> ret = std::nullopt;
+    uint32_t start = (track == 0) ? 0 : (sector + FILE_INTERLEAVE) % getNumSectors(track);
+
+    if (track == 0)
+    {
+        track = FIRST_FILE_TRACK;
+    }
+
+    while ((ret == std::nullopt) && (track != 0))
+    {
+        for (uint32_t idx = 0; (ret == std::nullopt) && (idx < getNumSectors(track)); idx++)
+        {
+            uint32_t sec = (start + idx) % getNumSectors(track);
+
+            if (!used[getSectorNumber(track, sec)])
+            {
+                sector = sec;
+                used[getSectorNumber(track, sec)] = true;
+                ret = std::make_pair(track, sec);
+            }
+        }
+
+        if (ret == std::nullopt)
+        {
+            track = getNextTrack(track);
+            start = 0;
+        }
+    }
+
+    return ret;
+}
+
+auto D64Image::addFile(std::string const &name, std::vector<uint8_t> const &bytes) -> bool
+{
+    uint32_t numBlocks = std::max<uint32_t>((bytes.size() + SECTOR_DATA_BYTES - 1) / SECTOR_DATA_BYTES, 1);
+    bool ret = (files.size() < MAX_FILES) && (numBlocks <= getFreeBlocks());
+
+    if (ret)
+    {
+        DiskFile file{toPetscii(name), bytes, {}};
+
+        for (uint32_t blockIdx = 0; blockIdx < numBlocks; blockIdx++)
+        {
+            // there are enough free sectors
+            std::pair<uint32_t, uint32_t> trackSector = allocateSector().value();
+            owners[getSectorNumber(trackSector.first, trackSector.second)] = std::make_pair(files.size(), blockIdx);
+            file.sectors.push_back(trackSector);
+        }
+        files.push_back(file);
+    }
+
+    return ret;
+}
+
+auto D64Image::getNumDirectorySectors() const -> uint32_t
+{
+    return std::max<uint32_t>((files.size() + ENTRIES_PER_SECTOR - 1) / ENTRIES_PER_SECTOR, 1);
+}
+
+// per track the number of free sectors and a bit per sector, set if free
+auto D64Image::getBamSector() const -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> ret(SECTOR_SIZE, 0x00);
+
+    ret[0] = DIRECTORY_TRACK;
+    ret[1] = getDirectorySectorAt(0);
+    ret[2] = DOS_VERSION;
+
+    for (uint32_t trk = 1; trk <= NUM_TRACKS; trk++)
+    {
+        uint32_t entry = BAM_ENTRIES + (trk - 1) * 4;
+
+        for (uint32_t sec = 0; sec < getNumSectors(trk); sec++)
+        {
+            bool isUsed = (trk == DIRECTORY_TRACK) ?
+                ((sec == BAM_SECTOR) || (getDirectoryIndex(sec) < getNumDirectorySectors())) :
+                used[getSectorNumber(trk, sec)];
+
+            if (!isUsed)
+            {
+                ret[entry]++;
+                ret[entry + 1 + sec / 8] |= static_cast<uint8_t>(1U << (sec % 8));
+            }
+        }
+    }
+
+    putString(ret, BAM_DISK_NAME, diskName, MAX_NAME_LENGTH + 2);
+    putString(ret, BAM_DISK_ID, diskId, 3);
+    putString(ret, BAM_DOS_TYPE, "2A", 6);
+
+    return ret;
+}
+
+auto D64Image::getDirectorySector(uint32_t dirIdx) const -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> ret(SECTOR_SIZE, 0x00);
+
+    ret[0] = (dirIdx + 1 < getNumDirectorySectors()) ? DIRECTORY_TRACK : 0x00;
+    ret[1] = (dirIdx + 1 < getNumDirectorySectors()) ? getDirectorySectorAt(dirIdx + 1) : 0xFF;
+
+    for (uint32_t entryIdx = 0; (entryIdx < ENTRIES_PER_SECTOR) && (dirIdx * ENTRIES_PER_SECTOR + entryIdx < files.size()); entryIdx++)
+    {
+        DiskFile const &file = files[dirIdx * ENTRIES_PER_SECTOR + entryIdx];
+        uint32_t entry = entryIdx * ENTRY_SIZE;
+
+        ret[entry + ENTRY_TYPE] = FILE_TYPE_PRG;
+        ret[entry + ENTRY_TYPE + 1] = file.sectors[0].first;
+        ret[entry + ENTRY_TYPE + 2] = file.sectors[0].second;
+        putString(ret, entry + ENTRY_NAME, file.name, MAX_NAME_LENGTH);
+        ret[entry + ENTRY_BLOCKS] = static_cast<uint8_t>(file.sectors.size() & 0xffU);
+        ret[entry + ENTRY_BLOCKS + 1] = static_cast<uint8_t>(file.sectors.size() >> 8U);
+    }
+
+    return ret;
+}
+
+// linked to the next sector of the file, the last one holds the index of its last byte instead
+auto D64Image::getFileSector(size_t fileIdx, size_t blockIdx) const -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> ret(SECTOR_SIZE, 0x00);
+    DiskFile const &file = files[fileIdx];
+    size_t start = blockIdx * SECTOR_DATA_BYTES;
+    size_t length = std::min<size_t>(file.bytes.size() - start, SECTOR_DATA_BYTES);
+
+    if (blockIdx + 1 < file.sectors.size())
+    {
+        ret[0] = file.sectors[blockIdx + 1].first;
+        ret[1] = file.sectors[blockIdx + 1].second;
+    }
+    else
+    {
+        ret[0] = 0x00;
+        ret[1] = static_cast<uint8_t>(length + 1);
+    }
+    std::copy(begin(file.bytes) + start, begin(file.bytes) + start + length, begin(ret) + 2);
+
+    return ret;
+}
+
+void D64Image::write(std::ostream &os) const
+{
+    std::vector<uint8_t> const empty(SECTOR_SIZE, 0x00);
+
+    for (uint32_t trk = 1; trk <= NUM_TRACKS; trk++)
+    {
+        for (uint32_t sec = 0; sec < getNumSectors(trk); sec++)
+        {
+            uint32_t sectorNumber = getSectorNumber(trk, sec);
+            std::vector<uint8_t> data = empty;
+
+            if ((trk == DIRECTORY_TRACK) && (sec == BAM_SECTOR))
+            {
+                data = getBamSector();
+            }
+            else if (trk == DIRECTORY_TRACK)
+            {
+                data = (getDirectoryIndex(sec) < getNumDirectorySectors()) ? getDirectorySector(getDirectoryIndex(sec)) : empty;
+            }
+            else if (used[sectorNumber])
+            {
+                data = getFileSector(owners[sectorNumber].first, owners[sectorNumber].second);
+            }
+
+            os.write(reinterpret_cast<char const *>(data.data()), data.size());
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef D64_IMAGE_H
+#define D64_IMAGE_H
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asm6502
+{
+
+// A file on the disk and the sectors holding it, in the order of its sector chain
+class DiskFile
+{
+public:
+    std::string name;                   // PETSCII, at most D64Image::MAX_NAME_LENGTH characters
+    std::vector<uint8_t> bytes;         // a .PRG including its load address
+    std::vector<std::pair<uint32_t, uint32_t>> sectors;     // track and sector
+};
+
+// A 1541 disk image with 35 tracks holding PRG files. Files are allocated when added, like
+// the DOS does from the directory track outwards with an interleave of 10 sectors, the image
+// is then written sector by sector in one pass, each sector generated from the files, the
+// directory and the BAM.
+class D64Image
+{
+public:
+    static uint32_t const NUM_TRACKS = 35;
+    static uint32_t const SECTOR_SIZE = 256;
+    static uint32_t const SECTOR_DATA_BYTES = SECTOR_SIZE - 2;     // after the link to the next sector
+    static uint32_t const DIRECTORY_TRACK = 18;
+    static uint32_t const DIRECTORY_INTERLEAVE = 3;
+    static uint32_t const FILE_INTERLEAVE = 10;
+    static uint32_t const ENTRIES_PER_SECTOR = 8;
+    static uint32_t const MAX_FILES = 144;                          // 18 directory sectors
+    static uint32_t const MAX_NAME_LENGTH = 16;
+
+    D64Image(std::string const &diskName_, std::string const &diskId_);
+
+    // false if the directory or the disk is full
+    auto addFile(std::string const &name, std::vector<uint8_t> const &bytes) -> bool;
+    void write(std::ostream &os) const;
+
+    auto getFiles() const -> std::vector<DiskFile> const & { return files; }
+    auto getFreeBlocks() const -> uint32_t;     // as listed by the directory, without the directory track
+
+    static auto getNumSectors(uint32_t track) -> uint32_t;
+    // tracks start at 1, the sectors of a track at 0
+    static auto getSectorNumber(uint32_t track, uint32_t sector) -> uint32_t;
+    // uppercase, the characters the directory listing shows as typed
+    static auto toPetscii(std::string const &name) -> std::string;
+
+private:
+    auto allocateSector() -> std::optional<std::pair<uint32_t, uint32_t>>;
+    auto getBamSector() const -> std::vector<uint8_t>;
+    auto getNumDirectorySectors() const -> uint32_t;
+    auto getDirectorySector(uint32_t dirIdx) const -> std::vector<uint8_t>;
+    auto getFileSector(size_t fileIdx, size_t blockIdx) const -> std::vector<uint8_t>;
+
+    std::string diskName;
+    std::string diskId;
+    std::vector<DiskFile> files;
+    std::vector<bool> used;                         // per linear sector number
+    std::vector<std::pair<size_t, size_t>> owners;  // per linear sector number, file and block index
+    uint32_t track;                                 // where the last sector was allocated
+    uint32_t sector;
+};
+
+} // namespace
+
+#endif
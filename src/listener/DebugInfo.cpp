@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <sstream>
+
+#include "BinaryIO.h"
+#include "DebugInfo.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+std::string const DEBUG_INFO_MAGIC = "A65DBG";
+uint8_t const DEBUG_INFO_VERSION = 1;
+uint32_t const MAX_ADDRESS = 0xffff;
+
+auto toHex(uint32_t address) -> std::string
+{
+    std::stringstream strm;
+    strm << std::hex << std::setw(4) << std::setfill('0') << address;
+    return strm.str();
+}
+
+}
+
+auto asm6502::makeDebugInfo(MemBlocks const &memBlocks, SymbolTable const &symbolTable) -> DebugInfo
+{
+    DebugInfo ret;
+    std::map<std::string, uint32_t> fileIdx;
+
+    for (auto const &codeLine : memBlocks.getCodeLines())
+    {
+        if (codeLine.getLengthBytes() > 0)
+        {
+            auto pos = fileIdx.emplace(codeLine.getFileName(), static_cast<uint32_t>(ret.files.size()));
+            if (pos.second)
+            {
+                ret.files.push_back(codeLine.getFileName());
+            }
+
+            ret.lines.push_back(LineInfo{codeLine.getStartAddress(), codeLine.getLengthBytes(), pos.first->second,
+                                         static_cast<uint32_t>(codeLine.getSrcLine()), static_cast<uint32_t>(codeLine.getSrcCol())});
+        }
+    }
+
+    for (auto const &sym : symbolTable.getSymbols())
+    {
+        if (sym.second.val <= MAX_ADDRESS)
+        {
+            ret.labels.push_back(LabelInfo{sym.second.val, sym.first});
+        }
+    }
+
+    // lines are in source order, .ORG may go back; labels with the same address stay sorted by name
+    std::stable_sort(begin(ret.lines), end(ret.lines), [](LineInfo const &lhs, LineInfo const &rhs) { return lhs.address < rhs.address; });
+    std::stable_sort(begin(ret.labels), end(ret.labels), [](LabelInfo const &lhs, LabelInfo const &rhs) { return lhs.address < rhs.address; });
+
+    return ret;
+}
+
+void asm6502::writeDebugInfo(std::ostream &os, DebugInfo const &debugInfo)
+{
+    os << DEBUG_INFO_MAGIC;
+    os.put(static_cast<char>(DEBUG_INFO_VERSION));
+
+    writeNumber(os, static_cast<uint32_t>(debugInfo.files.size()), 2);
+    for (auto const &file : debugInfo.files)
+    {
+        writeString(os, file);
+    }
+
+    writeNumber(os, static_cast<uint32_t>(debugInfo.lines.size()), 4);
+    for (auto const &line : debugInfo.lines)
+    {
+        writeNumber(os, line.address, 2);
+        writeNumber(os, line.lengthBytes, 4);
+        writeNumber(os, line.fileIdx, 2);
+        writeNumber(os, line.line, 4);
+        writeNumber(os, line.col, 4);
+    }
+
+    writeNumber(os, static_cast<uint32_t>(debugInfo.labels.size()), 4);
+    for (auto const &label : debugInfo.labels)
+    {
+        writeNumber(os, label.address, 2);
+        writeString(os, label.name);
+    }
+}
+
+auto asm6502::readDebugInfo(std::istream &is) -> std::optional<DebugInfo>
+{
+    std::vector<char> data{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+    BinaryReader reader(data);
+    DebugInfo ret;
+
+    bool valid = (reader.readString(DEBUG_INFO_MAGIC.length()) == DEBUG_INFO_MAGIC) && (reader.readNumber(1) == DEBUG_INFO_VERSION);
+
+    uint32_t numFiles = reader.readNumber(2);
+    for (uint32_t idx = 0; valid && !reader.hasFailed() && (idx < numFiles); idx++)
+    {
+        ret.files.push_back(reader.readString());
+    }
+
+    uint32_t numLines = reader.readNumber(4);
+    for (uint32_t idx = 0; valid && !reader.hasFailed() && (idx < numLines); idx++)
+    {
+        LineInfo line{};
+        line.address = reader.readNumber(2);
+        line.lengthBytes = reader.readNumber(4);
+        line.fileIdx = reader.readNumber(2);
+        line.line = reader.readNumber(4);
+        line.col = reader.readNumber(4);
+
+        valid = line.fileIdx < numFiles;
+        ret.lines.push_back(line);
+    }
+
+    uint32_t numLabels = reader.readNumber(4);
+    for (uint32_t idx = 0; valid && !reader.hasFailed() && (idx < numLabels); idx++)
+    {
+        uint32_t address = reader.readNumber(2);
+        ret.labels.push_back(LabelInfo{address, reader.readString()});
+    }
+
+    valid = valid && !reader.hasFailed() && reader.isAtEnd();
+
+    return valid ? std::optional<DebugInfo>(ret) : std::nullopt;
+}
+
+void asm6502::writeDebugInfoText(std::ostream &os, DebugInfo const &debugInfo)
+{
+    for (auto const &line : debugInfo.lines)
+    {
+        os << toHex(line.address) << " " << line.lengthBytes << " " << debugInfo.files[line.fileIdx] << ":" << line.line << ":" << line.col << "\n";
+    }
+
+    for (auto const &label : debugInfo.labels)
+    {
+        os << toHex(label.address) << " " << label.name << "\n";
+    }
+}
+
+void asm6502::writeViceLabels(std::ostream &os, DebugInfo const &debugInfo)
+{
+    for (auto const &label : debugInfo.labels)
+    {
+        os << "al C:" << toHex(label.address) << " ." << label.name << "\n";
+    }
+}
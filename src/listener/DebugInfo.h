@@ -0,0 +1,64 @@
+#ifndef DEBUG_INFO_H
+#define DEBUG_INFO_H
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "MemBlocks.h"
+#include "SymbolTable.h"
+
+namespace asm6502
+{
+
+// The source position of the bytes of one line
+class LineInfo
+{
+public:
+    uint32_t address;
+    uint32_t lengthBytes;
+    uint32_t fileIdx;       // into DebugInfo::files
+    uint32_t line;
+    uint32_t col;
+};
+
+class LabelInfo
+{
+public:
+    uint32_t address;
+    std::string name;
+};
+
+// Maps the addresses of an assembled program back to the source, for emulators and profilers
+// attributing the program counter to lines and labels. Lines and labels are sorted by address.
+class DebugInfo
+{
+public:
+    std::vector<std::string> files;
+    std::vector<LineInfo> lines;
+    std::vector<LabelInfo> labels;
+};
+
+// lines generating bytes and all symbols with 16 bit values, including those of the prelude
+auto makeDebugInfo(MemBlocks const &memBlocks, SymbolTable const &symbolTable) -> DebugInfo;
+
+// Format, all numbers little endian:
+//   "A65DBG", version byte,
+//   number of files (2 bytes), per file: name length (2 bytes), name,
+//   number of lines (4 bytes), per line: address (2 bytes), length (4 bytes), file index (2 bytes), line (4 bytes), column (4 bytes),
+//   number of labels (4 bytes), per label: address (2 bytes), name length (2 bytes), name
+void writeDebugInfo(std::ostream &os, DebugInfo const &debugInfo);
+// nullopt if the debug info is invalid
+auto readDebugInfo(std::istream &is) -> std::optional<DebugInfo>;
+
+// one line per source line, "c000 3 file.asm:12:0" with the position as in error messages, then the labels "c000 start"
+void writeDebugInfoText(std::ostream &os, DebugInfo const &debugInfo);
+
+// "al C:c000 .start" per label, loaded by the VICE monitor with "ll"
+void writeViceLabels(std::ostream &os, DebugInfo const &debugInfo);
+
+} // namespace
+
+#endif
@@ -0,0 +1,259 @@
+#include <fstream>
+#include <sstream>
+
+#include <MOS6502Lexer.h>
+
+#include "IncludeTokenSource.h"
+#include "MOS6502Listener.h"
+
+using namespace asm6502;
+
+// deeper nesting is considered a runaway recursion
+static size_t const MAX_INCLUDE_DEPTH = 32;
+
+// keeps the lexer errors of a cached file instead of printing them
+class LexerErrorCollector : public antlr4::BaseErrorListener
+{
+public:
+    explicit LexerErrorCollector(std::vector<TokenizedFile::CachedError> &errors_) : errors{errors_} {}
+
+    void syntaxError(antlr4::Recognizer * /*recognizer*/, antlr4::Token * /*offendingSymbol*/, size_t line,
+                     size_t charPositionInLine, const std::string &msg, std::exception_ptr /*e*/) override
+    {
+        errors.push_back({line, charPositionInLine, msg});
+    }
+
+private:
+    std::vector<TokenizedFile::CachedError> &errors;
+};
+
+auto IncludeCache::getInstance() -> IncludeCache &
+{
+    static IncludeCache instance;
+    return instance;
+}
+
+auto IncludeCache::getFile(std::filesystem::path const &path) -> std::shared_ptr<TokenizedFile const>
+{
+    std::error_code ec;
+    std::filesystem::path canonicalPath = std::filesystem::canonical(path, ec);
+    std::filesystem::file_time_type modificationTime = ec ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(canonicalPath, ec);
+
+    std::shared_ptr<TokenizedFile const> ret = nullptr;
+
+    if (!ec)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto pos = files.find(canonicalPath.string());
+
+        if ((pos != end(files)) && (pos->second->modificationTime == modificationTime))
+        {
+            ret = pos->second;
+        }
+        else
+        {
+            ret = tokenize(canonicalPath, modificationTime);
+
+            if (ret != nullptr)
+            {
+                files[canonicalPath.string()] = ret;
+                numTokenizations++;
+            }
+        }
+    }
+
+    return ret;
+}
+
+auto IncludeCache::getNumTokenizations() -> size_t
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return numTokenizations;
+}
+
+auto IncludeCache::tokenize(std::filesystem::path const &path, std::filesystem::file_time_type modificationTime) -> std::shared_ptr<TokenizedFile const>
+{
+    std::shared_ptr<TokenizedFile> ret = nullptr;
+    std::ifstream stream(path);
+
+    if (!stream.fail())
+    {
+        ret = std::make_shared<TokenizedFile>();
+        ret->path = path.string();
+        ret->modificationTime = modificationTime;
+        ret->input = std::make_unique<antlr4::ANTLRInputStream>(stream);
+        ret->input->name = path.string();
+
+        MOS6502Lexer lexer(ret->input.get());
+        LexerErrorCollector errorCollector(ret->errors);
+        lexer.removeErrorListeners();
+        lexer.addErrorListener(&errorCollector);
+
+        for (auto token = lexer.nextToken(); token->getType() != antlr4::Token::EOF; token = lexer.nextToken())
+        {
+            ret->tokens.push_back({
+                token->getType(), token->getChannel(), token->getStartIndex(), token->getStopIndex(),
+                token->getLine(), token->getCharPositionInLine(), token->getText() });
+        }
+    }
+
+    return ret;
+}
+
+IncludeTokenSource::IncludeTokenSource(antlr4::TokenSource &mainSource_, std::string const &mainFileName_, std::vector<std::string> const &includePaths_, MOS6502Listener &listener_) :
+    mainSource{mainSource_},
+    mainFileName{mainFileName_},
+    includePaths{includePaths_},
+    listener{listener_}
+{
+}
+
+auto IncludeTokenSource::nextToken() -> std::unique_ptr<antlr4::Token>
+{
+    std::unique_ptr<antlr4::Token> ret = nullptr;
+
+    while (ret == nullptr)
+    {
+        if (includeStack.empty())
+        {
+            ret = nextMainToken();
+        }
+        else if (includeStack.back().pos >= includeStack.back().file->tokens.size())
+        {
+            includeStack.pop_back();
+        }
+        else
+        {
+            ret = nextIncludedToken(includeStack.back());
+        }
+    }
+
+    return ret;
+}
+
+// nullptr if an include directive was consumed
+auto IncludeTokenSource::nextMainToken() -> std::unique_ptr<antlr4::Token>
+{
+    while ((lookahead.size() < 3) && (lookahead.empty() || (lookahead.back()->getType() != antlr4::Token::EOF)))
+    {
+        lookahead.push_back(mainSource.nextToken());
+    }
+
+    std::unique_ptr<antlr4::Token> ret = nullptr;
+
+    if ((lookahead.size() == 3) &&
+        isIncludeDirective(lookahead[0]->getType(), lookahead[1]->getType(), lookahead[1]->getText(), lookahead[2]->getType()))
+    {
+        std::string nameWithQuotes = lookahead[2]->getText();
+        size_t line = lookahead[0]->getLine();
+        size_t col = lookahead[0]->getCharPositionInLine();
+        lookahead.erase(begin(lookahead), begin(lookahead) + 3);
+
+        beginInclude(nameWithQuotes, mainFileName, line, col);
+    }
+    else
+    {
+        ret = std::move(lookahead.front());
+        lookahead.pop_front();
+    }
+
+    return ret;
+}
+
+// nullptr if an include directive was consumed. The cached tokens are shared,
+// the parser gets a fresh copy of each.
+auto IncludeTokenSource::nextIncludedToken(Frame &frame) -> std::unique_ptr<antlr4::Token>
+{
+    auto const &tokens = frame.file->tokens;
+    std::unique_ptr<antlr4::Token> ret = nullptr;
+
+    if ((frame.pos + 2 < tokens.size()) &&
+        isIncludeDirective(tokens[frame.pos].type, tokens[frame.pos + 1].type, tokens[frame.pos + 1].text, tokens[frame.pos + 2].type))
+    {
+        auto const &dot = tokens[frame.pos];
+        std::string nameWithQuotes = tokens[frame.pos + 2].text;
+        std::shared_ptr<TokenizedFile const> includingFile = frame.file;
+        frame.pos += 3;
+
+        // frame may be invalidated by pushing the included file
+        beginInclude(nameWithQuotes, includingFile->path, dot.line, dot.col);
+    }
+    else
+    {
+        auto const &cached = tokens[frame.pos++];
+        auto token = std::make_unique<antlr4::CommonToken>(
+            std::pair<antlr4::TokenSource *, antlr4::CharStream *>(this, frame.file->input.get()),
+            cached.type, cached.channel, cached.start, cached.stop);
+        token->setLine(cached.line);
+        token->setCharPositionInLine(cached.col);
+        token->setText(cached.text);
+        ret = std::move(token);
+    }
+
+    return ret;
+}
+
+auto IncludeTokenSource::isIncludeDirective(size_t type0, size_t type1, std::string const &text1, size_t type2) -> bool
+{
+    return (type0 == MOS6502Lexer::DOT) && (type1 == MOS6502Lexer::ID) && (text1 == "INCLUDE") && (type2 == MOS6502Lexer::STRING);
+}
+
+auto IncludeTokenSource::findInclude(std::string const &name, std::string const &includingFile) const -> std::optional<std::filesystem::path>
+{
+    std::optional<std::filesystem::path> ret = std::nullopt;
+    std::filesystem::path namePath(name);
+    std::error_code ec;
+
+    if (namePath.is_absolute())
+    {
+        ret = namePath;
+    }
+    else
+    {
+        std::vector<std::filesystem::path> candidates{ std::filesystem::path(includingFile).parent_path() / namePath };
+        for (auto const &includePath : includePaths)
+        {
+            candidates.push_back(std::filesystem::path(includePath) / namePath);
+        }
+
+        for (auto const &candidate : candidates)
+        {
+            if (std::filesystem::is_regular_file(candidate, ec))
+            {
+                ret = candidate;
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+void IncludeTokenSource::beginInclude(std::string const &nameWithQuotes, std::string const &includingFile, size_t line, size_t col)
+{
+    std::string name = nameWithQuotes.substr(1, nameWithQuotes.length() - 2);
+    std::optional<std::filesystem::path> optPath = findInclude(name, includingFile);
+    std::shared_ptr<TokenizedFile const> file = (optPath != std::nullopt) ? IncludeCache::getInstance().getFile(optPath.value()) : nullptr;
+
+    if (file == nullptr)
+    {
+        addError(includingFile, line, col, "Could not open include file \"" + name + "\".");
+    }
+    else if (includeStack.size() >= MAX_INCLUDE_DEPTH)
+    {
+        addError(includingFile, line, col, "Include files nested too deeply, is \"" + name + "\" including itself?");
+    }
+    else
+    {
+        for (auto const &error : file->errors)
+        {
+            listener.addParseError(ErrorCode::Syntax, file->path, error.line, error.col, error.msg);
+        }
+        includeStack.push_back(Frame{file, 0});
+    }
+}
+
+void IncludeTokenSource::addError(std::string const &file, size_t line, size_t col, std::string const &msg)
+{
+    listener.addParseError(ErrorCode::Include, file, line, col, msg);
+}
@@ -0,0 +1,115 @@
+#ifndef INCLUDE_TOKEN_SOURCE_H
+#define INCLUDE_TOKEN_SOURCE_H
+
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <antlr4-runtime.h>
+
+namespace asm6502
+{
+
+class MOS6502Listener;
+
+// The tokens of one source file, lexed once and shared by all assembler runs of the process
+class TokenizedFile
+{
+public:
+    class CachedToken
+    {
+    public:
+        size_t type;
+        size_t channel;
+        size_t start;
+        size_t stop;
+        size_t line;
+        size_t col;
+        std::string text;
+    };
+
+    class CachedError
+    {
+    public:
+        size_t line;
+        size_t col;
+        std::string msg;
+    };
+
+    std::string path;
+    std::filesystem::file_time_type modificationTime;
+    std::unique_ptr<antlr4::ANTLRInputStream> input;   // named after the file, tokens refer to it for their source name
+    std::vector<CachedToken> tokens;                    // w/o EOF
+    std::vector<CachedError> errors;                    // of the lexer, reported each time the file is included
+};
+
+// Process-wide cache of tokenized include files, keyed by canonical path. A file is
+// lexed again if its modification time changed since it was cached.
+class IncludeCache
+{
+public:
+    static auto getInstance() -> IncludeCache &;
+
+    // nullptr if the file cannot be read
+    auto getFile(std::filesystem::path const &path) -> std::shared_ptr<TokenizedFile const>;
+    auto getNumTokenizations() -> size_t;
+
+private:
+    IncludeCache() = default;
+
+    static auto tokenize(std::filesystem::path const &path, std::filesystem::file_time_type modificationTime) -> std::shared_ptr<TokenizedFile const>;
+
+    std::mutex mutex;
+    std::map<std::string, std::shared_ptr<TokenizedFile const>> files;
+    size_t numTokenizations = 0;
+};
+
+// Sits between the lexer of the main file and the parser. It replaces each
+// .INCLUDE "file" by the tokens of that file, which are taken from the IncludeCache.
+// Included files are searched relative to the including file first, then in the
+// include paths in their given order.
+class IncludeTokenSource : public antlr4::TokenSource
+{
+public:
+    IncludeTokenSource(antlr4::TokenSource &mainSource_, std::string const &mainFileName_, std::vector<std::string> const &includePaths_, MOS6502Listener &listener_);
+
+    auto nextToken() -> std::unique_ptr<antlr4::Token> override;
+    auto getLine() const -> size_t override { return mainSource.getLine(); }
+    auto getCharPositionInLine() -> size_t override { return mainSource.getCharPositionInLine(); }
+    auto getInputStream() -> antlr4::CharStream * override { return mainSource.getInputStream(); }
+    auto getSourceName() -> std::string override { return mainFileName; }
+    auto getTokenFactory() -> antlr4::TokenFactory<antlr4::CommonToken> * override { return mainSource.getTokenFactory(); }
+
+private:
+
+    class Frame
+    {
+    public:
+        std::shared_ptr<TokenizedFile const> file;
+        size_t pos;
+    };
+
+    static auto isIncludeDirective(size_t type0, size_t type1, std::string const &text1, size_t type2) -> bool;
+
+    auto nextMainToken() -> std::unique_ptr<antlr4::Token>;
+    auto nextIncludedToken(Frame &frame) -> std::unique_ptr<antlr4::Token>;
+    auto findInclude(std::string const &name, std::string const &includingFile) const -> std::optional<std::filesystem::path>;
+    void beginInclude(std::string const &nameWithQuotes, std::string const &includingFile, size_t line, size_t col);
+    void addError(std::string const &file, size_t line, size_t col, std::string const &msg);
+
+    antlr4::TokenSource &mainSource;
+    std::string mainFileName;
+    std::vector<std::string> includePaths;
+    MOS6502Listener &listener;
+    std::deque<std::unique_ptr<antlr4::Token>> lookahead;  // tokens of the main file, to detect .INCLUDE
+    std::vector<Frame> includeStack;                        // innermost include last
+};
+
+} // namespace
+
+#endif
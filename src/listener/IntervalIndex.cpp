@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <iterator>
+
+#include "IntervalIndex.h"
+
+using namespace asm6502;
+
+auto IntervalIndex::insert(uint32_t start, uint32_t end) -> std::optional<AddressRange>
+{
+    std::optional<AddressRange> ret = findOverlap(start, end);
+
+    if ((ret == std::nullopt) && (start < end))
+    {
+        ranges.emplace(start, end);
+    }
+
+    return ret;
+}
+
+// only the ranges next to start may overlap, the ranges do not overlap each other
+auto IntervalIndex::findOverlap(uint32_t start, uint32_t end) const -> std::optional<AddressRange>
+{
+    std::optional<AddressRange> ret = std::nullopt;
+    auto next = ranges.lower_bound(start);
+
+    if ((next != begin(ranges)) && (std::prev(next)->second > start) && (start < end))
+    {
+        ret = *std::prev(next);
+    }
+    else if ((next != std::end(ranges)) && (next->first < end))
+    {
+        ret = *next;
+    }
+
+    return ret;
+}
+
+// walks the gaps between the ranges from start on
+auto IntervalIndex::findFirstFit(uint32_t start, uint32_t end, uint32_t length) const -> std::optional<uint32_t>
+{
+    std::optional<uint32_t> ret = std::nullopt;
+    uint32_t candidate = start;
+    auto next = ranges.upper_bound(start);
+
+    if ((next != begin(ranges)) && (std::prev(next)->second > candidate))
+    {
+        candidate = std::prev(next)->second;
+    }
+
+    while ((ret == std::nullopt) && (candidate + length <= end))
+    {
+        if ((next == std::end(ranges)) || (candidate + length <= next->first))
+        {
+            ret = candidate;
+        }
+        else
+        {
+            candidate = std::max(candidate, next->second);
+            ++next;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,34 @@
+#ifndef INTERVAL_INDEX_H
+#define INTERVAL_INDEX_H
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <utility>
+
+namespace asm6502
+{
+
+// address range [first, second)
+typedef std::pair<uint32_t, uint32_t> AddressRange;
+
+// Non-overlapping address ranges ordered by their start, e.g. the memory occupied by the
+// blocks of a program. Inserting and looking up a range take O(log n).
+class IntervalIndex
+{
+public:
+    // a range overlapping [start, end) if any, otherwise [start, end) is added
+    auto insert(uint32_t start, uint32_t end) -> std::optional<AddressRange>;
+    auto findOverlap(uint32_t start, uint32_t end) const -> std::optional<AddressRange>;
+
+    // the lowest start address from start on of a free range of length bytes that ends
+    // at end the latest
+    auto findFirstFit(uint32_t start, uint32_t end, uint32_t length) const -> std::optional<uint32_t>;
+
+private:
+    std::map<uint32_t, uint32_t> ranges; // start to end
+};
+
+} // namespace
+
+#endif
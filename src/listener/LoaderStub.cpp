@@ -0,0 +1,79 @@
+#include "LoaderStub.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+uint8_t const OPC_LDA_IMM = 0xA9;
+uint8_t const OPC_STA_ZPG = 0x85;
+uint8_t const OPC_LDX_IMM = 0xA2;
+uint8_t const OPC_JSR = 0x20;
+
+}
+
+std::vector<uint8_t> const asm6502::loaderBasicLine
+{
+    0x0B, 0x08, 0x0A, 0x00, 0x9E, '2', '0', '6', '1', 0x00, 0x00, 0x00
+};
+
+std::vector<uint8_t> const asm6502::loaderCopyForward
+{
+    0xA0, 0x00,         //          LDY #0
+    0xE0, 0x00,         //          CPX #0
+    0xF0, 0x0E,         //          BEQ rest
+    0xB1, 0xFB,         // page:    LDA [$FB],Y
+    0x91, 0xFD,         //          STA [$FD],Y
+    0xC8,               //          INY
+    0xD0, 0xF9,         //          BNE page
+    0xE6, 0xFC,         //          INC $FC
+    0xE6, 0xFE,         //          INC $FE
+    0xCA,               //          DEX
+    0xD0, 0xF2,         //          BNE page
+    0xC4, 0x02,         // rest:    CPY $02
+    0xF0, 0x07,         //          BEQ done
+    0xB1, 0xFB,         //          LDA [$FB],Y
+    0x91, 0xFD,         //          STA [$FD],Y
+    0xC8,               //          INY
+    0xD0, 0xF5,         //          BNE rest
+    0x60                // done:    RTS
+};
+
+std::vector<uint8_t> const asm6502::loaderCopyBackward
+{
+    0xA4, 0x02,         //          LDY $02
+    0xF0, 0x09,         //          BEQ pages
+    0x88,               // rest:    DEY
+    0xB1, 0xFB,         //          LDA [$FB],Y
+    0x91, 0xFD,         //          STA [$FD],Y
+    0xC0, 0x00,         //          CPY #0
+    0xD0, 0xF7,         //          BNE rest
+    0xE0, 0x00,         // pages:   CPX #0
+    0xF0, 0x10,         //          BEQ done
+    0xC6, 0xFC,         // page:    DEC $FC
+    0xC6, 0xFE,         //          DEC $FE
+    0x88,               // byte:    DEY
+    0xB1, 0xFB,         //          LDA [$FB],Y
+    0x91, 0xFD,         //          STA [$FD],Y
+    0xC0, 0x00,         //          CPY #0
+    0xD0, 0xF7,         //          BNE byte
+    0xCA,               //          DEX
+    0xD0, 0xF0,         //          BNE page
+    0x60                // done:    RTS
+};
+
+void asm6502::appendLoaderCall(std::vector<uint8_t> &code, uint32_t src, uint32_t dst, uint32_t length, uint32_t copyAddress)
+{
+    std::vector<uint8_t> call
+    {
+        OPC_LDA_IMM, static_cast<uint8_t>(src & 0xffU), OPC_STA_ZPG, 0xFB,
+        OPC_LDA_IMM, static_cast<uint8_t>(src >> 8U), OPC_STA_ZPG, 0xFC,
+        OPC_LDA_IMM, static_cast<uint8_t>(dst & 0xffU), OPC_STA_ZPG, 0xFD,
+        OPC_LDA_IMM, static_cast<uint8_t>(dst >> 8U), OPC_STA_ZPG, 0xFE,
+        OPC_LDA_IMM, static_cast<uint8_t>(length & 0xffU), OPC_STA_ZPG, 0x02,
+        OPC_LDX_IMM, static_cast<uint8_t>(length >> 8U),
+        OPC_JSR, static_cast<uint8_t>(copyAddress & 0xffU), static_cast<uint8_t>(copyAddress >> 8U)
+    };
+
+    code.insert(end(code), begin(call), end(call));
+}
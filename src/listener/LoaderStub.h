@@ -0,0 +1,34 @@
+#ifndef LOADER_STUB_H
+#define LOADER_STUB_H
+
+#include <cstdint>
+#include <vector>
+
+namespace asm6502
+{
+
+// Building blocks of self-starting C64 programs: a BASIC line which calls the machine code
+// behind it, and routines copying memory. See MemBlocks::getLoaderProgram() and LzPacker.
+
+uint16_t const LOADER_ADDRESS = 0x0801;
+uint32_t const LOADER_END_ADDRESS = 0xA000;     // BASIC ROM, a program must be loaded below
+
+// 10 SYS 2061, followed by the end of the BASIC program. The machine code follows at 2061.
+extern std::vector<uint8_t> const loaderBasicLine;
+
+// the copy routines take the source pointer in $FB/$FC, the destination pointer in $FD/$FE,
+// the number of full pages in X and the remaining bytes in $02
+
+// ascending, for a destination below the source
+extern std::vector<uint8_t> const loaderCopyForward;
+// descending, for a destination above the source. The pointers point to the remaining bytes
+// behind the full pages.
+extern std::vector<uint8_t> const loaderCopyBackward;
+
+// LDA #<src, STA $FB, LDA #>src, STA $FC, the same for dst, LDA #rest, STA $02, LDX #pages, JSR copy
+uint32_t const LOADER_CALL_BYTES = 25;
+void appendLoaderCall(std::vector<uint8_t> &code, uint32_t src, uint32_t dst, uint32_t length, uint32_t copyAddress);
+
+} // namespace
+
+#endif
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "LoaderStub.h"
+#include "LzPacker.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+uint32_t const HASH_SIZE = 0x10000;
+int32_t const NO_POSITION = -1;
+uint32_t const MAX_OFFSET = 0xffff;
+
+// the depacker after the BASIC line, it moves the packed stream from behind itself to the end
+// of the memory, then unpacks it. The offsets of the addresses patched by getPackedProgram().
+uint32_t const PROLOGUE_BYTES = 5 + LOADER_CALL_BYTES + 8;
+uint32_t const DEPACK_JSR_GETBYTE[] = {1, 6, 13, 21, 44, 57};
+uint32_t const DEPACK_STA_MCOPY_LO = 54;
+uint32_t const DEPACK_STA_MCOPY_HI = 66;
+uint32_t const DEPACK_JMP_ENTRY = 95;
+uint32_t const DEPACK_MCOPY = 68;
+uint32_t const DEPACK_GETBYTE = 97;
+
+std::vector<uint8_t> const depacker
+{
+    0x20, 0x00, 0x00,   // block:   JSR getbyte
+    0x85, 0xFD,         //          STA $FD
+    0x20, 0x00, 0x00,   //          JSR getbyte
+    0xF0, 0x4F,         //          BEQ finish          ; address in the zero page
+    0x85, 0xFE,         //          STA $FE
+    0x20, 0x00, 0x00,   // token:   JSR getbyte
+    0xF0, 0xEF,         //          BEQ block
+    0x30, 0x11,         //          BMI match
+    0xAA,               //          TAX
+    0x20, 0x00, 0x00,   // literal: JSR getbyte
+    0x91, 0xFD,         //          STA [$FD],Y
+    0xE6, 0xFD,         //          INC $FD
+    0xD0, 0x02,         //          BNE next
+    0xE6, 0xFE,         //          INC $FE
+    0xCA,               // next:    DEX
+    0xD0, 0xF2,         //          BNE literal
+    0xF0, 0xE8,         //          BEQ token
+    0x29, 0x7F,         // match:   AND #$7F
+    0xAA,               //          TAX
+    0xE8, 0xE8,         //          INX                 ; MIN_MATCH times
+    0xE8, 0xE8,         //          INX
+    0x20, 0x00, 0x00,   //          JSR getbyte
+    0x85, 0x02,         //          STA $02
+    0xA5, 0xFD,         //          LDA $FD
+    0x38,               //          SEC
+    0xE5, 0x02,         //          SBC $02
+    0x8D, 0x00, 0x00,   //          STA mcopy + 1
+    0x20, 0x00, 0x00,   //          JSR getbyte
+    0x85, 0x02,         //          STA $02
+    0xA5, 0xFE,         //          LDA $FE
+    0xE5, 0x02,         //          SBC $02
+    0x8D, 0x00, 0x00,   //          STA mcopy + 2
+    0xB9, 0x00, 0x00,   // mcopy:   LDA $0000,Y
+    0x91, 0xFD,         //          STA [$FD],Y
+    0xC8,               //          INY
+    0xCA,               //          DEX
+    0xD0, 0xF7,         //          BNE mcopy
+    0x98,               //          TYA
+    0x18,               //          CLC
+    0x65, 0xFD,         //          ADC $FD
+    0x85, 0xFD,         //          STA $FD
+    0x90, 0xB7,         //          BCC token
+    0xE6, 0xFE,         //          INC $FE
+    0xB0, 0xB3,         //          BCS token
+    0xA9, 0x37,         // finish:  LDA #$37            ; ROMs and I/O on
+    0x85, 0x01,         //          STA $01
+    0x58,               //          CLI
+    0x4C, 0x00, 0x00,   //          JMP entry
+    0xE6, 0xFB,         // getbyte: INC $FB             ; the pointer is incremented first
+    0xD0, 0x02,         //          BNE load
+    0xE6, 0xFC,         //          INC $FC
+    0xA0, 0x00,         // load:    LDY #0
+    0xB1, 0xFB,         //          LDA [$FB],Y
+    0x60                //          RTS
+};
+
+// cycles of the depacker parts, without page crossings
+uint64_t const CYCLES_PROLOGUE = 7 + 33 + 10;
+uint64_t const CYCLES_MOVE_PER_BYTE = 18;
+uint64_t const CYCLES_MOVE_PER_PAGE = 15;
+uint64_t const CYCLES_BLOCK = 62;
+uint64_t const CYCLES_BLOCK_END = 30;
+uint64_t const CYCLES_FINISH = 60 + 10;
+uint64_t const CYCLES_LITERALS = 35;
+uint64_t const CYCLES_PER_LITERAL = 46;
+uint64_t const CYCLES_MATCH = 138;
+uint64_t const CYCLES_PER_MATCH_BYTE = 17;
+
+auto hash(std::vector<uint8_t> const &bytes, uint32_t pos) -> uint32_t
+{
+    return ((bytes[pos] << 8U) ^ (bytes[pos + 1] << 4U) ^ bytes[pos + 2] ^ (bytes[pos + 2] << 11U)) & (HASH_SIZE - 1);
+}
+
+void patchWord(std::vector<uint8_t> &code, uint32_t offset, uint32_t word)
+{
+    code[offset] = static_cast<uint8_t>(word & 0xffU);
+    code[offset + 1] = static_cast<uint8_t>((word >> 8U) & 0xffU);
+}
+
+void flushLiterals(std::vector<uint8_t> &tokens, std::vector<uint8_t> const &bytes, uint32_t start, uint32_t end)
+{
+    while (start < end)
+    {
+        uint32_t count = std::min(end - start, LzPacker::MAX_LITERALS);
+        tokens.push_back(static_cast<uint8_t>(count));
+        tokens.insert(std::end(tokens), begin(bytes) + start, begin(bytes) + start + count);
+        start += count;
+    }
+}
+
+}
+
+LzPacker::LzPacker(size_t numThreads_) :
+    numThreads{std::max<size_t>(numThreads_, 1)}
+{
+}
+
+// greedy parse, the longest match of the hash chain wins
+auto LzPacker::packChunk(std::vector<uint8_t> const &bytes, std::vector<int32_t> const &prev, uint32_t start, uint32_t end) const -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> tokens;
+    uint32_t literalStart = start;
+    uint32_t pos = start;
+
+    while (pos < end)
+    {
+        uint32_t bestLength = 0;
+        uint32_t bestOffset = 0;
+        uint32_t maxLength = std::min(end - pos, MAX_MATCH);
+        int32_t candidate = prev[pos];
+
+        for (uint32_t chain = 0; (candidate != NO_POSITION) && (chain < MAX_CHAIN) && (pos - candidate <= MAX_OFFSET) && (bestLength < maxLength); chain++)
+        {
+            uint32_t length = 0;
+            while ((length < maxLength) && (bytes[candidate + length] == bytes[pos + length]))
+            {
+                length++;
+            }
+
+            if (length > bestLength)
+            {
+                bestLength = length;
+                bestOffset = pos - candidate;
+            }
+            candidate = prev[candidate];
+        }
+
+        if (bestLength >= MIN_MATCH)
+        {
+            flushLiterals(tokens, bytes, literalStart, pos);
+            tokens.push_back(static_cast<uint8_t>(0x80U | (bestLength - MIN_MATCH)));
+            tokens.push_back(static_cast<uint8_t>(bestOffset & 0xffU));
+            tokens.push_back(static_cast<uint8_t>(bestOffset >> 8U));
+            pos += bestLength;
+            literalStart = pos;
+        }
+        else
+        {
+            pos++;
+        }
+    }
+
+    flushLiterals(tokens, bytes, literalStart, end);
+
+    return tokens;
+}
+
+auto LzPacker::pack(std::vector<uint8_t> const &bytes) const -> std::vector<uint8_t>
+{
+    // prev links each position to the last one before with the same hash, so the chain of a
+    // position only holds earlier positions. It is shared read-only by the chunks.
+    std::vector<int32_t> prev(bytes.size(), NO_POSITION);
+    std::vector<int32_t> head(HASH_SIZE, NO_POSITION);
+
+    for (uint32_t pos = 0; pos + 2 < bytes.size(); pos++)
+    {
+        uint32_t h = hash(bytes, pos);
+        prev[pos] = head[h];
+        head[h] = static_cast<int32_t>(pos);
+    }
+
+    size_t numChunks = (bytes.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<std::vector<uint8_t>> chunkTokens(numChunks);
+    std::atomic<size_t> nextChunk{0};
+
+    auto worker = [&]() {
+        for (size_t chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++)
+        {
+            uint32_t start = chunk * CHUNK_SIZE;
+            uint32_t end = std::min<uint32_t>(start + CHUNK_SIZE, bytes.size());
+            chunkTokens[chunk] = packChunk(bytes, prev, start, end);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t idx = 1; idx < std::min(numThreads, numChunks); idx++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<uint8_t> ret;
+    for (auto const &tokens : chunkTokens)
+    {
+        ret.insert(end(ret), begin(tokens), end(tokens));
+    }
+    ret.push_back(0x00);
+
+    return ret;
+}
+
+// walks the tokens of all blocks, the stream is known to be well-formed
+auto LzPacker::estimateDepackCycles(std::vector<uint8_t> const &stream) -> uint64_t
+{
+    uint64_t ret = CYCLES_PROLOGUE + CYCLES_MOVE_PER_BYTE * stream.size() + CYCLES_MOVE_PER_PAGE * (stream.size() >> 8U) + CYCLES_FINISH;
+    size_t pos = 0;
+
+    while (stream[pos + 1] != 0x00)
+    {
+        ret += CYCLES_BLOCK;
+        pos += 2;
+
+        for (uint8_t token = stream[pos++]; token != 0x00; token = stream[pos++])
+        {
+            if (token & 0x80U)
+            {
+                ret += CYCLES_MATCH + CYCLES_PER_MATCH_BYTE * ((token & 0x7FU) + MIN_MATCH);
+                pos += 2;
+            }
+            else
+            {
+                ret += CYCLES_LITERALS + CYCLES_PER_LITERAL * token;
+                pos += token;
+            }
+        }
+        ret += CYCLES_BLOCK_END;
+    }
+
+    return ret;
+}
+
+auto LzPacker::getPackedProgram(MemBlocks const &memBlocks, uint16_t entryAddress) const -> std::optional<PackedProgram>
+{
+    std::vector<uint8_t> stream;
+
+    for (uint32_t blockIdx = 0; blockIdx < memBlocks.getNumMemBlocks(); blockIdx++)
+    {
+        MemBlock const &memBlock = memBlocks.getMemBlockAt(blockIdx);
+        std::vector<uint8_t> tokens = pack(memBlock.getBytes());
+
+        stream.push_back(static_cast<uint8_t>(memBlock.getStartAddress() & 0xffU));
+        stream.push_back(static_cast<uint8_t>(memBlock.getStartAddress() >> 8U));
+        stream.insert(end(stream), begin(tokens), end(tokens));
+    }
+    stream.push_back(0x00);
+    stream.push_back(0x00);
+
+    uint32_t codeAddress = LOADER_ADDRESS + loaderBasicLine.size();
+    uint32_t depackAddress = codeAddress + PROLOGUE_BYTES;
+    uint32_t copyBackwardAddress = depackAddress + depacker.size();
+    uint32_t dataAddress = copyBackwardAddress + loaderCopyBackward.size();
+    uint32_t movedAddress = 0x10000 - stream.size();
+    bool overlapsDepacker = (dataAddress + stream.size() > LOADER_END_ADDRESS);
+
+    for (uint32_t blockIdx = 0; blockIdx < memBlocks.getNumMemBlocks(); blockIdx++)
+    {
+        uint32_t start = memBlocks.getMemBlockAt(blockIdx).getStartAddress();
+        uint32_t end = start + memBlocks.getMemBlockAt(blockIdx).getLengthBytes();
+
+        // a block in the zero page would read as the end of the stream
+        overlapsDepacker = overlapsDepacker || (start < 0x200) || ((start < dataAddress) && (end > LOADER_ADDRESS)) ||
+                           (end > movedAddress);
+    }
+
+    std::optional<PackedProgram> ret = std::nullopt;
+
+    if (!overlapsDepacker)
+    {
+        std::vector<uint8_t> prg{static_cast<uint8_t>(LOADER_ADDRESS & 0xffU), static_cast<uint8_t>(LOADER_ADDRESS >> 8U)};
+        prg.insert(end(prg), begin(loaderBasicLine), end(loaderBasicLine));
+
+        // SEI, all RAM: LDA #$34, STA $01
+        prg.insert(end(prg), {0x78, 0xA9, 0x34, 0x85, 0x01});
+        uint32_t pagesLength = stream.size() & 0xff00U;
+        appendLoaderCall(prg, dataAddress + pagesLength, movedAddress + pagesLength, stream.size(), copyBackwardAddress);
+
+        // the stream pointer is incremented before each read
+        uint32_t streamPointer = movedAddress - 1;
+        prg.insert(end(prg), {0xA9, static_cast<uint8_t>(streamPointer & 0xffU), 0x85, 0xFB, 0xA9, static_cast<uint8_t>(streamPointer >> 8U), 0x85, 0xFC});
+
+        std::vector<uint8_t> code = depacker;
+        for (uint32_t offset : DEPACK_JSR_GETBYTE)
+        {
+            patchWord(code, offset, depackAddress + DEPACK_GETBYTE);
+        }
+        patchWord(code, DEPACK_STA_MCOPY_LO, depackAddress + DEPACK_MCOPY + 1);
+        patchWord(code, DEPACK_STA_MCOPY_HI, depackAddress + DEPACK_MCOPY + 2);
+        patchWord(code, DEPACK_JMP_ENTRY, entryAddress);
+
+        prg.insert(end(prg), begin(code), end(code));
+        prg.insert(end(prg), begin(loaderCopyBackward), end(loaderCopyBackward));
+        prg.insert(end(prg), begin(stream), end(stream));
+
+        uint32_t unpackedBytes = 0;
+        if (memBlocks.getNumMemBlocks() > 0)
+        {
+            MemBlock const &last = memBlocks.getMemBlockAt(memBlocks.getNumMemBlocks() - 1);
+            unpackedBytes = 2 + last.getStartAddress() + last.getLengthBytes() - memBlocks.getMemBlockAt(0).getStartAddress();
+        }
+
+        ret = PackedProgram{prg, unpackedBytes, estimateDepackCycles(stream)};
+    }
+
+    return ret;
+}
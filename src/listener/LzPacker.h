@@ -0,0 +1,58 @@
+#ifndef LZ_PACKER_H
+#define LZ_PACKER_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "MemBlocks.h"
+
+namespace asm6502
+{
+
+// A self-extracting program and what the packing achieved
+class PackedProgram
+{
+public:
+    std::vector<uint8_t> prg;       // starting with its load address
+    uint32_t unpackedBytes;         // of the plain .PRG, including the padding between the mem blocks
+    uint64_t depackCycles;          // estimated, from the SYS to the jump to the entry
+};
+
+// LZ77 packer for C64 programs. The packed stream holds for each mem block its address,
+// followed by tokens up to a zero byte; a block address in the zero page ends the stream:
+//   $01-$7F       that many literal bytes follow
+//   $80-$FF, lo, hi  copy (token & $7F) + MIN_MATCH bytes from lo/hi bytes before
+// Matches are searched with hash chains in the bytes of the same block. Blocks are split into
+// chunks which are parsed in parallel, the chunks are fixed so the output does not depend on
+// the number of threads.
+class LzPacker
+{
+public:
+    static uint32_t const MIN_MATCH = 4;
+    static uint32_t const MAX_MATCH = 0x7F + MIN_MATCH;
+    static uint32_t const MAX_LITERALS = 0x7F;
+    static uint32_t const MAX_CHAIN = 64;       // candidates examined per position
+    static uint32_t const CHUNK_SIZE = 0x2000;
+
+    explicit LzPacker(size_t numThreads_);
+
+    // the tokens of one block, terminated by a zero byte
+    auto pack(std::vector<uint8_t> const &bytes) const -> std::vector<uint8_t>;
+
+    // a .PRG at $0801 starting with BASIC "10 SYS 2061". The depacker moves the packed stream
+    // to the end of the memory, unpacks the mem blocks with all ROMs and I/O switched off and
+    // jumps to entryAddress. nullopt if a mem block overlaps the depacker, the moved stream, its
+    // zero page pointers ($00-$02, $FB-$FE) or the stack, or the program does not fit below $A000.
+    auto getPackedProgram(MemBlocks const &memBlocks, uint16_t entryAddress) const -> std::optional<PackedProgram>;
+
+private:
+    auto packChunk(std::vector<uint8_t> const &bytes, std::vector<int32_t> const &prev, uint32_t start, uint32_t end) const -> std::vector<uint8_t>;
+    static auto estimateDepackCycles(std::vector<uint8_t> const &stream) -> uint64_t;
+
+    size_t numThreads;
+};
+
+} // namespace
+
+#endif
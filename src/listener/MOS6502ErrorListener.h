@@ -21,16 +21,18 @@ public:
     void syntaxError(antlr4::Recognizer *recognizer, antlr4::Token *offendingSymbol, size_t line,
                              size_t charPositionInLine, const std::string &msg, std::exception_ptr e) override
     {
-        pListener->addParseError(getErrorMessage(line, charPositionInLine, msg));
+        pListener->addParseError(ErrorCode::Syntax, getSourceName(offendingSymbol), line, charPositionInLine, msg);
     }
 
 private:
 
-    std::string getErrorMessage(size_t linenr, size_t colnr, std::string const &errmsg) const
+    // tokens of included files name their file, lexer errors have no offending token
+    std::string getSourceName(antlr4::Token *offendingSymbol) const
     {
-        std::stringstream strm;
-        strm << fileName << ":" << linenr << ":" << colnr << ": error: " << errmsg << std::endl;
-        return strm.str();
+        antlr4::CharStream *pStream = (offendingSymbol != nullptr) ? offendingSymbol->getInputStream() : nullptr;
+        std::string sourceName = (pStream != nullptr) ? pStream->getSourceName() : "";
+
+        return (sourceName.empty() || (sourceName == antlr4::IntStream::UNKNOWN_SOURCE_NAME)) ? fileName : sourceName;
     }
 
     std::string fileName;
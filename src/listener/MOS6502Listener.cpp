@@ -4,89 +4,43 @@
  *  Created on: 19.08.2018
  *      Author: Ernst
  */
+#include <algorithm>
+#include <filesystem>
 #include <functional>
+#include <iomanip>
 #include <sstream>
 #include <stdexcept>
 #include <memory>
 #include <iostream>
 #include <iterator>
+#include <set>
 #include <string>
 
 #include "MOS6502Listener.h"
+#include "MappedFile.h"
+#include "OpcodeTables.h"
 
 using namespace std;
 
 namespace asm6502
 {
 
-static uint8_t const jmp_indir_opcode = 0x6C;
+// all variables share this address in the first run, only their references matter
+static uint32_t const PROVISIONAL_VARIABLE_ADDRESS = 0x80;
 
-static map<string, uint8_t> const dir_opcodes
-{
-    {"BRK", 0x00}, {"PHP", 0x08}, {"ASL", 0x0A}, {"CLC", 0x18}, {"PLP", 0x28}, {"ROL", 0x2A}, {"SEC", 0x38}, {"RTI", 0x40},
-    {"PHA", 0x48}, {"LSR", 0x4A}, {"CLI", 0x58}, {"RTS", 0x60}, {"PLA", 0x68}, {"ROR", 0x6A}, {"SEI", 0x78}, {"DEY", 0x88},
-    {"TXA", 0x8A}, {"TYA", 0x98}, {"TXS", 0x9A}, {"TAY", 0xA8}, {"TAX", 0xAA}, {"CLV", 0xB8}, {"TSX", 0xBA}, {"INY", 0xC8},
-    {"DEX", 0xCA}, {"CLD", 0xD8}, {"INX", 0xE8}, {"NOP", 0xEA}, {"SED", 0xF8}
-};
-
-static map<string, uint8_t> const imm_opcodes
-{
-    {"ORA", 0x09}, {"AND", 0x29}, {"EOR", 0x49}, {"ADC", 0x69}, {"LDY", 0xA0}, {"LDX", 0xA2}, {"LDA", 0xA9}, {"CPY", 0xC0},
-    {"CMP", 0xC9}, {"CPX", 0xE0}, {"SBC", 0xE9}
-};
-
-static map<string, uint8_t> const rel_opcodes
-{
-    {"BPL", 0x10}, {"BMI", 0x30}, {"BVC", 0x50}, {"BVS", 0x70}, {"BCC", 0x90}, {"BCS", 0xB0}, {"BNE", 0xD0}, {"BEQ", 0xF0}
-};
-
-static map<string, uint8_t> const idx_x_opcodes
-{
-    {"ORA", 0x1D}, {"ASL", 0x1E}, {"AND", 0x3D}, {"ROL", 0x3E}, {"EOR", 0x5D}, {"LSR", 0x5E}, {"ADC", 0x7D}, {"ROR", 0x7E},
-    {"STA", 0x9D}, {"LDY", 0xBC}, {"LDA", 0xBD}, {"CMP", 0xDD}, {"DEC", 0xDE}, {"SBC", 0xFD}, {"INC", 0xFE}
-};
-
-static map<string, uint8_t> const idx_x_zpg_opcodes
-{
-    {"ORA", 0x15}, {"ASL", 0x16}, {"AND", 0x35}, {"ROL", 0x36}, {"EOR", 0x55}, {"LSR", 0x56}, {"ADC", 0x75}, {"ROR", 0x76},
-    {"STY", 0x94}, {"STA", 0x95}, {"LDY", 0xB4}, {"LDA", 0xB5}, {"CMP", 0xD5}, {"DEC", 0xD6}, {"DBC", 0xF5}, {"INC", 0xF6}
-};
-
-static map<string, uint8_t> const idx_y_opcodes
-{
-    {"ORA", 0x19}, {"AND", 0x39}, {"EOR", 0x59}, {"ADC", 0x79}, {"STA", 0x99}, {"LDA", 0xB9}, {"LDX", 0xBE}, {"CMP", 0xD9},
-    {"SBC", 0xF9}
-};
-
-static map<string, uint8_t> const idx_y_zpg_opcodes
-{
-    {"STX", 0x96}, {"LDX", 0xB6}
-};
-
-static map<string, uint8_t> const abs_opcodes
-{
-    {"ORA", 0x0D}, {"ASL", 0x0E}, {"JSR", 0x20}, {"BIT", 0x2C}, {"AND", 0x2D}, {"ROL", 0x2E}, {"JMP", 0x4C},
-    {"EOR", 0x4D}, {"LSR", 0x4E}, {"ADC", 0x6D}, {"ROR", 0x6E}, {"STY", 0x8C}, {"STA", 0x8D}, {"STX", 0x8E}, {"LDY", 0xAC},
-    {"LDA", 0xAD}, {"LDX", 0xAE}, {"CPY", 0xCC}, {"CMP", 0xCD}, {"DEC", 0xCE}, {"CPX", 0xEC}, {"SBC", 0xED}, {"INC", 0xEE}
-};
+// the zero page addresses not used by the C64 BASIC interpreter and KERNAL
+static vector<AddressRange> const DEFAULT_ZERO_PAGE_POOL{{0xFB, 0xFF}};
 
-static map<string, uint8_t> const abs_zpg_opcodes
-{
-    {"ORA", 0x05}, {"ASL", 0x06}, {"BIT", 0x24}, {"AND", 0x25}, {"ROL", 0x26}, {"EOR", 0x45}, {"LSR", 0x46}, {"ADC", 0x65},
-    {"ROR", 0x66}, {"STY", 0x84}, {"STA", 0x85}, {"STX", 0x86}, {"LDY", 0xA4}, {"LDA", 0xA5}, {"LDX", 0xA6}, {"CPY", 0xC4},
-    {"CMP", 0xC5}, {"DEC", 0xC6}, {"CPX", 0xE4}, {"SBC", 0xE5}, {"INC", 0xE6}
-};
+// expressions and symbols of one line, lines with more grow the buffers once
+static size_t const LINE_SCRATCH_CAPACITY = 32;
 
-static map<string, uint8_t> const idx_idr_opcodes
+// addresses and operands in error messages
+static auto toHex(uint32_t value) -> string
 {
-    {"ORA", 0x01}, {"AND", 0x21}, {"EOR", 0x41}, {"ADC", 0x61}, {"STA", 0x81}, {"LDA", 0xA1}, {"CMP", 0xC1}, {"SBC", 0xE1}
-};
-
-static map<string, uint8_t> const idr_idx_opcodes
-{
-    {"ORA", 0x11}, {"AND", 0x31}, {"EOR", 0x51}, {"ADC", 0x71}, {"STA", 0x91}, {"LDA", 0xB1}, {"CMP", 0xD1}, {"SBC", 0xF1}
-};
-
+    stringstream strm;
+    strm << hex << setw(4) << setfill('0') << value;
+    return strm.str();
+}
 
 auto findOpCode(map<string, uint8_t> const &opcodeMap, string const &opcode) -> uint8_t
 {
@@ -110,251 +64,658 @@ auto findIdxZpgOpCodes(map<string, uint8_t> const &opcodeMap, map<string, uint8_
 }
 
 
-static function<TOptExprValue(TOptExprValue, TOptExprValue)> const add = [](TOptExprValue arg1, TOptExprValue arg2)
+// evaluates postfix items, symbols are looked up in symbolTable, the address of a relocatable
+// label is only known to the linker
+static auto evalPostfixItems(PostfixItem const *first, PostfixItem const *last, SymbolTable const &symbolTable, ScratchBuffer<uint32_t> &stack) -> TOptExprValue
 {
+    auto lookup = [&symbolTable](string const &symbol)
+    {
+        std::optional<Sym> optSym = symbolTable.resolveSymbol(symbol);
+        return ((optSym != std::nullopt) && !optSym.value().relocatable) ? TOptExprValue(optSym.value().val) : std::nullopt;
+    };
+
     TOptExprValue ret = std::nullopt;
 
-    if ((arg1 != std::nullopt) && (arg2 != std::nullopt))
+    // most operands are a single value or symbol
+    if ((last - first == 1) && (first->op == PostfixOp::Value))
     {
-        ret = TOptExprValue(arg1.value() + arg2.value());
+        ret = first->value;
+    }
+    else if ((last - first == 1) && (first->op == PostfixOp::Symbol))
+    {
+        ret = lookup(first->symbol);
+    }
+    else
+    {
+        ret = evalPostfix(first, last, {}, lookup, stack);
     }
 
     return ret;
-};
+}
 
-static function<TOptExprValue(TOptExprValue, TOptExprValue)> const sub = [](TOptExprValue arg1, TOptExprValue arg2)
+auto PostfixExpr::eval(SymbolTable const &symbolTable, ScratchBuffer<uint32_t> &stack) const -> TOptExprValue
 {
-    TOptExprValue ret = std::nullopt;
+    return evalPostfixItems(items.data(), items.data() + items.size(), symbolTable, stack);
+}
 
-    if ((arg1 != std::nullopt) && (arg2 != std::nullopt))
+auto PostfixExpr::getText() const -> std::string
+{
+    std::string ret = "<<expression>>";
+
+    if ((items.size() == 1) && (items[0].op == PostfixOp::Symbol))
+    {
+        ret = items[0].symbol;
+    }
+    else if (items.size() == 1)
     {
-        ret = TOptExprValue(arg1.value() - arg2.value());
+        ret = std::to_string(items[0].value);
     }
 
     return ret;
-};
+}
 
-static function<TOptExprValue(TOptExprValue, TOptExprValue)> const div = [](TOptExprValue arg1, TOptExprValue arg2)
+void PostfixExpr::collectSymbols(std::vector<std::string> &symbols) const
 {
-    TOptExprValue ret = std::nullopt;
+    for (auto const &item : items)
+    {
+        if (item.op == PostfixOp::Symbol)
+        {
+            symbols.push_back(item.symbol);
+        }
+    }
+}
 
-    if ((arg1 != std::nullopt) && (arg2 != std::nullopt))
+void PostfixExpr::toPostfix(SymbolTable const &symbolTable, PostfixExpression &postfix) const
+{
+    for (auto const &item : items)
     {
-        ret = TOptExprValue(arg1.value() / arg2.value());
+        std::optional<Sym> optSym = (item.op == PostfixOp::Symbol) ? symbolTable.resolveSymbol(item.symbol) : std::nullopt;
+
+        if (optSym == std::nullopt)
+        {
+            postfix.push_back(item);
+        }
+        else if (optSym.value().relocatable)
+        {
+            postfix.push_back({PostfixOp::SectionBase, relocatableSectionOf(optSym.value().val), ""});
+            postfix.push_back({PostfixOp::Value, optSym.value().val & 0xffffU, ""});
+            postfix.push_back({PostfixOp::Add, 0, ""});
+        }
+        else
+        {
+            postfix.push_back({PostfixOp::Value, optSym.value().val, ""});
+        }
     }
+}
 
-    return ret;
-};
 
-static function<TOptExprValue(TOptExprValue, TOptExprValue)> const mul = [](TOptExprValue arg1, TOptExprValue arg2)
+MOS6502Listener::MOS6502Listener(char const *pFileName) :
+        fileName{pFileName},
+        sourceFiles{pFileName},
+        pLastSourceStream{nullptr},
+        lastSourceFileId{0},
+        currentAddress{0},
+        addressOfLine{ADDR_INVALID},
+        expressionStack{LINE_SCRATCH_CAPACITY},
+        linePostfix{LINE_SCRATCH_CAPACITY},
+        expressionDepthLimit{0},
+        exprValues{LINE_SCRATCH_CAPACITY},
+        evalStack{LINE_SCRATCH_CAPACITY},
+        errorLimit{0},
+        dataDirective{DataDirective::None},
+        statementCount{0},
+        lineHasLabel{false},
+        lineSymbols{LINE_SCRATCH_CAPACITY},
+        blockStart{0},
+        blockFileId{0},
+        blockLine{1},
+        blockCol{0},
+        objectMode{false},
+        undocumentedOpcodes{false},
+        currentSection{ABSOLUTE_SECTION},
+        relocatableUsed{false}
 {
-    TOptExprValue ret = std::nullopt;
+}
 
-    if ((arg1 != std::nullopt) && (arg2 != std::nullopt))
+// The tokens of included files refer to an input stream named after their file,
+// the tokens of the assembled file to the main input stream.
+auto MOS6502Listener::fileId(antlr4::ParserRuleContext const *ctx) -> size_t
+{
+    antlr4::CharStream *pStream = ctx->getStart()->getInputStream();
+
+    if (pStream != pLastSourceStream)
     {
-        ret = TOptExprValue(arg1.value() * arg2.value());
+        lastSourceFileId = getFileId((pStream != nullptr) ? pStream->getSourceName() : "");
+        pLastSourceStream = pStream;
     }
 
-    return ret;
-};
+    return lastSourceFileId;
+}
 
-static function<TOptExprValue(TOptExprValue, TOptExprValue)> const mod = [](TOptExprValue arg1, TOptExprValue arg2)
+auto MOS6502Listener::getFileId(std::string const &sourceName) -> size_t
 {
-    TOptExprValue ret = std::nullopt;
+    size_t ret = 0;
 
-    if ((arg1 != std::nullopt) && (arg2 != std::nullopt))
+    if (!sourceName.empty() && (sourceName != antlr4::IntStream::UNKNOWN_SOURCE_NAME) && (sourceName != fileName))
     {
-        ret = TOptExprValue(arg1.value() % arg2.value());
+        auto pos = find(begin(sourceFiles), end(sourceFiles), sourceName);
+        ret = distance(begin(sourceFiles), pos);
+
+        if (pos == end(sourceFiles))
+        {
+            sourceFiles.push_back(sourceName);
+        }
     }
 
     return ret;
-};
+}
 
-class ExpressionBase : public IExpression
+void MOS6502Listener::exitOrg_directive(MOS6502Parser::Org_directiveContext *ctx)
 {
-public:
-    ExpressionBase(size_t line_, size_t column_) : line{line_}, column{column_} {}
-    [[nodiscard]] auto getLine() const -> size_t override { return line; }
-    [[nodiscard]] auto getColumn() const -> size_t override { return column; }
-private:
-    size_t line;
-    size_t column;
-};
+    TOptExprValue optCurrAddr = popExpression();
+
+    if (optCurrAddr != std::nullopt)
+    {
+        closeBlock();
+        currentSection = ABSOLUTE_SECTION;
+        openBlock(optCurrAddr.value(), ctx);
+        addressOfLine = optCurrAddr.value();
+    } 
+}
 
-class Numeric : public ExpressionBase
+// .SEGMENT name: the following code is a relocatable section, placed in segment name by the linker
+void MOS6502Listener::exitSegment_directive(MOS6502Parser::Segment_directiveContext *ctx)
 {
-public:
-    Numeric(uint32_t _val, size_t line_, size_t col_) : ExpressionBase {line_, col_}, val{_val} {}
-    [[nodiscard]] auto eval(SymbolTable const &symbolTable) const -> TOptExprValue override 
+    if (objectMode)
+    {
+        closeBlock();
+        relocatableSections.push_back(RelocatableSection{ctx->ID()->getText(), 0, {}});
+        currentSection = static_cast<uint32_t>(relocatableSections.size() - 1);
+        openBlock(relocatableSectionAddress(currentSection), ctx);
+    }
+    else
     {
-        return {val};
+        addSegmentOutsideObjectModeError(ctx);
     }
+}
+
+// .RES count: reserves count bytes without payload, e.g. for variables
+void MOS6502Listener::exitRes_directive(MOS6502Parser::Res_directiveContext *ctx)
+{
+    TOptExprValue optCount = popExpression();
+    uint32_t maxCount = addressLimit() - currentAddress;
 
-    [[nodiscard]] auto getText() const -> std::string override
+    if (optCount == std::nullopt)
+    {
+        addMissingSymbolError(ctx->expression()->getText(), fileId(ctx), line(ctx), col(ctx));
+    }
+    else if (optCount.value() > maxCount)
+    {
+        addValueOutOfRangeError(optCount.value(), 0, maxCount, ctx);
+    }
+    else
     {
-        std::stringstream strm;
-        strm << val;
-        return strm.str();
+        currentAddress += optCount.value();
     }
+}
+
+// .VAR name, size: in the first run all variables share a provisional zero page address, later
+// variables outside the zero page take their space at the declaration
+void MOS6502Listener::exitVar_directive(MOS6502Parser::Var_directiveContext *ctx)
+{
+    string symName = ctx->ID()->getText();
+    TOptExprValue optSize = (ctx->expression() != nullptr) ? popExpression() : TOptExprValue(1);
 
-private:
-    uint32_t val;
-};
+    if (optSize == std::nullopt)
+    {
+        addMissingSymbolError(ctx->expression()->getText(), fileId(ctx), line(ctx), col(ctx));
+    }
+    else if ((optSize.value() == 0) || (optSize.value() > 0x100U))
+    {
+        addValueOutOfRangeError(optSize.value(), 1, 0x100U, ctx);
+    }
+    else if (!zeroPageVariables.has_value())
+    {
+        variables.push_back(VariableDeclaration{symName, optSize.value(), fileId(ctx), line(ctx), col(ctx)});
+        addSymbolCheckAlreadyDefined(symName, PROVISIONAL_VARIABLE_ADDRESS, ctx);
+    }
+    else if (zeroPageVariables.value().count(symName) > 0)
+    {
+        variables.push_back(VariableDeclaration{symName, optSize.value(), fileId(ctx), line(ctx), col(ctx)});
+        addSymbolCheckAlreadyDefined(symName, zeroPageVariables.value().at(symName), ctx);
+    }
+    else if (optSize.value() > addressLimit() - currentAddress)
+    {
+        addValueOutOfRangeError(optSize.value(), 1, addressLimit() - currentAddress, ctx);
+    }
+    else
+    {
+        variables.push_back(VariableDeclaration{symName, optSize.value(), fileId(ctx), line(ctx), col(ctx)});
+        addSymbolCheckAlreadyDefined(symName, currentAddress, ctx, isRelocatable());
+        relocatableUsed = relocatableUsed || isRelocatable();
+        currentAddress += optSize.value();
+    }
+}
 
-class Symbol : public ExpressionBase
+// .ZPPOOL first, last: zero page addresses available to variables
+void MOS6502Listener::exitZppool_directive(MOS6502Parser::Zppool_directiveContext *ctx)
 {
-public:
-    Symbol(string const _symbol, size_t line_, size_t col_) : ExpressionBase {line_, col_}, symbol{_symbol} {}
-    [[nodiscard]] auto eval(SymbolTable const &symbolTable) const -> TOptExprValue override
+    ScratchBuffer<TOptExprValue> const &firstAndLast = popAllExpressions();
+
+    if ((firstAndLast.size() != 2) || (firstAndLast[0] == std::nullopt) || (firstAndLast[1] == std::nullopt))
     {
-        TOptExprValue ret = std::nullopt;
+        addMissingSymbolError(ctx->getText(), fileId(ctx), line(ctx), col(ctx));
+    }
+    else if ((firstAndLast[1].value() > 0xffU) || (firstAndLast[0].value() > firstAndLast[1].value()))
+    {
+        addValueOutOfRangeError(firstAndLast[1].value(), firstAndLast[0].value(), 0xffU, ctx);
+    }
+    else
+    {
+        zeroPagePool.emplace_back(firstAndLast[0].value(), firstAndLast[1].value() + 1);
+    }
+}
 
-        std::optional<Sym> optSym = symbolTable.resolveSymbol(symbol);
+auto MOS6502Listener::getZeroPagePool() const -> vector<AddressRange>
+{
+    return zeroPagePool.empty() ? DEFAULT_ZERO_PAGE_POOL : zeroPagePool;
+}
 
-        if (optSym != std::nullopt)
-        {
-            ret = TOptExprValue(optSym.value().val);
-        }
+void MOS6502Listener::setObjectMode(bool objectMode_)
+{
+    objectMode = objectMode_;
+    relocatableSections.clear();
+    currentSection = ABSOLUTE_SECTION;
 
-        return ret;
+    if (objectMode)
+    {
+        relocatableSections.push_back(RelocatableSection{"CODE", 0, {}});
+        currentSection = 0;
+        currentAddress = relocatableSectionAddress(currentSection);
+        blockStart = currentAddress;
     }
+}
 
-    [[nodiscard]] auto getText() const -> std::string override { return symbol; }
-
-private:
-    string symbol;
-};
+void MOS6502Listener::exitR(MOS6502Parser::RContext * /*ctx*/)
+{
+    closeBlock();
+}
 
-class BinaryOperation : public ExpressionBase
+// blocks must not overlap, a block of a relocatable section gets the size of the section
+void MOS6502Listener::closeBlock()
 {
-public:
-    BinaryOperation(
-        shared_ptr<IExpression> _arg1, 
-        shared_ptr<IExpression> _arg2, 
-        function<TOptExprValue(TOptExprValue, TOptExprValue)> const *_op,
-        size_t line_,
-        size_t col_) :
-        ExpressionBase {line_, col_},
-        arg1{_arg1},
-        arg2{_arg2},
-        op{_op}
-        {};
+    std::optional<AddressRange> overlap = occupied.insert(blockStart, currentAddress);
 
-    [[nodiscard]] auto eval(SymbolTable const &symbolTable) const -> TOptExprValue override
+    if (overlap != std::nullopt)
     {
-        return (*op)(arg1->eval(symbolTable), arg2->eval(symbolTable));
+        addOverlappingBlocksError({blockStart, currentAddress}, overlap.value());
     }
 
-    [[nodiscard]] auto getText() const -> std::string override { return "<<expression>>"; }
+    if (isRelocatable())
+    {
+        relocatableSections[currentSection].size = currentAddress - relocatableSectionAddress(currentSection);
+    }
 
-private:
-    shared_ptr<IExpression> const arg1;
-    shared_ptr<IExpression> const arg2;
-    function<TOptExprValue(TOptExprValue, TOptExprValue)> const *op;
-};
+    // the section before the first .ORG or .SEGMENT is dropped if it is not used
+    if ((currentSection == 0) && (relocatableSections.size() == 1) && (relocatableSections[0].size == 0) && !relocatableUsed)
+    {
+        relocatableSections.clear();
+    }
+}
 
+void MOS6502Listener::openBlock(uint32_t address, antlr4::ParserRuleContext const *ctx)
+{
+    currentAddress = address;
+    blockStart = address;
+    blockFileId = fileId(ctx);
+    blockLine = line(ctx);
+    blockCol = col(ctx);
+}
 
-MOS6502Listener::MOS6502Listener(char const *pFileName) :
-        fileName{pFileName},
-        currentAddress{0},
-        addressOfLine{ADDR_INVALID}
+// data items are stored while they are parsed, the directives only tell how
+void MOS6502Listener::enterByte_directive(MOS6502Parser::Byte_directiveContext * /*ctx*/)
 {
+    dataDirective = DataDirective::Byte;
 }
 
-void MOS6502Listener::exitOrg_directive(MOS6502Parser::Org_directiveContext *ctx)
+void MOS6502Listener::enterWord_directive(MOS6502Parser::Word_directiveContext * /*ctx*/)
 {
-    TOptExprValue optCurrAddr = popExpression();
-    if (optCurrAddr != std::nullopt)
-    {
-        addressOfLine = optCurrAddr.value();
-        currentAddress = optCurrAddr.value();
-    } 
+    dataDirective = DataDirective::Word;
 }
 
-void MOS6502Listener::exitByte_directive(MOS6502Parser::Byte_directiveContext *ctx)
+void MOS6502Listener::enterDbyte_directive(MOS6502Parser::Dbyte_directiveContext * /*ctx*/)
 {
-    for (auto optByte : popAllExpressions())
+    dataDirective = DataDirective::DByte;
+}
+
+void MOS6502Listener::exitByte_directive(MOS6502Parser::Byte_directiveContext * /*ctx*/)
+{
+    dataDirective = DataDirective::None;
+}
+
+void MOS6502Listener::exitWord_directive(MOS6502Parser::Word_directiveContext * /*ctx*/)
+{
+    dataDirective = DataDirective::None;
+}
+
+void MOS6502Listener::exitDbyte_directive(MOS6502Parser::Dbyte_directiveContext * /*ctx*/)
+{
+    dataDirective = DataDirective::None;
+}
+
+// plain literals and strings have been stored already, only expressions are left
+void MOS6502Listener::exitData(MOS6502Parser::DataContext *ctx)
+{
+    if (ctx->expression() != nullptr)
     {
-        if (optByte != std::nullopt)
+        auto [optVal, optExpression] = popDeferrableExpression();
+
+        if (optVal != std::nullopt)
+        {
+            appendDataItem(optVal.value(), ctx);
+        }
+        else if ((optExpression != std::nullopt) && (dataDirective != DataDirective::None))
+        {
+            // reserve the item and patch it when all symbols are known
+            deferredDataItems.emplace_back(DeferredDataEval(dataDirective, std::move(optExpression.value()), currentAddress, fileId(ctx), line(ctx), col(ctx)));
+            appendByteToPayload(0xff);
+
+            if (dataDirective != DataDirective::Byte)
+            {
+                appendByteToPayload(0xff);
+            }
+        }
+        else
         {
-            auto byteVal = optByte.value();
+            addInternalError(fileId(ctx), line(ctx), col(ctx));
+        }
+    }
+}
 
-            if (byteVal > 255)
+void MOS6502Listener::appendDataItem(uint32_t val, antlr4::ParserRuleContext const *ctx)
+{
+    switch (dataDirective)
+    {
+        case DataDirective::Byte:
+            if (val > 255)
             {
-                addValueOutOfRangeError(byteVal, 0, 255, ctx);
+                addValueOutOfRangeError(val, 0, 255, ctx);
             }
             else
             {
-                appendByteToPayload(byteVal);
+                appendByteToPayload(static_cast<uint8_t>(val));
             }
-        }
+            break;
+
+        case DataDirective::Word:
+        case DataDirective::DByte:
+            if (val > 65535)
+            {
+                addValueOutOfRangeError(val, 0, 65535, ctx);
+            }
+            else if (dataDirective == DataDirective::Word)
+            {
+                addWordToPayload(static_cast<uint16_t>(val));
+            }
+            else
+            {
+                addDByteToPayload(static_cast<uint16_t>(val));
+            }
+            break;
+
+        case DataDirective::None:
+            addInternalError(fileId(ctx), line(ctx), col(ctx));
+            break;
     }
 }
 
-void MOS6502Listener::exitWord_directive(MOS6502Parser::Word_directiveContext *ctx)
+// a literal is a data item on its own if it is not part of an expression
+auto MOS6502Listener::isDataLiteral(antlr4::ParserRuleContext const *ctx) -> bool
 {
-    for (auto optWord : popAllExpressions())
+    antlr4::tree::ParseTree const *pParent = ctx->parent;
+
+    if (dynamic_cast<MOS6502Parser::Numerical_byteContext const *>(pParent) != nullptr)
     {
-        if (optWord != std::nullopt)
+        pParent = pParent->parent;
+    }
+
+    return (dynamic_cast<MOS6502Parser::NumericalContext const *>(pParent) != nullptr) &&
+           (dynamic_cast<MOS6502Parser::DataContext const *>(pParent->parent) != nullptr);
+}
+
+void MOS6502Listener::pushLiteral(uint32_t val, antlr4::ParserRuleContext const *ctx)
+{
+    if (isDataLiteral(ctx))
+    {
+        appendDataItem(val, ctx);
+    }
+    else
+    {
+        pushExpressionItem({PostfixOp::Value, val, ""}, ctx);
+    }
+}
+
+void MOS6502Listener::exitLabel(MOS6502Parser::LabelContext *ctx)
+{
+    string symName = ctx->ID()->getText();
+    addSymbolCheckAlreadyDefined(symName, currentAddress, ctx, isRelocatable());
+    lineHasLabel = true;
+    relocatableUsed = relocatableUsed || isRelocatable();
+}
+
+void MOS6502Listener::exitAss_directive(MOS6502Parser::Ass_directiveContext *ctx)
+{
+    string symName = ctx->ID()->getText();
+    auto [optExprVal, optExpression] = popDeferrableExpression();
+
+    if (optExprVal != std::nullopt)
+    {
+        addSymbolCheckAlreadyDefined(symName, optExprVal.value(), ctx);
+    }
+    else if (optExpression == std::nullopt)
+    {
+        addInternalError(fileId(ctx), line(ctx), col(ctx));
+    }
+    else if (symbolTable.resolveSymbol(symName) != std::nullopt)
+    {
+        addDuplicateSymbolError(symName, symbolTable.resolveSymbol(symName).value(), ctx);
+    }
+    else if (pendingAssignmentIdx.find(symName) != end(pendingAssignmentIdx))
+    {
+        PendingAssignment const &pending = pendingAssignments[pendingAssignmentIdx[symName]];
+        addDuplicateSymbolError(symName, Sym{pending.srcLine, pending.srcCol, 0, pending.fileId}, ctx);
+    }
+    else
+    {
+        // the expression refers to symbols defined later, see resolvePendingAssignments()
+        pendingAssignmentIdx[symName] = pendingAssignments.size();
+        pendingAssignments.push_back(PendingAssignment{symName, std::move(optExpression.value()), fileId(ctx), line(ctx), col(ctx)});
+    }
+}
+
+// Assignments referring to symbols defined after them are resolved in the order of
+// their dependencies: an assignment is evaluated as soon as all pending assignments it
+// refers to have been evaluated (Kahn's algorithm). Assignments left over depend on
+// each other in a cycle.
+void MOS6502Listener::resolvePendingAssignments()
+{
+    size_t numPending = pendingAssignments.size();
+    vector<size_t> numOpenDependencies(numPending, 0);
+    vector<vector<size_t>> dependents(numPending);
+    vector<size_t> ready;
+
+    for (size_t idx = 0; idx < numPending; idx++)
+    {
+        vector<string> symNames;
+        pendingAssignments[idx].expr.collectSymbols(symNames);
+        sort(begin(symNames), end(symNames));
+        symNames.erase(unique(begin(symNames), end(symNames)), end(symNames));
+
+        for (auto const &symName : symNames)
         {
-            auto wordVal = optWord.value();
-            if (wordVal > 65535)
+            auto pos = pendingAssignmentIdx.find(symName);
+            if (pos != end(pendingAssignmentIdx))
             {
-                addValueOutOfRangeError(wordVal, 0, 65535, ctx);
+                dependents[pos->second].push_back(idx);
+                numOpenDependencies[idx]++;
             }
-            else
+        }
+
+        if (numOpenDependencies[idx] == 0)
+        {
+            ready.push_back(idx);
+        }
+    }
+
+    for (size_t readyIdx = 0; readyIdx < ready.size(); readyIdx++)
+    {
+        PendingAssignment const &assignment = pendingAssignments[ready[readyIdx]];
+        TOptExprValue optExprVal = assignment.expr.eval(symbolTable, evalStack);
+
+        if (optExprVal != std::nullopt)
+        {
+            symbolTable.addSymbol(assignment.symName, assignment.srcLine, assignment.srcCol, optExprVal.value(), assignment.fileId);
+        }
+        else if (objectMode)
+        {
+            ObjectSymbol symbol{assignment.symName, {}, false, assignment.fileId, assignment.srcLine, assignment.srcCol};
+            assignment.expr.toPostfix(symbolTable, symbol.expr);
+            objectSymbols.push_back(symbol);
+        }
+        else
+        {
+            addMissingSymbolError(assignment.symName, assignment.fileId, assignment.srcLine, assignment.srcCol);
+        }
+
+        for (size_t dependent : dependents[ready[readyIdx]])
+        {
+            if (--numOpenDependencies[dependent] == 0)
             {
-                addWordToPayload(wordVal);
+                ready.push_back(dependent);
             }
         }
     }
+
+    for (size_t idx = 0; idx < numPending; idx++)
+    {
+        if (numOpenDependencies[idx] > 0)
+        {
+            addCircularDefinitionError(pendingAssignments[idx].symName, pendingAssignments[idx].fileId, pendingAssignments[idx].srcLine, pendingAssignments[idx].srcCol);
+        }
+    }
+
+    pendingAssignments.clear();
+    pendingAssignmentIdx.clear();
 }
 
-void MOS6502Listener::exitDbyte_directive(MOS6502Parser::Dbyte_directiveContext *ctx)
+// .GENBYTE i, count, expression: evaluates the expression for i = 0 .. count-1
+// and appends the results to the payload, .GENWORD stores them little endian
+void MOS6502Listener::exitGen_directive(MOS6502Parser::Gen_directiveContext *ctx)
 {
-    for (auto optDbyte : popAllExpressions())
+    bool isWord = (ctx->gen_type()->getText() == "GENWORD");
+    uint32_t maxValue = isWord ? 0xffffU : 0xffU;
+    string indexName = ctx->ID()->getText();
+    std::optional<PostfixExpr> optExpression = popNonEvalExpression();
+    TOptExprValue optCount = popExpression();
+
+    if ((optExpression == std::nullopt) || (optCount == std::nullopt))
+    {
+        addMissingSymbolError(ctx->expression(0)->getText(), fileId(ctx), line(ctx), col(ctx));
+    }
+    else if (optCount.value() > 0x10000U)
     {
-        if (optDbyte != std::nullopt)
+        addValueOutOfRangeError(optCount.value(), 0, 0x10000U, ctx);
+    }
+    else
+    {
+        // the index variable shadows a symbol of the same name, but only within the directive
+        SymbolTable indexSymbols = symbolTable;
+
+        for (uint32_t idx = 0; idx < optCount.value(); idx++)
         {
-            auto dByteVal = optDbyte.value();
-            if (dByteVal > 65535)
+            indexSymbols.addSymbol(indexName, line(ctx), col(ctx), idx, fileId(ctx));
+            TOptExprValue optVal = optExpression.value().eval(indexSymbols, evalStack);
+
+            if (optVal == std::nullopt)
+            {
+                addMissingSymbolError(ctx->expression(1)->getText(), fileId(ctx), line(ctx), col(ctx));
+                break;
+            }
+            else if (optVal.value() > maxValue)
+            {
+                addValueOutOfRangeError(optVal.value(), 0, maxValue, ctx);
+                break;
+            }
+            else if (isWord)
             {
-                addValueOutOfRangeError(dByteVal, 0, 65535, ctx);
+                addWordToPayload(static_cast<uint16_t>(optVal.value()));
             }
             else
             {
-                addDByteToPayload(dByteVal);
+                appendByteToPayload(static_cast<uint8_t>(optVal.value()));
             }
         }
     }
 }
 
-void MOS6502Listener::exitLabel(MOS6502Parser::LabelContext *ctx)
+// .INCBIN "file", offset, length: copies the bytes of a file into the payload, file names
+// are relative to the directory of the assembled file
+void MOS6502Listener::exitIncbin_directive(MOS6502Parser::Incbin_directiveContext *ctx)
 {
-    string symName = ctx->ID()->getText();
-    addSymbolCheckAlreadyDefined(symName, currentAddress, ctx);
-}
+    auto nameWithQuotes = ctx->STRING()->getText();
+    filesystem::path binPath(nameWithQuotes.substr(1, nameWithQuotes.length() - 2));
 
-void MOS6502Listener::exitAss_directive(MOS6502Parser::Ass_directiveContext *ctx)
-{
-    string symName = ctx->ID()->getText();
-    TOptExprValue optExprVal = popExpression();
-    if (optExprVal != std::nullopt)
+    if (binPath.is_relative())
     {
-        addSymbolCheckAlreadyDefined(symName, optExprVal.value(), ctx);
+        binPath = filesystem::path(getSourceFile(fileId(ctx))).parent_path() / binPath;
+    }
+
+    ScratchBuffer<TOptExprValue> const &offsetAndLength = popAllExpressions();
+    bool resolved = std::all_of(begin(offsetAndLength), end(offsetAndLength), [](TOptExprValue const &val) { return val != std::nullopt; });
+    MappedFile binFile(binPath.string());
+
+    if (!resolved)
+    {
+        addMissingSymbolError(ctx->getText(), fileId(ctx), line(ctx), col(ctx));
+    }
+    else if (!binFile.isOpen())
+    {
+        addFileNotReadableError(binPath.string(), ctx);
     }
     else
     {
-        addMissingSymbolError(symName, line(ctx), col(ctx));
+        size_t fileSize = binFile.getSize();
+        size_t offset = (offsetAndLength.size() > 0) ? offsetAndLength[0].value() : 0;
+        size_t length = (offsetAndLength.size() > 1) ? offsetAndLength[1].value() : fileSize - std::min(offset, fileSize);
+
+        if (offset > fileSize)
+        {
+            addValueOutOfRangeError(static_cast<uint32_t>(offset), 0, static_cast<uint32_t>(fileSize), ctx);
+        }
+        else if ((length > fileSize - offset) || (currentAddress + length > addressLimit()))
+        {
+            addValueOutOfRangeError(static_cast<uint32_t>(length), 0, static_cast<uint32_t>(std::min<size_t>(fileSize - offset, addressLimit() - currentAddress)), ctx);
+        }
+        else
+        {
+            appendBytesToPayload(binFile.getData() + offset, length);
+        }
     }
 }
 
-void MOS6502Listener::addSymbolCheckAlreadyDefined(string const &symName, uint32_t symVal, antlr4::ParserRuleContext *ctx)
+void MOS6502Listener::addSymbolCheckAlreadyDefined(string const &symName, uint32_t symVal, antlr4::ParserRuleContext *ctx, bool relocatable)
 {
     std::optional<Sym> optSym = symbolTable.resolveSymbol(symName);
-    if (optSym == std::nullopt)
+    auto pendingPos = pendingAssignmentIdx.find(symName);
+
+    if (pendingPos != end(pendingAssignmentIdx))
     {
-        symbolTable.addSymbol(symName, line(ctx), col(ctx), symVal);
+        PendingAssignment const &pending = pendingAssignments[pendingPos->second];
+        addDuplicateSymbolError(symName, Sym{pending.srcLine, pending.srcCol, 0, pending.fileId}, ctx);
+    }
+    else if (optSym == std::nullopt)
+    {
+        symbolTable.addSymbol(symName, line(ctx), col(ctx), symVal, fileId(ctx), relocatable);
     }
     else
     {
@@ -369,6 +730,7 @@ void MOS6502Listener::exitDir_statement(MOS6502Parser::Dir_statementContext *ctx
 
 void MOS6502Listener::exitImm_statement(MOS6502Parser::Imm_statementContext *ctx)
 {
+    checkUndocumentedOpcode(ctx->imm_opcode()->getText(), ctx);
     auto opCode = findOpCode(imm_opcodes, ctx->imm_opcode()->getText());
     appendIdxIdrOrIdrIdxOrImmCmd(opCode, ctx);
 }
@@ -379,15 +741,16 @@ void MOS6502Listener::exitRel_statement(MOS6502Parser::Rel_statementContext *ctx
 
     // the relative operand can only be resolved at the end of the assembler
     // run, since labels can be assigned here that have not yet been parsed
-    auto label = make_shared<Symbol>(ctx->symbol()->getText(), line(ctx), col(ctx));
+    PostfixExpr label(PostfixExpression{{PostfixOp::Symbol, 0, ctx->symbol()->getText()}}, fileId(ctx), line(ctx), col(ctx));
 
-    branchTargets.emplace_back(pair<uint32_t, shared_ptr<IExpression>>{currentAddress, label});
+    branchTargets.emplace_back(currentAddress, std::move(label));
     ++currentAddress;
 }
 
 void MOS6502Listener::exitIdx_x_statement(MOS6502Parser::Idx_x_statementContext *ctx)
 {
     auto opcodeStr = ctx->idx_opcode()->getText();
+    checkUndocumentedOpcode(opcodeStr, ctx);
     auto opCodeZpgOpCode = findIdxZpgOpCodes(idx_x_opcodes, idx_x_zpg_opcodes, opcodeStr);
     appendIdxOrZpgCmd(opCodeZpgOpCode.first, opCodeZpgOpCode.second, ctx);
 }
@@ -395,6 +758,7 @@ void MOS6502Listener::exitIdx_x_statement(MOS6502Parser::Idx_x_statementContext
 void MOS6502Listener::exitIdx_y_statement(MOS6502Parser::Idx_y_statementContext *ctx)
 {
     auto opcodeStr = ctx->idy_opcode()->getText();
+    checkUndocumentedOpcode(opcodeStr, ctx);
     auto opCodeZpgOpCode = findIdxZpgOpCodes(idx_y_opcodes, idx_y_zpg_opcodes, opcodeStr);
     appendIdxOrZpgCmd(opCodeZpgOpCode.first, opCodeZpgOpCode.second, ctx);
 }
@@ -402,31 +766,46 @@ void MOS6502Listener::exitIdx_y_statement(MOS6502Parser::Idx_y_statementContext
 void MOS6502Listener::exitIdx_abs_statement(MOS6502Parser::Idx_abs_statementContext *ctx)
 {
     auto opcodeStr = ctx->idabs_opcode()->getText();
+    checkUndocumentedOpcode(opcodeStr, ctx);
     auto opCodeZpgOpCode = findIdxZpgOpCodes(abs_opcodes, abs_zpg_opcodes, opcodeStr);
     appendIdxOrZpgCmd(opCodeZpgOpCode.first, opCodeZpgOpCode.second, ctx);
 }
 
 void MOS6502Listener::exitIdx_idr_statement(MOS6502Parser::Idx_idr_statementContext *ctx)
 {
+    checkUndocumentedOpcode(ctx->idx_idr_idx_opcode()->getText(), ctx);
     auto opcode = findOpCode(idx_idr_opcodes, ctx->idx_idr_idx_opcode()->getText());
     appendIdxIdrOrIdrIdxOrImmCmd(opcode, ctx);
 }
 
 void MOS6502Listener::exitIdr_idx_statement(MOS6502Parser::Idr_idx_statementContext *ctx)
 {
+    checkUndocumentedOpcode(ctx->idx_idr_idx_opcode()->getText(), ctx);
     auto opcode = findOpCode(idr_idx_opcodes, ctx->idx_idr_idx_opcode()->getText());
     appendIdxIdrOrIdrIdxOrImmCmd(opcode, ctx);
 }
 
+void MOS6502Listener::checkUndocumentedOpcode(string const &opcode, antlr4::ParserRuleContext const *ctx)
+{
+    if (!undocumentedOpcodes && (undocumented_opcodes.count(opcode) > 0))
+    {
+        addUndocumentedOpcodeError(opcode, ctx);
+    }
+}
+
 // opcode here is always implied zero-page
 void MOS6502Listener::appendIdxIdrOrIdrIdxOrImmCmd(uint8_t opcode, antlr4::ParserRuleContext const *ctx)
 {
-    shared_ptr<IExpression> pExpression = popNonEvalExpression();
+    auto [optOperand, optExpression] = popDeferrableExpression();
 
-    if (pExpression != nullptr)
+    if (opcode == 0)
     {
-        TOptExprValue optOperand = pExpression->eval(symbolTable);
+        // e.g. SAX [zp],Y, the map of the addressing mode does not know the opcode
+        addAddressingModeError(ctx);
+    }
 
+    if ((optOperand != std::nullopt) || (optExpression != std::nullopt))
+    {
         if (optOperand != std::nullopt)
         {
             // We could evaluate the expression, write the code immediately
@@ -439,7 +818,7 @@ void MOS6502Listener::appendIdxIdrOrIdrIdxOrImmCmd(uint8_t opcode, antlr4::Parse
             }
             else
             {
-                addOperandTooLargeError(operand, line(ctx), col(ctx));
+                addOperandTooLargeError(operand, fileId(ctx), line(ctx), col(ctx));
             }
         }
         else
@@ -447,13 +826,13 @@ void MOS6502Listener::appendIdxIdrOrIdrIdxOrImmCmd(uint8_t opcode, antlr4::Parse
             // The expression could not be evaluated due to a missing symbol we don't know yet
             // Since we now have to reserve payload for the statement, we reserve 2 bytes here
             // one for the opcode, one for the zero-based address
-            makeDeferredExpression(opcode, 2, pExpression, currentAddress, line(ctx), col(ctx));
+            makeDeferredExpression(opcode, 2, std::move(optExpression.value()), currentAddress, fileId(ctx), line(ctx), col(ctx));
         }
     }
     else
     {
         // Something went wrong. We do not have an expression for our command at all!
-        addInternalError(line(ctx), col(ctx));
+        addInternalError(fileId(ctx), line(ctx), col(ctx));
     }
 
 }
@@ -461,12 +840,10 @@ void MOS6502Listener::appendIdxIdrOrIdrIdxOrImmCmd(uint8_t opcode, antlr4::Parse
 
 void MOS6502Listener::appendIdxOrZpgCmd(uint8_t opcode, uint8_t opcode_zpg, antlr4::ParserRuleContext const *ctx)
 {
-    shared_ptr<IExpression> pExpression = popNonEvalExpression();
+    auto [optOperand, optExpression] = popDeferrableExpression();
 
-    if (pExpression != nullptr)
+    if ((optOperand != std::nullopt) || (optExpression != std::nullopt))
     {
-        TOptExprValue optOperand = pExpression->eval(symbolTable);
-
         if (optOperand != std::nullopt)
         {
             // We could evaluate the expression, write the code immediately
@@ -479,6 +856,11 @@ void MOS6502Listener::appendIdxOrZpgCmd(uint8_t opcode, uint8_t opcode_zpg, antl
             }
             else
             {
+                if (opcode == 0)
+                {
+                    // only a zero page form exists, e.g. STX zp,Y
+                    addAddressingModeError(ctx);
+                }
                 appendByteToPayload(opcode);
                 appendByteToPayload(operand & 0xffU);
                 appendByteToPayload((operand >> 8U) & 0xffU);
@@ -489,19 +871,23 @@ void MOS6502Listener::appendIdxOrZpgCmd(uint8_t opcode, uint8_t opcode_zpg, antl
             // The expression could not be evaluated due to a missing symbol we don't know yet
             // Since we now have to reserve payload for the statement, we reserve 3 bytes here
             // one for the opcode, two for the potential 16 bit address
-            makeDeferredExpression(opcode, 3, pExpression, currentAddress, line(ctx), col(ctx));
+            if (opcode == 0)
+            {
+                addAddressingModeError(ctx);
+            }
+            makeDeferredExpression(opcode, 3, std::move(optExpression.value()), currentAddress, fileId(ctx), line(ctx), col(ctx));
         }
     }
     else
     {
         // Something went wrong. We do not have an expression for our command at all!
-        addInternalError(line(ctx), col(ctx));
+        addInternalError(fileId(ctx), line(ctx), col(ctx));
     }
 }
 
-void MOS6502Listener::makeDeferredExpression(uint8_t opcode, uint8_t opNrBytes, shared_ptr<IExpression> pExpression, uint32_t currentAddress, size_t line, size_t col )
+void MOS6502Listener::makeDeferredExpression(uint8_t opcode, uint8_t opNrBytes, PostfixExpr expression, uint32_t currentAddress, size_t fileId, size_t line, size_t col )
 {
-    deferredExpressionStatements.emplace_back(DeferredExpressionEval(opcode, opNrBytes, pExpression, currentAddress, line, col));
+    deferredExpressionStatements.emplace_back(DeferredExpressionEval(opcode, opNrBytes, std::move(expression), currentAddress, fileId, line, col));
     do { appendByteToPayload(0xff); } while (--opNrBytes > 0);
 }
 
@@ -515,32 +901,59 @@ void MOS6502Listener::exitIdr_statement(MOS6502Parser::Idr_statementContext *ctx
 
 void MOS6502Listener::exitExpression(MOS6502Parser::ExpressionContext * ctx)
 {
-    function<TOptExprValue(TOptExprValue, TOptExprValue)> const *op = nullptr;
+    std::optional<PostfixOp> op = std::nullopt;
     if (ctx->ADD() != nullptr)
     {
-        op = &add;
+        op = PostfixOp::Add;
     } else if (ctx->SUB() != nullptr)
     {
-        op = &sub;
+        op = PostfixOp::Sub;
     } else if (ctx->MUL() != nullptr)
     {
-        op = &mul;
+        op = PostfixOp::Mul;
     } else if (ctx->DIV() != nullptr)
     {
-        op = &div;
+        op = PostfixOp::Div;
     } else if (ctx->PERCENT() != nullptr)
     {
-        op = &mod;
+        op = PostfixOp::Mod;
+    } else if ((ctx->ID() != nullptr) && (ctx->ID()->getText() == "LO"))
+    {
+        op = PostfixOp::Lo;
+    } else if ((ctx->ID() != nullptr) && (ctx->ID()->getText() == "HI"))
+    {
+        op = PostfixOp::Hi;
+    } else if (ctx->ID() != nullptr)
+    {
+        addError(SemanticError{ErrorCode::UnknownFunction, fileId(ctx), line(ctx), col(ctx), {ctx->ID()->getText()}});
     }
 
-    if (op != nullptr)
+    // the items of the operands are already in postfix order, the operation follows them
+    if ((op != std::nullopt) && (expressionStack.size() >= (((op == PostfixOp::Lo) || (op == PostfixOp::Hi)) ? 1U : 2U)))
     {
-        auto arg2 = expressionStack.back();
-        expressionStack.pop_back();
-        auto arg1 = expressionStack.back();
-        expressionStack.pop_back();
+        size_t depth = expressionStack.back().depth;
 
-        expressionStack.emplace_back(make_shared<BinaryOperation>(arg1, arg2, op, line(ctx), col(ctx)));
+        if ((op != PostfixOp::Lo) && (op != PostfixOp::Hi))
+        {
+            expressionStack.pop_back();
+            depth = std::max(expressionStack.back().depth, depth + 1);
+        }
+
+        LineExpression &expr = expressionStack.back();
+        linePostfix.push_back({op.value(), 0, ""});
+        expr.depth = depth;
+        expr.fileId = fileId(ctx);
+        expr.line = line(ctx);
+        expr.col = col(ctx);
+
+        // replaced by 0 to avoid follow-up errors
+        if ((expressionDepthLimit > 0) && (depth > expressionDepthLimit))
+        {
+            addError(SemanticError{ErrorCode::ExpressionTooDeep, expr.fileId, expr.line, expr.col, {std::to_string(expressionDepthLimit)}});
+            linePostfix.truncate(expr.start);
+            linePostfix.push_back({PostfixOp::Value, 0, ""});
+            expr.depth = 1;
+        }
     }
     else
     {
@@ -552,68 +965,101 @@ void MOS6502Listener::exitSymbol(MOS6502Parser::SymbolContext *ctx)
 {
     uint32_t resolvedSymVal = 0xffffffff; // this is what is put into our expression if the symbol could not be resolved
     string symName = ctx->ID()->getText();
-    optional<Sym> optSymbolVal = symbolTable.resolveSymbol(symName);
+    optional<Sym> optSymbolVal = isGenIndexVariable(ctx, symName) ? std::nullopt : symbolTable.resolveSymbol(symName);
+    lineSymbols.push_back(symName);
 
-    if (optSymbolVal == std::nullopt)
+    // a zero page variable is known before its declaration
+    if ((optSymbolVal == std::nullopt) && zeroPageVariables.has_value() && (zeroPageVariables.value().count(symName) > 0))
+    {
+        optSymbolVal = Sym{line(ctx), col(ctx), zeroPageVariables.value().at(symName), fileId(ctx)};
+    }
+
+    if ((optSymbolVal == std::nullopt) || optSymbolVal.value().relocatable)
     {
         // if the symbol cannot be evaluated for now, add it as an unresolved symbol
-        expressionStack.emplace_back(make_shared<Symbol>(symName, line(ctx), col(ctx)));
+        pushExpressionItem({PostfixOp::Symbol, 0, symName}, ctx);
     }
     else
     {
         resolvedSymVal = optSymbolVal.value().val;
-        expressionStack.emplace_back(make_shared<Numeric>(resolvedSymVal, line(ctx), col(ctx)));
+        pushExpressionItem({PostfixOp::Value, resolvedSymVal, ""}, ctx);
     }    
 }
 
+// the index variable of an enclosing .GENBYTE/.GENWORD takes a different value per generated
+// element, it must not be replaced by the value of a symbol with the same name
+auto MOS6502Listener::isGenIndexVariable(MOS6502Parser::SymbolContext *ctx, string const &symName) -> bool
+{
+    bool ret = false;
+
+    for (auto *pParent = ctx->parent; (pParent != nullptr) && !ret; pParent = pParent->parent)
+    {
+        auto *pGenCtx = dynamic_cast<MOS6502Parser::Gen_directiveContext *>(pParent);
+
+        if (pGenCtx != nullptr)
+        {
+            ret = (pGenCtx->ID()->getText() == symName);
+        }
+    }
+
+    return ret;
+}
+
 void MOS6502Listener::exitDec8(MOS6502Parser::Dec8Context * ctx)
 {
     auto val = convertDec(ctx->getText());
-    expressionStack.emplace_back(make_shared<Numeric>(val, line(ctx), col(ctx)));
+    pushLiteral(val, ctx);
 }
 
 void MOS6502Listener::exitDec(MOS6502Parser::DecContext * ctx)
 {
     auto val = convertDec(ctx->getText());
-    expressionStack.emplace_back(make_shared<Numeric>(val, line(ctx), col(ctx)));
+    pushLiteral(val, ctx);
 }
 
 void MOS6502Listener::exitHex16(MOS6502Parser::Hex16Context * ctx)
 {
     // w/o leading $ sign
     auto val = convertHex(ctx->getText().substr(1));
-    expressionStack.emplace_back(make_shared<Numeric>(val, line(ctx), col(ctx)));
+    pushLiteral(val, ctx);
 }
 
 void MOS6502Listener::exitHex8(MOS6502Parser::Hex8Context * ctx)
 {
     // w/o leading $ sign
     auto val = convertHex(ctx->getText().substr(1));
-    expressionStack.emplace_back(make_shared<Numeric>(val, line(ctx), col(ctx)));
+    pushLiteral(val, ctx);
 }
 
 void MOS6502Listener::exitBin8(MOS6502Parser::Bin8Context * ctx)
 {
     // w/o leading % sign
     auto val = convertBin(ctx->getText().substr(1));
-    expressionStack.emplace_back(make_shared<Numeric>(val, line(ctx), col(ctx)));
+    pushLiteral(val, ctx);
 }
 
 void MOS6502Listener::exitChar8(MOS6502Parser::Char8Context * ctx)
 {
     // w/o leading/trailing apos
     auto val = ctx->getText()[1];
-    expressionStack.emplace_back(make_shared<Numeric>(val, line(ctx), col(ctx)));
+    pushLiteral(val, ctx);
 }
 
 void MOS6502Listener::exitData_string(MOS6502Parser::Data_stringContext * ctx)
 {
     auto stringWithQuotes = ctx->STRING()->getText();
-    auto stringNoQuotes = stringWithQuotes.substr(1, stringWithQuotes.length() - 2);
 
-    for (auto val : stringNoQuotes)
+    if (dataDirective == DataDirective::Byte)
+    {
+        // w/o leading/trailing quotes
+        appendBytesToPayload(reinterpret_cast<uint8_t const *>(stringWithQuotes.data() + 1), stringWithQuotes.length() - 2);
+    }
+    else
     {
-        expressionStack.emplace_back(make_shared<Numeric>(val, line(ctx), col(ctx)));
+        for (auto val : stringWithQuotes.substr(1, stringWithQuotes.length() - 2))
+        {
+            appendDataItem(static_cast<uint8_t>(val), ctx);
+        }
     }
 }
 
@@ -654,6 +1100,81 @@ auto MOS6502Listener::convertBin(string const &bin) -> uint32_t
     return ret;
 }
 
+void MOS6502Listener::exitStatement(MOS6502Parser::StatementContext *ctx)
+{
+    size_t statementIdx = statementCount++;
+    auto pos = statementRewrites.find(statementIdx);
+
+    for (auto const &symName : lineSymbols)
+    {
+        symbolReferences.push_back(SymbolReference{symName, statementIdx});
+    }
+    lineSymbols.clear();
+
+    if ((addressOfLine != ADDR_INVALID) && (pos != end(statementRewrites)))
+    {
+        applyStatementRewrite(pos->second);
+    }
+
+    // statements with errors or removed statements did not generate any code
+    if (addressOfLine != ADDR_INVALID)
+    {
+        InstructionRecord instr{statementIdx, line(ctx), addressOfLine, currentAddress - addressOfLine, lineHasLabel, {0, 0, 0}};
+        instructions.push_back(instr);
+    }
+}
+
+void MOS6502Listener::applyStatementRewrite(StatementRewrite const &rewrite)
+{
+    // a statement with a not yet resolvable operand or a branch left its
+    // deferred part as last entry, which has to follow the rewrite
+    bool isDeferred = !deferredExpressionStatements.empty() && (deferredExpressionStatements.back().address == addressOfLine);
+    bool isBranch = !branchTargets.empty() && (branchTargets.back().first == addressOfLine + 1);
+
+    if (rewrite.kind == RewriteKind::Remove)
+    {
+        if (isDeferred)
+        {
+            deferredExpressionStatements.pop_back();
+        }
+        if (isBranch)
+        {
+            branchTargets.pop_back();
+        }
+
+        payload.erase(payload.lower_bound(addressOfLine), payload.lower_bound(currentAddress));
+        currentAddress = addressOfLine;
+        addressOfLine = ADDR_INVALID;
+    }
+    else
+    {
+        payload[addressOfLine] = rewrite.opcode;
+        lineMnemonic = getOpcodeInfos()[rewrite.opcode].value().mnemonic;
+
+        if (isDeferred)
+        {
+            deferredExpressionStatements.back().opCode = rewrite.opcode;
+        }
+    }
+}
+
+auto MOS6502Listener::getInstructions() const -> vector<InstructionRecord>
+{
+    vector<InstructionRecord> ret = instructions;
+
+    // operands of deferred expressions and branches are known now
+    for (auto &instr : ret)
+    {
+        for (uint32_t idx = 0; (idx < instr.lengthBytes) && (idx < instr.bytes.size()); idx++)
+        {
+            auto pos = payload.find(instr.address + idx);
+            instr.bytes[idx] = (pos != end(payload)) ? pos->second : 0;
+        }
+    }
+
+    return ret;
+}
+
 void MOS6502Listener::exitLine(MOS6502Parser::LineContext *ctx)
 {
     uint32_t startAddress = 0;
@@ -665,13 +1186,20 @@ void MOS6502Listener::exitLine(MOS6502Parser::LineContext *ctx)
         numberOfBytes = currentAddress - addressOfLine;
     }
 
-    CodeLine codeLine(ctx, startAddress, numberOfBytes);
-    codeLines.push_back(codeLine);
+    codeLines.emplace_back(ctx, startAddress, numberOfBytes, getSourceFile(fileId(ctx)), line(ctx), col(ctx));
+    if (!lineMnemonic.empty())
+    {
+        codeLines.back().replaceMnemonic(lineMnemonic);
+        lineMnemonic.clear();
+    }
 
     // the expressions parsed in this codeline are not used any more
     // clean up the list for the next code line
     expressionStack.clear();
+    linePostfix.clear();
+    lineSymbols.clear();
     addressOfLine = ADDR_INVALID;
+    lineHasLabel = false;
 }
 
 void MOS6502Listener::resolveBranchTargets()
@@ -679,7 +1207,9 @@ void MOS6502Listener::resolveBranchTargets()
     for (auto const &bt : branchTargets)
     {
         uint32_t branchOperandAddress = bt.first;
-        TOptExprValue destAddress = bt.second->eval(symbolTable);
+        // the distance from a relocatable branch to an absolute target changes with the placement of its section
+        bool relocatableBranch = (relocatableSectionOf(branchOperandAddress) != ABSOLUTE_SECTION);
+        TOptExprValue destAddress = relocatableBranch ? std::nullopt : bt.second.eval(symbolTable, evalStack);
 
         if (destAddress != std::nullopt)
         {
@@ -693,12 +1223,17 @@ void MOS6502Listener::resolveBranchTargets()
             }
             else
             {
-                addBranchTargetTooFarError(*bt.second, branchOperandAddress + 1, destAddress.value());
+                addBranchTargetTooFarError(bt.second, branchOperandAddress + 1, destAddress.value());
             }
         }
+        else if (objectMode)
+        {
+            payload[branchOperandAddress] = 0;
+            addPatch(PatchKind::Relative, branchOperandAddress, bt.second);
+        }
         else
         {
-            addUnresolvedBranchTargetError(*bt.second);
+            addUnresolvedBranchTargetError(bt.second);
         }
     }
 }
@@ -707,13 +1242,13 @@ void MOS6502Listener::resolveDeferredExpressions()
 {
     for (auto const &defExprStmnt : deferredExpressionStatements)
     {
-        TOptExprValue eval = defExprStmnt.expr->eval(this->symbolTable);
+        TOptExprValue eval = defExprStmnt.expr.eval(this->symbolTable, evalStack);
         if (eval != std::nullopt)
         {
             uint32_t operand = eval.value();
             if ((operand > 255) && (defExprStmnt.opNrBytes < 3))
             {
-                addOperandTooLargeError(operand, defExprStmnt.srcLine, defExprStmnt.srcCol);
+                addOperandTooLargeError(operand, defExprStmnt.fileId, defExprStmnt.srcLine, defExprStmnt.srcCol);
             }
             else
             {
@@ -726,62 +1261,212 @@ void MOS6502Listener::resolveDeferredExpressions()
                 }
             }
         }
+        else if (objectMode)
+        {
+            payload[defExprStmnt.address] = defExprStmnt.opCode;
+            addPatch((defExprStmnt.opNrBytes == 3) ? PatchKind::Word : PatchKind::Byte, defExprStmnt.address + 1, defExprStmnt.expr);
+        }
+        else
+        {
+            addMissingSymbolError(defExprStmnt.expr.getText(), defExprStmnt.fileId, defExprStmnt.srcLine, defExprStmnt.srcCol);
+        }
+    }
+    for (auto const &dataItem : deferredDataItems)
+    {
+        TOptExprValue eval = dataItem.expr.eval(this->symbolTable, evalStack);
+        uint32_t maxValue = (dataItem.kind == DataDirective::Byte) ? 0xffU : 0xffffU;
+
+        if ((eval == std::nullopt) && objectMode)
+        {
+            addPatch((dataItem.kind == DataDirective::Byte) ? PatchKind::Byte : (dataItem.kind == DataDirective::Word) ? PatchKind::Word : PatchKind::DByte,
+                     dataItem.address, dataItem.expr);
+        }
+        else if (eval == std::nullopt)
+        {
+            addMissingSymbolError(dataItem.expr.getText(), dataItem.fileId, dataItem.srcLine, dataItem.srcCol);
+        }
+        else if (eval.value() > maxValue)
+        {
+            addValueOutOfRangeError(eval.value(), 0, maxValue, dataItem.fileId, dataItem.srcLine, dataItem.srcCol);
+        }
+        else if (dataItem.kind == DataDirective::Byte)
+        {
+            payload[dataItem.address] = static_cast<uint8_t>(eval.value());
+        }
         else
         {
-            addMissingSymbolError(defExprStmnt.expr->getText(), defExprStmnt.srcLine, defExprStmnt.srcCol);
+            uint8_t lsb = eval.value() & 0xffU;
+            uint8_t msb = (eval.value() >> 8U) & 0xffU;
+
+            // .WORD is little endian, .DBYTE keeps the byte order
+            payload[dataItem.address] = (dataItem.kind == DataDirective::Word) ? lsb : msb;
+            payload[dataItem.address + 1] = (dataItem.kind == DataDirective::Word) ? msb : lsb;
         }
     }
 }
 
-auto MOS6502Listener::getAssembledMemBlocks() const -> MemBlocks
+auto MOS6502Listener::takeResult() && -> AssemblyResult
 {
-    return { codeLines, payload };
+    AssemblyResult ret;
+
+    ret.errors = Diagnostics{std::move(errors), sourceFiles, preludeName};
+    if (ret.errors.empty())
+    {
+        ret.assembledProgram = MemBlocks(std::move(codeLines), payload);
+        ret.object = objectMode ? getObjectModule(ret.assembledProgram) : ObjectModule{};
+        ret.symbols = std::move(symbolTable);
+    }
+
+    return ret;
 }
 
-auto MOS6502Listener::popExpression() -> TOptExprValue
+void MOS6502Listener::exitExport_directive(MOS6502Parser::Export_directiveContext *ctx)
+{
+    for (auto *pId : ctx->ID())
+    {
+        exportRequests.push_back(ObjectSymbol{pId->getText(), {}, true, fileId(ctx), line(ctx), col(ctx)});
+    }
+}
+
+// exported assignments left to the linker are flagged, all other exported symbols are known
+void MOS6502Listener::resolveExports()
+{
+    // a program is not linked, its exports do not matter
+    for (auto const &request : objectMode ? exportRequests : std::vector<ObjectSymbol>())
+    {
+        auto pos = find_if(begin(objectSymbols), end(objectSymbols), [&request](ObjectSymbol const &symbol) { return symbol.name == request.name; });
+
+        if (pos != end(objectSymbols))
+        {
+            pos->exported = true;
+        }
+        else if (symbolTable.resolveSymbol(request.name) != std::nullopt)
+        {
+            ObjectSymbol symbol = request;
+            PostfixExpr({{PostfixOp::Symbol, 0, request.name}}, request.fileId, request.line, request.col).toPostfix(symbolTable, symbol.expr);
+            objectSymbols.push_back(symbol);
+        }
+        else
+        {
+            addMissingSymbolError(request.name, request.fileId, request.line, request.col);
+        }
+    }
+}
+
+void MOS6502Listener::addPatch(PatchKind kind, uint32_t address, PostfixExpr const &expr)
+{
+    uint32_t section = relocatableSectionOf(address);
+    ObjectPatch patch{kind, section, (section == ABSOLUTE_SECTION) ? address : (address & 0xffffU), {}, expr.getFileId(), expr.getLine(), expr.getColumn()};
+    expr.toPostfix(symbolTable, patch.expr);
+    objectPatches.push_back(patch);
+}
+
+auto MOS6502Listener::getObjectModule(MemBlocks const &memBlocks) const -> ObjectModule
+{
+    ObjectModule ret;
+
+    for (uint32_t idx = 0; idx < memBlocks.getNumMemBlocks(); idx++)
+    {
+        if (memBlocks.getMemBlockAt(idx).getStartAddress() < relocatableSectionAddress(0))
+        {
+            ret.sections.push_back(memBlocks.getMemBlockAt(idx));
+        }
+    }
+
+    // the payload is ordered by address, i.e. by section and offset
+    ret.relocatableSections = relocatableSections;
+    for (auto pos = payload.lower_bound(relocatableSectionAddress(0)); pos != end(payload); ++pos)
+    {
+        std::vector<uint8_t> &bytes = ret.relocatableSections.at(relocatableSectionOf(pos->first)).bytes;
+        bytes.resize((pos->first & 0xffffU) + 1U);
+        bytes.back() = pos->second;
+    }
+
+    ret.symbols = objectSymbols;
+    ret.patches = objectPatches;
+    ret.sourceFiles = sourceFiles;
+
+    return ret;
+}
+
+void MOS6502Listener::pushExpressionItem(PostfixItem item, antlr4::ParserRuleContext const *ctx)
+{
+    expressionStack.push_back(LineExpression{linePostfix.size(), 1, fileId(ctx), line(ctx), col(ctx)});
+    linePostfix.push_back(std::move(item));
+}
+
+auto MOS6502Listener::evalTopExpression() -> TOptExprValue
 {
     TOptExprValue ret = std::nullopt;
     if (!expressionStack.empty())
     {
-        ret = expressionStack.back()->eval(symbolTable);
-        expressionStack.pop_back();
+        ret = evalPostfixItems(linePostfix.data() + expressionStack[expressionStack.size() - 1].start, linePostfix.data() + linePostfix.size(), symbolTable, evalStack);
     }
     return ret;
 }
 
-auto MOS6502Listener::popNonEvalExpression() -> shared_ptr<IExpression>
+auto MOS6502Listener::popExpression() -> TOptExprValue
 {
-    shared_ptr<IExpression> ret = nullptr;
+    TOptExprValue ret = evalTopExpression();
     if (!expressionStack.empty())
     {
-        ret = expressionStack.back();
+        linePostfix.truncate(expressionStack.back().start);
         expressionStack.pop_back();
     }
     return ret;
 }
 
-auto MOS6502Listener::peekExpression() -> TOptExprValue
+// the expression is kept beyond the line, e.g. to be evaluated at the end of the run
+auto MOS6502Listener::popNonEvalExpression() -> std::optional<PostfixExpr>
 {
-    TOptExprValue ret = std::nullopt;
+    std::optional<PostfixExpr> ret = std::nullopt;
     if (!expressionStack.empty())
     {
-        ret = expressionStack.back()->eval(symbolTable);
+        LineExpression const &expr = expressionStack.back();
+        ret.emplace(PostfixExpression(linePostfix.begin() + expr.start, linePostfix.end()), expr.fileId, expr.line, expr.col);
+        linePostfix.truncate(expr.start);
+        expressionStack.pop_back();
     }
     return ret;
 }
 
-auto MOS6502Listener::popAllExpressions() -> vector<TOptExprValue>
+// operands with known values, the most common case, are not copied out of the line
+auto MOS6502Listener::popDeferrableExpression() -> pair<TOptExprValue, std::optional<PostfixExpr>>
 {
-    vector<TOptExprValue> ret;
+    pair<TOptExprValue, std::optional<PostfixExpr>> ret{evalTopExpression(), std::nullopt};
 
-    for (auto const &e : expressionStack)
+    if (ret.first == std::nullopt)
     {
-        ret.push_back(e->eval(symbolTable));
+        ret.second = popNonEvalExpression();
+    }
+    else
+    {
+        linePostfix.truncate(expressionStack.back().start);
+        expressionStack.pop_back();
+    }
+
+    return ret;
+}
+
+auto MOS6502Listener::peekExpression() -> TOptExprValue
+{
+    return evalTopExpression();
+}
+
+auto MOS6502Listener::popAllExpressions() -> ScratchBuffer<TOptExprValue> const &
+{
+    exprValues.clear();
+
+    for (size_t idx = 0; idx < expressionStack.size(); idx++)
+    {
+        size_t end = (idx + 1 < expressionStack.size()) ? expressionStack[idx + 1].start : linePostfix.size();
+        exprValues.push_back(evalPostfixItems(linePostfix.data() + expressionStack[idx].start, linePostfix.data() + end, symbolTable, evalStack));
     }
 
     expressionStack.clear();
+    linePostfix.clear();
 
-    return ret;
+    return exprValues;
 }
 
 void MOS6502Listener::appendByteToPayload(uint8_t byte)
@@ -794,6 +1479,26 @@ void MOS6502Listener::appendByteToPayload(uint8_t byte)
     payload[currentAddress++] = byte;
 }
 
+// appends a block of bytes at the end of the payload, each insertion is hinted
+// by the position of its predecessor
+void MOS6502Listener::appendBytesToPayload(uint8_t const *pBytes, size_t numberOfBytes)
+{
+    if (numberOfBytes > 0)
+    {
+        if (addressOfLine == ADDR_INVALID)
+        {
+            addressOfLine = currentAddress;
+        }
+
+        auto hint = payload.lower_bound(currentAddress);
+
+        for (size_t idx = 0; idx < numberOfBytes; idx++)
+        {
+            hint = std::next(payload.insert_or_assign(hint, currentAddress++, pBytes[idx]));
+        }
+    }
+}
+
 void MOS6502Listener::appendByteToPayload(optional<uint8_t> optByte)
 {
     if (optByte != std::nullopt)
@@ -839,62 +1544,101 @@ void MOS6502Listener::addDByteToPayload(optional<uint16_t> optDbyte)
     }
 }
 
-void MOS6502Listener::addMissingSymbolError(std::string const &symName, size_t line, size_t col)
+void MOS6502Listener::addMissingSymbolError(std::string const &symName, size_t fileId, size_t line, size_t col)
 {
-    std::stringstream strm;
-    strm << "Symbol or expression \"" << symName << "\" could not be resolved.";
-    semanticErrors.emplace_back(SemanticError{strm.str(), fileName, line, col});
+    addError(SemanticError{ErrorCode::MissingSymbol, fileId, line, col, {symName}});
 }
 
-void MOS6502Listener::addUnresolvedBranchTargetError(IExpression const &branchTargetExpression)
+void MOS6502Listener::addUnresolvedBranchTargetError(PostfixExpr const &branchTargetExpression)
 {
-    std::stringstream strm;
-    strm << "Symbol or expression \"" << branchTargetExpression.getText() << "\" could not be resolved";
-    semanticErrors.emplace_back(SemanticError{strm.str(), fileName, branchTargetExpression.getLine(), branchTargetExpression.getColumn()});
+    addError(SemanticError{ErrorCode::UnresolvedBranchTarget, branchTargetExpression.getFileId(), branchTargetExpression.getLine(),
+                           branchTargetExpression.getColumn(), {branchTargetExpression.getText()}});
 }
 
-void MOS6502Listener::addBranchTargetTooFarError(IExpression const &branchTargetExpression, uint32_t branch, uint32_t target)
+void MOS6502Listener::addBranchTargetTooFarError(PostfixExpr const &branchTargetExpression, uint32_t branch, uint32_t target)
 {
-    std::stringstream strm;
-    strm 
-        << "Branch at address 0x" 
-        << std::hex << std::setfill('0') << branch
-        << " is too far away from the branch target \"" << branchTargetExpression.getText() << "\" at address 0x"
-        << std::hex << std::setfill('0') << target << ".";
-    
-    semanticErrors.emplace_back(SemanticError{strm.str(), fileName, branchTargetExpression.getLine(), branchTargetExpression.getColumn()});
+    addError(SemanticError{ErrorCode::BranchTargetTooFar, branchTargetExpression.getFileId(), branchTargetExpression.getLine(),
+                           branchTargetExpression.getColumn(), {toHex(branch), branchTargetExpression.getText(), toHex(target)}});
 }
 
 void MOS6502Listener::addDuplicateSymbolError(std::string const &symName, Sym const &duplicate, antlr4::ParserRuleContext const *ctx)
 {
     std::stringstream strm;
-    strm << "Redefinition of Symbol \"" << symName << "\" detected. " << std::endl
-         << "See previous definition at " << fileName << ":" << duplicate.line << ":" << duplicate.col << std::endl;
+    strm << getSourceFile(duplicate.fileId) << ":" << duplicate.line << ":" << duplicate.col;
 
-    semanticErrors.emplace_back(SemanticError{strm.str(), fileName, line(ctx), col(ctx)});
+    addError(SemanticError{ErrorCode::DuplicateSymbol, fileId(ctx), line(ctx), col(ctx), {symName, strm.str()}});
 }
 
 void MOS6502Listener::addValueOutOfRangeError(uint32_t value, uint32_t min, uint32_t max, antlr4::ParserRuleContext const *ctx)
 {
-    std::stringstream strm;
-    strm << "Value \"" << value << "\" is out of its supported value range: [" << min << "," << max << "]."<< std::endl;
-    semanticErrors.emplace_back(SemanticError{strm.str(), fileName, line(ctx), col(ctx)});
+    addValueOutOfRangeError(value, min, max, fileId(ctx), line(ctx), col(ctx));
 }
 
-void MOS6502Listener::addOperandTooLargeError(uint32_t operand, size_t line, size_t col)
+void MOS6502Listener::addValueOutOfRangeError(uint32_t value, uint32_t min, uint32_t max, size_t fileId, size_t line, size_t col)
 {
-    std::stringstream strm;
-    strm 
-        << "The operation requires a one byte operand operand, but its value 0x" 
-        << std::hex << std::setw(4) << std::setfill('0') << operand << " does not fit into one byte."<< std::endl;
-    semanticErrors.emplace_back(SemanticError{strm.str(), fileName, line, col});
+    addError(SemanticError{ErrorCode::ValueOutOfRange, fileId, line, col, {std::to_string(value), std::to_string(min), std::to_string(max)}});
+}
 
+void MOS6502Listener::addOperandTooLargeError(uint32_t operand, size_t fileId, size_t line, size_t col)
+{
+    addError(SemanticError{ErrorCode::OperandTooLarge, fileId, line, col, {toHex(operand)}});
+}
+
+void MOS6502Listener::addFileNotReadableError(std::string const &path, antlr4::ParserRuleContext const *ctx)
+{
+    addError(SemanticError{ErrorCode::FileNotReadable, fileId(ctx), line(ctx), col(ctx), {path}});
+}
+
+void MOS6502Listener::addCircularDefinitionError(std::string const &symName, size_t fileId, size_t line, size_t col)
+{
+    addError(SemanticError{ErrorCode::CircularDefinition, fileId, line, col, {symName}});
+}
+
+void MOS6502Listener::addOverlappingBlocksError(AddressRange const &block, AddressRange const &overlapped)
+{
+    addError(SemanticError{ErrorCode::OverlappingBlocks, blockFileId, blockLine, blockCol,
+                           {toHex(block.first), toHex(block.second - 1), toHex(overlapped.first), toHex(overlapped.second - 1)}});
+}
+
+void MOS6502Listener::addSegmentOutsideObjectModeError(antlr4::ParserRuleContext const *ctx)
+{
+    addError(SemanticError{ErrorCode::SegmentOutsideObjectMode, fileId(ctx), line(ctx), col(ctx)});
+}
+
+void MOS6502Listener::addUndocumentedOpcodeError(string const &opcode, antlr4::ParserRuleContext const *ctx)
+{
+    addError(SemanticError{ErrorCode::UndocumentedOpcode, fileId(ctx), line(ctx), col(ctx), {opcode}});
+}
+
+void MOS6502Listener::addAddressingModeError(antlr4::ParserRuleContext const *ctx)
+{
+    addError(SemanticError{ErrorCode::AddressingMode, fileId(ctx), line(ctx), col(ctx), {ctx->getStart()->getText()}});
 }
 
 // These errors should not happen. Likely cause by programming bug
-void MOS6502Listener::addInternalError(size_t line, size_t col)
+void MOS6502Listener::addInternalError(size_t fileId, size_t line, size_t col)
 {
-    semanticErrors.emplace_back(SemanticError{"Internal error.", fileName, line, col});
+    addError(SemanticError{ErrorCode::Internal, fileId, line, col});
+}
+
+void MOS6502Listener::addParseError(ErrorCode code, std::string const &sourceName, size_t line, size_t col, std::string const &errorMsg)
+{
+    addError(SemanticError{code, getFileId(sourceName), line, col, {errorMsg}});
+}
+
+// garbage input, e.g. a binary file, would otherwise report an error for about every byte
+void MOS6502Listener::addError(SemanticError error)
+{
+    if (!isErrorLimitReached())
+    {
+        errors.push_back(std::move(error));
+
+        if ((errorLimit > 0) && (errors.size() == errorLimit))
+        {
+            errors.push_back(SemanticError{ErrorCode::ErrorLimit, errors.back().getFileId(), errors.back().getLine(), errors.back().getColumn(),
+                                           {std::to_string(errorLimit)}});
+        }
+    }
 }
 
 } /* namespace asm6502 */
@@ -21,6 +21,11 @@
 #include "CodeLine.h"
 #include "SemanticError.h"
 #include "MemBlocks.h"
+#include "PeepholeOptimizer.h"
+#include "IntervalIndex.h"
+#include "VariableAllocator.h"
+#include "ScratchBuffer.h"
+#include "linker/ObjectModule.h"
 
 namespace asm6502
 {
@@ -29,14 +34,37 @@ typedef std::optional<uint32_t> TOptExprValue;
 
 constexpr uint32_t ADDR_INVALID = 0xffffffffU;
 
-class IExpression
+// in object mode, relocatable sections are assembled at virtual addresses beyond the
+// 64k address space, 64k per section
+constexpr auto relocatableSectionAddress(uint32_t section) -> uint32_t { return (section + 1U) << 16U; }
+constexpr auto relocatableSectionOf(uint32_t address) -> uint32_t { return (address < 0x10000U) ? ABSOLUTE_SECTION : (address >> 16U) - 1U; }
+
+// An expression kept beyond its line, e.g. referring to a label defined later, flattened into
+// postfix order. It is stored by value and evaluated with an explicit stack, so generated
+// expressions with hundreds of terms neither recurse nor chase pointers.
+class PostfixExpr
 {
 public:
-    virtual ~IExpression(){};
-    virtual auto eval(SymbolTable const &symbolTable) const -> TOptExprValue = 0;
-    virtual auto getText() const -> std::string = 0;
-    [[nodiscard]] virtual auto getLine() const -> size_t = 0;
-    [[nodiscard]] virtual auto getColumn() const -> size_t = 0;
+    PostfixExpr(PostfixExpression items_, size_t fileId_, size_t line_, size_t column_) :
+        items{std::move(items_)},
+        fileId{fileId_},
+        line{line_},
+        column{column_}
+    {}
+
+    auto eval(SymbolTable const &symbolTable, ScratchBuffer<uint32_t> &stack) const -> TOptExprValue;
+    auto getText() const -> std::string;
+    [[nodiscard]] auto getFileId() const -> size_t { return fileId; }
+    [[nodiscard]] auto getLine() const -> size_t { return line; }
+    [[nodiscard]] auto getColumn() const -> size_t { return column; }
+    void collectSymbols(std::vector<std::string> &symbols) const; // names of all unresolved symbols
+    void toPostfix(SymbolTable const &symbolTable, PostfixExpression &postfix) const; // for the linker, known symbols are replaced by their values
+
+private:
+    PostfixExpression items;
+    size_t fileId;
+    size_t line;
+    size_t column;
 };
 
 // Implements a deferred expression evaluation for commands that use
@@ -45,8 +73,9 @@ public:
 class DeferredExpressionEval
 {
 public:
-    DeferredExpressionEval(uint8_t opCode_, uint8_t opNrBytes_, std::shared_ptr<IExpression> expr_, uint32_t address_, size_t srcLine_, size_t srcCol_) :
-        expr{expr_},
+    DeferredExpressionEval(uint8_t opCode_, uint8_t opNrBytes_, PostfixExpr expr_, uint32_t address_, size_t fileId_, size_t srcLine_, size_t srcCol_) :
+        expr{std::move(expr_)},
+        fileId{fileId_},
         srcLine{srcLine_},
         srcCol{srcCol_},
         address{address_},
@@ -54,7 +83,8 @@ public:
         opNrBytes{opNrBytes_}
     {}
 
-    std::shared_ptr<IExpression> expr;
+    PostfixExpr expr;
+    size_t fileId;
     size_t srcLine;
     size_t srcCol;
     uint32_t address;
@@ -62,6 +92,72 @@ public:
     uint8_t opNrBytes;
 };
 
+
+// data directive whose items are currently parsed
+enum class DataDirective
+{
+    None,
+    Byte,
+    Word,
+    DByte
+};
+
+// Data items of .BYTE, .WORD and .DBYTE whose value is not yet known, e.g. jump tables
+// referring to labels defined later. Their space is reserved, and filled in
+// after the whole file has been parsed.
+class DeferredDataEval
+{
+public:
+    DeferredDataEval(DataDirective kind_, PostfixExpr expr_, uint32_t address_, size_t fileId_, size_t srcLine_, size_t srcCol_) :
+        expr{std::move(expr_)},
+        fileId{fileId_},
+        srcLine{srcLine_},
+        srcCol{srcCol_},
+        address{address_},
+        kind{kind_}
+    {}
+
+    PostfixExpr expr;
+    size_t fileId;
+    size_t srcLine;
+    size_t srcCol;
+    uint32_t address;
+    DataDirective kind;
+};
+
+// Symbol assignment whose expression refers to symbols that are not yet defined
+class PendingAssignment
+{
+public:
+    std::string symName;
+    PostfixExpr expr;
+    size_t fileId;
+    size_t srcLine;
+    size_t srcCol;
+};
+
+// An expression of the current line, flattened into postfix items. Its items start at start in
+// the items of the line and reach up to the start of the next expression on the stack.
+class LineExpression
+{
+public:
+    size_t start;
+    size_t depth;   // of the stack to evaluate the items
+    size_t fileId;
+    size_t line;
+    size_t col;
+};
+
+// What an assembler run produced, moved out of the listener by MOS6502Listener::takeResult()
+class AssemblyResult
+{
+public:
+    Diagnostics errors;
+    MemBlocks assembledProgram;
+    SymbolTable symbols;
+    ObjectModule object;        // object mode only
+};
+
 class MOS6502Listener : public MOS6502BaseListener
 {
 public:
@@ -69,12 +165,22 @@ public:
     virtual ~MOS6502Listener() = default;
 
     void exitOrg_directive(MOS6502Parser::Org_directiveContext * /*ctx*/) override;
+    void enterByte_directive(MOS6502Parser::Byte_directiveContext * /*ctx*/) override;
+    void enterWord_directive(MOS6502Parser::Word_directiveContext * /*ctx*/) override;
+    void enterDbyte_directive(MOS6502Parser::Dbyte_directiveContext * /*ctx*/) override;
     void exitByte_directive(MOS6502Parser::Byte_directiveContext * /*ctx*/) override;
     void exitWord_directive(MOS6502Parser::Word_directiveContext * /*ctx*/) override;
     void exitDbyte_directive(MOS6502Parser::Dbyte_directiveContext * /*ctx*/) override;
 
     void exitLabel(MOS6502Parser::LabelContext * /*ctx*/) override;
     void exitAss_directive(MOS6502Parser::Ass_directiveContext * /*ctx*/) override;
+    void exitGen_directive(MOS6502Parser::Gen_directiveContext * /*ctx*/) override;
+    void exitIncbin_directive(MOS6502Parser::Incbin_directiveContext * /*ctx*/) override;
+    void exitExport_directive(MOS6502Parser::Export_directiveContext * /*ctx*/) override;
+    void exitSegment_directive(MOS6502Parser::Segment_directiveContext * /*ctx*/) override;
+    void exitRes_directive(MOS6502Parser::Res_directiveContext * /*ctx*/) override;
+    void exitVar_directive(MOS6502Parser::Var_directiveContext * /*ctx*/) override;
+    void exitZppool_directive(MOS6502Parser::Zppool_directiveContext * /*ctx*/) override;
 
     void exitDir_statement(MOS6502Parser::Dir_statementContext * /*ctx*/) override;
     void exitImm_statement(MOS6502Parser::Imm_statementContext * /*ctx*/) override;
@@ -95,19 +201,63 @@ public:
     void exitHex8(MOS6502Parser::Hex8Context * ctx) override;
     void exitBin8(MOS6502Parser::Bin8Context * ctx) override;
     void exitChar8(MOS6502Parser::Char8Context * ctx) override;
+    void exitData(MOS6502Parser::DataContext * /*ctx*/) override;
     void exitData_string(MOS6502Parser::Data_stringContext * /*ctx*/) override;
 
+    void exitStatement(MOS6502Parser::StatementContext * /*ctx*/) override;
     void exitLine(MOS6502Parser::LineContext * /*ctx*/) override;
+    void exitR(MOS6502Parser::RContext * /*ctx*/) override;
 
+    void resolvePendingAssignments(); // must run before the other resolve methods
     void resolveBranchTargets();
     void resolveDeferredExpressions();
-    bool detectedErrors() const { return ((semanticErrors.size() + parseErrors.size()) > 0); }
-
-    MemBlocks getAssembledMemBlocks() const;
-    std::vector<asm6502::SemanticError> getSemanticErrors() const { return semanticErrors; }
-    std::vector<std::string> getParseErrors() const { return parseErrors; }
-
-    void addParseError(std::string const &errorMsg) {parseErrors.push_back(errorMsg); }
+    void resolveExports(); // object mode only, after the other resolve methods
+    bool detectedErrors() const { return !errors.empty(); }
+
+    // hands the lines, payload and symbols over instead of copying them, the listener is left
+    // without them. The program and the object module are only built without errors.
+    auto takeResult() && -> AssemblyResult;
+    SymbolTable const &getSymbolTable() const { return symbolTable; }
+    auto getErrors() const -> std::vector<asm6502::SemanticError> const & { return errors; }
+    auto getDiagnostics() const -> Diagnostics { return Diagnostics{errors, sourceFiles, preludeName}; }
+
+    // errors of the lexer, the parser and the token sources, which know the name of the source only
+    void addParseError(ErrorCode code, std::string const &sourceName, size_t line, size_t col, std::string const &errorMsg);
+    // after limit errors an ErrorLimit error is added and further errors are dropped, 0 for no limit.
+    // The token source then ends the input, which bounds the time spent on garbage input.
+    void setErrorLimit(size_t limit) { errorLimit = limit; }
+    // expressions needing a deeper evaluation stack are an error, 0 for no limit
+    void setExpressionDepthLimit(size_t limit) { expressionDepthLimit = limit; }
+    auto isErrorLimitReached() const -> bool { return (errorLimit > 0) && (errors.size() > errorLimit); }
+
+    // symbols known before the first line is assembled, e.g. loaded from a symbol snapshot
+    void setPrelude(SymbolTable const &prelude, std::string const &preludeName_) { symbolTable = prelude; preludeName = preludeName_; }
+
+    // the assembled file has id 0, included files are numbered in the order they are used
+    auto getSourceFile(size_t fileId) const -> std::string const & { return (fileId == Sym::PRELUDE_FILE_ID) ? preludeName : sourceFiles.at(fileId); }
+    auto getSourceFiles() const -> std::vector<std::string> const & { return sourceFiles; }
+
+    // peephole optimization: rewrites are applied to the statements while they are assembled,
+    // the assembled statements are recorded to find further rewrites
+    void setStatementRewrites(std::map<size_t, StatementRewrite> const &rewrites) { statementRewrites = rewrites; }
+    auto getInstructions() const -> std::vector<InstructionRecord>;
+
+    // variables: the first run places all variables at a provisional zero page address and records
+    // their references, the next runs place the given variables in the zero page, the others at
+    // their declaration
+    void setZeroPageVariables(std::map<std::string, uint32_t> const &variables) { zeroPageVariables = variables; }
+    auto getVariables() const -> std::vector<VariableDeclaration> const & { return variables; }
+    auto getSymbolReferences() const -> std::vector<SymbolReference> const & { return symbolReferences; }
+    auto getZeroPagePool() const -> std::vector<AddressRange>;
+
+    // object mode: symbols that are not defined are left to the linker, the operands referring
+    // to them become patches. The code before the first .ORG is a relocatable section of
+    // segment CODE, .SEGMENT starts a relocatable section, their labels are offsets.
+    void setObjectMode(bool objectMode_);
+
+    // the stable undocumented NMOS opcodes like LAX are errors unless enabled
+    void setUndocumentedOpcodes(bool enable) { undocumentedOpcodes = enable; }
+    auto isUndocumentedOpcodesEnabled() const -> bool { return undocumentedOpcodes; }
 
 private:
 
@@ -115,48 +265,116 @@ private:
     static uint32_t convertHex(std::string const &hex);
     static uint32_t convertBin(std::string const &bin);
 
+    void pushExpressionItem(PostfixItem item, antlr4::ParserRuleContext const *ctx);
+    auto evalTopExpression() -> TOptExprValue;
+
     TOptExprValue popExpression();
     TOptExprValue peekExpression();
-    std::shared_ptr<IExpression> popNonEvalExpression();
+    // the expression is kept beyond the line, nullopt without an expression
+    auto popNonEvalExpression() -> std::optional<PostfixExpr>;
+    // the value of the expression if it is known, otherwise the expression to be evaluated later
+    auto popDeferrableExpression() -> std::pair<TOptExprValue, std::optional<PostfixExpr>>;
+
+    // evaluates the expressions of the line into exprValues, valid until the next call
+    auto popAllExpressions() -> ScratchBuffer<TOptExprValue> const &;
+
+    static auto isGenIndexVariable(MOS6502Parser::SymbolContext *ctx, std::string const &symName) -> bool;
 
-    std::vector<TOptExprValue> popAllExpressions();
+    static auto isDataLiteral(antlr4::ParserRuleContext const *ctx) -> bool;
+    void pushLiteral(uint32_t val, antlr4::ParserRuleContext const *ctx);
+    void appendDataItem(uint32_t val, antlr4::ParserRuleContext const *ctx);
 
+    void checkUndocumentedOpcode(std::string const &opcode, antlr4::ParserRuleContext const *ctx);
     void appendIdxOrZpgCmd(uint8_t opcode, uint8_t opcode_zpg, antlr4::ParserRuleContext const *ctx);
     void appendIdxIdrOrIdrIdxOrImmCmd(uint8_t opcode, antlr4::ParserRuleContext const *ctx);
 
     void appendByteToPayload(uint8_t byte);
     void appendByteToPayload(std::optional<uint8_t> optByte);
+    void appendBytesToPayload(uint8_t const *pBytes, size_t numberOfBytes);
     void addWordToPayload(uint16_t word);
     void addWordToPayload(std::optional<uint16_t> optWord);
     void addDByteToPayload(uint16_t dbyte);
     void addDByteToPayload(std::optional<uint16_t> optDbyte);
 
-    void addSymbolCheckAlreadyDefined(std::string const &symName, uint32_t symVal, antlr4::ParserRuleContext *ctx);
-    void addMissingSymbolError(std::string const &symName, size_t line, size_t col);
-    void addUnresolvedBranchTargetError(IExpression const &branchTargetExpression); // for failed branch target resolution
-    void addBranchTargetTooFarError(IExpression const &branchTargetExpression, uint32_t branch, uint32_t target); // if branch and target are too far away, out of byte offset [-128 .. 127]
+    void addSymbolCheckAlreadyDefined(std::string const &symName, uint32_t symVal, antlr4::ParserRuleContext *ctx, bool relocatable = false);
+    auto isRelocatable() const -> bool { return currentSection != ABSOLUTE_SECTION; }
+    auto addressLimit() const -> uint32_t { return (currentAddress | 0xffffU) + 1U; } // end of the address space, or of the relocatable section
+    void closeBlock();
+    void openBlock(uint32_t address, antlr4::ParserRuleContext const *ctx);
+    void addPatch(PatchKind kind, uint32_t address, PostfixExpr const &expr);
+    void addMissingSymbolError(std::string const &symName, size_t fileId, size_t line, size_t col);
+    void addUnresolvedBranchTargetError(PostfixExpr const &branchTargetExpression); // for failed branch target resolution
+    void addBranchTargetTooFarError(PostfixExpr const &branchTargetExpression, uint32_t branch, uint32_t target); // if branch and target are too far away, out of byte offset [-128 .. 127]
     void addDuplicateSymbolError(std::string const &symName, Sym const &duplicate, antlr4::ParserRuleContext const *ctx);
     void addValueOutOfRangeError(uint32_t value, uint32_t min, uint32_t max, antlr4::ParserRuleContext const *ctx);
-    void addOperandTooLargeError(uint32_t operand, size_t line, size_t col);
-    void addInternalError(size_t line, size_t col);
-
+    void addValueOutOfRangeError(uint32_t value, uint32_t min, uint32_t max, size_t fileId, size_t line, size_t col);
+    void addOperandTooLargeError(uint32_t operand, size_t fileId, size_t line, size_t col);
+    void addFileNotReadableError(std::string const &path, antlr4::ParserRuleContext const *ctx);
+    void addCircularDefinitionError(std::string const &symName, size_t fileId, size_t line, size_t col);
+    void addOverlappingBlocksError(AddressRange const &block, AddressRange const &overlapped);
+    void addSegmentOutsideObjectModeError(antlr4::ParserRuleContext const *ctx);
+    void addUndocumentedOpcodeError(std::string const &opcode, antlr4::ParserRuleContext const *ctx);
+    void addAddressingModeError(antlr4::ParserRuleContext const *ctx);
+    void addInternalError(size_t fileId, size_t line, size_t col);
+    void addError(SemanticError error);
+
+    auto getObjectModule(MemBlocks const &memBlocks) const -> ObjectModule;
+    auto fileId(antlr4::ParserRuleContext const *ctx) -> size_t;
+    auto getFileId(std::string const &sourceName) -> size_t;
     size_t line(antlr4::ParserRuleContext const *ctx) { return ctx->getStart()->getLine(); }
     size_t col(antlr4::ParserRuleContext const *ctx) { return ctx->getStart()->getCharPositionInLine(); }
 
-    void makeDeferredExpression(uint8_t opcode, uint8_t opNrBytes, std::shared_ptr<IExpression> pExpression, uint32_t currentAddress, size_t line, size_t col );
+    void applyStatementRewrite(StatementRewrite const &rewrite);
+
+    void makeDeferredExpression(uint8_t opcode, uint8_t opNrBytes, PostfixExpr expression, uint32_t currentAddress, size_t fileId, size_t line, size_t col );
 
 
     std::string fileName;
+    std::vector<std::string> sourceFiles;           // indexed by file id
+    std::string preludeName;                        // source of symbols with Sym::PRELUDE_FILE_ID
+    antlr4::CharStream *pLastSourceStream;          // caches the file id of the last looked up token
+    size_t lastSourceFileId;
     uint32_t currentAddress;
     uint32_t addressOfLine;
-    std::vector<std::pair<uint32_t, std::shared_ptr<IExpression const>>> branchTargets; // branch tgt addresses to labels
+    std::vector<std::pair<uint32_t, PostfixExpr>> branchTargets; // branch tgt addresses to labels
     std::vector<DeferredExpressionEval> deferredExpressionStatements;
+    std::vector<DeferredDataEval> deferredDataItems;
+    std::vector<PendingAssignment> pendingAssignments;
+    std::map<std::string, size_t> pendingAssignmentIdx; // symbol name to index into pendingAssignments
     SymbolTable symbolTable;
-    std::vector<std::shared_ptr<IExpression>> expressionStack; // expression stack for one code line, reset after each code line
+    ScratchBuffer<LineExpression> expressionStack;  // expression stack for one code line, reset after each code line
+    ScratchBuffer<PostfixItem> linePostfix;         // the items of the expressions on the stack
+    size_t expressionDepthLimit;
+    ScratchBuffer<TOptExprValue> exprValues;        // see popAllExpressions()
+    ScratchBuffer<uint32_t> evalStack;              // reused by all evaluations
     std::map<uint32_t, uint8_t> payload;
     std::vector<CodeLine> codeLines;
-    std::vector<asm6502::SemanticError> semanticErrors;
-    std::vector<std::string> parseErrors;
+    std::vector<asm6502::SemanticError> errors;
+    size_t errorLimit;
+    DataDirective dataDirective;
+    size_t statementCount;
+    bool lineHasLabel;
+    std::string lineMnemonic;                       // set if a rewrite replaced the opcode of the current line
+    std::map<size_t, StatementRewrite> statementRewrites;
+    std::vector<InstructionRecord> instructions;
+    std::optional<std::map<std::string, uint32_t>> zeroPageVariables; // nullopt in the first run
+    std::vector<VariableDeclaration> variables;
+    ScratchBuffer<std::string> lineSymbols;         // symbols referred to by the current line
+    std::vector<SymbolReference> symbolReferences;  // symbols referred to by statements
+    std::vector<AddressRange> zeroPagePool;
+    IntervalIndex occupied;                         // by the closed blocks, a block starts at .ORG or .SEGMENT
+    uint32_t blockStart;
+    size_t blockFileId;
+    size_t blockLine;
+    size_t blockCol;
+    bool objectMode;
+    bool undocumentedOpcodes;
+    uint32_t currentSection;                        // index into relocatableSections, or ABSOLUTE_SECTION
+    std::vector<RelocatableSection> relocatableSections; // their bytes are in payload
+    bool relocatableUsed;                           // a relocatable label has been defined
+    std::vector<ObjectSymbol> exportRequests;       // symbols named by .EXPORT
+    std::vector<ObjectSymbol> objectSymbols;        // assignments left to the linker, and the exported symbols
+    std::vector<ObjectPatch> objectPatches;
 };
 
 } /* namespace asm6502 */
@@ -0,0 +1,586 @@
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <sstream>
+
+#include <MOS6502Lexer.h>
+
+#include "MacroTokenSource.h"
+#include "MOS6502Listener.h"
+#include "OpcodeTables.h"
+
+using namespace asm6502;
+
+// deeper nesting is considered a runaway recursion
+static size_t const MAX_EXPANSION_DEPTH = 32;
+// upper limit of the count of .REPT, more repetitions would overflow the 64k address space anyway
+static int64_t const MAX_REPETITIONS = 0x10000;
+// tokens followed by an operand
+static std::set<size_t> const OPERAND_PREFIXES{
+    MOS6502Lexer::POUND, MOS6502Lexer::COMMA, MOS6502Lexer::LPAREN, MOS6502Lexer::LBRAKET, MOS6502Lexer::ADD,
+    MOS6502Lexer::SUB, MOS6502Lexer::MUL, MOS6502Lexer::DIV, MOS6502Lexer::PERCENT, MOS6502Lexer::EQUALS};
+
+namespace
+{
+
+// recursive descent evaluation of the constant expressions of .REPT and assignments,
+// nullopt if the tokens are no complete expression with known symbols
+class ConstantEvaluator
+{
+public:
+    ConstantEvaluator(std::vector<antlr4::Token *> const &tokens_, std::function<std::optional<int64_t>(std::string const &)> lookup_) :
+        tokens{tokens_},
+        lookup{lookup_},
+        pos{0}
+    {}
+
+    auto evaluate() -> std::optional<int64_t>
+    {
+        std::optional<int64_t> ret = sum();
+        return (pos == tokens.size()) ? ret : std::nullopt;
+    }
+
+private:
+    auto peekType(size_t idx = 0) const -> size_t { return (pos + idx < tokens.size()) ? tokens[pos + idx]->getType() : antlr4::Token::EOF; }
+
+    auto sum() -> std::optional<int64_t>
+    {
+        std::optional<int64_t> ret = product();
+
+        while (ret && ((peekType() == MOS6502Lexer::ADD) || (peekType() == MOS6502Lexer::SUB)))
+        {
+            bool isAdd = (tokens[pos++]->getType() == MOS6502Lexer::ADD);
+            std::optional<int64_t> rhs = product();
+            ret = rhs ? std::optional<int64_t>(isAdd ? (ret.value() + rhs.value()) : (ret.value() - rhs.value())) : std::nullopt;
+        }
+
+        return ret;
+    }
+
+    auto product() -> std::optional<int64_t>
+    {
+        std::optional<int64_t> ret = factor();
+
+        while (ret && ((peekType() == MOS6502Lexer::MUL) || (peekType() == MOS6502Lexer::DIV) || (peekType() == MOS6502Lexer::PERCENT)))
+        {
+            size_t op = tokens[pos++]->getType();
+            std::optional<int64_t> rhs = factor();
+
+            if (!rhs || ((op != MOS6502Lexer::MUL) && (rhs.value() == 0)))
+            {
+                ret = std::nullopt;
+            }
+            else
+            {
+                ret = (op == MOS6502Lexer::MUL) ? ret.value() * rhs.value() :
+                      (op == MOS6502Lexer::DIV) ? ret.value() / rhs.value() : ret.value() % rhs.value();
+            }
+        }
+
+        return ret;
+    }
+
+    auto factor() -> std::optional<int64_t>
+    {
+        std::optional<int64_t> ret = std::nullopt;
+        size_t type = peekType();
+        // LO(...) or HI(...)
+        std::string function = ((type == MOS6502Lexer::ID) && (peekType(1) == MOS6502Lexer::LPAREN)) ? tokens[pos]->getText() : "";
+
+        if (!function.empty())
+        {
+            pos++;
+        }
+
+        if ((type == MOS6502Lexer::LPAREN) || !function.empty())
+        {
+            pos++;
+            ret = sum();
+
+            if ((peekType() == MOS6502Lexer::RPAREN) && (function.empty() || (function == "LO") || (function == "HI")))
+            {
+                pos++;
+                ret = !ret ? ret : (function == "LO") ? (ret.value() & 0xff) : (function == "HI") ? ((ret.value() >> 8) & 0xff) : ret;
+            }
+            else
+            {
+                ret = std::nullopt;
+            }
+        }
+        else if (type == MOS6502Lexer::ID)
+        {
+            ret = lookup(tokens[pos++]->getText());
+        }
+        else if (type != antlr4::Token::EOF)
+        {
+            ret = number(tokens[pos++]);
+        }
+
+        return ret;
+    }
+
+    static auto number(antlr4::Token const *token) -> std::optional<int64_t>
+    {
+        std::optional<int64_t> ret = std::nullopt;
+        std::string text = token->getText();
+
+        switch (token->getType())
+        {
+            case MOS6502Lexer::DEC8:
+            case MOS6502Lexer::DEC:
+                ret = std::stoll(text);
+                break;
+            case MOS6502Lexer::HEX8:
+            case MOS6502Lexer::HEX16:
+                ret = std::stoll(text.substr(1), nullptr, 16);
+                break;
+            case MOS6502Lexer::BIN8:
+                ret = std::stoll(text.substr(1), nullptr, 2);
+                break;
+            case MOS6502Lexer::CHAR8:
+                ret = static_cast<uint8_t>(text[1]);
+                break;
+            default:
+                break;
+        }
+
+        return ret;
+    }
+
+    std::vector<antlr4::Token *> const &tokens;
+    std::function<std::optional<int64_t>(std::string const &)> lookup;
+    size_t pos;
+};
+
+}
+
+MacroTokenSource::MacroTokenSource(antlr4::TokenSource &source_, std::string const &mainFileName_, MOS6502Listener &listener_) :
+    source{source_},
+    mainFileName{mainFileName_},
+    listener{listener_},
+    pLastToken{nullptr},
+    lastExpansionId{0}
+{
+}
+
+auto MacroTokenSource::nextToken() -> std::unique_ptr<antlr4::Token>
+{
+    std::unique_ptr<antlr4::Token> ret = nullptr;
+
+    while (ret == nullptr)
+    {
+        antlr4::Token *token = peek(0);
+
+        if (isUndocumentedMnemonicSymbol(token))
+        {
+            dynamic_cast<antlr4::WritableToken &>(*token).setType(MOS6502Lexer::ID);
+        }
+
+        if (listener.isErrorLimitReached())
+        {
+            // the rest of the input is not read
+            pending.clear();
+            ret = std::make_unique<antlr4::CommonToken>(antlr4::Token::EOF);
+        }
+        else if (isDirective(0, "MACRO"))
+        {
+            defineMacro();
+        }
+        else if (isDirective(0, "REPT"))
+        {
+            expandRepetition();
+        }
+        else if (isDirective(0, "ENDM"))
+        {
+            addError(token, ".ENDM without .MACRO.");
+            take();
+            take();
+        }
+        else if (isDirective(0, "ENDR"))
+        {
+            addError(token, ".ENDR without .REPT.");
+            take();
+            take();
+        }
+        else if ((token->getType() == MOS6502Lexer::ID) && (peek(1)->getType() == MOS6502Lexer::EQUALS))
+        {
+            recordConstant();
+            ret = take();
+        }
+        else if ((token->getType() == MOS6502Lexer::ID) && (peek(1)->getType() != MOS6502Lexer::COLON) &&
+                 isStatementStart(token) && (macros.find(token->getText()) != end(macros)))
+        {
+            expandMacro();
+        }
+        else
+        {
+            ret = take();
+        }
+    }
+
+    // the token stream of the parser keeps the tokens until the end of the parse
+    pLastToken = ret.get();
+    return ret;
+}
+
+auto MacroTokenSource::expansionDepth(antlr4::Token const *token) -> size_t
+{
+    auto const *pExpanded = dynamic_cast<ExpandedToken const *>(token);
+    return (pExpanded != nullptr) ? pExpanded->depth : 0;
+}
+
+auto MacroTokenSource::expansionId(antlr4::Token const *token) -> size_t
+{
+    auto const *pExpanded = dynamic_cast<ExpandedToken const *>(token);
+    return (pExpanded != nullptr) ? pExpanded->expansionId : 0;
+}
+
+// replayed lines are told apart by their expansion, e.g. the repetitions of a .REPT body
+auto MacroTokenSource::isSameLine(antlr4::Token const *first, antlr4::Token const *other) -> bool
+{
+    return (other->getType() != antlr4::Token::EOF) &&
+           (other->getInputStream() == first->getInputStream()) &&
+           (other->getLine() == first->getLine()) &&
+           (expansionId(other) == expansionId(first));
+}
+
+// macros are called at the start of a line, or after its label
+auto MacroTokenSource::isStatementStart(antlr4::Token const *token) const -> bool
+{
+    return (pLastToken == nullptr) || (pLastToken->getType() == MOS6502Lexer::COLON) || !isSameLine(pLastToken, token);
+}
+
+// Without -u, the undocumented mnemonics are no reserved words: they name a symbol when labeled or
+// assigned, or when they follow an opcode, a directive or an operator on the same line. At the
+// start of a statement they remain mnemonics, which the listener reports as not enabled.
+auto MacroTokenSource::isUndocumentedMnemonicSymbol(antlr4::Token *token) -> bool
+{
+    bool ret = false;
+
+    if (!listener.isUndocumentedOpcodesEnabled() && (token->getType() != MOS6502Lexer::ID) &&
+        (undocumented_opcodes.count(token->getText()) > 0))
+    {
+        size_t nextType = peek(1)->getType();
+        // the implicit tokens of the grammar, i.e. opcodes and directives, precede the named ones
+        size_t lastType = (pLastToken != nullptr) ? pLastToken->getType() : antlr4::Token::EOF;
+        bool afterKeywordOrOperator = (lastType < MOS6502Lexer::DEC8) || (OPERAND_PREFIXES.count(lastType) > 0);
+
+        ret = (nextType == MOS6502Lexer::COLON) || (nextType == MOS6502Lexer::EQUALS) || (!isStatementStart(token) && afterKeywordOrOperator);
+    }
+
+    return ret;
+}
+
+auto MacroTokenSource::peek(size_t idx) -> antlr4::Token *
+{
+    while ((pending.size() <= idx) && (pending.empty() || (pending.back()->getType() != antlr4::Token::EOF)))
+    {
+        pending.push_back(source.nextToken());
+    }
+
+    return (idx < pending.size()) ? pending[idx].get() : pending.back().get();
+}
+
+auto MacroTokenSource::take() -> std::unique_ptr<antlr4::Token>
+{
+    peek(0);
+    std::unique_ptr<antlr4::Token> ret = std::move(pending.front());
+    pending.pop_front();
+
+    return ret;
+}
+
+auto MacroTokenSource::takeRestOfLine(antlr4::Token const *first) -> TokenList
+{
+    TokenList ret;
+
+    while (isSameLine(first, peek(0)))
+    {
+        ret.push_back(take());
+    }
+
+    return ret;
+}
+
+auto MacroTokenSource::isDirective(size_t idx, std::string const &name) -> bool
+{
+    return (peek(idx)->getType() == MOS6502Lexer::DOT) && (peek(idx + 1)->getType() == MOS6502Lexer::ID) && (peek(idx + 1)->getText() == name);
+}
+
+void MacroTokenSource::defineMacro()
+{
+    std::unique_ptr<antlr4::Token> dot = take();
+    take();
+
+    TokenList header = takeRestOfLine(dot.get());
+    Macro macro;
+
+    // the name, then parameters separated by commas
+    bool validHeader = !header.empty() && ((header.size() == 1) || (header.size() % 2 == 0));
+
+    for (size_t idx = 0; validHeader && (idx < header.size()); idx++)
+    {
+        validHeader = (header[idx]->getType() == ((idx % 2 == 0) && (idx > 0) ? MOS6502Lexer::COMMA : MOS6502Lexer::ID));
+
+        if ((idx > 0) && (header[idx]->getType() == MOS6502Lexer::ID))
+        {
+            macro.params.push_back(header[idx]->getText());
+        }
+    }
+
+    bool closed = false;
+
+    while (!closed && (peek(0)->getType() != antlr4::Token::EOF))
+    {
+        if (isDirective(0, "ENDM"))
+        {
+            take();
+            take();
+            closed = true;
+        }
+        else if (isDirective(0, "MACRO"))
+        {
+            addError(peek(0), "Macro definitions cannot be nested.");
+            takeRestOfLine(take().get());
+        }
+        else
+        {
+            macro.body.push_back(take());
+        }
+    }
+
+    std::string name = header.empty() ? "" : header[0]->getText();
+
+    if (!validHeader)
+    {
+        addError(dot.get(), "Invalid macro definition, expected .MACRO <name> [<param>[, <param>]...].");
+    }
+    else if (!closed)
+    {
+        addError(dot.get(), "Missing .ENDM of macro " + name + ".");
+    }
+    else if (macros.find(name) != end(macros))
+    {
+        addError(dot.get(), "Macro " + name + " is already defined.");
+    }
+    else
+    {
+        macros.emplace(name, std::move(macro));
+    }
+}
+
+void MacroTokenSource::expandMacro()
+{
+    std::unique_ptr<antlr4::Token> nameToken = take();
+    Macro const &macro = macros.at(nameToken->getText());
+    TokenList argTokens = takeRestOfLine(nameToken.get());
+
+    // arguments are separated by commas outside of brackets
+    std::vector<TokenList> args;
+    int nesting = 0;
+
+    for (auto &argToken : argTokens)
+    {
+        size_t type = argToken->getType();
+        nesting += ((type == MOS6502Lexer::LPAREN) || (type == MOS6502Lexer::LBRAKET)) ? 1 : 0;
+        nesting -= ((type == MOS6502Lexer::RPAREN) || (type == MOS6502Lexer::RBRAKET)) ? 1 : 0;
+
+        if (args.empty())
+        {
+            args.emplace_back();
+        }
+
+        if ((type == MOS6502Lexer::COMMA) && (nesting == 0))
+        {
+            args.emplace_back();
+        }
+        else
+        {
+            args.back().push_back(std::move(argToken));
+        }
+    }
+
+    size_t depth = expansionDepth(nameToken.get()) + 1;
+
+    if (args.size() != macro.params.size())
+    {
+        std::stringstream strm;
+        strm << "Macro " << nameToken->getText() << " expects " << macro.params.size() << " argument(s), got " << args.size() << ".";
+        addError(nameToken.get(), strm.str());
+    }
+    else if (depth > MAX_EXPANSION_DEPTH)
+    {
+        addError(nameToken.get(), "Macros nested too deeply, is " + nameToken->getText() + " expanding itself?");
+    }
+    else
+    {
+        TokenList expansion = replay(macro.body, macro.params, args, nameToken->getText(), depth);
+        pending.insert(begin(pending), std::make_move_iterator(begin(expansion)), std::make_move_iterator(end(expansion)));
+    }
+}
+
+void MacroTokenSource::expandRepetition()
+{
+    std::unique_ptr<antlr4::Token> dot = take();
+    take();
+
+    TokenList countTokens = takeRestOfLine(dot.get());
+    TokenList body;
+    size_t nesting = 0;
+    bool closed = false;
+
+    while (!closed && (peek(0)->getType() != antlr4::Token::EOF))
+    {
+        if (isDirective(0, "ENDR") && (nesting == 0))
+        {
+            take();
+            take();
+            closed = true;
+        }
+        else
+        {
+            nesting += isDirective(0, "REPT") ? 1 : 0;
+            nesting -= isDirective(0, "ENDR") ? 1 : 0;
+            body.push_back(take());
+        }
+    }
+
+    std::vector<antlr4::Token *> countExpression;
+    std::transform(begin(countTokens), end(countTokens), back_inserter(countExpression), [](auto const &token) { return token.get(); });
+    std::optional<int64_t> count = evaluate(countExpression);
+    size_t depth = expansionDepth(dot.get()) + 1;
+
+    if (!closed)
+    {
+        addError(dot.get(), "Missing .ENDR of .REPT.");
+    }
+    else if (!count || (count.value() < 0) || (count.value() > MAX_REPETITIONS))
+    {
+        std::stringstream strm;
+        strm << "The count of .REPT must be a constant from 0 to " << MAX_REPETITIONS << ", using numbers and symbols assigned before.";
+        addError(dot.get(), strm.str());
+    }
+    else if (depth > MAX_EXPANSION_DEPTH)
+    {
+        addError(dot.get(), "Repetitions nested too deeply.");
+    }
+    else
+    {
+        TokenList expansion;
+
+        for (int64_t idx = 0; idx < count.value(); idx++)
+        {
+            TokenList repetition = replay(body, {}, {}, ".REPT", depth);
+            std::move(begin(repetition), end(repetition), back_inserter(expansion));
+        }
+
+        pending.insert(begin(pending), std::make_move_iterator(begin(expansion)), std::make_move_iterator(end(expansion)));
+    }
+}
+
+// the value of an assignment is recorded if it is known already, later .REPT may use it as count
+void MacroTokenSource::recordConstant()
+{
+    antlr4::Token *symbol = peek(0);
+    std::vector<antlr4::Token *> expression;
+
+    for (size_t idx = 2; isSameLine(symbol, peek(idx)); idx++)
+    {
+        expression.push_back(peek(idx));
+    }
+
+    std::optional<int64_t> value = evaluate(expression);
+
+    if (value)
+    {
+        constants[symbol->getText()] = value.value();
+    }
+}
+
+// copies of the body tokens, with the parameters replaced by the argument tokens
+// and the labels defined in the body made unique to this expansion
+auto MacroTokenSource::replay(TokenList const &body, std::vector<std::string> const &params, std::vector<TokenList> const &args,
+                              std::string const &name, size_t depth) -> TokenList
+{
+    size_t id = ++lastExpansionId;
+    std::set<std::string> localLabels;
+
+    for (size_t idx = 0; idx + 1 < body.size(); idx++)
+    {
+        if ((body[idx]->getType() == MOS6502Lexer::ID) && (body[idx + 1]->getType() == MOS6502Lexer::COLON))
+        {
+            localLabels.insert(body[idx]->getText());
+        }
+    }
+
+    TokenList ret;
+
+    // the tokens take the position of the body token they replace
+    auto copyToken = [this, &ret, &name, depth, id](antlr4::Token const &content, antlr4::Token const &position, std::string const &text)
+    {
+        auto token = std::make_unique<ExpandedToken>(
+            std::pair<antlr4::TokenSource *, antlr4::CharStream *>(this, position.getInputStream()),
+            content.getType(), content.getChannel(), position.getStartIndex(), position.getStopIndex(), name, depth, id);
+        token->setLine(position.getLine());
+        token->setCharPositionInLine(position.getCharPositionInLine());
+        token->setText(text);
+        ret.push_back(std::move(token));
+    };
+
+    for (auto const &bodyToken : body)
+    {
+        std::string text = bodyToken->getText();
+        auto param = find(begin(params), end(params), text);
+
+        if ((bodyToken->getType() == MOS6502Lexer::ID) && (param != end(params)))
+        {
+            for (auto const &argToken : args[distance(begin(params), param)])
+            {
+                copyToken(*argToken, *bodyToken, argToken->getText());
+            }
+        }
+        else if ((bodyToken->getType() == MOS6502Lexer::ID) && (localLabels.find(text) != end(localLabels)))
+        {
+            std::stringstream strm;
+            strm << text << "__" << id;
+            copyToken(*bodyToken, *bodyToken, strm.str());
+        }
+        else
+        {
+            copyToken(*bodyToken, *bodyToken, text);
+        }
+    }
+
+    return ret;
+}
+
+auto MacroTokenSource::evaluate(std::vector<antlr4::Token *> const &tokens) const -> std::optional<int64_t>
+{
+    ConstantEvaluator evaluator(tokens, [this](std::string const &symbol) -> std::optional<int64_t>
+    {
+        std::optional<int64_t> ret = std::nullopt;
+        auto constant = constants.find(symbol);
+
+        if (constant != end(constants))
+        {
+            ret = constant->second;
+        }
+        else if (listener.getSymbolTable().resolveSymbol(symbol))
+        {
+            ret = listener.getSymbolTable().resolveSymbol(symbol).value().val;
+        }
+
+        return ret;
+    });
+
+    return tokens.empty() ? std::nullopt : evaluator.evaluate();
+}
+
+void MacroTokenSource::addError(antlr4::Token const *token, std::string const &msg)
+{
+    std::string file = (token->getInputStream() != nullptr) ? token->getInputStream()->getSourceName() : "";
+    file = (file.empty() || (file == antlr4::IntStream::UNKNOWN_SOURCE_NAME)) ? mainFileName : file;
+
+    listener.addParseError(ErrorCode::Macro, file, token->getLine(), token->getCharPositionInLine(), msg);
+}
@@ -0,0 +1,104 @@
+#ifndef MACRO_TOKEN_SOURCE_H
+#define MACRO_TOKEN_SOURCE_H
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <antlr4-runtime.h>
+
+namespace asm6502
+{
+
+class MOS6502Listener;
+
+// A token replayed from a macro or .REPT body. It keeps the position of the body token,
+// so errors refer to the line of the body, and names the macro for the listing.
+class ExpandedToken : public antlr4::CommonToken
+{
+public:
+    ExpandedToken(std::pair<antlr4::TokenSource *, antlr4::CharStream *> source, size_t type, size_t channel, size_t start, size_t stop,
+                  std::string const &macroName_, size_t depth_, size_t expansionId_) :
+        antlr4::CommonToken(source, type, channel, start, stop),
+        macroName{macroName_},
+        depth{depth_},
+        expansionId{expansionId_}
+    {}
+
+    std::string macroName;  // ".REPT" for repetitions
+    size_t depth;           // 1 for expansions in the source, 2 for expansions within these, ...
+    size_t expansionId;     // unique per expansion, resp. per repetition of a .REPT body
+};
+
+// Sits between the IncludeTokenSource and the parser, and expands macros and repetitions:
+//
+//   .MACRO <name> [<param>[, <param>]...]      .REPT <count>
+//   <body>                                     <body>
+//   .ENDM                                      .ENDR
+//
+// A macro is called by its name followed by its arguments, separated by commas.
+// Parameters and arguments, as well as the count of .REPT, end with their line.
+// The tokens of a body are kept from its definition, each expansion replays them,
+// replacing the parameters by the tokens of the arguments. Labels defined within a
+// body are local to each expansion. The count of .REPT must be a constant expression
+// of numbers and symbols assigned before.
+class MacroTokenSource : public antlr4::TokenSource
+{
+public:
+    MacroTokenSource(antlr4::TokenSource &source_, std::string const &mainFileName_, MOS6502Listener &listener_);
+
+    auto nextToken() -> std::unique_ptr<antlr4::Token> override;
+    auto getLine() const -> size_t override { return source.getLine(); }
+    auto getCharPositionInLine() -> size_t override { return source.getCharPositionInLine(); }
+    auto getInputStream() -> antlr4::CharStream * override { return source.getInputStream(); }
+    auto getSourceName() -> std::string override { return mainFileName; }
+    auto getTokenFactory() -> antlr4::TokenFactory<antlr4::CommonToken> * override { return source.getTokenFactory(); }
+
+private:
+
+    class Macro
+    {
+    public:
+        std::vector<std::string> params;
+        std::vector<std::unique_ptr<antlr4::Token>> body;
+    };
+
+    typedef std::vector<std::unique_ptr<antlr4::Token>> TokenList;
+
+    static auto expansionDepth(antlr4::Token const *token) -> size_t;
+    static auto expansionId(antlr4::Token const *token) -> size_t;
+    static auto isSameLine(antlr4::Token const *first, antlr4::Token const *other) -> bool;
+
+    auto isStatementStart(antlr4::Token const *token) const -> bool;
+    auto isUndocumentedMnemonicSymbol(antlr4::Token *token) -> bool;
+    auto peek(size_t idx) -> antlr4::Token *;
+    auto take() -> std::unique_ptr<antlr4::Token>;
+    auto takeRestOfLine(antlr4::Token const *first) -> TokenList;
+    auto isDirective(size_t idx, std::string const &name) -> bool;
+
+    void defineMacro();
+    void expandMacro();
+    void expandRepetition();
+    void recordConstant();
+    auto replay(TokenList const &body, std::vector<std::string> const &params, std::vector<TokenList> const &args,
+                std::string const &name, size_t depth) -> TokenList;
+    auto evaluate(std::vector<antlr4::Token *> const &tokens) const -> std::optional<int64_t>;
+
+    void addError(antlr4::Token const *token, std::string const &msg);
+
+    antlr4::TokenSource &source;
+    std::string mainFileName;
+    MOS6502Listener &listener;
+    std::deque<std::unique_ptr<antlr4::Token>> pending;    // fetched and expanded tokens, not yet passed to the parser
+    std::map<std::string, Macro> macros;
+    std::map<std::string, int64_t> constants;               // assignments with constant values, for the count of .REPT
+    antlr4::Token const *pLastToken;                        // last token passed to the parser
+    size_t lastExpansionId;
+};
+
+} // namespace
+
+#endif
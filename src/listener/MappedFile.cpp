@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace asm6502;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const &path) :
+    open{false},
+    pData{nullptr},
+    size{0},
+    hFile{INVALID_HANDLE_VALUE},
+    hMapping{nullptr}
+{
+    hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    LARGE_INTEGER fileSize;
+    if ((hFile != INVALID_HANDLE_VALUE) && GetFileSizeEx(hFile, &fileSize))
+    {
+        size = static_cast<size_t>(fileSize.QuadPart);
+        open = true;
+
+        // empty files cannot be mapped, but are fine to include
+        if (size > 0)
+        {
+            hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            pData = (hMapping != nullptr) ? static_cast<uint8_t const *>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+            open = (pData != nullptr);
+        }
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (pData != nullptr)
+    {
+        UnmapViewOfFile(pData);
+    }
+    if (hMapping != nullptr)
+    {
+        CloseHandle(hMapping);
+    }
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hFile);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(std::string const &path) :
+    open{false},
+    pData{nullptr},
+    size{0}
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    struct stat fileStat;
+    if ((fd >= 0) && (fstat(fd, &fileStat) == 0) && S_ISREG(fileStat.st_mode))
+    {
+        size = static_cast<size_t>(fileStat.st_size);
+        open = true;
+
+        // empty files cannot be mapped, but are fine to include
+        if (size > 0)
+        {
+            void *pMapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            pData = (pMapping != MAP_FAILED) ? static_cast<uint8_t const *>(pMapping) : nullptr;
+            open = (pData != nullptr);
+        }
+    }
+
+    // the mapping stays valid after closing the descriptor
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (pData != nullptr)
+    {
+        munmap(const_cast<uint8_t *>(pData), size);
+    }
+}
+
+#endif
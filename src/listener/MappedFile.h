@@ -0,0 +1,38 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <string>
+
+namespace asm6502
+{
+
+// Read-only memory mapping of a complete file, the bytes are available
+// without copying them into a buffer first. The mapping is released
+// when the object is destroyed.
+class MappedFile
+{
+public:
+    explicit MappedFile(std::string const &path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const &) = delete;
+    auto operator = (MappedFile const &) -> MappedFile & = delete;
+
+    auto isOpen() const -> bool { return open; }
+    auto getData() const -> uint8_t const * { return pData; }
+    auto getSize() const -> size_t { return size; }
+
+private:
+    bool open;
+    uint8_t const *pData;
+    size_t size;
+#ifdef _WIN32
+    void *hFile;
+    void *hMapping;
+#endif
+};
+
+} // namespace
+
+#endif
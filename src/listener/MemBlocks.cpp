@@ -1,9 +1,20 @@
+#include <algorithm>
 #include <iomanip>
 
+#include "LoaderStub.h"
 #include "MemBlocks.h"
 
 using namespace asm6502;
 
+namespace
+{
+
+uint32_t const BASIC_LINE_BYTES_DENSE = 16;   // "nnnn data " and 16 times "255," fit into 80 columns
+uint32_t const BASIC_LINE_BYTES = 4;
+uint8_t const OPC_JMP = 0x4C;
+
+}
+
 auto MemBlocks::getMemBlocks(std::vector<asm6502::CodeLine> const &codeLines, std::map<uint32_t, uint8_t> const &payload) -> std::vector<MemBlock>
 {
     std::vector<MemBlock> memBlocks;
@@ -17,16 +28,18 @@ auto MemBlocks::getMemBlocks(std::vector<asm6502::CodeLine> const &codeLines, st
         {
             if (!currMemBlockBytes.empty())
             {
-                memBlocks.emplace_back(MemBlock(currMemBlockAddress, currMemBlockBytes));
-                currMemBlockBytes.clear();
+                memBlocks.emplace_back(currMemBlockAddress, std::move(currMemBlockBytes));
+                currMemBlockBytes = std::vector<uint8_t>();
             }
 
             currMemBlockAddress = codeLine.getStartAddress();
         }
 
-        for (uint32_t idx = 0; idx < codeLine.getLengthBytes(); idx++)
+        // the bytes of a line are consecutive in the payload, walked instead of looked up one by one
+        auto pos = payload.lower_bound(codeLine.getStartAddress());
+        for (uint32_t address = codeLine.getStartAddress(); address < codeLine.getStartAddress() + codeLine.getLengthBytes(); address++)
         {
-            currMemBlockBytes.push_back(payload.at(codeLine.getStartAddress() + idx));
+            currMemBlockBytes.push_back(((pos != end(payload)) && (pos->first == address)) ? (pos++)->second : payload.at(address));
         }
 
         pPrevCodeLine = &codeLine;
@@ -34,8 +47,7 @@ auto MemBlocks::getMemBlocks(std::vector<asm6502::CodeLine> const &codeLines, st
 
     if (!currMemBlockBytes.empty())
     {
-        memBlocks.emplace_back(MemBlock(currMemBlockAddress, currMemBlockBytes));
-        currMemBlockBytes.clear();
+        memBlocks.emplace_back(currMemBlockAddress, std::move(currMemBlockBytes));
     }
 
     // sort the various blocks by starting address
@@ -49,9 +61,10 @@ auto MemBlocks::areAdjacent(asm6502::CodeLine const *prevCodeLine, asm6502::Code
     return (prevCodeLine != nullptr) && (prevCodeLine->getStartAddress() + prevCodeLine->getLengthBytes() == currCodeLine->getStartAddress());
 }
 
-auto MemBlocks::getBasicMemBlockInitializerListing() const -> std::string 
+auto MemBlocks::getBasicMemBlockInitializerListing(bool dense) const -> std::string 
 {
     std::stringstream strm;
+    uint32_t bytesPerLine = dense ? BASIC_LINE_BYTES_DENSE : BASIC_LINE_BYTES;
 
     strm << "100 read nb" << std::endl;
     strm << "110 for bi = 1 to nb" << std::endl;
@@ -80,15 +93,16 @@ auto MemBlocks::getBasicMemBlockInitializerListing() const -> std::string
 
         for (uint32_t byteIdx = 0; byteIdx < memBlock.getLengthBytes(); byteIdx++)
         {
-            if (byteIdx % 4 == 0)
+            if (byteIdx % bytesPerLine == 0)
             {
                 strm << std::endl << lineNr << " data ";
                 lineNr += 10;
             }
 
-            strm << std::setw(3) << static_cast<uint32_t>(memBlock.getByteAt(byteIdx));
+            // the dense listing leaves out the padding
+            strm << std::setw(dense ? 0 : 3) << static_cast<uint32_t>(memBlock.getByteAt(byteIdx));
 
-            if ((byteIdx % 4 != 3) && (byteIdx + 1 < memBlock.getLengthBytes()))
+            if ((byteIdx % bytesPerLine != bytesPerLine - 1) && (byteIdx + 1 < memBlock.getLengthBytes()))
             {
                 strm << ",";
             }
@@ -100,6 +114,71 @@ auto MemBlocks::getBasicMemBlockInitializerListing() const -> std::string
     return strm.str();
 }
 
+// The mem blocks follow the loader code in the order of their addresses. Blocks moving down
+// are copied first in ascending order, then the blocks moving up in descending order, so no
+// block overwrites the bytes of a block not copied yet.
+auto MemBlocks::getLoaderProgram(uint16_t entryAddress) const -> std::optional<std::vector<uint8_t>>
+{
+    uint32_t codeAddress = LOADER_ADDRESS + loaderBasicLine.size();
+    uint32_t copyForwardAddress = codeAddress + LOADER_CALL_BYTES * getNumMemBlocks() + 3;
+    uint32_t copyBackwardAddress = copyForwardAddress + loaderCopyForward.size();
+    uint32_t dataAddress = copyBackwardAddress + loaderCopyBackward.size();
+    bool overlapsLoader = false;
+
+    std::vector<uint32_t> sources;
+    uint32_t src = dataAddress;
+    for (auto const &memBlock : memBlocks)
+    {
+        uint32_t start = memBlock.getStartAddress();
+        uint32_t end = start + memBlock.getLengthBytes();
+
+        overlapsLoader = overlapsLoader || ((start <= 0x02) && (end > 0x02)) || ((start < 0xFF) && (end > 0xFB)) ||
+                         ((start < 0x200) && (end > 0x100)) || ((start < dataAddress) && (end > LOADER_ADDRESS));
+        sources.push_back(src);
+        src += memBlock.getLengthBytes();
+    }
+
+    std::optional<std::vector<uint8_t>> ret = std::nullopt;
+
+    // the copy routines would read the BASIC ROM instead of the loaded bytes beyond $9FFF
+    if (!overlapsLoader && (src <= LOADER_END_ADDRESS))
+    {
+        std::vector<uint8_t> prg{static_cast<uint8_t>(LOADER_ADDRESS & 0xffU), static_cast<uint8_t>(LOADER_ADDRESS >> 8U)};
+        prg.insert(end(prg), begin(loaderBasicLine), end(loaderBasicLine));
+
+        for (size_t idx = 0; idx < memBlocks.size(); idx++)
+        {
+            if (memBlocks[idx].getStartAddress() < sources[idx])
+            {
+                appendLoaderCall(prg, sources[idx], memBlocks[idx].getStartAddress(), memBlocks[idx].getLengthBytes(), copyForwardAddress);
+            }
+        }
+        for (size_t idx = memBlocks.size(); idx > 0; idx--)
+        {
+            MemBlock const &memBlock = memBlocks[idx - 1];
+            uint32_t pagesLength = memBlock.getLengthBytes() & 0xff00U;
+
+            if (memBlock.getStartAddress() >= sources[idx - 1])
+            {
+                appendLoaderCall(prg, sources[idx - 1] + pagesLength, memBlock.getStartAddress() + pagesLength, memBlock.getLengthBytes(), copyBackwardAddress);
+            }
+        }
+
+        prg.insert(end(prg), {OPC_JMP, static_cast<uint8_t>(entryAddress & 0xffU), static_cast<uint8_t>(entryAddress >> 8U)});
+        prg.insert(end(prg), begin(loaderCopyForward), end(loaderCopyForward));
+        prg.insert(end(prg), begin(loaderCopyBackward), end(loaderCopyBackward));
+
+        for (auto const &memBlock : memBlocks)
+        {
+            prg.insert(end(prg), begin(memBlock.getBytes()), end(memBlock.getBytes()));
+        }
+
+        ret = prg;
+    }
+
+    return ret;
+}
+
 auto MemBlocks::getByteAt(uint32_t address) const -> uint8_t
 {
     uint8_t ret = 0xff;
@@ -126,43 +205,39 @@ auto MemBlocks::getMachineCode(bool includeAssembly) const -> std::string
     return strm.str();
 }
 
-// streams the list of mem blocks into a binary .prg file, which starts
-// with a 16 bit start address (Little Endian), followed by the byte stream
-// followed by a zero byte as terminator
-auto asm6502::operator << (std::ostream &os, asm6502::MemBlocks const &memBlocks) -> std::ostream & 
-{  
-    if (memBlocks.getNumMemBlocks() > 0)
+// a .prg image, which starts with a 16 bit start address (Little Endian), followed by the
+// bytes of the mem blocks, the gaps between them padded with 0xff
+auto MemBlocks::getProgramBytes() const -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> ret;
+
+    if (getNumMemBlocks() > 0)
     {
-        auto itMemBlock = begin(memBlocks.memBlocks);
-        uint32_t startAddress = itMemBlock->getStartAddress();
-        os << static_cast<uint8_t>(startAddress & 0xffU); // LSB of start address
-        os << static_cast<uint8_t>((startAddress >> 8U) & 0xffU); // MSB of start address
+        uint32_t startAddress = memBlocks.front().getStartAddress();
+        ret.push_back(static_cast<uint8_t>(startAddress & 0xffU)); // LSB of start address
+        ret.push_back(static_cast<uint8_t>((startAddress >> 8U) & 0xffU)); // MSB of start address
 
-        while (itMemBlock != end(memBlocks.memBlocks))
+        for (auto const &memBlock : memBlocks)
         {
-            os << *itMemBlock;
-            auto itNextMemBlock = itMemBlock + 1 ;
-
-            if (itNextMemBlock != end(memBlocks.memBlocks))
-            {
-                // should be safe, start addresses and lengths are in fact uint32_t (16 bit)
-                auto numPadding = itNextMemBlock->getStartAddress() - (itMemBlock->getStartAddress() + itMemBlock->getLengthBytes());
-
-                for (uint32_t padIdx = 0; padIdx < numPadding; padIdx++)
-                {
-                    os << static_cast<uint8_t>(0xff);
-                }
-            }
-
-            itMemBlock = itNextMemBlock;
+            // should be safe, start addresses and lengths are in fact uint32_t (16 bit)
+            ret.resize(ret.size() + (memBlock.getStartAddress() - startAddress), 0xff);
+            ret.insert(end(ret), begin(memBlock.getBytes()), end(memBlock.getBytes()));
+            startAddress = memBlock.getStartAddress() + memBlock.getLengthBytes();
         }
     }
 
+    return ret;
+}
+
+// streams the list of mem blocks into a binary .prg file, see getProgramBytes(),
+// followed by a zero byte as terminator
+auto asm6502::operator << (std::ostream &os, asm6502::MemBlocks const &memBlocks) -> std::ostream & 
+{  
+    for (auto byte : memBlocks.getProgramBytes()) { os << byte; }
+
     // zero-byte termination: Added this since converting a binary file without it would yield a truncated
-    // file (last actual byte was missing) when writing it into a .d64 image file. Not yet sure whether
-    // this is aproblem in the file or in the .d64 conversion
-    // is it perhaps that .PRG files should only contain an *even* number of bytes?
-    // in that case, pad only to make the byte length even
+    // file (last actual byte was missing) when writing it into a .d64 image file with an external tool.
+    // D64Image, used by ASM6502 -d, stores the exact length in the last sector and needs no terminator.
     os << static_cast<uint8_t>(0x00);
 
     return os;
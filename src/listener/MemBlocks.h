@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <iostream>
+#include <optional>
+#include <utility>
 
 #include "CodeLine.h"
 
@@ -12,9 +14,9 @@ namespace asm6502
 class MemBlock
 {
 public:
-    MemBlock(uint32_t startAddress_, std::vector<uint8_t> const &bytes_) :
+    MemBlock(uint32_t startAddress_, std::vector<uint8_t> bytes_) :
         startAddress(startAddress_),
-        bytes(bytes_)
+        bytes(std::move(bytes_))
     {}
 
     auto operator == (MemBlock const &rhs) const -> bool
@@ -35,6 +37,7 @@ public:
     auto getStartAddress() const -> uint32_t { return startAddress; }
     auto getLengthBytes() const -> uint32_t { return bytes.size(); }
     auto getByteAt(uint32_t idx) const -> uint8_t { return bytes.at(idx); }
+    auto getBytes() const -> std::vector<uint8_t> const & { return bytes; }
 
     friend auto operator << (std::ostream &os, asm6502::MemBlock const &memBlock) -> std::ostream &;
 
@@ -50,11 +53,17 @@ class MemBlocks
 public:
     MemBlocks() {}
     MemBlocks(std::vector<asm6502::CodeLine> const &codeLines_, std::map<uint32_t, uint8_t> const &payload) :
-        codeLines { codeLines_ },
-        memBlocks { getMemBlocks(codeLines_, payload) }
+        memBlocks { getMemBlocks(codeLines_, payload) },
+        codeLines { codeLines_ }
     {}
 
-    MemBlocks(std::vector<asm6502::MemBlock> const &memBlocks_) : memBlocks(memBlocks_) {}
+    // takes over the lines, e.g. of a finished listener. The mem blocks are initialized first, as declared.
+    MemBlocks(std::vector<asm6502::CodeLine> &&codeLines_, std::map<uint32_t, uint8_t> const &payload) :
+        memBlocks { getMemBlocks(codeLines_, payload) },
+        codeLines { std::move(codeLines_) }
+    {}
+
+    MemBlocks(std::vector<asm6502::MemBlock> memBlocks_) : memBlocks(std::move(memBlocks_)) {}
 
     auto operator == (MemBlocks const &rhs) const -> bool
     {
@@ -68,14 +77,23 @@ public:
 
     auto getNumMemBlocks() const -> uint32_t { return memBlocks.size(); }
 
-    auto getMemBlockAt(uint32_t idx) const -> MemBlock
+    auto getMemBlockAt(uint32_t idx) const -> MemBlock const &
     {
         return memBlocks.at(idx);
     }
 
+    auto getCodeLines() const -> std::vector<asm6502::CodeLine> const & { return codeLines; }
+
     auto getMachineCode(bool includeAssembly) const -> std::string;
-    auto getBasicMemBlockInitializerListing() const -> std::string;
+    // dense: as many bytes per DATA line as fit into the 80 columns of a C64 BASIC line
+    auto getBasicMemBlockInitializerListing(bool dense = false) const -> std::string;
+    // a .PRG at $0801 which starts with BASIC "10 SYS 2061", copies the mem blocks to their
+    // addresses and jumps to entryAddress. nullopt if a mem block overlaps the loader itself,
+    // its zero page pointers ($02, $FB-$FE) or the stack, or if the loader does not fit below $A000.
+    auto getLoaderProgram(uint16_t entryAddress) const -> std::optional<std::vector<uint8_t>>;
     auto getByteAt(uint32_t address) const -> uint8_t;
+    // the .PRG image with its load address, without the terminator written by operator<<
+    auto getProgramBytes() const -> std::vector<uint8_t>;
 
     friend auto operator<<(std::ostream& os, asm6502::MemBlocks const &memBlocks) -> std::ostream&;
 
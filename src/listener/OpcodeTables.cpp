@@ -0,0 +1,149 @@
+#include "OpcodeTables.h"
+
+using namespace std;
+
+namespace asm6502
+{
+
+uint8_t const jmp_indir_opcode = 0x6C;
+
+map<string, uint8_t> const dir_opcodes
+{
+    {"BRK", 0x00}, {"PHP", 0x08}, {"ASL", 0x0A}, {"CLC", 0x18}, {"PLP", 0x28}, {"ROL", 0x2A}, {"SEC", 0x38}, {"RTI", 0x40},
+    {"PHA", 0x48}, {"LSR", 0x4A}, {"CLI", 0x58}, {"RTS", 0x60}, {"PLA", 0x68}, {"ROR", 0x6A}, {"SEI", 0x78}, {"DEY", 0x88},
+    {"TXA", 0x8A}, {"TYA", 0x98}, {"TXS", 0x9A}, {"TAY", 0xA8}, {"TAX", 0xAA}, {"CLV", 0xB8}, {"TSX", 0xBA}, {"INY", 0xC8},
+    {"DEX", 0xCA}, {"CLD", 0xD8}, {"INX", 0xE8}, {"NOP", 0xEA}, {"SED", 0xF8}
+};
+
+map<string, uint8_t> const imm_opcodes
+{
+    {"ORA", 0x09}, {"AND", 0x29}, {"EOR", 0x49}, {"ADC", 0x69}, {"LDY", 0xA0}, {"LDX", 0xA2}, {"LDA", 0xA9}, {"CPY", 0xC0},
+    {"CMP", 0xC9}, {"CPX", 0xE0}, {"SBC", 0xE9},
+    {"ANC", 0x0B}, {"ALR", 0x4B}, {"ARR", 0x6B}, {"SBX", 0xCB}
+};
+
+map<string, uint8_t> const rel_opcodes
+{
+    {"BPL", 0x10}, {"BMI", 0x30}, {"BVC", 0x50}, {"BVS", 0x70}, {"BCC", 0x90}, {"BCS", 0xB0}, {"BNE", 0xD0}, {"BEQ", 0xF0}
+};
+
+map<string, uint8_t> const idx_x_opcodes
+{
+    {"ORA", 0x1D}, {"ASL", 0x1E}, {"AND", 0x3D}, {"ROL", 0x3E}, {"EOR", 0x5D}, {"LSR", 0x5E}, {"ADC", 0x7D}, {"ROR", 0x7E},
+    {"STA", 0x9D}, {"LDY", 0xBC}, {"LDA", 0xBD}, {"CMP", 0xDD}, {"DEC", 0xDE}, {"SBC", 0xFD}, {"INC", 0xFE},
+    {"SLO", 0x1F}, {"RLA", 0x3F}, {"SRE", 0x5F}, {"RRA", 0x7F}, {"DCP", 0xDF}, {"ISC", 0xFF}
+};
+
+map<string, uint8_t> const idx_x_zpg_opcodes
+{
+    {"ORA", 0x15}, {"ASL", 0x16}, {"AND", 0x35}, {"ROL", 0x36}, {"EOR", 0x55}, {"LSR", 0x56}, {"ADC", 0x75}, {"ROR", 0x76},
+    {"STY", 0x94}, {"STA", 0x95}, {"LDY", 0xB4}, {"LDA", 0xB5}, {"CMP", 0xD5}, {"DEC", 0xD6}, {"SBC", 0xF5}, {"INC", 0xF6},
+    {"SLO", 0x17}, {"RLA", 0x37}, {"SRE", 0x57}, {"RRA", 0x77}, {"DCP", 0xD7}, {"ISC", 0xF7}
+};
+
+map<string, uint8_t> const idx_y_opcodes
+{
+    {"ORA", 0x19}, {"AND", 0x39}, {"EOR", 0x59}, {"ADC", 0x79}, {"STA", 0x99}, {"LDA", 0xB9}, {"LDX", 0xBE}, {"CMP", 0xD9},
+    {"SBC", 0xF9},
+    {"SLO", 0x1B}, {"RLA", 0x3B}, {"SRE", 0x5B}, {"RRA", 0x7B}, {"LAX", 0xBF}, {"DCP", 0xDB}, {"ISC", 0xFB}
+};
+
+map<string, uint8_t> const idx_y_zpg_opcodes
+{
+    {"STX", 0x96}, {"LDX", 0xB6},
+    {"SAX", 0x97}, {"LAX", 0xB7}
+};
+
+map<string, uint8_t> const abs_opcodes
+{
+    {"ORA", 0x0D}, {"ASL", 0x0E}, {"JSR", 0x20}, {"BIT", 0x2C}, {"AND", 0x2D}, {"ROL", 0x2E}, {"JMP", 0x4C},
+    {"EOR", 0x4D}, {"LSR", 0x4E}, {"ADC", 0x6D}, {"ROR", 0x6E}, {"STY", 0x8C}, {"STA", 0x8D}, {"STX", 0x8E}, {"LDY", 0xAC},
+    {"LDA", 0xAD}, {"LDX", 0xAE}, {"CPY", 0xCC}, {"CMP", 0xCD}, {"DEC", 0xCE}, {"CPX", 0xEC}, {"SBC", 0xED}, {"INC", 0xEE},
+    {"SLO", 0x0F}, {"RLA", 0x2F}, {"SRE", 0x4F}, {"RRA", 0x6F}, {"SAX", 0x8F}, {"LAX", 0xAF}, {"DCP", 0xCF}, {"ISC", 0xEF}
+};
+
+map<string, uint8_t> const abs_zpg_opcodes
+{
+    {"ORA", 0x05}, {"ASL", 0x06}, {"BIT", 0x24}, {"AND", 0x25}, {"ROL", 0x26}, {"EOR", 0x45}, {"LSR", 0x46}, {"ADC", 0x65},
+    {"ROR", 0x66}, {"STY", 0x84}, {"STA", 0x85}, {"STX", 0x86}, {"LDY", 0xA4}, {"LDA", 0xA5}, {"LDX", 0xA6}, {"CPY", 0xC4},
+    {"CMP", 0xC5}, {"DEC", 0xC6}, {"CPX", 0xE4}, {"SBC", 0xE5}, {"INC", 0xE6},
+    {"SLO", 0x07}, {"RLA", 0x27}, {"SRE", 0x47}, {"RRA", 0x67}, {"SAX", 0x87}, {"LAX", 0xA7}, {"DCP", 0xC7}, {"ISC", 0xE7}
+};
+
+map<string, uint8_t> const idx_idr_opcodes
+{
+    {"ORA", 0x01}, {"AND", 0x21}, {"EOR", 0x41}, {"ADC", 0x61}, {"STA", 0x81}, {"LDA", 0xA1}, {"CMP", 0xC1}, {"SBC", 0xE1},
+    {"SLO", 0x03}, {"RLA", 0x23}, {"SRE", 0x43}, {"RRA", 0x63}, {"SAX", 0x83}, {"LAX", 0xA3}, {"DCP", 0xC3}, {"ISC", 0xE3}
+};
+
+map<string, uint8_t> const idr_idx_opcodes
+{
+    {"ORA", 0x11}, {"AND", 0x31}, {"EOR", 0x51}, {"ADC", 0x71}, {"STA", 0x91}, {"LDA", 0xB1}, {"CMP", 0xD1}, {"SBC", 0xF1},
+    {"SLO", 0x13}, {"RLA", 0x33}, {"SRE", 0x53}, {"RRA", 0x73}, {"LAX", 0xB3}, {"DCP", 0xD3}, {"ISC", 0xF3}
+};
+
+// the stable undocumented NMOS opcodes, only assembled if enabled. The unstable ones like
+// XAA, AHX or TAS depend on the chip and are left out.
+set<string> const undocumented_opcodes
+{
+    "SLO", "RLA", "SRE", "RRA", "SAX", "LAX", "DCP", "ISC", "ANC", "ALR", "ARR", "SBX"
+};
+
+
+static auto makeOpcodeInfos() -> array<optional<OpcodeInfo>, 256>
+{
+    array<optional<OpcodeInfo>, 256> ret;
+    pair<map<string, uint8_t> const *, AddressingMode> const tables[] =
+    {
+        {&dir_opcodes, AddressingMode::Implied}, {&imm_opcodes, AddressingMode::Immediate},
+        {&rel_opcodes, AddressingMode::Relative}, {&idx_x_opcodes, AddressingMode::AbsoluteX},
+        {&idx_x_zpg_opcodes, AddressingMode::ZeroPageX}, {&idx_y_opcodes, AddressingMode::AbsoluteY},
+        {&idx_y_zpg_opcodes, AddressingMode::ZeroPageY}, {&abs_opcodes, AddressingMode::Absolute},
+        {&abs_zpg_opcodes, AddressingMode::ZeroPage}, {&idx_idr_opcodes, AddressingMode::IndexedIndirect},
+        {&idr_idx_opcodes, AddressingMode::IndirectIndexed}
+    };
+
+    for (auto const &table : tables)
+    {
+        for (auto const &opcode : *table.first)
+        {
+            ret[opcode.second] = OpcodeInfo{opcode.first, table.second, undocumented_opcodes.count(opcode.first) > 0};
+        }
+    }
+    ret[jmp_indir_opcode] = OpcodeInfo{"JMP", AddressingMode::Indirect, false};
+
+    return ret;
+}
+
+auto getOpcodeInfos() -> array<optional<OpcodeInfo>, 256> const &
+{
+    static array<optional<OpcodeInfo>, 256> const opcodeInfos = makeOpcodeInfos();
+
+    return opcodeInfos;
+}
+
+auto getOperandBytes(AddressingMode mode) -> uint32_t
+{
+    uint32_t ret = 1;
+
+    switch (mode)
+    {
+        case AddressingMode::Implied:
+            ret = 0;
+            break;
+
+        case AddressingMode::AbsoluteX:
+        case AddressingMode::AbsoluteY:
+        case AddressingMode::Absolute:
+        case AddressingMode::Indirect:
+            ret = 2;
+            break;
+
+        default:
+            break;
+    }
+
+    return ret;
+}
+
+} // namespace
@@ -0,0 +1,51 @@
+#ifndef OPCODE_TABLES_H
+#define OPCODE_TABLES_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+
+namespace asm6502
+{
+
+// mnemonic to opcode per addressing mode, shared by the assembler and the disassembler
+extern std::map<std::string, uint8_t> const dir_opcodes;
+extern std::map<std::string, uint8_t> const imm_opcodes;
+extern std::map<std::string, uint8_t> const rel_opcodes;
+extern std::map<std::string, uint8_t> const idx_x_opcodes;
+extern std::map<std::string, uint8_t> const idx_x_zpg_opcodes;
+extern std::map<std::string, uint8_t> const idx_y_opcodes;
+extern std::map<std::string, uint8_t> const idx_y_zpg_opcodes;
+extern std::map<std::string, uint8_t> const abs_opcodes;
+extern std::map<std::string, uint8_t> const abs_zpg_opcodes;
+extern std::map<std::string, uint8_t> const idx_idr_opcodes;
+extern std::map<std::string, uint8_t> const idr_idx_opcodes;
+extern std::set<std::string> const undocumented_opcodes;
+extern uint8_t const jmp_indir_opcode;
+
+enum class AddressingMode
+{
+    Implied, Immediate, Relative, AbsoluteX, ZeroPageX, AbsoluteY, ZeroPageY, Absolute, ZeroPage, IndexedIndirect,
+    IndirectIndexed, Indirect
+};
+
+// An opcode as decoded from the tables
+class OpcodeInfo
+{
+public:
+    std::string mnemonic;
+    AddressingMode mode;
+    bool undocumented;
+};
+
+// the tables reversed, indexed by the opcode, nullopt for opcodes the assembler does not know
+auto getOpcodeInfos() -> std::array<std::optional<OpcodeInfo>, 256> const &;
+// without the opcode itself
+auto getOperandBytes(AddressingMode mode) -> uint32_t;
+
+} // namespace
+
+#endif
@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "PeepholeOptimizer.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+uint8_t const OPC_JSR = 0x20;
+uint8_t const OPC_JMP = 0x4C;
+uint8_t const OPC_RTS = 0x60;
+uint8_t const OPC_CLC = 0x18;
+uint8_t const OPC_SEC = 0x38;
+uint8_t const OPC_SED = 0xF8;
+uint8_t const OPC_ADC_IMM = 0x69;
+uint8_t const OPC_SBC_IMM = 0xE9;
+
+uint8_t const FLAG_C = 0x01;
+uint8_t const FLAG_V = 0x40;
+
+// per register: immediate load, zero page load and store, transfers and steps
+class RegisterOpcodes
+{
+public:
+    char name;
+    uint8_t ldImm;
+    uint8_t ldZpg;
+    uint8_t stZpg;
+    std::vector<uint8_t> stores;    // all stores of the register, they leave registers and flags alone
+    std::vector<uint8_t> setsNZ;    // instructions which leave N and Z reflecting the register value
+};
+
+std::vector<RegisterOpcodes> const registerOpcodes
+{
+    {
+        'A', 0xA9, 0xA5, 0x85,
+        { 0x85, 0x95, 0x8D, 0x9D, 0x99, 0x81, 0x91 },
+        {
+            0xA9, 0xA5, 0xB5, 0xAD, 0xBD, 0xB9, 0xA1, 0xB1, // LDA
+            0x09, 0x05, 0x15, 0x0D, 0x1D, 0x19, 0x01, 0x11, // ORA
+            0x29, 0x25, 0x35, 0x2D, 0x3D, 0x39, 0x21, 0x31, // AND
+            0x49, 0x45, 0x55, 0x4D, 0x5D, 0x59, 0x41, 0x51, // EOR
+            0x69, 0x65, 0x75, 0x6D, 0x7D, 0x79, 0x61, 0x71, // ADC
+            0xE9, 0xE5, 0xF5, 0xED, 0xFD, 0xF9, 0xE1, 0xF1, // SBC
+            0x8A, 0x98, 0x68, 0x0A, 0x4A, 0x2A, 0x6A        // TXA, TYA, PLA, ASL A, LSR A, ROL A, ROR A
+        }
+    },
+    {
+        'X', 0xA2, 0xA6, 0x86,
+        { 0x86, 0x96, 0x8E },
+        { 0xA2, 0xA6, 0xB6, 0xAE, 0xBE, 0xAA, 0xBA, 0xE8, 0xCA } // LDX, TAX, TSX, INX, DEX
+    },
+    {
+        'Y', 0xA0, 0xA4, 0x84,
+        { 0x84, 0x94, 0x8C },
+        { 0xA0, 0xA4, 0xB4, 0xAC, 0xBC, 0xA8, 0xC8, 0x88 }      // LDY, TAY, INY, DEY
+    }
+};
+
+// TXA/TYA, CLC, ADC #1, TAX/TAY -> INX/INY, TXA/TYA and the SEC, SBC #1 counterparts
+class IndexStepPattern
+{
+public:
+    uint8_t transferToA;
+    uint8_t flagOp;
+    uint8_t arithOp;
+    uint8_t transferFromA;
+    uint8_t step;
+    char const *description;
+};
+
+std::vector<IndexStepPattern> const indexStepPatterns
+{
+    { 0x8A, OPC_CLC, OPC_ADC_IMM, 0xAA, 0xE8, "TXA / CLC / ADC #1 / TAX -> INX / TXA" },
+    { 0x98, OPC_CLC, OPC_ADC_IMM, 0xA8, 0xC8, "TYA / CLC / ADC #1 / TAY -> INY / TYA" },
+    { 0x8A, OPC_SEC, OPC_SBC_IMM, 0xAA, 0xCA, "TXA / SEC / SBC #1 / TAX -> DEX / TXA" },
+    { 0x98, OPC_SEC, OPC_SBC_IMM, 0xA8, 0x88, "TYA / SEC / SBC #1 / TAY -> DEY / TYA" },
+};
+
+auto contains(std::vector<uint8_t> const &opcodes, uint8_t opcode) -> bool
+{
+    return std::find(begin(opcodes), end(opcodes), opcode) != end(opcodes);
+}
+
+std::vector<uint8_t> const adcSbcOpcodes
+{
+    0x69, 0x65, 0x75, 0x6D, 0x7D, 0x79, 0x61, 0x71,
+    0xE9, 0xE5, 0xF5, 0xED, 0xFD, 0xF9, 0xE1, 0xF1
+};
+
+// instructions reading a flag before (possibly) writing it
+std::vector<uint8_t> const readsCarry
+{
+    0x2A, 0x26, 0x36, 0x2E, 0x3E, 0x6A, 0x66, 0x76, 0x6E, 0x7E, // ROL, ROR
+    0x90, 0xB0, 0x08,                                           // BCC, BCS, PHP
+    0x27, 0x37, 0x2F, 0x3F, 0x3B, 0x23, 0x33,                   // RLA (undocumented)
+    0x67, 0x77, 0x6F, 0x7F, 0x7B, 0x63, 0x73,                   // RRA (undocumented)
+    0xE7, 0xF7, 0xEF, 0xFF, 0xFB, 0xE3, 0xF3, 0x6B              // ISC, ARR (undocumented)
+};
+
+std::vector<uint8_t> const readsOverflow
+{
+    0x50, 0x70, 0x08                                            // BVC, BVS, PHP
+};
+
+// instructions overwriting a flag without reading it
+std::vector<uint8_t> const killsCarry
+{
+    0x18, 0x38, 0x28,                                           // CLC, SEC, PLP
+    0xC9, 0xC5, 0xD5, 0xCD, 0xDD, 0xD9, 0xC1, 0xD1,             // CMP
+    0xE0, 0xE4, 0xEC, 0xC0, 0xC4, 0xCC,                         // CPX, CPY
+    0x0A, 0x06, 0x16, 0x0E, 0x1E, 0x4A, 0x46, 0x56, 0x4E, 0x5E  // ASL, LSR
+};
+
+std::vector<uint8_t> const killsOverflow
+{
+    0xB8, 0x28, 0x24, 0x2C                                      // CLV, PLP, BIT
+};
+
+// after these, the flow of control is not known any more
+std::vector<uint8_t> const controlFlow
+{
+    0x10, 0x30, 0x50, 0x70, 0x90, 0xB0, 0xD0, 0xF0,             // branches
+    0x4C, 0x6C, OPC_JSR, OPC_RTS, 0x40, 0x00                    // JMP, JSR, RTS, RTI, BRK
+};
+
+auto hex(uint32_t value, int width) -> std::string
+{
+    std::stringstream strm;
+    strm << "$" << std::hex << std::uppercase << std::setw(width) << std::setfill('0') << value;
+    return strm.str();
+}
+
+auto operand(InstructionRecord const &instr) -> uint32_t
+{
+    return (instr.lengthBytes == 3) ? (instr.bytes[1] | (instr.bytes[2] << 8U)) : instr.bytes[1];
+}
+
+}
+
+auto PeepholeOptimizer::optimize(std::vector<InstructionRecord> const &instructions) -> bool
+{
+    size_t numRewrites = rewrites.size();
+
+    bool binaryMode = std::none_of(begin(instructions), end(instructions),
+        [](InstructionRecord const &instr) { return instr.bytes[0] == OPC_SED; });
+
+    size_t idx = 0;
+    while (idx < instructions.size())
+    {
+        size_t consumed = matchTailCall(instructions, idx);
+
+        if (consumed == 0)
+        {
+            consumed = matchRedundantImmediateLoad(instructions, idx);
+        }
+        if (consumed == 0)
+        {
+            consumed = matchStoreReload(instructions, idx, binaryMode);
+        }
+        if (consumed == 0)
+        {
+            consumed = matchIndexIncrement(instructions, idx, binaryMode);
+        }
+
+        idx += std::max<size_t>(consumed, 1);
+    }
+
+    return rewrites.size() > numRewrites;
+}
+
+// JSR x / RTS -> JMP x: the subroutine returns to our caller directly
+auto PeepholeOptimizer::matchTailCall(Instructions const &instrs, size_t idx) -> size_t
+{
+    size_t ret = 0;
+
+    if (isContiguous(instrs, idx, 2) && isUnlabeled(instrs, idx + 1, 1) &&
+        (instrs[idx].bytes[0] == OPC_JSR) && (instrs[idx + 1].bytes[0] == OPC_RTS))
+    {
+        std::string target = hex(operand(instrs[idx]), 4);
+        addRewrite(instrs[idx], RewriteKind::ReplaceOpcode, OPC_JMP);
+        addRewrite(instrs[idx + 1], RewriteKind::Remove, 0);
+        report(instrs[idx], "JSR " + target + " / RTS -> JMP " + target, 1, 9);
+        ret = 2;
+    }
+
+    return ret;
+}
+
+// LDx #n / (stores) / LDx #n: the second load neither changes the register nor its flags
+auto PeepholeOptimizer::matchRedundantImmediateLoad(Instructions const &instrs, size_t idx) -> size_t
+{
+    size_t ret = 0;
+
+    for (auto const &reg : registerOpcodes)
+    {
+        if ((idx < instrs.size()) && (instrs[idx].bytes[0] == reg.ldImm))
+        {
+            size_t next = idx + 1;
+            while (isContiguous(instrs, next - 1, 2) && isUnlabeled(instrs, next, 1) && contains(reg.stores, instrs[next].bytes[0]))
+            {
+                next++;
+            }
+
+            if (isContiguous(instrs, next - 1, 2) && isUnlabeled(instrs, next, 1) &&
+                (instrs[next].bytes[0] == reg.ldImm) && (instrs[next].bytes[1] == instrs[idx].bytes[1]))
+            {
+                addRewrite(instrs[next], RewriteKind::Remove, 0);
+                report(instrs[next], std::string("redundant LD") + reg.name + " #" + hex(instrs[next].bytes[1], 2) + " removed", 2, 2);
+                ret = next + 1 - idx;
+            }
+            break;
+        }
+    }
+
+    return ret;
+}
+
+// (op setting NZ from x) / STx zpg / LDx zpg -> the reload does not change anything.
+// Only zero page addresses from $02 are considered, $00/$01 are the 6510 I/O port,
+// absolute addresses may be I/O registers which read back differently. In decimal mode,
+// N and Z after ADC and SBC do not reflect the result, the reload sets them.
+auto PeepholeOptimizer::matchStoreReload(Instructions const &instrs, size_t idx, bool binaryMode) -> size_t
+{
+    size_t ret = 0;
+
+    if (isContiguous(instrs, idx, 3) && isUnlabeled(instrs, idx + 1, 2))
+    {
+        uint8_t opcode = instrs[idx].bytes[0];
+
+        for (auto const &reg : registerOpcodes)
+        {
+            if (contains(reg.setsNZ, opcode) && (binaryMode || !contains(adcSbcOpcodes, opcode)) &&
+                (instrs[idx + 1].bytes[0] == reg.stZpg) && (instrs[idx + 2].bytes[0] == reg.ldZpg) &&
+                (instrs[idx + 1].bytes[1] == instrs[idx + 2].bytes[1]) && (instrs[idx + 1].bytes[1] >= 0x02))
+            {
+                std::string zpg = hex(instrs[idx + 1].bytes[1], 2);
+                addRewrite(instrs[idx + 2], RewriteKind::Remove, 0);
+                report(instrs[idx + 2], std::string("ST") + reg.name + " " + zpg + " / LD" + reg.name + " " + zpg + " -> ST" + reg.name + " " + zpg, 2, 3);
+                ret = 3;
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+// TXA / CLC / ADC #1 / TAX -> INX / TXA, if carry and overflow are not used afterwards
+auto PeepholeOptimizer::matchIndexIncrement(Instructions const &instrs, size_t idx, bool binaryMode) -> size_t
+{
+    size_t ret = 0;
+
+    if (binaryMode && isContiguous(instrs, idx, 4) && isUnlabeled(instrs, idx + 1, 3))
+    {
+        for (auto const &pattern : indexStepPatterns)
+        {
+            if ((instrs[idx].bytes[0] == pattern.transferToA) && (instrs[idx + 1].bytes[0] == pattern.flagOp) &&
+                (instrs[idx + 2].bytes[0] == pattern.arithOp) && (instrs[idx + 2].bytes[1] == 0x01) &&
+                (instrs[idx + 3].bytes[0] == pattern.transferFromA) &&
+                isFlagDead(instrs, idx + 4, FLAG_C) && isFlagDead(instrs, idx + 4, FLAG_V))
+            {
+                addRewrite(instrs[idx], RewriteKind::ReplaceOpcode, pattern.step);
+                addRewrite(instrs[idx + 1], RewriteKind::ReplaceOpcode, pattern.transferToA);
+                addRewrite(instrs[idx + 2], RewriteKind::Remove, 0);
+                addRewrite(instrs[idx + 3], RewriteKind::Remove, 0);
+                report(instrs[idx], pattern.description, 3, 4);
+                ret = 4;
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+auto PeepholeOptimizer::isContiguous(Instructions const &instrs, size_t idx, size_t count) -> bool
+{
+    bool ret = (idx + count <= instrs.size());
+
+    for (size_t i = idx; ret && (i + 1 < idx + count); i++)
+    {
+        ret = (instrs[i].address + instrs[i].lengthBytes == instrs[i + 1].address);
+    }
+
+    return ret;
+}
+
+auto PeepholeOptimizer::isUnlabeled(Instructions const &instrs, size_t idx, size_t count) -> bool
+{
+    bool ret = (idx + count <= instrs.size());
+
+    for (size_t i = idx; ret && (i < idx + count); i++)
+    {
+        ret = !instrs[i].hasLabel;
+    }
+
+    return ret;
+}
+
+// follows the straight line code from idx until the flag is overwritten without being read.
+// Anything else, including reaching a branch or the end of the code block, keeps the flag alive.
+auto PeepholeOptimizer::isFlagDead(Instructions const &instrs, size_t idx, uint8_t flag) -> bool
+{
+    bool isDead = false;
+    bool isDecided = false;
+
+    for (size_t i = idx; !isDecided && (i < instrs.size()) && ((i == idx) || isContiguous(instrs, i - 1, 2)); i++)
+    {
+        uint8_t opcode = instrs[i].bytes[0];
+        bool reads = (flag == FLAG_C) ? (contains(readsCarry, opcode) || contains(adcSbcOpcodes, opcode)) : contains(readsOverflow, opcode);
+        bool kills = (flag == FLAG_C) ? contains(killsCarry, opcode) : (contains(killsOverflow, opcode) || contains(adcSbcOpcodes, opcode));
+
+        if (reads || contains(controlFlow, opcode))
+        {
+            isDecided = true;
+        }
+        else if (kills)
+        {
+            isDead = true;
+            isDecided = true;
+        }
+    }
+
+    return isDead;
+}
+
+void PeepholeOptimizer::addRewrite(InstructionRecord const &instr, RewriteKind kind, uint8_t opcode)
+{
+    statementRewrites[instr.statementIdx] = StatementRewrite{kind, opcode};
+}
+
+void PeepholeOptimizer::report(InstructionRecord const &instr, std::string const &description, uint32_t bytesSaved, uint32_t cyclesSaved)
+{
+    rewrites.push_back(PeepholeRewrite{instr.srcLine, description, bytesSaved, cyclesSaved});
+}
@@ -0,0 +1,86 @@
+#ifndef PEEPHOLE_OPTIMIZER_H
+#define PEEPHOLE_OPTIMIZER_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace asm6502
+{
+
+// One assembled statement, as recorded by the listener
+class InstructionRecord
+{
+public:
+    size_t statementIdx;        // ordinal of the statement in the source, stable across assembler runs
+    size_t srcLine;
+    uint32_t address;
+    uint32_t lengthBytes;
+    bool hasLabel;              // labeled statements may be jump or branch targets
+    std::array<uint8_t, 3> bytes;
+};
+
+enum class RewriteKind
+{
+    Remove,                     // the statement is dropped, following code moves down
+    ReplaceOpcode               // the statement keeps its operand, but gets another opcode
+};
+
+// Applied by the listener when it assembles the statement with the given statementIdx
+class StatementRewrite
+{
+public:
+    RewriteKind kind;
+    uint8_t opcode;
+};
+
+// Describes one applied peephole, for reporting
+class PeepholeRewrite
+{
+public:
+    size_t srcLine;
+    std::string description;
+    uint32_t bytesSaved;
+    uint32_t cyclesSaved;
+};
+
+// Finds well-known, safe 6502 peepholes in the statements of an assembled program.
+// The rewrites are expressed on source statements, the caller re-assembles the source
+// with them, which lays out all addresses again and patches branches and jumps.
+// Code is assumed to run in binary mode, rewrites depending on this are disabled for
+// programs containing an SED instruction.
+class PeepholeOptimizer
+{
+public:
+    // returns true if new rewrites were found
+    auto optimize(std::vector<InstructionRecord> const &instructions) -> bool;
+
+    auto getStatementRewrites() const -> std::map<size_t, StatementRewrite> const & { return statementRewrites; }
+    auto getRewrites() const -> std::vector<PeepholeRewrite> const & { return rewrites; }
+
+private:
+
+    using Instructions = std::vector<InstructionRecord>;
+
+    // each matcher returns the number of instructions consumed by the rewrite, or zero
+    auto matchTailCall(Instructions const &instrs, size_t idx) -> size_t;
+    auto matchRedundantImmediateLoad(Instructions const &instrs, size_t idx) -> size_t;
+    auto matchStoreReload(Instructions const &instrs, size_t idx, bool binaryMode) -> size_t;
+    auto matchIndexIncrement(Instructions const &instrs, size_t idx, bool binaryMode) -> size_t;
+
+    static auto isContiguous(Instructions const &instrs, size_t idx, size_t count) -> bool;
+    static auto isUnlabeled(Instructions const &instrs, size_t idx, size_t count) -> bool;
+    static auto isFlagDead(Instructions const &instrs, size_t idx, uint8_t flag) -> bool;
+
+    void addRewrite(InstructionRecord const &instr, RewriteKind kind, uint8_t opcode);
+    void report(InstructionRecord const &instr, std::string const &description, uint32_t bytesSaved, uint32_t cyclesSaved);
+
+    std::map<size_t, StatementRewrite> statementRewrites;
+    std::vector<PeepholeRewrite> rewrites;
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,20 @@
+#include <atomic>
+
+#include "ScratchBuffer.h"
+
+namespace
+{
+
+std::atomic<size_t> numAllocations{0};
+
+}
+
+auto asm6502::getScratchBufferAllocations() -> size_t
+{
+    return numAllocations.load();
+}
+
+void asm6502::countScratchBufferAllocation()
+{
+    numAllocations++;
+}
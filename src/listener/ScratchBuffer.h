@@ -0,0 +1,75 @@
+#ifndef SCRATCH_BUFFER_H
+#define SCRATCH_BUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace asm6502
+{
+
+// heap allocations of the storage of all ScratchBuffers, summed over all buffers and threads
+auto getScratchBufferAllocations() -> size_t;
+void countScratchBufferAllocation();
+
+// the standard allocator, counting each allocation
+template <typename T>
+class CountingAllocator
+{
+public:
+    typedef T value_type;
+
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(CountingAllocator<U> const &) {}
+
+    auto allocate(size_t n) -> T *
+    {
+        countScratchBufferAllocation();
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+    template <typename U>
+    auto operator==(CountingAllocator<U> const &) const -> bool { return true; }
+    template <typename U>
+    auto operator!=(CountingAllocator<U> const &) const -> bool { return false; }
+};
+
+// Per-line state of the listener, e.g. the expression stack. The buffer is reserved once and
+// reused for each line, clear() keeps its capacity, so the lines do not allocate it again. Only
+// an unusually long line grows it. Elements owning heap memory, e.g. long strings, still allocate
+// it themselves.
+template <typename T>
+class ScratchBuffer
+{
+public:
+    explicit ScratchBuffer(size_t capacity) { items.reserve(capacity); }
+
+    void push_back(T item) { items.push_back(std::move(item)); }
+
+    template <typename... Args>
+    void emplace_back(Args &&... args) { push_back(T(std::forward<Args>(args)...)); }
+
+    void pop_back() { items.pop_back(); }
+    void clear() { items.clear(); }
+    void truncate(size_t size) { items.resize(std::min(size, items.size())); }
+
+    auto back() -> T & { return items.back(); }
+    auto data() const -> T const * { return items.data(); }
+    auto empty() const -> bool { return items.empty(); }
+    auto size() const -> size_t { return items.size(); }
+    auto operator[](size_t idx) const -> T const & { return items[idx]; }
+    auto begin() const { return items.begin(); }
+    auto end() const { return items.end(); }
+
+private:
+    std::vector<T, CountingAllocator<T>> items;
+};
+
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include <iomanip>
+#include <sstream>
+
+#include "SemanticError.h"
+#include "SymbolTable.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+// %0, %1, ... are replaced by the arguments
+auto getFormat(ErrorCode code) -> char const *
+{
+    char const *ret = "";
+
+    switch (code)
+    {
+        case ErrorCode::Syntax:
+        case ErrorCode::Include:
+        case ErrorCode::Macro:
+        case ErrorCode::Exception:
+            ret = "%0";
+            break;
+        case ErrorCode::MissingSymbol:
+        case ErrorCode::UnresolvedBranchTarget:
+            ret = "Symbol or expression \"%0\" could not be resolved.";
+            break;
+        case ErrorCode::BranchTargetTooFar:
+            ret = "Branch at address 0x%0 is too far away from the branch target \"%1\" at address 0x%2.";
+            break;
+        case ErrorCode::DuplicateSymbol:
+            ret = "Redefinition of Symbol \"%0\" detected. See previous definition at %1.";
+            break;
+        case ErrorCode::ValueOutOfRange:
+            ret = "Value \"%0\" is out of its supported value range: [%1,%2].";
+            break;
+        case ErrorCode::OperandTooLarge:
+            ret = "The operation requires a one byte operand, but its value 0x%0 does not fit into one byte.";
+            break;
+        case ErrorCode::FileNotReadable:
+            ret = "Could not read binary file \"%0\".";
+            break;
+        case ErrorCode::CircularDefinition:
+            ret = "Symbol \"%0\" is defined in terms of itself, directly or through other symbols.";
+            break;
+        case ErrorCode::OverlappingBlocks:
+            ret = "Code at 0x%0-0x%1 overlaps code at 0x%2-0x%3.";
+            break;
+        case ErrorCode::SegmentOutsideObjectMode:
+            ret = ".SEGMENT is only supported when assembling an object file.";
+            break;
+        case ErrorCode::UndocumentedOpcode:
+            ret = "Undocumented opcode %0 is only supported with -u.";
+            break;
+        case ErrorCode::AddressingMode:
+            ret = "Addressing mode not available for %0.";
+            break;
+        case ErrorCode::UnknownFunction:
+            ret = "Unknown function %0, supported are LO and HI.";
+            break;
+        case ErrorCode::ZeroPagePoolExhausted:
+            ret = "Variable \"%0\" is used with indirect addressing, but the zero page pool is exhausted.";
+            break;
+        case ErrorCode::FileNotOpened:
+            ret = "Could not open file.";
+            break;
+        case ErrorCode::ExpressionTooDeep:
+            ret = "Expression is nested too deeply, the limit is %0.";
+            break;
+        case ErrorCode::ErrorLimit:
+            ret = "Too many errors, stopping after %0.";
+            break;
+        case ErrorCode::Internal:
+            ret = "Internal error.";
+            break;
+    }
+
+    return ret;
+}
+
+auto escapeJson(std::string const &str) -> std::string
+{
+    std::stringstream strm;
+
+    for (char ch : str)
+    {
+        switch (ch)
+        {
+            case '"':
+                strm << "\\\"";
+                break;
+            case '\\':
+                strm << "\\\\";
+                break;
+            case '\n':
+                strm << "\\n";
+                break;
+            case '\t':
+                strm << "\\t";
+                break;
+            default:
+                if (static_cast<uint8_t>(ch) < 0x20)
+                {
+                    strm << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<uint32_t>(static_cast<uint8_t>(ch)) << std::dec;
+                }
+                else
+                {
+                    strm << ch;
+                }
+                break;
+        }
+    }
+
+    return strm.str();
+}
+
+}
+
+auto SemanticError::getMessage() const -> std::string
+{
+    std::string ret;
+
+    for (char const *pFormat = getFormat(code); *pFormat != '\0'; pFormat++)
+    {
+        size_t argIdx = ((pFormat[0] == '%') && (pFormat[1] >= '0') && (pFormat[1] <= '9')) ? static_cast<size_t>(pFormat[1] - '0') : args.size();
+
+        if (argIdx < args.size())
+        {
+            ret += args[argIdx];
+            pFormat++;
+        }
+        else
+        {
+            ret += *pFormat;
+        }
+    }
+
+    return ret;
+}
+
+auto SemanticError::getErrorMessage(std::string const &fileName) const -> std::string
+{
+    return (line > 0) ? formatErrorMessage(fileName, line, col, getMessage()) : (fileName + ": error: " + getMessage() + "\n");
+}
+
+auto SemanticError::getCodeName(ErrorCode code) -> char const *
+{
+    static char const * const names[] = {
+        "syntax", "include", "macro", "missing-symbol", "unresolved-branch-target", "branch-target-too-far", "duplicate-symbol",
+        "value-out-of-range", "operand-too-large", "file-not-readable", "circular-definition", "overlapping-blocks",
+        "segment-outside-object-mode", "undocumented-opcode", "addressing-mode", "unknown-function", "zero-page-pool-exhausted",
+        "file-not-opened", "exception", "expression-too-deep", "error-limit", "internal" };
+
+    return names[static_cast<size_t>(code)];
+}
+
+auto Diagnostics::getSourceFile(size_t fileId) const -> std::string const &
+{
+    return (fileId == Sym::PRELUDE_FILE_ID) ? preludeName : sourceFiles.at(fileId);
+}
+
+auto Diagnostics::getMessages() const -> std::vector<std::string>
+{
+    std::vector<std::string> ret;
+
+    for (auto const &error : errors)
+    {
+        ret.push_back(error.getErrorMessage(getSourceFile(error.getFileId())));
+    }
+
+    return ret;
+}
+
+void Diagnostics::writeText(std::ostream &os) const
+{
+    for (auto const &error : errors)
+    {
+        os << error.getErrorMessage(getSourceFile(error.getFileId()));
+    }
+}
+
+void Diagnostics::writeJson(std::ostream &os) const
+{
+    for (auto const &error : errors)
+    {
+        os
+            << "{\"file\": \"" << escapeJson(getSourceFile(error.getFileId())) << "\", \"line\": " << error.getLine()
+            << ", \"column\": " << error.getColumn() << ", \"code\": \"" << SemanticError::getCodeName(error.getCode())
+            << "\", \"message\": \"" << escapeJson(error.getMessage()) << "\"}\n";
+    }
+}
+
+auto asm6502::formatErrorMessage(std::string const &fileName, size_t line, size_t col, std::string const &msg) -> std::string
+{
+    std::stringstream strm;
+    strm << fileName << ":" << line << ":" << col << ": error: " << msg << std::endl;
+
+    return strm.str();
+}
@@ -1,36 +1,97 @@
 #ifndef SEMANTIC_ERROR_H
 #define SEMANTIC_ERROR_H
 
+#include <cstdint>
+#include <iostream>
 #include <string>
-#include <sstream>
+#include <utility>
+#include <vector>
 
 namespace asm6502
 {
+
+// what went wrong, each code has a message with placeholders for the arguments of the error
+enum class ErrorCode : uint8_t
+{
+    Syntax,                     // lexer or parser message
+    Include,                    // message
+    Macro,                      // message
+    MissingSymbol,              // symbol or expression
+    UnresolvedBranchTarget,     // expression
+    BranchTargetTooFar,         // branch address, expression, target address
+    DuplicateSymbol,            // symbol, position of the previous definition
+    ValueOutOfRange,            // value, min, max
+    OperandTooLarge,            // operand
+    FileNotReadable,            // path
+    CircularDefinition,         // symbol
+    OverlappingBlocks,          // block start, end, overlapped start, end
+    SegmentOutsideObjectMode,
+    UndocumentedOpcode,         // opcode
+    AddressingMode,             // mnemonic
+    UnknownFunction,            // name
+    ZeroPagePoolExhausted,      // variable
+    FileNotOpened,              // w/o position
+    Exception,                  // what(), w/o position
+    ExpressionTooDeep,          // limit
+    ErrorLimit,                 // limit
+    Internal
+};
+
+// A diagnostic as compact record, the message is only formatted when it is printed. Line 0
+// stands for an error of the whole file.
 class SemanticError
 {
 public:
-    SemanticError(std::string const &_errmsg, std::string const &_filename, std::size_t _linenr, std::size_t _colnr) : 
-        errmsg{_errmsg},
-        filename{_filename},
-        linenr{_linenr},
-        colnr{_colnr}
+    SemanticError(ErrorCode code_, size_t fileId_, size_t line_, size_t col_, std::vector<std::string> args_ = {}) :
+        code{code_},
+        fileId{fileId_},
+        line{line_},
+        col{col_},
+        args{std::move(args_)}
     {}
 
-    std::string getErrorMessage() const
-    {
-        std::stringstream strm;
-        strm << filename << ":" << linenr << ":" << colnr << ": error: " << errmsg << std::endl;
+    auto getCode() const -> ErrorCode { return code; }
+    auto getFileId() const -> size_t { return fileId; }
+    auto getLine() const -> size_t { return line; }
+    auto getColumn() const -> size_t { return col; }
+
+    // the message with the arguments filled in, w/o position
+    auto getMessage() const -> std::string;
+    // "file:line:col: error: message\n"
+    auto getErrorMessage(std::string const &fileName) const -> std::string;
+    // the code as written to JSON, e.g. "missing-symbol"
+    static auto getCodeName(ErrorCode code) -> char const *;
 
-        return strm.str();
-    }
-    
 private:
+    ErrorCode code;
+    size_t fileId;
+    size_t line;
+    size_t col;
+    std::vector<std::string> args;
+};
 
-    std::string errmsg;
-    std::string filename;
-    std::size_t linenr;
-    std::size_t colnr;
+// The errors of an assembled program and the files they refer to
+class Diagnostics
+{
+public:
+    std::vector<SemanticError> errors;
+    std::vector<std::string> sourceFiles;   // by file id, see MOS6502Listener::getSourceFile()
+    std::string preludeName;
+
+    auto empty() const -> bool { return errors.empty(); }
+    auto size() const -> size_t { return errors.size(); }
+    auto getSourceFile(size_t fileId) const -> std::string const &;
+
+    // formats each error, see SemanticError::getErrorMessage()
+    auto getMessages() const -> std::vector<std::string>;
+    void writeText(std::ostream &os) const;
+    // JSON Lines, an object per error: {"file": ..., "line": ..., "column": ..., "code": ..., "message": ...}
+    void writeJson(std::ostream &os) const;
 };
+
+// for errors outside of assembled files, e.g. of test files
+auto formatErrorMessage(std::string const &fileName, size_t line, size_t col, std::string const &msg) -> std::string;
+
 }
 
 #endif
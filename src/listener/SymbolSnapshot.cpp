@@ -0,0 +1,57 @@
+#include <iterator>
+#include <vector>
+
+#include "BinaryIO.h"
+#include "SymbolSnapshot.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+std::string const SNAPSHOT_MAGIC = "A65SYM";
+uint8_t const SNAPSHOT_VERSION = 1;
+
+}
+
+void asm6502::writeSymbolSnapshot(std::ostream &os, SymbolTable const &symbolTable)
+{
+    SymbolMap symbols = symbolTable.getSymbols();
+
+    os << SNAPSHOT_MAGIC;
+    os.put(static_cast<char>(SNAPSHOT_VERSION));
+    writeNumber(os, static_cast<uint32_t>(symbols.size()), 4);
+
+    for (auto const &sym : symbols)
+    {
+        writeString(os, sym.first);
+        writeNumber(os, sym.second.val, 4);
+        writeNumber(os, static_cast<uint32_t>(sym.second.line), 4);
+        writeNumber(os, static_cast<uint32_t>(sym.second.col), 4);
+    }
+}
+
+auto asm6502::readSymbolSnapshot(std::istream &is) -> std::optional<SymbolTable>
+{
+    std::vector<char> data{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+    BinaryReader reader(data);
+
+    bool valid = (reader.readString(SNAPSHOT_MAGIC.length()) == SNAPSHOT_MAGIC) && (reader.readNumber(1) == SNAPSHOT_VERSION);
+    uint32_t numSymbols = reader.readNumber(4);
+    auto symbols = std::make_shared<SymbolMap>();
+
+    for (uint32_t idx = 0; valid && !reader.hasFailed() && (idx < numSymbols); idx++)
+    {
+        std::string name = reader.readString();
+        uint32_t val = reader.readNumber(4);
+        uint32_t line = reader.readNumber(4);
+        uint32_t col = reader.readNumber(4);
+
+        // names are written sorted, each one is inserted at the end
+        symbols->emplace_hint(symbols->end(), name, Sym{line, col, val, Sym::PRELUDE_FILE_ID});
+    }
+
+    valid = valid && !reader.hasFailed() && reader.isAtEnd();
+
+    return valid ? std::optional<SymbolTable>(SymbolTable(symbols)) : std::nullopt;
+}
@@ -0,0 +1,24 @@
+#ifndef SYMBOL_SNAPSHOT_H
+#define SYMBOL_SNAPSHOT_H
+
+#include <iostream>
+#include <optional>
+
+#include "SymbolTable.h"
+
+namespace asm6502
+{
+
+// Compact binary image of a symbol table, e.g. of a file with hardware equates,
+// which is loaded as prelude instead of assembling the file again.
+// Format, all numbers little endian:
+//   "A65SYM", version byte, number of symbols (4 bytes),
+//   per symbol sorted by name: name length (2 bytes), name, value (4 bytes), line (4 bytes), column (4 bytes)
+void writeSymbolSnapshot(std::ostream &os, SymbolTable const &symbolTable);
+
+// the loaded symbols form the shared base of the returned table, nullopt if the snapshot is invalid
+auto readSymbolSnapshot(std::istream &is) -> std::optional<SymbolTable>;
+
+} // namespace
+
+#endif
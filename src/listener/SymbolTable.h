@@ -1,9 +1,12 @@
 #ifndef SYMBOL_TABLE_H_
 #define SYMBOL_TABLE_H_
 
-#include <string>
+#include <cstdint>
+#include <limits>
 #include <map>
+#include <memory>
 #include <optional>
+#include <string>
 
 namespace asm6502
 {
@@ -11,26 +14,41 @@ namespace asm6502
 class Sym
 {
 public:
-    Sym(size_t line_, size_t col_, uint32_t val_) : 
+    static constexpr size_t PRELUDE_FILE_ID = std::numeric_limits<size_t>::max(); // loaded from a symbol snapshot
+
+    Sym(size_t line_, size_t col_, uint32_t val_, size_t fileId_ = 0, bool relocatable_ = false) : 
         line{line_},
         col{col_},
-        val{val_}
+        val{val_},
+        fileId{fileId_},
+        relocatable{relocatable_}
     {}
 
     Sym() : 
         line{0},
         col{0},
-        val{0}
+        val{0},
+        fileId{0},
+        relocatable{false}
     {}
 
     size_t line;
     size_t col;
     uint32_t val;
+    size_t fileId;      // file of the definition, see MOS6502Listener::getSourceFile()
+    bool relocatable;   // label of a module assembled as relocatable object, val is its offset in the module
 };
 
+typedef std::map<std::string, Sym> SymbolMap;
+
+// Symbols defined by the assembled program, on top of an optional base of prelude symbols.
+// The base is immutable and shared by all copies of the table, e.g. between threads
+// assembling different programs with the same prelude; a copy only duplicates its own symbols.
 class SymbolTable
 {
 public:
+    SymbolTable() : base{nullptr} {}
+    explicit SymbolTable(std::shared_ptr<SymbolMap const> base_) : base{base_} {}
 
     std::optional<Sym> resolveSymbol(std::string const &symbol) const
     {
@@ -41,19 +59,42 @@ public:
         {
             ret = std::optional<Sym>(pos->second);
         }
+        else if (base != nullptr)
+        {
+            auto basePos = base->find(symbol);
+
+            if (basePos != end(*base))
+            {
+                ret = std::optional<Sym>(basePos->second);
+            }
+        }
 
         return ret;
     }
 
-    void addSymbol(std::string const &symbol, size_t line, size_t col, uint32_t val)
+    void addSymbol(std::string const &symbol, size_t line, size_t col, uint32_t val, size_t fileId = 0, bool relocatable = false)
     {
         // if a symbol aready existed, we overwrite it here
         // symbol clashes must be covered by the caller
-        symbols[symbol] = {line, col, val};
+        symbols[symbol] = {line, col, val, fileId, relocatable};
+    }
+
+    // all symbols, including the base symbols
+    auto getSymbols() const -> SymbolMap
+    {
+        SymbolMap ret = (base != nullptr) ? *base : SymbolMap{};
+
+        for (auto const &sym : symbols)
+        {
+            ret[sym.first] = sym.second;
+        }
+
+        return ret;
     }
 
 private:
-    std::map<std::string, Sym> symbols;
+    std::shared_ptr<SymbolMap const> base;
+    SymbolMap symbols;
 };
 } // namespace
 #endif
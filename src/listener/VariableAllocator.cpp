@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <numeric>
+#include <optional>
+
+#include "VariableAllocator.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+uint32_t const NO_TARGET = 0xffffffffU;
+uint8_t const OPC_JMP = 0x4C;
+uint8_t const OPC_JMP_IND = 0x6C;
+uint8_t const OPC_STA_ZPG_X = 0x95;
+uint8_t const OPC_STY_ZPG_X = 0x94;
+uint8_t const OPC_STX_ZPG_Y = 0x96;
+uint8_t const OPC_LDX_ZPG_Y = 0xB6;
+uint8_t const OPC_SAX_ZPG_Y = 0x97;
+uint8_t const OPC_LAX_ZPG_Y = 0xB7;
+
+// [zp,X] and [zp],Y, also of the undocumented opcodes, and the indexed stores without absolute counterpart
+auto requiresZeroPage(uint8_t opcode) -> bool
+{
+    uint8_t mode = opcode & 0x1DU;
+    return (mode == 0x01) || (mode == 0x11) || (opcode == OPC_STY_ZPG_X) || (opcode == OPC_STX_ZPG_Y) || (opcode == OPC_SAX_ZPG_Y);
+}
+
+// absolute addressed instructions with a zero page counterpart, e.g. referring to a variable
+// declared later
+auto hasZeroPageForm(uint8_t opcode) -> bool
+{
+    uint8_t mode = opcode & 0x1FU;
+    return ((mode == 0x0C) || (mode == 0x0D) || (mode == 0x0E) || (mode == 0x0F) || (mode == 0x1C) || (mode == 0x1D) ||
+            (mode == 0x1E) || (mode == 0x1F)) && (opcode != OPC_JMP) && (opcode != OPC_JMP_IND);
+}
+
+// cycles a zero page instruction saves against its absolute counterpart, which is one byte
+// longer. Indexed reads take as long as their absolute counterparts without page crossing.
+auto getZeroPageSavings(uint8_t opcode) -> std::optional<uint32_t>
+{
+    std::optional<uint32_t> ret = std::nullopt;
+
+    switch (opcode & 0x1FU)
+    {
+        case 0x04:
+        case 0x05:
+        case 0x06:
+        case 0x07:
+            ret = 1;
+            break;
+
+        case 0x14:
+        case 0x15:
+        case 0x16:
+        case 0x17:
+            if ((opcode != OPC_STY_ZPG_X) && (opcode != OPC_STX_ZPG_Y) && (opcode != OPC_SAX_ZPG_Y))
+            {
+                // read-modify-write instructions and STA
+                bool isRmw = (((opcode & 0x1EU) == 0x16) && (opcode != OPC_LDX_ZPG_Y) && (opcode != OPC_LAX_ZPG_Y));
+                ret = (isRmw || (opcode == OPC_STA_ZPG_X)) ? 1 : 0;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return ret;
+}
+
+}
+
+// a backward branch or jump closes a loop from its target up to itself
+auto VariableAllocator::getLoopDepths(std::vector<InstructionRecord> const &instructions) -> std::map<size_t, size_t>
+{
+    std::vector<AddressRange> loops;
+    std::map<size_t, size_t> ret;
+
+    for (auto const &instr : instructions)
+    {
+        uint32_t target = NO_TARGET;
+
+        if (((instr.bytes[0] & 0x1FU) == 0x10) && (instr.lengthBytes == 2))
+        {
+            target = instr.address + 2 + static_cast<uint32_t>(static_cast<int8_t>(instr.bytes[1]));
+        }
+        else if ((instr.bytes[0] == OPC_JMP) && (instr.lengthBytes == 3))
+        {
+            target = instr.bytes[1] | (static_cast<uint32_t>(instr.bytes[2]) << 8U);
+        }
+
+        if (target <= instr.address)
+        {
+            loops.emplace_back(target, instr.address);
+        }
+    }
+
+    for (auto const &instr : instructions)
+    {
+        ret[instr.statementIdx] = std::count_if(begin(loops), end(loops),
+            [&instr](AddressRange const &loop) { return (loop.first <= instr.address) && (instr.address <= loop.second); });
+    }
+
+    return ret;
+}
+
+void VariableAllocator::allocate(std::vector<VariableDeclaration> const &variables, std::vector<SymbolReference> const &references,
+                                 std::vector<InstructionRecord> const &instructions, std::vector<AddressRange> const &pool)
+{
+    std::map<size_t, size_t> loopDepths = getLoopDepths(instructions);
+    std::map<size_t, InstructionRecord const *> statements;
+
+    for (auto const &instr : instructions)
+    {
+        statements[instr.statementIdx] = &instr;
+    }
+
+    allocations.clear();
+    allocationIdx.clear();
+    for (auto const &variable : variables)
+    {
+        allocationIdx[variable.name] = allocations.size();
+        allocations.push_back(VariableAllocation{variable, false, 0, 0, 0, false, 0, 0});
+    }
+
+    // only references accessing the memory of a variable count, not e.g. its address as immediate
+    for (auto const &reference : references)
+    {
+        auto pos = allocationIdx.find(reference.name);
+        auto statement = statements.find(reference.statementIdx);
+
+        if ((pos != end(allocationIdx)) && (statement != end(statements)))
+        {
+            VariableAllocation &allocation = allocations[pos->second];
+            uint8_t opcode = statement->second->bytes[0];
+
+            if (requiresZeroPage(opcode) || hasZeroPageForm(opcode) || (getZeroPageSavings(opcode) != std::nullopt))
+            {
+                uint64_t weight = 1;
+                for (size_t depth = std::min(loopDepths[reference.statementIdx], MAX_LOOP_DEPTH); depth > 0; depth--)
+                {
+                    weight *= LOOP_WEIGHT;
+                }
+
+                allocation.references++;
+                allocation.weight += weight;
+                allocation.requiresZeroPage = allocation.requiresZeroPage || requiresZeroPage(opcode);
+            }
+        }
+    }
+
+    std::vector<size_t> order(allocations.size());
+    std::iota(begin(order), end(order), 0);
+    std::stable_sort(begin(order), end(order), [this](size_t lhs, size_t rhs) {
+        return (allocations[lhs].requiresZeroPage != allocations[rhs].requiresZeroPage) ?
+            allocations[lhs].requiresZeroPage : (allocations[lhs].weight > allocations[rhs].weight); });
+
+    // first fit into the pool, unreferenced variables stay out of the zero page
+    IntervalIndex occupied;
+    for (size_t idx : order)
+    {
+        VariableAllocation &allocation = allocations[idx];
+
+        for (auto range = begin(pool); (allocation.references > 0) && !allocation.zeroPage && (range != end(pool)); ++range)
+        {
+            std::optional<uint32_t> optAddress = occupied.findFirstFit(range->first, range->second, allocation.variable.size);
+
+            if (optAddress != std::nullopt)
+            {
+                allocation.zeroPage = true;
+                allocation.address = optAddress.value();
+                occupied.insert(allocation.address, allocation.address + allocation.variable.size);
+            }
+        }
+    }
+}
+
+void VariableAllocator::account(std::vector<SymbolReference> const &references, std::vector<InstructionRecord> const &instructions)
+{
+    std::map<size_t, uint8_t> opcodes;
+
+    for (auto const &instr : instructions)
+    {
+        opcodes[instr.statementIdx] = instr.bytes[0];
+    }
+
+    for (auto const &reference : references)
+    {
+        auto pos = allocationIdx.find(reference.name);
+        auto opcode = opcodes.find(reference.statementIdx);
+
+        if ((pos != end(allocationIdx)) && allocations[pos->second].zeroPage && (opcode != end(opcodes)))
+        {
+            std::optional<uint32_t> optCycles = getZeroPageSavings(opcode->second);
+
+            if (optCycles != std::nullopt)
+            {
+                allocations[pos->second].bytesSaved++;
+                allocations[pos->second].cyclesSaved += optCycles.value();
+            }
+        }
+    }
+}
+
+auto VariableAllocator::getZeroPageAddresses() const -> std::map<std::string, uint32_t>
+{
+    std::map<std::string, uint32_t> ret;
+
+    for (auto const &allocation : allocations)
+    {
+        if (allocation.zeroPage)
+        {
+            ret[allocation.variable.name] = allocation.address;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,78 @@
+#ifndef VARIABLE_ALLOCATOR_H
+#define VARIABLE_ALLOCATOR_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "IntervalIndex.h"
+#include "PeepholeOptimizer.h"
+
+namespace asm6502
+{
+
+// A variable declared by .VAR, as recorded by the listener
+class VariableDeclaration
+{
+public:
+    std::string name;
+    uint32_t size;
+    size_t fileId;
+    size_t srcLine;
+    size_t srcCol;
+};
+
+// A symbol used in the operand of the statement with statementIdx
+class SymbolReference
+{
+public:
+    std::string name;
+    size_t statementIdx;
+};
+
+// The address assigned to a variable, and what it is worth
+class VariableAllocation
+{
+public:
+    VariableDeclaration variable;
+    bool zeroPage;
+    uint32_t address;           // zero page only, the others are placed at their declaration
+    size_t references;
+    uint64_t weight;            // references weighted by their loop nesting
+    bool requiresZeroPage;      // used with indirect addressing
+    uint32_t bytesSaved;
+    uint32_t cyclesSaved;       // per execution of each referring statement
+};
+
+// Assigns zero page slots to the variables with the highest weight, i.e. the number of their
+// references, each reference counting LOOP_WEIGHT times more per enclosing loop. Loops are
+// found as backward branches and jumps. Variables used with indirect addressing are placed
+// first, they cannot do without the zero page.
+// The allocation is based on a first assembler run, the caller re-assembles the source
+// with the zero page addresses, then accounts the savings in the re-assembled statements.
+class VariableAllocator
+{
+public:
+    static constexpr uint64_t LOOP_WEIGHT = 8;
+    static constexpr size_t MAX_LOOP_DEPTH = 8;
+
+    void allocate(std::vector<VariableDeclaration> const &variables, std::vector<SymbolReference> const &references,
+                  std::vector<InstructionRecord> const &instructions, std::vector<AddressRange> const &pool);
+    void account(std::vector<SymbolReference> const &references, std::vector<InstructionRecord> const &instructions);
+
+    // variable name to zero page address
+    auto getZeroPageAddresses() const -> std::map<std::string, uint32_t>;
+    // in declaration order
+    auto getAllocations() const -> std::vector<VariableAllocation> const & { return allocations; }
+
+private:
+    static auto getLoopDepths(std::vector<InstructionRecord> const &instructions) -> std::map<size_t, size_t>;
+
+    std::vector<VariableAllocation> allocations;
+    std::map<std::string, size_t> allocationIdx;
+};
+
+} // namespace
+
+#endif
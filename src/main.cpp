@@ -1,9 +1,17 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <thread>
 
 #include "ASM6502.h"
+#include "disasm/RoundTripChecker.h"
 #include "getopt.hpp"
+#include "sim/MOS6502Profiler.h"
 
 using namespace std;
 using namespace asm6502;
@@ -11,14 +19,208 @@ using namespace asm6502;
 static int const RET_OK = 0;
 static int const RET_ERR = 1;
 
+static uint64_t const PROFILE_MAX_CYCLES = 1000000000ULL;
+static size_t const PROFILE_MAX_HOTSPOTS = 20;
+static char const * const DISK_ID = "01";
+static size_t const DEFAULT_ERROR_LIMIT = 20;
+
 void usage(char const *argv0)
 {
     cerr 
         << "Usage: " << endl
-        << argv0 << " <asmfile> [-a] [-b] [-p <progfile>]" << endl
+        << argv0 << " <asmfile>... [-a] [-b] [-B] [-p <progfile>] [-l <progfile>] [-z <progfile>] [-e <entry>] [-d <d64file>] [-x <entry>] [-O] [-I <path>]... [-S <symfile>] [-P <symfile>] [-c <objfile>] [-g <dbgfile>] [-G <txtfile>] [-L <labelfile>] [-u] [-r] [-E <limit>] [-J]" << endl
         << "    -a: output assembly and machine code bytes" << endl
         << "    -b: output C64 basic program that pokes machine code into RAM" << endl
-        << "    -p <progfile>: write machine code into a progfile (C64 .PRG)" << endl;
+        << "    -B: output a denser C64 basic program, 16 bytes per DATA line" << endl
+        << "    -p <progfile>: write machine code into a progfile (C64 .PRG)" << endl
+        << "    -l <progfile>: write a progfile that is started with RUN and copies the machine code into place" << endl
+        << "    -z <progfile>: like -l, with the machine code LZ-packed and unpacked after RUN, reports the ratio" << endl
+        << "    -e <entry>: jump to label or address <entry> after loading with -l or -z, default is the lowest address" << endl
+        << "    -d <d64file>: write the machine code of each <asmfile> as a program into a C64 disk image" << endl
+        << "    -x <entry>: run the routine at label or address <entry> in the simulator, output a profile" << endl
+        << "    -O: apply peephole optimizations, report each applied optimization" << endl
+        << "    -I <path>: search .INCLUDE files in <path>, may be given multiple times" << endl
+        << "    -S <symfile>: write the symbols of the program into a symbol snapshot" << endl
+        << "    -P <symfile>: predefine the symbols of a symbol snapshot" << endl
+        << "    -c <objfile>: assemble into an object file for LINK6502, undefined symbols are left to the linker" << endl
+        << "    -g <dbgfile>: write a binary source map of addresses to file, line and column, and the labels" << endl
+        << "    -G <txtfile>: write the source map as text" << endl
+        << "    -L <labelfile>: write the labels as VICE monitor label file, loaded with \"ll\"" << endl
+        << "    -u: accept the stable undocumented NMOS opcodes like LAX, SAX, DCP, ISC and SBX" << endl
+        << "    -r: disassemble the machine code, reassemble it and verify the bytes are the same" << endl
+        << "    -E <limit>: stop assembling a file after <limit> errors, 0 for no limit, default is " << DEFAULT_ERROR_LIMIT << endl
+        << "    -J: output errors as JSON, one object per line" << endl
+        << "Several <asmfile>s are assembled one after the other, with -a, -b, -B, -d and -r only" << endl;
+}
+
+// the file name without directory and extension, as the name of a program or disk
+static auto getProgramName(std::string const &path) -> std::string
+{
+    return std::filesystem::path(path).stem().string();
+}
+
+// entry is either a label/symbol of the program, or a hex ($c000) or decimal address
+static auto resolveEntry(std::string const &entry, SymbolTable const &symbols) -> std::optional<uint16_t>
+{
+    std::optional<uint16_t> ret = std::nullopt;
+    std::optional<Sym> optSym = symbols.resolveSymbol(entry);
+
+    if (optSym != std::nullopt)
+    {
+        ret = static_cast<uint16_t>(optSym.value().val);
+    }
+    else if (!entry.empty())
+    {
+        std::stringstream ss;
+        uint32_t address = 0;
+
+        if (entry[0] == '$')
+        {
+            ss << std::hex << entry.substr(1);
+        }
+        else
+        {
+            ss << entry;
+        }
+
+        if ((ss >> address) && ss.eof() && (address <= 0xffff))
+        {
+            ret = static_cast<uint16_t>(address);
+        }
+    }
+
+    return ret;
+}
+
+static auto profile(AssemblyStatus const &assemblyStatus, std::string const &entry) -> int
+{
+    int ret = RET_OK;
+    std::optional<uint16_t> optEntryAddress = resolveEntry(entry, assemblyStatus.symbols);
+
+    if (optEntryAddress != std::nullopt)
+    {
+        auto pSim = std::make_unique<MOS6502Sim>();
+        pSim->loadMemBlocks(assemblyStatus.assembledProgram);
+        pSim->enableProfiling(true);
+        RunResult result = pSim->run(optEntryAddress.value(), PROFILE_MAX_CYCLES);
+
+        MOS6502Profiler profiler(assemblyStatus.assembledProgram, assemblyStatus.symbols);
+        profiler.attribute(*pSim);
+
+        cout << "--- 6502 Profile ---" << std::endl;
+        switch (result.stopReason)
+        {
+            case StopReason::Rts:
+                cout << "Routine returned." << std::endl;
+                break;
+            case StopReason::Brk:
+                cout << "Stopped at BRK." << std::endl;
+                break;
+            case StopReason::CycleLimit:
+                cout << "Stopped after " << PROFILE_MAX_CYCLES << " cycles." << std::endl;
+                break;
+            case StopReason::IllegalOpcode:
+                cout << "Stopped at illegal opcode, PC=0x" << std::hex << pSim->getRegisters().pc << std::dec << std::endl;
+                break;
+        }
+        cout << profiler.getHotSpotReport(PROFILE_MAX_HOTSPOTS) << std::endl;
+        cout << "--- Annotated Listing ---" << std::endl;
+        cout << profiler.getAnnotatedListing() << std::endl;
+    }
+    else
+    {
+        cerr << "Could not resolve entry point: " << entry << std::endl;
+        ret = RET_ERR;
+    }
+
+    return ret;
+}
+
+// the loader jumps to the entry, by default to the start of the first mem block
+static auto resolveLoaderEntry(AssemblyStatus const &assemblyStatus, std::string const &entry) -> std::optional<uint16_t>
+{
+    MemBlocks const &program = assemblyStatus.assembledProgram;
+
+    return entry.empty() ?
+        ((program.getNumMemBlocks() > 0) ? std::optional<uint16_t>(program.getMemBlockAt(0).getStartAddress()) : std::nullopt) :
+        resolveEntry(entry, assemblyStatus.symbols);
+}
+
+static auto writeLoader(AssemblyStatus const &assemblyStatus, std::string const &loaderFilePath, std::string const &entry) -> int
+{
+    int ret = RET_OK;
+    MemBlocks const &program = assemblyStatus.assembledProgram;
+    std::optional<uint16_t> optEntryAddress = resolveLoaderEntry(assemblyStatus, entry);
+
+    if (optEntryAddress == std::nullopt)
+    {
+        cerr << "Could not resolve entry point: " << entry << std::endl;
+        ret = RET_ERR;
+    }
+    else if (!writeLoaderFile(loaderFilePath.c_str(), program, optEntryAddress.value()))
+    {
+        cerr << "Could not write loader file: " << loaderFilePath << ", the program must not overlap the loader at $0801 "
+             << "or its pointers at $02 and $FB-$FE, and it must fit below $A000" << std::endl;
+        ret = RET_ERR;
+    }
+
+    return ret;
+}
+
+static auto writePacked(AssemblyStatus const &assemblyStatus, std::string const &packedFilePath, std::string const &entry) -> int
+{
+    int ret = RET_OK;
+    std::optional<uint16_t> optEntryAddress = resolveLoaderEntry(assemblyStatus, entry);
+    std::optional<PackedProgram> optPacked = std::nullopt;
+
+    if (optEntryAddress == std::nullopt)
+    {
+        cerr << "Could not resolve entry point: " << entry << std::endl;
+        ret = RET_ERR;
+    }
+    else if ((optPacked = writePackedFile(packedFilePath.c_str(), assemblyStatus.assembledProgram, optEntryAddress.value(),
+                                          std::thread::hardware_concurrency())) == std::nullopt)
+    {
+        cerr << "Could not write packed file: " << packedFilePath << ", the program must not overlap the depacker at $0801, "
+             << "the zero page, the stack or the packed data moved below $10000, and the packed file must fit below $A000" << std::endl;
+        ret = RET_ERR;
+    }
+    else
+    {
+        PackedProgram const &packed = optPacked.value();
+        cerr << "Packed " << packed.unpackedBytes << " to " << packed.prg.size() << " bytes ("
+             << (packed.prg.size() * 100 / std::max<size_t>(packed.unpackedBytes, 1)) << "%), depacking takes about "
+             << packed.depackCycles << " cycles" << std::endl;
+    }
+
+    return ret;
+}
+
+// writes the source map files whose path is not empty
+static auto writeSourceMaps(DebugInfo const &debugInfo, std::string const &debugInfoFilePath,
+                            std::string const &debugInfoTextFilePath, std::string const &viceLabelFilePath) -> int
+{
+    int ret = RET_OK;
+
+    if (!debugInfoFilePath.empty() && !writeDebugInfoFile(debugInfoFilePath.c_str(), debugInfo))
+    {
+        cerr << "Could not write debug info file: " << debugInfoFilePath << std::endl;
+        ret = RET_ERR;
+    }
+
+    if (!debugInfoTextFilePath.empty() && !writeDebugInfoTextFile(debugInfoTextFilePath.c_str(), debugInfo))
+    {
+        cerr << "Could not write debug info file: " << debugInfoTextFilePath << std::endl;
+        ret = RET_ERR;
+    }
+
+    if (!viceLabelFilePath.empty() && !writeViceLabelFile(viceLabelFilePath.c_str(), debugInfo))
+    {
+        cerr << "Could not write label file: " << viceLabelFilePath << std::endl;
+        ret = RET_ERR;
+    }
+
+    return ret;
 }
 
 auto main(int argc, char *argv[]) -> int
@@ -27,11 +229,35 @@ auto main(int argc, char *argv[]) -> int
 
     bool assemblyOut = false;
     bool basicOut = false;
+    bool denseBasicOut = false;
+    bool loaderFileOut = false;
+    bool packedFileOut = false;
     bool prgFileOut = false;
+    bool profileOut = false;
+    bool symbolFileOut = false;
+    bool objectFileOut = false;
+    bool diskImageOut = false;
+    bool roundTripCheck = false;
+    bool jsonErrors = false;
+    bool debugInfoOut = false;
+    bool debugInfoTextOut = false;
+    bool viceLabelsOut = false;
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.errorLimit = DEFAULT_ERROR_LIMIT;
     std::string pProgFilePath = "";
-    std::string asmFilePath = "";
+    std::string loaderFilePath = "";
+    std::string packedFilePath = "";
+    std::string loaderEntry = "";
+    std::string profileEntry = "";
+    std::string symbolFilePath = "";
+    std::string objectFilePath = "";
+    std::string diskImageFilePath = "";
+    std::string debugInfoFilePath = "";
+    std::string debugInfoTextFilePath = "";
+    std::string viceLabelFilePath = "";
+    std::vector<std::string> asmFilePaths;
 
-    auto options = get_opt::getopt(argc, argv, "abp:");
+    auto options = get_opt::getopt(argc, argv, "abBp:l:z:e:d:x:OI:S:P:c:g:G:L:urE:J");
     for (auto const &option : options)
     {
         switch(option.opt)
@@ -42,12 +268,96 @@ auto main(int argc, char *argv[]) -> int
             case 'b':
                 basicOut = true;
                 break;
+            case 'B':
+                basicOut = true;
+                denseBasicOut = true;
+                break;
+            case 'l':
+                loaderFileOut = true;
+                loaderFilePath = option.optarg;
+                break;
+            case 'z':
+                packedFileOut = true;
+                packedFilePath = option.optarg;
+                break;
+            case 'e':
+                loaderEntry = option.optarg;
+                break;
             case 'p':
                 prgFileOut = true;
                 pProgFilePath = option.optarg;
                 break;
+            case 'd':
+                diskImageOut = true;
+                diskImageFilePath = option.optarg;
+                break;
+            case 'x':
+                profileOut = true;
+                profileEntry = option.optarg;
+                break;
+            case 'O':
+                assemblyOptions.optimize = true;
+                break;
+            case 'I':
+                assemblyOptions.includePaths.push_back(option.optarg);
+                break;
+            case 'S':
+                symbolFileOut = true;
+                symbolFilePath = option.optarg;
+                break;
+            case 'P':
+            {
+                std::optional<SymbolTable> optPrelude = readSymbolFile(option.optarg.c_str());
+                if (optPrelude != std::nullopt)
+                {
+                    assemblyOptions.prelude = optPrelude.value();
+                    assemblyOptions.preludeName = option.optarg;
+                }
+                else
+                {
+                    cerr << "Could not read symbol file: " << option.optarg << std::endl;
+                    ret = RET_ERR;
+                }
+                break;
+            }
+            case 'c':
+                objectFileOut = true;
+                objectFilePath = option.optarg;
+                assemblyOptions.objectMode = true;
+                break;
+            case 'g':
+                debugInfoOut = true;
+                debugInfoFilePath = option.optarg;
+                break;
+            case 'G':
+                debugInfoTextOut = true;
+                debugInfoTextFilePath = option.optarg;
+                break;
+            case 'L':
+                viceLabelsOut = true;
+                viceLabelFilePath = option.optarg;
+                break;
+            case 'u':
+                assemblyOptions.undocumentedOpcodes = true;
+                break;
+            case 'r':
+                roundTripCheck = true;
+                break;
+            case 'E':
+            {
+                std::stringstream ss(option.optarg);
+                if (!(ss >> assemblyOptions.errorLimit) || !ss.eof())
+                {
+                    cerr << "Invalid error limit: " << option.optarg << std::endl;
+                    ret = RET_ERR;
+                }
+                break;
+            }
+            case 'J':
+                jsonErrors = true;
+                break;
             case '!': // no preceding dash
-                asmFilePath=option.optarg;
+                asmFilePaths.push_back(option.optarg);
                 break;
             case '?':
                 usage(argv[0]);
@@ -84,7 +394,8 @@ auto main(int argc, char *argv[]) -> int
     // }
 
     // no parameters given -> default behavior: Output assembly and basic program
-    if (!(assemblyOut ||  basicOut || prgFileOut))
+    if (!(assemblyOut ||  basicOut || prgFileOut || loaderFileOut || packedFileOut || profileOut || symbolFileOut || objectFileOut || diskImageOut || roundTripCheck ||
+          debugInfoOut || debugInfoTextOut || viceLabelsOut))
     {
         assemblyOut = true;
         basicOut = true;
@@ -92,43 +403,132 @@ auto main(int argc, char *argv[]) -> int
 
     if (ret == RET_OK)
     {
-        if (!asmFilePath.empty() ) // asmfile is one additional parameter w/o options
+        // asmfiles are the additional parameters w/o options, several only for outputs not naming a file
+        if (asmFilePaths.empty() || ((asmFilePaths.size() > 1) &&
+            (prgFileOut || loaderFileOut || packedFileOut || profileOut || symbolFileOut || objectFileOut ||
+             debugInfoOut || debugInfoTextOut || viceLabelsOut)))
+        {
+            usage(argv[0]);
+            ret = RET_ERR;
+        }
+        else
         {
-            AssemblyStatus assemblyStatus = assembleFile(asmFilePath.c_str());
+            D64Image diskImage(getProgramName(diskImageFilePath), DISK_ID);
 
-            if (assemblyStatus.errors.empty())
+            for (auto const &asmFilePath : asmFilePaths)
             {
-                if (assemblyOut)
-                {
-                    cout << "--- 6502 Machine Code ---" << std::endl;
-                    cout << assemblyStatus.assembledProgram.getMachineCode(true) << std::endl;
-                }
+                AssemblyStatus assemblyStatus = assembleFile(asmFilePath.c_str(), assemblyOptions);
 
-                if (basicOut)
+                if (assemblyStatus.errors.empty())
                 {
-                    cout << "--- Commodore Basic Initializer Listing ---" << std::endl;
-                    cout << assemblyStatus.assembledProgram.getBasicMemBlockInitializerListing();
-                }
+                    for (auto const &optMsg : assemblyStatus.optimizations)
+                    {
+                        cerr << optMsg << std::endl;
+                    }
+
+                    for (auto const &varMsg : assemblyStatus.variables)
+                    {
+                        cerr << varMsg << std::endl;
+                    }
+
+                    if (assemblyOut)
+                    {
+                        cout << "--- 6502 Machine Code ---" << std::endl;
+                        cout << assemblyStatus.assembledProgram.getMachineCode(true) << std::endl;
+                    }
+
+                    if (basicOut)
+                    {
+                        cout << "--- Commodore Basic Initializer Listing ---" << std::endl;
+                        cout << assemblyStatus.assembledProgram.getBasicMemBlockInitializerListing(denseBasicOut);
+                    }
 
-                if (prgFileOut)
+                    if (prgFileOut)
+                    {
+                        writeProgFile(pProgFilePath.c_str(), assemblyStatus.assembledProgram);
+                    }
+
+                    if (loaderFileOut)
+                    {
+                        if (writeLoader(assemblyStatus, loaderFilePath, loaderEntry) != RET_OK)
+                        {
+                            ret = RET_ERR;
+                        }
+                    }
+
+                    if (packedFileOut)
+                    {
+                        if (writePacked(assemblyStatus, packedFilePath, loaderEntry) != RET_OK)
+                        {
+                            ret = RET_ERR;
+                        }
+                    }
+
+                    if (profileOut)
+                    {
+                        if (profile(assemblyStatus, profileEntry) != RET_OK)
+                        {
+                            ret = RET_ERR;
+                        }
+                    }
+
+                    if (symbolFileOut && !writeSymbolFile(symbolFilePath.c_str(), assemblyStatus.symbols))
+                    {
+                        cerr << "Could not write symbol file: " << symbolFilePath << std::endl;
+                        ret = RET_ERR;
+                    }
+
+                    if (objectFileOut && !writeObjectFile(objectFilePath.c_str(), assemblyStatus.object))
+                    {
+                        cerr << "Could not write object file: " << objectFilePath << std::endl;
+                        ret = RET_ERR;
+                    }
+
+                    if (debugInfoOut || debugInfoTextOut || viceLabelsOut)
+                    {
+                        if (writeSourceMaps(makeDebugInfo(assemblyStatus.assembledProgram, assemblyStatus.symbols),
+                                            debugInfoFilePath, debugInfoTextFilePath, viceLabelFilePath) != RET_OK)
+                        {
+                            ret = RET_ERR;
+                        }
+                    }
+
+                    if (roundTripCheck)
+                    {
+                        std::optional<std::string> optDifference = checkRoundTrip(assemblyStatus.assembledProgram, assemblyOptions);
+                        if (optDifference != std::nullopt)
+                        {
+                            cerr << asmFilePath << ": " << optDifference.value() << std::endl;
+                            ret = RET_ERR;
+                        }
+                    }
+
+                    if (diskImageOut && !diskImage.addFile(getProgramName(asmFilePath), assemblyStatus.assembledProgram.getProgramBytes()))
+                    {
+                        cerr << "Could not add " << asmFilePath << " to the disk image, the disk or its directory is full" << std::endl;
+                        ret = RET_ERR;
+                    }
+                }
+                else
                 {
-                    writeProgFile(pProgFilePath.c_str(), assemblyStatus.assembledProgram);
+                    if (jsonErrors)
+                    {
+                        assemblyStatus.errors.writeJson(cerr);
+                    }
+                    else
+                    {
+                        assemblyStatus.errors.writeText(cerr);
+                    }
+                    ret = RET_ERR;
                 }
             }
-            else
+
+            if (diskImageOut && (ret == RET_OK) && !writeDiskImageFile(diskImageFilePath.c_str(), diskImage))
             {
-                for (auto const &errMsg : assemblyStatus.errors)
-                {
-                    cerr << errMsg << std::endl;
-                }
+                cerr << "Could not write disk image: " << diskImageFilePath << std::endl;
                 ret = RET_ERR;
             }
         }
-        else
-        {
-            usage(argv[0]);
-            ret = RET_ERR;
-        }
     }
 
 
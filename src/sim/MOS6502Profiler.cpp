@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include "MOS6502Profiler.h"
+
+using namespace asm6502;
+
+MOS6502Profiler::MOS6502Profiler(MemBlocks const &program_, SymbolTable const &symbolTable_) :
+    program{program_},
+    totalCycles{0},
+    totalInstructions{0}
+{
+    for (auto const &codeLine : program.getCodeLines())
+    {
+        std::optional<Sym> optSym = codeLine.getLabel().empty() ? std::nullopt : symbolTable_.resolveSymbol(codeLine.getLabel());
+
+        if (optSym != std::nullopt)
+        {
+            labels.emplace_back(optSym.value().val, codeLine.getLabel());
+        }
+
+        lineEntries.push_back({ codeLine.getAssembly(), codeLine.getStartAddress(), 0, 0 });
+    }
+
+    for (auto const &sym : symbolTable_.getSymbols())
+    {
+        symbols.emplace_back(sym.second.val, sym.first);
+    }
+
+    std::sort(begin(labels), end(labels));
+    std::sort(begin(symbols), end(symbols));
+}
+
+void MOS6502Profiler::attribute(MOS6502Sim const &sim)
+{
+    std::vector<bool> isProgramAddress(0x10000, false);
+    std::map<std::string, ProfileEntry> labelProfile;
+    auto const &codeLines = program.getCodeLines();
+
+    totalCycles = 0;
+    totalInstructions = 0;
+
+    for (size_t lineIdx = 0; lineIdx < codeLines.size(); lineIdx++)
+    {
+        ProfileEntry &lineEntry = lineEntries.at(lineIdx);
+        lineEntry.cycles = 0;
+        lineEntry.instructions = 0;
+
+        uint32_t startAddress = codeLines[lineIdx].getStartAddress();
+        uint32_t endAddress = std::min<uint32_t>(startAddress + codeLines[lineIdx].getLengthBytes(), 0x10000);
+
+        for (uint32_t address = startAddress; address < endAddress; address++)
+        {
+            lineEntry.cycles += sim.getProfiledCycles(static_cast<uint16_t>(address));
+            lineEntry.instructions += sim.getProfiledInstructions(static_cast<uint16_t>(address));
+            isProgramAddress[address] = true;
+        }
+    }
+
+    for (uint32_t address = 0; address < 0x10000; address++)
+    {
+        uint64_t instructions = sim.getProfiledInstructions(static_cast<uint16_t>(address));
+
+        if (instructions > 0)
+        {
+            uint64_t cycles = sim.getProfiledCycles(static_cast<uint16_t>(address));
+            std::string name = isProgramAddress[address] ? findLabel(address) : findSymbol(address);
+
+            auto pos = labelProfile.find(name);
+            if (pos == end(labelProfile))
+            {
+                pos = labelProfile.emplace(name, ProfileEntry{name, address, 0, 0}).first;
+            }
+
+            pos->second.cycles += cycles;
+            pos->second.instructions += instructions;
+            totalCycles += cycles;
+            totalInstructions += instructions;
+        }
+    }
+
+    labelEntries.clear();
+    for (auto const &entry : labelProfile)
+    {
+        labelEntries.push_back(entry.second);
+    }
+}
+
+auto MOS6502Profiler::getLabelHotSpots() const -> std::vector<ProfileEntry>
+{
+    std::vector<ProfileEntry> ret = labelEntries;
+    sortByCycles(ret);
+    return ret;
+}
+
+auto MOS6502Profiler::getLineHotSpots() const -> std::vector<ProfileEntry>
+{
+    std::vector<ProfileEntry> ret;
+    std::copy_if(begin(lineEntries), end(lineEntries), std::back_inserter(ret),
+        [](ProfileEntry const &entry) { return entry.instructions > 0; });
+    sortByCycles(ret);
+    return ret;
+}
+
+auto MOS6502Profiler::getHotSpotReport(size_t maxEntries) const -> std::string
+{
+    std::stringstream strm;
+
+    strm << "Total: " << totalCycles << " cycles, " << totalInstructions << " instructions" << std::endl;
+    strm << std::endl << "Hot spots by label:" << std::endl;
+    strm << formatEntries(getLabelHotSpots(), maxEntries, totalCycles);
+    strm << std::endl << "Hot spots by line:" << std::endl;
+    strm << formatEntries(getLineHotSpots(), maxEntries, totalCycles);
+
+    return strm.str();
+}
+
+auto MOS6502Profiler::getAnnotatedListing() const -> std::string
+{
+    std::stringstream strm;
+    auto const &codeLines = program.getCodeLines();
+
+    strm << "    cycles     instr" << std::endl;
+
+    for (size_t lineIdx = 0; lineIdx < codeLines.size(); lineIdx++)
+    {
+        ProfileEntry const &lineEntry = lineEntries.at(lineIdx);
+
+        if (lineEntry.instructions > 0)
+        {
+            strm << std::setw(10) << lineEntry.cycles << std::setw(10) << lineEntry.instructions;
+        }
+        else
+        {
+            strm << std::setw(20) << "";
+        }
+
+        strm << "  " << codeLines[lineIdx].get(program, true);
+    }
+
+    return strm.str();
+}
+
+auto MOS6502Profiler::findLabel(uint32_t address) const -> std::string
+{
+    // first label with an address larger than the passed one, its predecessor is our label
+    auto pos = std::upper_bound(begin(labels), end(labels), address,
+        [](uint32_t addr, std::pair<uint32_t, std::string> const &label) { return addr < label.first; });
+
+    return (pos == begin(labels)) ? findSymbol(address) : std::prev(pos)->second;
+}
+
+auto MOS6502Profiler::findSymbol(uint32_t address) const -> std::string
+{
+    std::stringstream strm;
+
+    auto pos = std::upper_bound(begin(symbols), end(symbols), address,
+        [](uint32_t addr, std::pair<uint32_t, std::string> const &sym) { return addr < sym.first; });
+
+    if (pos == begin(symbols))
+    {
+        strm << "$" << std::hex << std::setw(4) << std::setfill('0') << address;
+    }
+    else
+    {
+        auto const &sym = *std::prev(pos);
+        strm << sym.second;
+
+        if (address > sym.first)
+        {
+            strm << "+" << (address - sym.first);
+        }
+    }
+
+    return strm.str();
+}
+
+void MOS6502Profiler::sortByCycles(std::vector<ProfileEntry> &entries)
+{
+    std::stable_sort(begin(entries), end(entries), [](ProfileEntry const &lhs, ProfileEntry const &rhs)
+    {
+        return (lhs.cycles != rhs.cycles) ? (lhs.cycles > rhs.cycles) : (lhs.address < rhs.address);
+    });
+}
+
+auto MOS6502Profiler::formatEntries(std::vector<ProfileEntry> const &entries, size_t maxEntries, uint64_t totalCycles) -> std::string
+{
+    std::stringstream strm;
+
+    strm << "    cycles       %     instr  address  name" << std::endl;
+
+    for (size_t idx = 0; (idx < entries.size()) && (idx < maxEntries); idx++)
+    {
+        ProfileEntry const &entry = entries[idx];
+        double percent = (totalCycles > 0) ? (100.0 * static_cast<double>(entry.cycles) / static_cast<double>(totalCycles)) : 0.0;
+
+        strm
+            << std::dec << std::setfill(' ')
+            << std::setw(10) << entry.cycles
+            << std::setw(8) << std::fixed << std::setprecision(2) << percent
+            << std::setw(10) << entry.instructions
+            << "  0x" << std::hex << std::setw(4) << std::setfill('0') << entry.address
+            << "  " << entry.name << std::endl;
+    }
+
+    return strm.str();
+}
@@ -0,0 +1,63 @@
+#ifndef MOS6502_PROFILER_H
+#define MOS6502_PROFILER_H
+
+#include <string>
+#include <vector>
+
+#include "listener/MemBlocks.h"
+#include "listener/SymbolTable.h"
+#include "MOS6502Sim.h"
+
+namespace asm6502
+{
+
+class ProfileEntry
+{
+public:
+    std::string name;       // label, assembly of a code line, or symbol+offset outside of the program
+    uint32_t address;
+    uint64_t cycles;
+    uint64_t instructions;
+};
+
+// Attributes the cycles and instruction counts a MOS6502Sim collected in profiling mode
+// to the code lines and labels of the assembled program. Each executed address belongs
+// to the code line covering it, and to the closest label at or before it. Executed
+// addresses outside of the program are attributed to the closest symbol.
+// The profiler refers to the passed program, which must outlive it.
+class MOS6502Profiler
+{
+public:
+    MOS6502Profiler(MemBlocks const &program_, SymbolTable const &symbolTable_);
+
+    void attribute(MOS6502Sim const &sim);
+
+    auto getTotalCycles() const -> uint64_t { return totalCycles; }
+    auto getTotalInstructions() const -> uint64_t { return totalInstructions; }
+
+    // sorted by cycles, most expensive first; entries without executed instructions are omitted
+    auto getLabelHotSpots() const -> std::vector<ProfileEntry>;
+    auto getLineHotSpots() const -> std::vector<ProfileEntry>;
+
+    auto getHotSpotReport(size_t maxEntries) const -> std::string;
+    auto getAnnotatedListing() const -> std::string;
+
+private:
+
+    auto findLabel(uint32_t address) const -> std::string;
+    auto findSymbol(uint32_t address) const -> std::string;
+    static void sortByCycles(std::vector<ProfileEntry> &entries);
+    static auto formatEntries(std::vector<ProfileEntry> const &entries, size_t maxEntries, uint64_t totalCycles) -> std::string;
+
+    MemBlocks const &program;
+    std::vector<std::pair<uint32_t, std::string>> labels;  // code labels, sorted by address
+    std::vector<std::pair<uint32_t, std::string>> symbols; // all symbols, sorted by value
+    std::vector<ProfileEntry> lineEntries;   // one per code line of the program
+    std::vector<ProfileEntry> labelEntries;
+    uint64_t totalCycles;
+    uint64_t totalInstructions;
+};
+
+} // namespace
+
+#endif
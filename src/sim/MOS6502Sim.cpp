@@ -0,0 +1,712 @@
+#include <algorithm>
+#include <limits>
+
+#include "MOS6502Sim.h"
+
+using namespace asm6502;
+
+namespace
+{
+// addressing modes, names follow the opcode maps in MOS6502Listener.cpp
+enum class Mode
+{
+    Acc, Imm, Zpg, ZpgX, ZpgY, Abs, AbsX, AbsY, IdxIdr, IdrIdx
+};
+}
+
+// All instructions are implemented as static functions taking the simulator instance,
+// so they can be stored in a plain function pointer table and dispatched without any
+// virtual calls. Addressing mode and base cycle count are template parameters, the
+// extra cycles for page crossings and taken branches are added at runtime.
+struct MOS6502Sim::Ops
+{
+    using Handler = void (*)(MOS6502Sim &s);
+    using ReadOp = void (*)(MOS6502Sim &s, uint8_t val);
+    using ModifyOp = uint8_t (*)(MOS6502Sim &s, uint8_t val);
+
+    static std::array<Handler, 256> const table;
+
+    //
+    // memory access helpers
+    //
+
+    static auto fetch(MOS6502Sim &s) -> uint8_t
+    {
+        return s.memory[s.regs.pc++];
+    }
+
+    static auto fetchWord(MOS6502Sim &s) -> uint16_t
+    {
+        uint16_t lsb = fetch(s);
+        uint16_t msb = fetch(s);
+        return static_cast<uint16_t>(lsb | (msb << 8U));
+    }
+
+    // pointers in the zero page wrap around at the page boundary
+    static auto readZpgWord(MOS6502Sim &s, uint8_t zpgAddress) -> uint16_t
+    {
+        uint16_t lsb = s.memory[zpgAddress];
+        uint16_t msb = s.memory[static_cast<uint8_t>(zpgAddress + 1)];
+        return static_cast<uint16_t>(lsb | (msb << 8U));
+    }
+
+    static void push(MOS6502Sim &s, uint8_t byte)
+    {
+        s.memory[0x100U | s.regs.sp--] = byte;
+    }
+
+    static auto pull(MOS6502Sim &s) -> uint8_t
+    {
+        return s.memory[0x100U | ++s.regs.sp];
+    }
+
+    template<bool IsRead>
+    static auto indexed(MOS6502Sim &s, uint16_t base, uint8_t index) -> uint16_t
+    {
+        auto address = static_cast<uint16_t>(base + index);
+
+        // reading instructions need one more cycle if the indexing crosses a page boundary
+        if (IsRead && ((address ^ base) & 0xff00U))
+        {
+            s.cycles++;
+        }
+
+        return address;
+    }
+
+    template<Mode M, bool IsRead>
+    static auto address(MOS6502Sim &s) -> uint16_t
+    {
+        if constexpr (M == Mode::Imm)       { return s.regs.pc++; }
+        else if constexpr (M == Mode::Zpg)  { return fetch(s); }
+        else if constexpr (M == Mode::ZpgX) { return static_cast<uint8_t>(fetch(s) + s.regs.x); }
+        else if constexpr (M == Mode::ZpgY) { return static_cast<uint8_t>(fetch(s) + s.regs.y); }
+        else if constexpr (M == Mode::Abs)  { return fetchWord(s); }
+        else if constexpr (M == Mode::AbsX) { return indexed<IsRead>(s, fetchWord(s), s.regs.x); }
+        else if constexpr (M == Mode::AbsY) { return indexed<IsRead>(s, fetchWord(s), s.regs.y); }
+        else if constexpr (M == Mode::IdxIdr) { return readZpgWord(s, static_cast<uint8_t>(fetch(s) + s.regs.x)); }
+        else { static_assert(M == Mode::IdrIdx); return indexed<IsRead>(s, readZpgWord(s, fetch(s)), s.regs.y); }
+    }
+
+    //
+    // flag helpers
+    //
+
+    static void setFlag(MOS6502Sim &s, uint8_t flag, bool set)
+    {
+        s.regs.p = set ? (s.regs.p | flag) : (s.regs.p & ~flag);
+    }
+
+    static auto isSet(MOS6502Sim const &s, uint8_t flag) -> bool
+    {
+        return (s.regs.p & flag) != 0;
+    }
+
+    static void setNZ(MOS6502Sim &s, uint8_t val)
+    {
+        s.regs.p = (s.regs.p & ~(FLAG_N | FLAG_Z)) | (val & FLAG_N) | ((val == 0) ? FLAG_Z : 0);
+    }
+
+    static void stop(MOS6502Sim &s, StopReason reason)
+    {
+        s.stopReason = reason;
+        s.cycleLimit = 0; // terminates the run loop
+    }
+
+    //
+    // generic instruction shapes
+    //
+
+    template<Mode M, uint8_t Cycles, ReadOp Op>
+    static void read(MOS6502Sim &s)
+    {
+        Op(s, s.memory[address<M, true>(s)]);
+        s.cycles += Cycles;
+    }
+
+    template<Mode M, uint8_t Cycles, uint8_t Registers::*Reg>
+    static void store(MOS6502Sim &s)
+    {
+        s.memory[address<M, false>(s)] = s.regs.*Reg;
+        s.cycles += Cycles;
+    }
+
+    template<Mode M, uint8_t Cycles, ModifyOp Op>
+    static void modify(MOS6502Sim &s)
+    {
+        if constexpr (M == Mode::Acc)
+        {
+            s.regs.a = Op(s, s.regs.a);
+        }
+        else
+        {
+            uint16_t addr = address<M, false>(s);
+            s.memory[addr] = Op(s, s.memory[addr]);
+        }
+        s.cycles += Cycles;
+    }
+
+    template<uint8_t Flag, bool IsSet>
+    static void branch(MOS6502Sim &s)
+    {
+        auto offset = static_cast<int8_t>(fetch(s));
+
+        if (isSet(s, Flag) == IsSet)
+        {
+            auto target = static_cast<uint16_t>(s.regs.pc + offset);
+            s.cycles += ((target ^ s.regs.pc) & 0xff00U) ? 4 : 3;
+            s.regs.pc = target;
+        }
+        else
+        {
+            s.cycles += 2;
+        }
+    }
+
+    template<uint8_t Flag, bool Set>
+    static void flag(MOS6502Sim &s)
+    {
+        setFlag(s, Flag, Set);
+        s.cycles += 2;
+    }
+
+    template<uint8_t Registers::*Src, uint8_t Registers::*Dst>
+    static void transfer(MOS6502Sim &s)
+    {
+        s.regs.*Dst = s.regs.*Src;
+        setNZ(s, s.regs.*Dst);
+        s.cycles += 2;
+    }
+
+    template<uint8_t Registers::*Reg, int8_t Delta>
+    static void step(MOS6502Sim &s)
+    {
+        s.regs.*Reg = static_cast<uint8_t>(s.regs.*Reg + Delta);
+        setNZ(s, s.regs.*Reg);
+        s.cycles += 2;
+    }
+
+    //
+    // operations
+    //
+
+    static void lda(MOS6502Sim &s, uint8_t val) { s.regs.a = val; setNZ(s, val); }
+    static void ldx(MOS6502Sim &s, uint8_t val) { s.regs.x = val; setNZ(s, val); }
+    static void ldy(MOS6502Sim &s, uint8_t val) { s.regs.y = val; setNZ(s, val); }
+    static void ora(MOS6502Sim &s, uint8_t val) { s.regs.a |= val; setNZ(s, s.regs.a); }
+    static void and_(MOS6502Sim &s, uint8_t val) { s.regs.a &= val; setNZ(s, s.regs.a); }
+    static void eor(MOS6502Sim &s, uint8_t val) { s.regs.a ^= val; setNZ(s, s.regs.a); }
+
+    static void compare(MOS6502Sim &s, uint8_t reg, uint8_t val)
+    {
+        setFlag(s, FLAG_C, reg >= val);
+        setNZ(s, static_cast<uint8_t>(reg - val));
+    }
+
+    static void cmp(MOS6502Sim &s, uint8_t val) { compare(s, s.regs.a, val); }
+    static void cpx(MOS6502Sim &s, uint8_t val) { compare(s, s.regs.x, val); }
+    static void cpy(MOS6502Sim &s, uint8_t val) { compare(s, s.regs.y, val); }
+
+    static void bit(MOS6502Sim &s, uint8_t val)
+    {
+        setFlag(s, FLAG_Z, (s.regs.a & val) == 0);
+        s.regs.p = (s.regs.p & ~(FLAG_N | FLAG_V)) | (val & (FLAG_N | FLAG_V));
+    }
+
+    static void adc(MOS6502Sim &s, uint8_t val)
+    {
+        uint8_t a = s.regs.a;
+        uint32_t carry = isSet(s, FLAG_C) ? 1 : 0;
+        uint32_t sum = a + val + carry;
+
+        if (!isSet(s, FLAG_D))
+        {
+            setFlag(s, FLAG_V, (~(a ^ val) & (a ^ sum) & 0x80U) != 0);
+            setFlag(s, FLAG_C, sum > 0xffU);
+            s.regs.a = static_cast<uint8_t>(sum);
+            setNZ(s, s.regs.a);
+        }
+        else
+        {
+            // NMOS decimal mode: Z is taken from the binary sum, N and V from the
+            // intermediate result after the low nibble correction
+            uint32_t lo = (a & 0x0fU) + (val & 0x0fU) + carry;
+            uint32_t hi = (a & 0xf0U) + (val & 0xf0U);
+
+            if (lo > 0x09U)
+            {
+                lo += 0x06U;
+                hi += 0x10U;
+            }
+
+            setFlag(s, FLAG_Z, (sum & 0xffU) == 0);
+            setFlag(s, FLAG_N, (hi & 0x80U) != 0);
+            setFlag(s, FLAG_V, (~(a ^ val) & (a ^ hi) & 0x80U) != 0);
+
+            if (hi > 0x90U)
+            {
+                hi += 0x60U;
+            }
+
+            setFlag(s, FLAG_C, hi > 0xffU);
+            s.regs.a = static_cast<uint8_t>((lo & 0x0fU) | (hi & 0xf0U));
+        }
+    }
+
+    static void sbc(MOS6502Sim &s, uint8_t val)
+    {
+        uint8_t a = s.regs.a;
+        uint32_t borrow = isSet(s, FLAG_C) ? 0 : 1;
+        uint32_t diff = a - val - borrow;
+
+        // on the NMOS 6502 all flags are set from the binary result, also in decimal mode
+        setFlag(s, FLAG_V, ((a ^ val) & (a ^ diff) & 0x80U) != 0);
+        setFlag(s, FLAG_C, diff < 0x100U);
+        setNZ(s, static_cast<uint8_t>(diff));
+
+        if (!isSet(s, FLAG_D))
+        {
+            s.regs.a = static_cast<uint8_t>(diff);
+        }
+        else
+        {
+            uint32_t lo = (a & 0x0fU) - (val & 0x0fU) - borrow;
+            uint32_t hi = (a & 0xf0U) - (val & 0xf0U);
+
+            if (lo & 0x10U)
+            {
+                lo -= 0x06U;
+                hi -= 0x10U;
+            }
+
+            if (hi & 0x100U)
+            {
+                hi -= 0x60U;
+            }
+
+            s.regs.a = static_cast<uint8_t>((lo & 0x0fU) | (hi & 0xf0U));
+        }
+    }
+
+    static auto asl(MOS6502Sim &s, uint8_t val) -> uint8_t
+    {
+        setFlag(s, FLAG_C, (val & 0x80U) != 0);
+        auto res = static_cast<uint8_t>(val << 1U);
+        setNZ(s, res);
+        return res;
+    }
+
+    static auto lsr(MOS6502Sim &s, uint8_t val) -> uint8_t
+    {
+        setFlag(s, FLAG_C, (val & 0x01U) != 0);
+        auto res = static_cast<uint8_t>(val >> 1U);
+        setNZ(s, res);
+        return res;
+    }
+
+    static auto rol(MOS6502Sim &s, uint8_t val) -> uint8_t
+    {
+        auto res = static_cast<uint8_t>((val << 1U) | (isSet(s, FLAG_C) ? 0x01U : 0x00U));
+        setFlag(s, FLAG_C, (val & 0x80U) != 0);
+        setNZ(s, res);
+        return res;
+    }
+
+    static auto ror(MOS6502Sim &s, uint8_t val) -> uint8_t
+    {
+        auto res = static_cast<uint8_t>((val >> 1U) | (isSet(s, FLAG_C) ? 0x80U : 0x00U));
+        setFlag(s, FLAG_C, (val & 0x01U) != 0);
+        setNZ(s, res);
+        return res;
+    }
+
+    static auto inc(MOS6502Sim &s, uint8_t val) -> uint8_t
+    {
+        auto res = static_cast<uint8_t>(val + 1);
+        setNZ(s, res);
+        return res;
+    }
+
+    static auto dec(MOS6502Sim &s, uint8_t val) -> uint8_t
+    {
+        auto res = static_cast<uint8_t>(val - 1);
+        setNZ(s, res);
+        return res;
+    }
+
+    //
+    // stable undocumented operations, read-modify-write combined with an accumulator operation
+    //
+
+    static auto slo(MOS6502Sim &s, uint8_t val) -> uint8_t { uint8_t res = asl(s, val); ora(s, res); return res; }
+    static auto rla(MOS6502Sim &s, uint8_t val) -> uint8_t { uint8_t res = rol(s, val); and_(s, res); return res; }
+    static auto sre(MOS6502Sim &s, uint8_t val) -> uint8_t { uint8_t res = lsr(s, val); eor(s, res); return res; }
+    static auto rra(MOS6502Sim &s, uint8_t val) -> uint8_t { uint8_t res = ror(s, val); adc(s, res); return res; }
+    static auto dcp(MOS6502Sim &s, uint8_t val) -> uint8_t { uint8_t res = dec(s, val); cmp(s, res); return res; }
+    static auto isc(MOS6502Sim &s, uint8_t val) -> uint8_t { uint8_t res = inc(s, val); sbc(s, res); return res; }
+
+    static void lax(MOS6502Sim &s, uint8_t val) { s.regs.a = val; s.regs.x = val; setNZ(s, val); }
+    static void anc(MOS6502Sim &s, uint8_t val) { and_(s, val); setFlag(s, FLAG_C, (s.regs.a & 0x80U) != 0); }
+    static void alr(MOS6502Sim &s, uint8_t val) { and_(s, val); s.regs.a = lsr(s, s.regs.a); }
+
+    // the flags are those of binary mode, also in decimal mode
+    static void arr(MOS6502Sim &s, uint8_t val)
+    {
+        and_(s, val);
+        s.regs.a = ror(s, s.regs.a);
+        setFlag(s, FLAG_C, (s.regs.a & 0x40U) != 0);
+        setFlag(s, FLAG_V, (((s.regs.a >> 6U) ^ (s.regs.a >> 5U)) & 0x01U) != 0);
+    }
+
+    static void sbx(MOS6502Sim &s, uint8_t val)
+    {
+        auto andX = static_cast<uint8_t>(s.regs.a & s.regs.x);
+        compare(s, andX, val);
+        s.regs.x = static_cast<uint8_t>(andX - val);
+    }
+
+    template<Mode M, uint8_t Cycles>
+    static void sax(MOS6502Sim &s)
+    {
+        s.memory[address<M, false>(s)] = s.regs.a & s.regs.x;
+        s.cycles += Cycles;
+    }
+
+    //
+    // instructions which do not fit into the generic shapes
+    //
+
+    static void brk(MOS6502Sim &s)
+    {
+        s.regs.pc--; // leave the PC at the BRK instruction
+        s.cycles += 7;
+        stop(s, StopReason::Brk);
+    }
+
+    static void illegal(MOS6502Sim &s)
+    {
+        s.regs.pc--;
+        stop(s, StopReason::IllegalOpcode);
+    }
+
+    static void nop(MOS6502Sim &s)
+    {
+        s.cycles += 2;
+    }
+
+    static void jmpAbs(MOS6502Sim &s)
+    {
+        s.regs.pc = fetchWord(s);
+        s.cycles += 3;
+    }
+
+    static void jmpIdr(MOS6502Sim &s)
+    {
+        uint16_t ptr = fetchWord(s);
+        // NMOS bug: the pointer MSB is read from the same page as the LSB
+        uint16_t lsb = s.memory[ptr];
+        uint16_t msb = s.memory[(ptr & 0xff00U) | ((ptr + 1) & 0x00ffU)];
+        s.regs.pc = static_cast<uint16_t>(lsb | (msb << 8U));
+        s.cycles += 5;
+    }
+
+    static void jsr(MOS6502Sim &s)
+    {
+        uint16_t target = fetchWord(s);
+        uint16_t retAddr = s.regs.pc - 1;
+        push(s, static_cast<uint8_t>(retAddr >> 8U));
+        push(s, static_cast<uint8_t>(retAddr & 0xffU));
+        s.regs.pc = target;
+        s.cycles += 6;
+    }
+
+    static void rts(MOS6502Sim &s)
+    {
+        uint16_t lsb = pull(s);
+        uint16_t msb = pull(s);
+        s.regs.pc = static_cast<uint16_t>((lsb | (msb << 8U)) + 1);
+        s.cycles += 6;
+
+        if (s.regs.sp == s.returnSP)
+        {
+            stop(s, StopReason::Rts);
+        }
+    }
+
+    static void rti(MOS6502Sim &s)
+    {
+        s.regs.p = (pull(s) & ~FLAG_B) | FLAG_U;
+        uint16_t lsb = pull(s);
+        uint16_t msb = pull(s);
+        s.regs.pc = static_cast<uint16_t>(lsb | (msb << 8U));
+        s.cycles += 6;
+    }
+
+    static void pha(MOS6502Sim &s) { push(s, s.regs.a); s.cycles += 3; }
+    static void php(MOS6502Sim &s) { push(s, s.regs.p | FLAG_B | FLAG_U); s.cycles += 3; }
+    static void pla(MOS6502Sim &s) { s.regs.a = pull(s); setNZ(s, s.regs.a); s.cycles += 4; }
+    static void plp(MOS6502Sim &s) { s.regs.p = (pull(s) & ~FLAG_B) | FLAG_U; s.cycles += 4; }
+    static void txs(MOS6502Sim &s) { s.regs.sp = s.regs.x; s.cycles += 2; } // the only transfer not affecting flags
+
+    static auto makeTable() -> std::array<Handler, 256>
+    {
+        using R = Registers;
+        std::array<Handler, 256> t;
+        t.fill(&illegal);
+
+        t[0x69] = &read<Mode::Imm, 2, adc>;   t[0x65] = &read<Mode::Zpg, 3, adc>;   t[0x75] = &read<Mode::ZpgX, 4, adc>;
+        t[0x6D] = &read<Mode::Abs, 4, adc>;   t[0x7D] = &read<Mode::AbsX, 4, adc>;  t[0x79] = &read<Mode::AbsY, 4, adc>;
+        t[0x61] = &read<Mode::IdxIdr, 6, adc>; t[0x71] = &read<Mode::IdrIdx, 5, adc>;
+
+        t[0x29] = &read<Mode::Imm, 2, and_>;  t[0x25] = &read<Mode::Zpg, 3, and_>;  t[0x35] = &read<Mode::ZpgX, 4, and_>;
+        t[0x2D] = &read<Mode::Abs, 4, and_>;  t[0x3D] = &read<Mode::AbsX, 4, and_>; t[0x39] = &read<Mode::AbsY, 4, and_>;
+        t[0x21] = &read<Mode::IdxIdr, 6, and_>; t[0x31] = &read<Mode::IdrIdx, 5, and_>;
+
+        t[0x0A] = &modify<Mode::Acc, 2, asl>; t[0x06] = &modify<Mode::Zpg, 5, asl>; t[0x16] = &modify<Mode::ZpgX, 6, asl>;
+        t[0x0E] = &modify<Mode::Abs, 6, asl>; t[0x1E] = &modify<Mode::AbsX, 7, asl>;
+
+        t[0x10] = &branch<FLAG_N, false>;     t[0x30] = &branch<FLAG_N, true>;
+        t[0x50] = &branch<FLAG_V, false>;     t[0x70] = &branch<FLAG_V, true>;
+        t[0x90] = &branch<FLAG_C, false>;     t[0xB0] = &branch<FLAG_C, true>;
+        t[0xD0] = &branch<FLAG_Z, false>;     t[0xF0] = &branch<FLAG_Z, true>;
+
+        t[0x24] = &read<Mode::Zpg, 3, bit>;   t[0x2C] = &read<Mode::Abs, 4, bit>;
+
+        t[0x00] = &brk;
+
+        t[0x18] = &flag<FLAG_C, false>;       t[0x38] = &flag<FLAG_C, true>;
+        t[0x58] = &flag<FLAG_I, false>;       t[0x78] = &flag<FLAG_I, true>;
+        t[0xD8] = &flag<FLAG_D, false>;       t[0xF8] = &flag<FLAG_D, true>;
+        t[0xB8] = &flag<FLAG_V, false>;
+
+        t[0xC9] = &read<Mode::Imm, 2, cmp>;   t[0xC5] = &read<Mode::Zpg, 3, cmp>;   t[0xD5] = &read<Mode::ZpgX, 4, cmp>;
+        t[0xCD] = &read<Mode::Abs, 4, cmp>;   t[0xDD] = &read<Mode::AbsX, 4, cmp>;  t[0xD9] = &read<Mode::AbsY, 4, cmp>;
+        t[0xC1] = &read<Mode::IdxIdr, 6, cmp>; t[0xD1] = &read<Mode::IdrIdx, 5, cmp>;
+
+        t[0xE0] = &read<Mode::Imm, 2, cpx>;   t[0xE4] = &read<Mode::Zpg, 3, cpx>;   t[0xEC] = &read<Mode::Abs, 4, cpx>;
+        t[0xC0] = &read<Mode::Imm, 2, cpy>;   t[0xC4] = &read<Mode::Zpg, 3, cpy>;   t[0xCC] = &read<Mode::Abs, 4, cpy>;
+
+        t[0xC6] = &modify<Mode::Zpg, 5, dec>; t[0xD6] = &modify<Mode::ZpgX, 6, dec>;
+        t[0xCE] = &modify<Mode::Abs, 6, dec>; t[0xDE] = &modify<Mode::AbsX, 7, dec>;
+
+        t[0xCA] = &step<&R::x, -1>;           t[0x88] = &step<&R::y, -1>;
+        t[0xE8] = &step<&R::x, 1>;            t[0xC8] = &step<&R::y, 1>;
+
+        t[0x49] = &read<Mode::Imm, 2, eor>;   t[0x45] = &read<Mode::Zpg, 3, eor>;   t[0x55] = &read<Mode::ZpgX, 4, eor>;
+        t[0x4D] = &read<Mode::Abs, 4, eor>;   t[0x5D] = &read<Mode::AbsX, 4, eor>;  t[0x59] = &read<Mode::AbsY, 4, eor>;
+        t[0x41] = &read<Mode::IdxIdr, 6, eor>; t[0x51] = &read<Mode::IdrIdx, 5, eor>;
+
+        t[0xE6] = &modify<Mode::Zpg, 5, inc>; t[0xF6] = &modify<Mode::ZpgX, 6, inc>;
+        t[0xEE] = &modify<Mode::Abs, 6, inc>; t[0xFE] = &modify<Mode::AbsX, 7, inc>;
+
+        t[0x4C] = &jmpAbs;                    t[0x6C] = &jmpIdr;
+        t[0x20] = &jsr;
+
+        t[0xA9] = &read<Mode::Imm, 2, lda>;   t[0xA5] = &read<Mode::Zpg, 3, lda>;   t[0xB5] = &read<Mode::ZpgX, 4, lda>;
+        t[0xAD] = &read<Mode::Abs, 4, lda>;   t[0xBD] = &read<Mode::AbsX, 4, lda>;  t[0xB9] = &read<Mode::AbsY, 4, lda>;
+        t[0xA1] = &read<Mode::IdxIdr, 6, lda>; t[0xB1] = &read<Mode::IdrIdx, 5, lda>;
+
+        t[0xA2] = &read<Mode::Imm, 2, ldx>;   t[0xA6] = &read<Mode::Zpg, 3, ldx>;   t[0xB6] = &read<Mode::ZpgY, 4, ldx>;
+        t[0xAE] = &read<Mode::Abs, 4, ldx>;   t[0xBE] = &read<Mode::AbsY, 4, ldx>;
+
+        t[0xA0] = &read<Mode::Imm, 2, ldy>;   t[0xA4] = &read<Mode::Zpg, 3, ldy>;   t[0xB4] = &read<Mode::ZpgX, 4, ldy>;
+        t[0xAC] = &read<Mode::Abs, 4, ldy>;   t[0xBC] = &read<Mode::AbsX, 4, ldy>;
+
+        t[0x4A] = &modify<Mode::Acc, 2, lsr>; t[0x46] = &modify<Mode::Zpg, 5, lsr>; t[0x56] = &modify<Mode::ZpgX, 6, lsr>;
+        t[0x4E] = &modify<Mode::Abs, 6, lsr>; t[0x5E] = &modify<Mode::AbsX, 7, lsr>;
+
+        t[0xEA] = &nop;
+
+        t[0x09] = &read<Mode::Imm, 2, ora>;   t[0x05] = &read<Mode::Zpg, 3, ora>;   t[0x15] = &read<Mode::ZpgX, 4, ora>;
+        t[0x0D] = &read<Mode::Abs, 4, ora>;   t[0x1D] = &read<Mode::AbsX, 4, ora>;  t[0x19] = &read<Mode::AbsY, 4, ora>;
+        t[0x01] = &read<Mode::IdxIdr, 6, ora>; t[0x11] = &read<Mode::IdrIdx, 5, ora>;
+
+        t[0x48] = &pha;                       t[0x08] = &php;
+        t[0x68] = &pla;                       t[0x28] = &plp;
+
+        t[0x2A] = &modify<Mode::Acc, 2, rol>; t[0x26] = &modify<Mode::Zpg, 5, rol>; t[0x36] = &modify<Mode::ZpgX, 6, rol>;
+        t[0x2E] = &modify<Mode::Abs, 6, rol>; t[0x3E] = &modify<Mode::AbsX, 7, rol>;
+
+        t[0x6A] = &modify<Mode::Acc, 2, ror>; t[0x66] = &modify<Mode::Zpg, 5, ror>; t[0x76] = &modify<Mode::ZpgX, 6, ror>;
+        t[0x6E] = &modify<Mode::Abs, 6, ror>; t[0x7E] = &modify<Mode::AbsX, 7, ror>;
+
+        t[0x40] = &rti;                       t[0x60] = &rts;
+
+        t[0xE9] = &read<Mode::Imm, 2, sbc>;   t[0xE5] = &read<Mode::Zpg, 3, sbc>;   t[0xF5] = &read<Mode::ZpgX, 4, sbc>;
+        t[0xED] = &read<Mode::Abs, 4, sbc>;   t[0xFD] = &read<Mode::AbsX, 4, sbc>;  t[0xF9] = &read<Mode::AbsY, 4, sbc>;
+        t[0xE1] = &read<Mode::IdxIdr, 6, sbc>; t[0xF1] = &read<Mode::IdrIdx, 5, sbc>;
+
+        t[0x85] = &store<Mode::Zpg, 3, &R::a>; t[0x95] = &store<Mode::ZpgX, 4, &R::a>; t[0x8D] = &store<Mode::Abs, 4, &R::a>;
+        t[0x9D] = &store<Mode::AbsX, 5, &R::a>; t[0x99] = &store<Mode::AbsY, 5, &R::a>;
+        t[0x81] = &store<Mode::IdxIdr, 6, &R::a>; t[0x91] = &store<Mode::IdrIdx, 6, &R::a>;
+
+        t[0x86] = &store<Mode::Zpg, 3, &R::x>; t[0x96] = &store<Mode::ZpgY, 4, &R::x>; t[0x8E] = &store<Mode::Abs, 4, &R::x>;
+        t[0x84] = &store<Mode::Zpg, 3, &R::y>; t[0x94] = &store<Mode::ZpgX, 4, &R::y>; t[0x8C] = &store<Mode::Abs, 4, &R::y>;
+
+        t[0xAA] = &transfer<&R::a, &R::x>;    t[0xA8] = &transfer<&R::a, &R::y>;
+        t[0xBA] = &transfer<&R::sp, &R::x>;   t[0x8A] = &transfer<&R::x, &R::a>;
+        t[0x98] = &transfer<&R::y, &R::a>;    t[0x9A] = &txs;
+
+        // stable undocumented opcodes
+        t[0x07] = &modify<Mode::Zpg, 5, slo>; t[0x17] = &modify<Mode::ZpgX, 6, slo>; t[0x0F] = &modify<Mode::Abs, 6, slo>;
+        t[0x1F] = &modify<Mode::AbsX, 7, slo>; t[0x1B] = &modify<Mode::AbsY, 7, slo>;
+        t[0x03] = &modify<Mode::IdxIdr, 8, slo>; t[0x13] = &modify<Mode::IdrIdx, 8, slo>;
+
+        t[0x27] = &modify<Mode::Zpg, 5, rla>; t[0x37] = &modify<Mode::ZpgX, 6, rla>; t[0x2F] = &modify<Mode::Abs, 6, rla>;
+        t[0x3F] = &modify<Mode::AbsX, 7, rla>; t[0x3B] = &modify<Mode::AbsY, 7, rla>;
+        t[0x23] = &modify<Mode::IdxIdr, 8, rla>; t[0x33] = &modify<Mode::IdrIdx, 8, rla>;
+
+        t[0x47] = &modify<Mode::Zpg, 5, sre>; t[0x57] = &modify<Mode::ZpgX, 6, sre>; t[0x4F] = &modify<Mode::Abs, 6, sre>;
+        t[0x5F] = &modify<Mode::AbsX, 7, sre>; t[0x5B] = &modify<Mode::AbsY, 7, sre>;
+        t[0x43] = &modify<Mode::IdxIdr, 8, sre>; t[0x53] = &modify<Mode::IdrIdx, 8, sre>;
+
+        t[0x67] = &modify<Mode::Zpg, 5, rra>; t[0x77] = &modify<Mode::ZpgX, 6, rra>; t[0x6F] = &modify<Mode::Abs, 6, rra>;
+        t[0x7F] = &modify<Mode::AbsX, 7, rra>; t[0x7B] = &modify<Mode::AbsY, 7, rra>;
+        t[0x63] = &modify<Mode::IdxIdr, 8, rra>; t[0x73] = &modify<Mode::IdrIdx, 8, rra>;
+
+        t[0xC7] = &modify<Mode::Zpg, 5, dcp>; t[0xD7] = &modify<Mode::ZpgX, 6, dcp>; t[0xCF] = &modify<Mode::Abs, 6, dcp>;
+        t[0xDF] = &modify<Mode::AbsX, 7, dcp>; t[0xDB] = &modify<Mode::AbsY, 7, dcp>;
+        t[0xC3] = &modify<Mode::IdxIdr, 8, dcp>; t[0xD3] = &modify<Mode::IdrIdx, 8, dcp>;
+
+        t[0xE7] = &modify<Mode::Zpg, 5, isc>; t[0xF7] = &modify<Mode::ZpgX, 6, isc>; t[0xEF] = &modify<Mode::Abs, 6, isc>;
+        t[0xFF] = &modify<Mode::AbsX, 7, isc>; t[0xFB] = &modify<Mode::AbsY, 7, isc>;
+        t[0xE3] = &modify<Mode::IdxIdr, 8, isc>; t[0xF3] = &modify<Mode::IdrIdx, 8, isc>;
+
+        t[0x87] = &sax<Mode::Zpg, 3>;         t[0x97] = &sax<Mode::ZpgY, 4>;        t[0x8F] = &sax<Mode::Abs, 4>;
+        t[0x83] = &sax<Mode::IdxIdr, 6>;
+
+        t[0xA7] = &read<Mode::Zpg, 3, lax>;   t[0xB7] = &read<Mode::ZpgY, 4, lax>;  t[0xAF] = &read<Mode::Abs, 4, lax>;
+        t[0xBF] = &read<Mode::AbsY, 4, lax>;  t[0xA3] = &read<Mode::IdxIdr, 6, lax>; t[0xB3] = &read<Mode::IdrIdx, 5, lax>;
+
+        t[0x0B] = &read<Mode::Imm, 2, anc>;   t[0x4B] = &read<Mode::Imm, 2, alr>;
+        t[0x6B] = &read<Mode::Imm, 2, arr>;   t[0xCB] = &read<Mode::Imm, 2, sbx>;
+
+        return t;
+    }
+};
+
+std::array<MOS6502Sim::Ops::Handler, 256> const MOS6502Sim::Ops::table = MOS6502Sim::Ops::makeTable();
+
+MOS6502Sim::MOS6502Sim() :
+    memory{},
+    regs{},
+    cycles{0},
+    cycleLimit{0},
+    returnSP{0},
+    stopReason{StopReason::CycleLimit}
+{
+}
+
+void MOS6502Sim::loadMemBlocks(MemBlocks const &memBlocks)
+{
+    for (uint32_t memBlockIdx = 0; memBlockIdx < memBlocks.getNumMemBlocks(); memBlockIdx++)
+    {
+        MemBlock const &memBlock = memBlocks.getMemBlockAt(memBlockIdx);
+
+        for (uint32_t byteIdx = 0; byteIdx < memBlock.getLengthBytes(); byteIdx++)
+        {
+            memory[(memBlock.getStartAddress() + byteIdx) & 0xffffU] = memBlock.getByteAt(byteIdx);
+        }
+    }
+}
+
+void MOS6502Sim::clearMemory(uint8_t fillByte)
+{
+    memory.fill(fillByte);
+}
+
+auto MOS6502Sim::readWord(uint16_t address) const -> uint16_t
+{
+    return static_cast<uint16_t>(memory[address] | (memory[static_cast<uint16_t>(address + 1)] << 8U));
+}
+
+void MOS6502Sim::writeWord(uint16_t address, uint16_t word)
+{
+    memory[address] = static_cast<uint8_t>(word & 0xffU);
+    memory[static_cast<uint16_t>(address + 1)] = static_cast<uint8_t>(word >> 8U);
+}
+
+auto MOS6502Sim::run(uint16_t startAddress, uint64_t maxCycles) -> RunResult
+{
+    // act like a JSR from an external caller: the return address goes onto the stack,
+    // and the routine has returned once the stack pointer is back at its current value
+    returnSP = regs.sp;
+    Ops::push(*this, 0xff);
+    Ops::push(*this, 0xff);
+    regs.pc = startAddress;
+
+    uint64_t const startCycles = cycles;
+    // saturated, a caller may pass the largest count for no limit
+    cycleLimit = (maxCycles > std::numeric_limits<uint64_t>::max() - startCycles) ? std::numeric_limits<uint64_t>::max() : startCycles + maxCycles;
+    stopReason = StopReason::CycleLimit;
+
+    uint64_t instructions = isProfiling() ? runLoop<true>() : runLoop<false>();
+
+    return { stopReason, cycles - startCycles, instructions };
+}
+
+template<bool Profile>
+auto MOS6502Sim::runLoop() -> uint64_t
+{
+    uint64_t instructions = 0;
+
+    // instructions which end the run set cycleLimit to zero, so one compare per instruction suffices
+    while (cycles < cycleLimit)
+    {
+        if constexpr (Profile)
+        {
+            uint16_t const opcodeAddress = regs.pc;
+            uint64_t const cyclesBefore = cycles;
+            Ops::table[memory[regs.pc++]](*this);
+            profileCycles[opcodeAddress] += cycles - cyclesBefore;
+            profileInstructions[opcodeAddress]++;
+        }
+        else
+        {
+            Ops::table[memory[regs.pc++]](*this);
+        }
+        instructions++;
+    }
+
+    if (stopReason == StopReason::IllegalOpcode)
+    {
+        instructions--; // the illegal opcode has not been executed
+
+        if constexpr (Profile)
+        {
+            profileInstructions[regs.pc]--;
+        }
+    }
+
+    return instructions;
+}
+
+void MOS6502Sim::enableProfiling(bool enable)
+{
+    if (enable)
+    {
+        profileCycles.assign(memory.size(), 0);
+        profileInstructions.assign(memory.size(), 0);
+    }
+    else
+    {
+        profileCycles.clear();
+        profileInstructions.clear();
+    }
+}
+
+void MOS6502Sim::resetProfile()
+{
+    std::fill(begin(profileCycles), end(profileCycles), 0);
+    std::fill(begin(profileInstructions), end(profileInstructions), 0);
+}
+
+auto MOS6502Sim::getProfiledCycles(uint16_t address) const -> uint64_t
+{
+    return isProfiling() ? profileCycles[address] : 0;
+}
+
+auto MOS6502Sim::getProfiledInstructions(uint16_t address) const -> uint64_t
+{
+    return isProfiling() ? profileInstructions[address] : 0;
+}
@@ -0,0 +1,110 @@
+#ifndef MOS6502_SIM_H
+#define MOS6502_SIM_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "listener/MemBlocks.h"
+
+namespace asm6502
+{
+
+// Processor status flags, in the bit positions of the 6502 P register
+constexpr uint8_t FLAG_C = 0x01U;
+constexpr uint8_t FLAG_Z = 0x02U;
+constexpr uint8_t FLAG_I = 0x04U;
+constexpr uint8_t FLAG_D = 0x08U;
+constexpr uint8_t FLAG_B = 0x10U;
+constexpr uint8_t FLAG_U = 0x20U; // unused, always reads as one
+constexpr uint8_t FLAG_V = 0x40U;
+constexpr uint8_t FLAG_N = 0x80U;
+
+class Registers
+{
+public:
+    uint8_t a = 0;
+    uint8_t x = 0;
+    uint8_t y = 0;
+    uint8_t sp = 0xff;
+    uint8_t p = FLAG_U | FLAG_I;
+    uint16_t pc = 0;
+};
+
+enum class StopReason
+{
+    Rts,            // the called routine returned to its (simulated) caller
+    Brk,            // a BRK instruction was executed
+    CycleLimit,     // the cycle budget passed to run() was exhausted
+    IllegalOpcode   // an opcode without an implementation was fetched
+};
+
+class RunResult
+{
+public:
+    StopReason stopReason;
+    uint64_t cycles;        // cycles consumed by this run
+    uint64_t instructions;  // instructions executed by this run
+};
+
+// Executes NMOS 6502 machine code in a flat 64 KiB memory. Cycles are counted
+// per instruction, including the extra cycles for page crossings on indexed reads
+// and for taken branches. There are no I/O chips and no interrupts, the simulator
+// is meant for running assembled routines in isolation.
+// Instructions are dispatched via a table of plain function pointers.
+class MOS6502Sim
+{
+public:
+    MOS6502Sim();
+
+    // copies all mem blocks to their start addresses, other memory is left unchanged
+    void loadMemBlocks(MemBlocks const &memBlocks);
+    void clearMemory(uint8_t fillByte = 0x00);
+
+    auto getRegisters() const -> Registers const & { return regs; }
+    void setRegisters(Registers const &registers) { regs = registers; }
+    void setA(uint8_t a) { regs.a = a; }
+    void setX(uint8_t x) { regs.x = x; }
+    void setY(uint8_t y) { regs.y = y; }
+    void setSP(uint8_t sp) { regs.sp = sp; }
+    void setP(uint8_t p) { regs.p = p | FLAG_U; }
+
+    auto readByte(uint16_t address) const -> uint8_t { return memory[address]; }
+    auto readWord(uint16_t address) const -> uint16_t;
+    void writeByte(uint16_t address, uint8_t byte) { memory[address] = byte; }
+    void writeWord(uint16_t address, uint16_t word);
+
+    // Calls the routine at startAddress as if it was invoked via JSR and runs it until
+    // it returns via RTS, executes a BRK, or until maxCycles have been consumed.
+    auto run(uint16_t startAddress, uint64_t maxCycles) -> RunResult;
+
+    // total number of cycles executed since construction
+    auto getTotalCycles() const -> uint64_t { return cycles; }
+
+    // In profiling mode, the cycles and the number of executions of each instruction
+    // are accumulated at the address of the instruction's opcode
+    void enableProfiling(bool enable);
+    void resetProfile();
+    auto isProfiling() const -> bool { return !profileCycles.empty(); }
+    auto getProfiledCycles(uint16_t address) const -> uint64_t;
+    auto getProfiledInstructions(uint16_t address) const -> uint64_t;
+
+private:
+    struct Ops; // instruction implementations, see MOS6502Sim.cpp
+
+    template<bool Profile>
+    auto runLoop() -> uint64_t;
+
+    std::array<uint8_t, 0x10000> memory;
+    Registers regs;
+    uint64_t cycles;
+    uint64_t cycleLimit;
+    uint8_t returnSP;   // stack pointer value after the RTS returning from run()
+    StopReason stopReason;
+    std::vector<uint64_t> profileCycles;
+    std::vector<uint64_t> profileInstructions;
+};
+
+} // namespace
+
+#endif
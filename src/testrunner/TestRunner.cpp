@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+#include "listener/SemanticError.h"
+#include "TestRunner.h"
+
+using namespace asm6502;
+
+namespace
+{
+
+std::map<std::string, uint8_t> const flags
+{
+    {"C", FLAG_C}, {"Z", FLAG_Z}, {"I", FLAG_I}, {"D", FLAG_D}, {"V", FLAG_V}, {"N", FLAG_N}
+};
+
+auto isRegister(std::string const &name) -> bool
+{
+    return (name == "A") || (name == "X") || (name == "Y") || (name == "SP") || (name == "P") || (flags.count(name) > 0);
+}
+
+auto getRegister(Registers const &regs, std::string const &name) -> uint8_t
+{
+    auto flag = flags.find(name);
+
+    return (name == "A") ? regs.a : (name == "X") ? regs.x : (name == "Y") ? regs.y : (name == "SP") ? regs.sp :
+           (name == "P") ? regs.p : (((regs.p & flag->second) != 0) ? 1 : 0);
+}
+
+void setRegister(Registers &regs, std::string const &name, uint8_t value)
+{
+    auto flag = flags.find(name);
+
+    if (name == "A") { regs.a = value; }
+    else if (name == "X") { regs.x = value; }
+    else if (name == "Y") { regs.y = value; }
+    else if (name == "SP") { regs.sp = value; }
+    else if (name == "P") { regs.p = value | FLAG_U; }
+    else { regs.p = (value != 0) ? (regs.p | flag->second) : (regs.p & ~flag->second); }
+}
+
+auto hex(uint32_t value, int digits) -> std::string
+{
+    std::stringstream strm;
+    strm << "$" << std::hex << std::setw(digits) << std::setfill('0') << value;
+    return strm.str();
+}
+
+// addresses and bytes are 16 bit at most, cycle counts 32 bit
+uint32_t const MAX_ADDRESS_VALUE = 0xffffU;
+uint32_t const MAX_CYCLES_VALUE = 0xffffffffU;
+
+// number up to maxValue, symbol or symbol+number, see parseTestFile()
+auto parseValue(std::string const &token, SymbolTable const &symbols, uint32_t maxValue) -> std::optional<uint32_t>
+{
+    std::optional<uint32_t> ret = std::nullopt;
+    size_t plusPos = token.find('+', 1);
+
+    if (!token.empty() && ((token[0] == '<') || (token[0] == '>')))
+    {
+        std::optional<uint32_t> optWord = parseValue(token.substr(1), symbols, MAX_ADDRESS_VALUE);
+        if (optWord != std::nullopt)
+        {
+            ret = (token[0] == '<') ? (optWord.value() & 0xffU) : ((optWord.value() >> 8U) & 0xffU);
+        }
+    }
+    else if (plusPos != std::string::npos)
+    {
+        std::optional<uint32_t> optBase = parseValue(token.substr(0, plusPos), symbols, maxValue);
+        std::optional<uint32_t> optOffset = parseValue(token.substr(plusPos + 1), symbols, maxValue);
+        if ((optBase != std::nullopt) && (optOffset != std::nullopt))
+        {
+            ret = optBase.value() + optOffset.value();
+        }
+    }
+    else if (!token.empty() && ((token[0] == '$') || (token[0] == '%') || std::isdigit(static_cast<unsigned char>(token[0]))))
+    {
+        std::string digits = std::isdigit(static_cast<unsigned char>(token[0])) ? token : token.substr(1);
+        int base = (token[0] == '$') ? 16 : (token[0] == '%') ? 2 : 10;
+        size_t parsed = 0;
+
+        try
+        {
+            unsigned long value = std::stoul(digits, &parsed, base);
+            if ((parsed == digits.length()) && (value <= maxValue))
+            {
+                ret = static_cast<uint32_t>(value);
+            }
+        }
+        catch (std::exception const &)
+        {
+            // not a number, ret stays empty
+        }
+    }
+    else
+    {
+        std::optional<Sym> optSym = symbols.resolveSymbol(token);
+        if (optSym != std::nullopt)
+        {
+            ret = optSym.value().val;
+        }
+    }
+
+    return ret;
+}
+
+}
+
+auto asm6502::parseTestFile(std::istream &strm, std::string const &fileName, SymbolTable const &symbols) -> TestFile
+{
+    TestFile ret;
+    std::optional<RoutineTest> optTest = std::nullopt;
+    std::string lineText;
+    size_t lineNr = 0;
+
+    auto addError = [&](std::string const &msg) { ret.errors.push_back(formatErrorMessage(fileName, lineNr, 1, msg)); };
+
+    while (std::getline(strm, lineText))
+    {
+        lineNr++;
+        std::stringstream lineStrm(lineText.substr(0, lineText.find(';')));
+        std::vector<std::string> tokens{std::istream_iterator<std::string>(lineStrm), std::istream_iterator<std::string>()};
+        std::vector<uint32_t> values;
+        bool valid = true;
+
+        if (tokens.empty())
+        {
+            continue;
+        }
+
+        // the values following the command, starting after the name of a test or a register
+        size_t firstValue = ((tokens[0] == "TEST") || (((tokens[0] == "SET") || (tokens[0] == "EXPECT")) &&
+                             (tokens.size() > 1) && isRegister(tokens[1]))) ? 2 : 1;
+        uint32_t maxValue = (tokens[0] == "MAXCYCLES") ? MAX_CYCLES_VALUE : MAX_ADDRESS_VALUE;
+        for (size_t idx = firstValue; idx < tokens.size(); idx++)
+        {
+            std::optional<uint32_t> optValue = parseValue(tokens[idx], symbols, maxValue);
+            if (optValue != std::nullopt)
+            {
+                values.push_back(optValue.value());
+            }
+            else
+            {
+                addError("Cannot resolve " + tokens[idx] + ".");
+                valid = false;
+            }
+        }
+
+        if (!valid)
+        {
+            // reported above
+        }
+        else if (tokens[0] == "TEST")
+        {
+            if (optTest != std::nullopt)
+            {
+                addError("Test " + optTest.value().name + " is not ended by END.");
+            }
+            if ((tokens.size() != 3))
+            {
+                addError("TEST takes a name and an entry.");
+                optTest = std::nullopt;
+            }
+            else
+            {
+                optTest = RoutineTest{tokens[1], static_cast<uint16_t>(values[0]), lineNr, {}, {}, {}, {}};
+            }
+        }
+        else if ((tokens[0] != "SET") && (tokens[0] != "EXPECT") && (tokens[0] != "MAXCYCLES") && (tokens[0] != "END"))
+        {
+            addError("Unknown command " + tokens[0] + ".");
+        }
+        else if (optTest == std::nullopt)
+        {
+            addError(tokens[0] + " outside of a test.");
+        }
+        else if (tokens[0] == "END")
+        {
+            ret.tests.push_back(optTest.value());
+            optTest = std::nullopt;
+        }
+        else if (tokens[0] == "MAXCYCLES")
+        {
+            if (values.size() == 1)
+            {
+                optTest.value().maxCycles = values[0];
+            }
+            else
+            {
+                addError("MAXCYCLES takes a number of cycles.");
+            }
+        }
+        else if (tokens.size() < 2)
+        {
+            addError(tokens[0] + " takes a register or an address and values.");
+        }
+        else if (std::any_of(begin(values) + ((firstValue == 2) ? 0 : 1), end(values), [](uint32_t value) { return value > 0xffU; }))
+        {
+            addError(tokens[0] + " takes byte values.");
+        }
+        else if (firstValue == 2)
+        {
+            if ((values.size() != 1) || ((flags.count(tokens[1]) > 0) && (values[0] > 1)))
+            {
+                addError(tokens[0] + " " + tokens[1] + " takes one value" + ((flags.count(tokens[1]) > 0) ? ", 0 or 1." : "."));
+            }
+            else
+            {
+                RegisterValue registerValue{tokens[1], static_cast<uint8_t>(values[0])};
+                ((tokens[0] == "SET") ? optTest.value().registers : optTest.value().expectedRegisters).push_back(registerValue);
+            }
+        }
+        else if (values.size() < 2)
+        {
+            addError(tokens[0] + " takes a register or an address and values.");
+        }
+        else
+        {
+            MemoryValue memoryValue{static_cast<uint16_t>(values[0]), {begin(values) + 1, end(values)}};
+            ((tokens[0] == "SET") ? optTest.value().memory : optTest.value().expectedMemory).push_back(memoryValue);
+        }
+    }
+
+    if (optTest != std::nullopt)
+    {
+        addError("Test " + optTest.value().name + " is not ended by END.");
+    }
+
+    return ret;
+}
+
+TestRunner::TestRunner(MemBlocks const &program_, size_t numThreads_) :
+    program{program_},
+    numThreads{std::max<size_t>(numThreads_, 1)}
+{
+}
+
+auto TestRunner::runTest(MOS6502Sim &sim, RoutineTest const &test) const -> RoutineTestResult
+{
+    RoutineTestResult ret{test.name, true, 0, {}};
+    Registers regs;
+
+    sim.clearMemory();
+    sim.loadMemBlocks(program);
+    for (auto const &memoryValue : test.memory)
+    {
+        for (size_t idx = 0; idx < memoryValue.bytes.size(); idx++)
+        {
+            sim.writeByte(memoryValue.address + idx, memoryValue.bytes[idx]);
+        }
+    }
+    for (auto const &registerValue : test.registers)
+    {
+        setRegister(regs, registerValue.name, registerValue.value);
+    }
+    sim.setRegisters(regs);
+
+    RunResult result = sim.run(test.entry, test.maxCycles);
+    ret.cycles = result.cycles;
+
+    switch (result.stopReason)
+    {
+        case StopReason::Rts:
+            break;
+        case StopReason::Brk:
+            ret.failures.push_back("Stopped at BRK, PC=" + hex(sim.getRegisters().pc, 4));
+            break;
+        case StopReason::CycleLimit:
+            ret.failures.push_back("Did not return within " + std::to_string(test.maxCycles) + " cycles");
+            break;
+        case StopReason::IllegalOpcode:
+            ret.failures.push_back("Stopped at illegal opcode, PC=" + hex(sim.getRegisters().pc, 4));
+            break;
+    }
+
+    for (auto const &registerValue : test.expectedRegisters)
+    {
+        uint8_t value = getRegister(sim.getRegisters(), registerValue.name);
+        if (value != registerValue.value)
+        {
+            ret.failures.push_back(registerValue.name + " is " + hex(value, 2) + ", expected " + hex(registerValue.value, 2));
+        }
+    }
+
+    for (auto const &memoryValue : test.expectedMemory)
+    {
+        for (size_t idx = 0; idx < memoryValue.bytes.size(); idx++)
+        {
+            uint16_t address = memoryValue.address + idx;
+            if (sim.readByte(address) != memoryValue.bytes[idx])
+            {
+                ret.failures.push_back(hex(address, 4) + " is " + hex(sim.readByte(address), 2) + ", expected " + hex(memoryValue.bytes[idx], 2));
+            }
+        }
+    }
+
+    ret.passed = ret.failures.empty();
+
+    return ret;
+}
+
+auto TestRunner::run(std::vector<RoutineTest> const &tests) const -> std::vector<RoutineTestResult>
+{
+    std::vector<RoutineTestResult> ret(tests.size());
+    std::atomic<size_t> nextTest{0};
+
+    auto worker = [&]() {
+        auto pSim = std::make_unique<MOS6502Sim>();
+        for (size_t testIdx = nextTest++; testIdx < tests.size(); testIdx = nextTest++)
+        {
+            ret[testIdx] = runTest(*pSim, tests[testIdx]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t idx = 1; idx < std::min(numThreads, tests.size()); idx++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    return ret;
+}
@@ -0,0 +1,97 @@
+#ifndef TEST_RUNNER_H
+#define TEST_RUNNER_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "listener/MemBlocks.h"
+#include "listener/SymbolTable.h"
+#include "sim/MOS6502Sim.h"
+
+namespace asm6502
+{
+
+// A register A, X, Y, SP, P or a flag C, Z, I, D, V, N and its value
+class RegisterValue
+{
+public:
+    std::string name;
+    uint8_t value;
+};
+
+// Bytes starting at an address
+class MemoryValue
+{
+public:
+    uint16_t address;
+    std::vector<uint8_t> bytes;
+};
+
+// A routine called with initial registers and memory, and what it must leave behind
+class RoutineTest
+{
+public:
+    static uint64_t const DEFAULT_MAX_CYCLES = 1000000;
+
+    std::string name;
+    uint16_t entry;
+    size_t srcLine;
+    std::vector<RegisterValue> registers;
+    std::vector<MemoryValue> memory;
+    std::vector<RegisterValue> expectedRegisters;
+    std::vector<MemoryValue> expectedMemory;
+    uint64_t maxCycles = DEFAULT_MAX_CYCLES;
+};
+
+class RoutineTestResult
+{
+public:
+    std::string name;
+    bool passed;
+    uint64_t cycles;
+    std::vector<std::string> failures;
+};
+
+class TestFile
+{
+public:
+    std::vector<RoutineTest> tests;
+    std::vector<std::string> errors;
+};
+
+// Reads the tests of a program from a test file. Each line holds one command, ';' starts a comment:
+//   TEST <name> <entry>            starts a test calling the routine at <entry>
+//   SET <register> <value>         sets a register or flag before the call
+//   SET <address> <value>...       writes bytes before the call
+//   EXPECT <register> <value>      the register or flag after the return
+//   EXPECT <address> <value>...    the bytes after the return
+//   MAXCYCLES <count>              fails the test if the routine takes longer
+//   END                            ends the test
+// Values are decimal, $hex or %binary numbers or symbols of the program, optionally with an added
+// number (table+2), '<' and '>' select the low and the high byte (<pointer). Values are 16 bit at
+// most, the count of MAXCYCLES 32 bit.
+auto parseTestFile(std::istream &strm, std::string const &fileName, SymbolTable const &symbols) -> TestFile;
+
+// Runs the tests on numThreads threads, each with its own simulator, which is loaded with
+// the program before each test
+class TestRunner
+{
+public:
+    TestRunner(MemBlocks const &program_, size_t numThreads_);
+
+    // in the order of the tests
+    auto run(std::vector<RoutineTest> const &tests) const -> std::vector<RoutineTestResult>;
+
+private:
+    auto runTest(MOS6502Sim &sim, RoutineTest const &test) const -> RoutineTestResult;
+
+    MemBlocks program;
+    size_t numThreads;
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,139 @@
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ASM6502.h"
+#include "getopt.hpp"
+#include "testrunner/TestRunner.h"
+
+using namespace std;
+using namespace asm6502;
+
+static int const RET_OK = 0;
+static int const RET_ERR = 1;
+
+static char const * const TEST_FILE_EXTENSION = ".test";
+static int const NAME_WIDTH = 32;
+
+void usage(char const *argv0)
+{
+    cerr
+        << "Usage: " << endl
+        << argv0 << " <asmfile> [-t <testfile>] [-j <threads>] [-u] [-I <path>]..." << endl
+        << "    -t <testfile>: read the tests from <testfile>, default is <asmfile> with the extension .test" << endl
+        << "    -j <threads>: run the tests on <threads> threads, default is one per core" << endl
+        << "    -u: accept the stable undocumented NMOS opcodes" << endl
+        << "    -I <path>: search .INCLUDE files in <path>, may be given multiple times" << endl;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    int ret = RET_OK;
+
+    AssemblyOptions assemblyOptions;
+    std::string asmFilePath = "";
+    std::string testFilePath = "";
+    size_t numThreads = std::thread::hardware_concurrency();
+
+    auto options = get_opt::getopt(argc, argv, "t:j:uI:");
+    for (auto const &option : options)
+    {
+        switch(option.opt)
+        {
+            case 't':
+                testFilePath = option.optarg;
+                break;
+            case 'j':
+            {
+                std::stringstream ss(option.optarg);
+                if (!(ss >> numThreads) || !ss.eof() || (numThreads == 0))
+                {
+                    cerr << "Invalid number of threads: " << option.optarg << std::endl;
+                    ret = RET_ERR;
+                }
+                break;
+            }
+            case 'u':
+                assemblyOptions.undocumentedOpcodes = true;
+                break;
+            case 'I':
+                assemblyOptions.includePaths.push_back(option.optarg);
+                break;
+            case '!': // no preceding dash
+                asmFilePath = option.optarg;
+                break;
+            case '?':
+                usage(argv[0]);
+                ret = RET_ERR;
+                break;
+
+            default:
+                assert(0);
+        }
+    }
+
+    if ((ret == RET_OK) && asmFilePath.empty())
+    {
+        usage(argv[0]);
+        ret = RET_ERR;
+    }
+
+    if (ret == RET_OK)
+    {
+        AssemblyStatus assemblyStatus = assembleFile(asmFilePath.c_str(), assemblyOptions);
+        std::string testPath = testFilePath.empty() ?
+            std::filesystem::path(asmFilePath).replace_extension(TEST_FILE_EXTENSION).string() : testFilePath;
+        std::ifstream testFile(testPath);
+
+        if (!assemblyStatus.errors.empty())
+        {
+            assemblyStatus.errors.writeText(cerr);
+            ret = RET_ERR;
+        }
+        else if (testFile.fail())
+        {
+            cerr << "Could not open test file: " << testPath << std::endl;
+            ret = RET_ERR;
+        }
+        else
+        {
+            TestFile tests = parseTestFile(testFile, testPath, assemblyStatus.symbols);
+
+            for (auto const &errMsg : tests.errors)
+            {
+                cerr << errMsg;
+                ret = RET_ERR;
+            }
+
+            if (ret == RET_OK)
+            {
+                std::vector<RoutineTestResult> results = TestRunner(assemblyStatus.assembledProgram, numThreads).run(tests.tests);
+                size_t numFailed = 0;
+
+                // the cycles of each test, to spot performance regressions of the routines
+                for (auto const &result : results)
+                {
+                    cout << (result.passed ? "PASS " : "FAIL ") << std::left << std::setw(NAME_WIDTH) << result.name
+                         << std::right << std::setw(10) << result.cycles << " cycles" << std::endl;
+                    for (auto const &failure : result.failures)
+                    {
+                        cout << "    " << failure << std::endl;
+                    }
+                    numFailed += result.passed ? 0 : 1;
+                }
+                cout << results.size() << " tests, " << numFailed << " failed" << std::endl;
+
+                ret = (numFailed == 0) ? RET_OK : RET_ERR;
+            }
+        }
+    }
+
+    return ret;
+}
@@ -4,9 +4,13 @@
  *  Created on: 19.08.2018
  *      Author: Ernst
  */
+#include <filesystem>
+#include <fstream>
+
 #include <catch2/catch_test_macros.hpp>
 
 #include "MOS6502TestHelper.h"
+#include "listener/ScratchBuffer.h"
 
 using namespace antlr4;
 
@@ -218,7 +222,245 @@ TEST_CASE( "calling subroutines", "6502 Assembler" )
         ); 
 }
 
+TEST_CASE( "data lists mixing literals, strings and expressions", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            BASE = $10 "
+        << "            .ORG $1000 "
+        << "            .BYTE 1, \"AB\", BASE + 1, 'C', %101, $ff, 255 "
+        << "            .WORD $1234, \"AB\", BASE * 2, 1000 "
+        << "            .DBYTE $1234, BASE + $100 "
+        ;
+    testAssembly(prog,
+        MemBlocks({
+            {0x1000, { 0x01, 0x41, 0x42, 0x11, 0x43, 0x05, 0xff, 0xff,
+                        0x34, 0x12, 0x41, 0x00, 0x42, 0x00, 0x20, 0x00, 0xe8, 0x03,
+                        0x12, 0x34, 0x01, 0x10}}
+            })
+        );
+}
 
+TEST_CASE( "jump tables with forward references", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 "
+        << "            JMP [table] "
+        << "table:      .WORD state0, state1, $2000 "
+        << "bytes:      .BYTE LO(state1), HI(state1) "
+        << "            .DBYTE state1 "
+        << "state0:     RTS "
+        << "state1:     NOP "
+        << "            RTS "
+        ;
+    testAssembly(prog,
+        MemBlocks({
+            {0x1000, { 0x6c, 0x03, 0x10,
+                        0x0d, 0x10, 0x0e, 0x10, 0x00, 0x20,
+                        0x0e, 0x10, 0x10, 0x0e,
+                        0x60, 0xea, 0x60}}
+            })
+        );
+}
 
+TEST_CASE( "assignments referring to later symbols", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            ROW_2 = ROW_1 + COLUMNS "
+        << "            ROW_1 = SCREEN + COLUMNS "
+        << "            .ORG $1000 "
+        << "            LDA #HI(ROW_2) "
+        << "            STA ROW_2 + 1 "
+        << "            JMP EXIT "
+        << "            SCREEN = $0400 "
+        << "            COLUMNS = 40 "
+        << "            EXIT = done "
+        << "done:       RTS "
+        ;
+    testAssembly(prog,
+        MemBlocks({
+            {0x1000, { 0xa9, 0x04, 0x8d, 0x51, 0x04, 0x4c, 0x08, 0x10, 0x60 }}
+            })
+        );
+}
+
+TEST_CASE( "generated lookup tables", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            i = 7 "
+        << "            .ORG $3000 "
+        << "squares:    .GENBYTE i, 8, i * i "
+        << "rows:       .GENWORD row, 4, $0400 + row * 40 "
+        << "            .BYTE LO($1234), HI($1234), i "
+        ;
+    testAssembly(prog,
+        MemBlocks({
+            {0x3000, { 0x00, 0x01, 0x04, 0x09, 0x10, 0x19, 0x24, 0x31,
+                        0x00, 0x04, 0x28, 0x04, 0x50, 0x04, 0x78, 0x04,
+                        0x34, 0x12, 0x07}}
+            })
+        );
+}
+
+// LO and HI are functions only when followed by a parenthesis
+TEST_CASE( "LO and HI name symbols", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "LO = $10" << std::endl
+        << "            .ORG $2000" << std::endl
+        << "HI:         .BYTE LO, HI(LO + $1200)" << std::endl
+        << "            LDA HI" << std::endl
+        ;
+    testAssembly(prog, MemBlocks({{0x2000, {0x10, 0x12, 0xAD, 0x00, 0x20}}}));
+
+    std::stringstream unknown;
+    unknown
+        << "            .ORG $2000" << std::endl
+        << "            .BYTE MID($1234)" << std::endl;
+    testErrors(unknown, {2});
+}
+
+TEST_CASE( "binary file inclusion", "6502 Assembler" )
+{
+    std::filesystem::path binPath = std::filesystem::temp_directory_path() / "asm6502_incbin_test.bin";
+    {
+        std::ofstream binFile(binPath, std::ios::binary | std::ios::trunc);
+        for (int val = 0; val < 32; val++)
+        {
+            binFile.put(static_cast<char>(val));
+        }
+    }
+
+    std::stringstream prog;
+    prog
+        << "            .ORG $2000 "
+        << "all:        .INCBIN \"" << binPath.string() << "\" "
+        << "part:       .INCBIN \"" << binPath.string() << "\", 30 "
+        << "            .INCBIN \"" << binPath.string() << "\", 4, 2 "
+        ;
+
+    AssemblyStatus as = parseStream(prog, "");
+    std::filesystem::remove(binPath);
+    REQUIRE(as.errors.empty());
+
+    MemBlock const &mb = as.assembledProgram.getMemBlockAt(0);
+    REQUIRE(mb.getStartAddress() == 0x2000);
+    REQUIRE(mb.getLengthBytes() == 32 + 2 + 2);
+    REQUIRE(mb.getByteAt(31) == 31);
+    REQUIRE(mb.getByteAt(32) == 30);
+    REQUIRE(mb.getByteAt(35) == 5);
+
+    // the listing of the whole file is shortened
+    std::string listing = as.assembledProgram.getMachineCode(false);
+    REQUIRE(listing.find("0x2000:0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,... (32 bytes)") != std::string::npos);
+}
+
+TEST_CASE( "undocumented opcodes", "6502 Assembler" )
+{
+    std::string prog
+    {
+        "            .ORG $C000 "
+        "ptr = $FB "
+        "            LAX ptr "
+        "            LAX $C100,Y "
+        "            SAX ptr,Y "
+        "            SAX [ptr,X] "
+        "            DCP $C100,X "
+        "            ISC [ptr],Y "
+        "            SLO ptr,X "
+        "            RRA $C100 "
+        "            SBX #$10 "
+        "            ANC #$80 "
+        "            ALR #$0F "
+        "            ARR #$7F "
+    };
+
+    std::stringstream strm(prog);
+    AssemblyStatus as;
+    AssemblyOptions options;
+    options.undocumentedOpcodes = true;
+    assembleStream(strm, "", options, as);
+    REQUIRE(as.errors.empty());
+
+    MemBlocks ref({{0xC000, {0xA7, 0xFB, 0xBF, 0x00, 0xC1, 0x97, 0xFB, 0x83, 0xFB, 0xDF, 0x00, 0xC1, 0xF3, 0xFB,
+                             0x17, 0xFB, 0x6F, 0x00, 0xC1, 0xCB, 0x10, 0x0B, 0x80, 0x4B, 0x0F, 0x6B, 0x7F}}});
+    REQUIRE(as.assembledProgram == ref);
+
+    // they are errors unless enabled, as are addressing modes the opcode does not have
+    std::stringstream disabled(prog);
+    testErrors(disabled, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1});
+
+    std::stringstream noMode;
+    noMode
+        << ".ORG $C000" << std::endl
+        << "STX $C100,Y" << std::endl;
+    testErrors(noMode, {2});
+}
+
+// without -u, the undocumented mnemonics are no reserved words
+TEST_CASE( "undocumented mnemonics name symbols", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "ISC = $10" << std::endl
+        << "            .ORG $2000" << std::endl
+        << "ARR:        LDA ISC" << std::endl
+        << "            JMP ARR" << std::endl
+        << "            .BYTE ALR, ISC + 1" << std::endl
+        << "ALR = 3" << std::endl
+        ;
+    testAssembly(prog, MemBlocks({{0x2000, {0xA5, 0x10, 0x4C, 0x00, 0x20, 0x03, 0x11}}}));
+}
+
+// the per-line state of the listener is reused, instruction lines do not allocate it
+TEST_CASE( "instruction lines do not allocate the scratch buffers", "6502 Assembler" )
+{
+    // the storage of the buffers allocated while assembling a program of the given length
+    auto getAllocations = [](int repetitions) -> size_t
+    {
+        std::stringstream prog;
+        prog << ".ORG $C000" << std::endl << "table = $C100" << std::endl;
+        for (int i = 0; i < repetitions; i++)
+        {
+            prog
+                << "LDA table+" << i % 16 << ",X" << std::endl
+                << "STA $D020" << std::endl
+                << "ADC #LO(table + 2 * 3)" << std::endl;
+        }
+
+        size_t allocations = getScratchBufferAllocations();
+        AssemblyStatus as;
+        assembleStream(prog, "", as);
+        REQUIRE(as.errors.empty());
+        return getScratchBufferAllocations() - allocations;
+    };
+
+    size_t fewLines = getAllocations(10);
+    REQUIRE(fewLines > 0);
+    REQUIRE(getAllocations(500) == fewLines);
+}
+
+// generated address arithmetic has hundreds of terms
+TEST_CASE( "long expressions evaluated", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog << ".ORG $C000" << std::endl << "one = 1" << std::endl << "LDA $C000";
+    for (int i = 0; i < 1000; i++)
+    {
+        prog << "+one-" << i % 2;
+    }
+    prog << std::endl << ".WORD 100-10-1, 2*3+4, 17/2%5, HI($1234+2)*2" << std::endl;
+
+    AssemblyStatus as;
+    assembleStream(prog, "", as);
+    REQUIRE(as.errors.empty());
+
+    MemBlocks ref({{0xC000, {0xAD, 0xF4, 0xC1, 89, 0, 10, 0, 3, 0, 0x24, 0}}});
+    REQUIRE(as.assembledProgram == ref);
+}
 
 } /* namespace asm6502 */
@@ -0,0 +1,78 @@
+#include <sstream>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+#include "listener/DebugInfo.h"
+
+namespace asm6502
+{
+// source maps and label files for emulators and profilers
+
+static auto assembleDebugInfo() -> DebugInfo
+{
+    std::stringstream prog(
+        ".ORG $C000\n"
+        "LDY #0\n"
+        "\n"
+        "label: STY $D020\n"
+        "INY\n"
+        "BNE label\n"
+        "RTS\n");
+    AssemblyStatus as;
+    assembleStream(prog, "frame.asm", as);
+    REQUIRE(as.errors.empty());
+
+    return makeDebugInfo(as.assembledProgram, as.symbols);
+}
+
+TEST_CASE( "source map holds the lines generating bytes and the labels", "6502 Debug Info" )
+{
+    DebugInfo debugInfo = assembleDebugInfo();
+
+    REQUIRE(debugInfo.files == std::vector<std::string>{"frame.asm"});
+    REQUIRE(debugInfo.lines.size() == 5);
+    REQUIRE(debugInfo.lines[0].address == 0xC000);
+    REQUIRE(debugInfo.lines[0].lengthBytes == 2);
+    REQUIRE(debugInfo.lines[0].line == 2);
+    REQUIRE(debugInfo.lines[1].address == 0xC002);
+    REQUIRE(debugInfo.lines[1].lengthBytes == 3);
+    REQUIRE(debugInfo.lines[1].line == 4);
+    REQUIRE(debugInfo.lines[1].col == 0);
+    REQUIRE(debugInfo.lines[4].address == 0xC008);
+    REQUIRE(debugInfo.lines[4].line == 7);
+
+    REQUIRE(debugInfo.labels.size() == 1);
+    REQUIRE(debugInfo.labels[0].address == 0xC002);
+    REQUIRE(debugInfo.labels[0].name == "label");
+
+    std::stringstream viceLabels;
+    writeViceLabels(viceLabels, debugInfo);
+    REQUIRE(viceLabels.str() == "al C:c002 .label\n");
+
+    std::stringstream text;
+    writeDebugInfoText(text, debugInfo);
+    REQUIRE(text.str().find("c002 3 frame.asm:4:0\n") != std::string::npos);
+    REQUIRE(text.str().find("c002 label\n") != std::string::npos);
+}
+
+TEST_CASE( "binary source maps are read back", "6502 Debug Info" )
+{
+    DebugInfo debugInfo = assembleDebugInfo();
+    std::stringstream binary;
+    writeDebugInfo(binary, debugInfo);
+    std::string data = binary.str();
+
+    std::stringstream in(data);
+    std::optional<DebugInfo> optDebugInfo = readDebugInfo(in);
+    REQUIRE(optDebugInfo != std::nullopt);
+    REQUIRE(optDebugInfo.value().files == debugInfo.files);
+    REQUIRE(optDebugInfo.value().lines.size() == debugInfo.lines.size());
+    REQUIRE(optDebugInfo.value().lines[3].address == debugInfo.lines[3].address);
+    REQUIRE(optDebugInfo.value().lines[3].line == debugInfo.lines[3].line);
+    REQUIRE(optDebugInfo.value().labels[0].name == "label");
+
+    std::stringstream truncated(data.substr(0, data.size() - 1));
+    REQUIRE(readDebugInfo(truncated) == std::nullopt);
+}
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+#include "disasm/Disassembler.h"
+#include "disasm/RoundTripChecker.h"
+
+namespace asm6502
+{
+// disassembly with the opcode tables of the assembler, and the round trip back
+
+// each opcode the tables know, with a zero page and an absolute operand below $100
+static auto getAllOpcodes() -> MemBlocks
+{
+    std::vector<uint8_t> bytes;
+
+    for (uint32_t opcode = 0; opcode < 0x100; opcode++)
+    {
+        std::optional<OpcodeInfo> const &optInfo = getOpcodeInfos()[opcode];
+
+        if (optInfo != std::nullopt)
+        {
+            std::vector<uint8_t> operand{0x12, 0x34};
+            bytes.push_back(opcode);
+            bytes.insert(end(bytes), begin(operand), begin(operand) + getOperandBytes(optInfo.value().mode));
+
+            if (getOperandBytes(optInfo.value().mode) == 2)
+            {
+                bytes.insert(end(bytes), {static_cast<uint8_t>(opcode), 0x12, 0x00});
+            }
+        }
+    }
+
+    return MemBlocks({{0x2000, bytes}});
+}
+
+TEST_CASE( "all opcodes survive the round trip", "6502 Disassembler" )
+{
+    MemBlocks program = getAllOpcodes();
+    AssemblyOptions options;
+
+    // without -u, the undocumented opcodes become data
+    REQUIRE(checkRoundTrip(program, options) == std::nullopt);
+    options.undocumentedOpcodes = true;
+    REQUIRE(checkRoundTrip(program, options) == std::nullopt);
+
+    // 151 documented opcodes and the 56 of the stable undocumented mnemonics
+    size_t numOpcodes = 0;
+    for (auto const &optInfo : getOpcodeInfos())
+    {
+        numOpcodes += (optInfo != std::nullopt) ? 1 : 0;
+    }
+    REQUIRE(numOpcodes == 151 + 56);
+}
+
+TEST_CASE( "disassembly labels branch targets and keeps absolute operands", "6502 Disassembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $C000 "
+        << "loop:       LDA table,X "
+        << "            SBC $12,X "
+        << "            JMP [$0012] "
+        << "            BNE loop "
+        << "            .BYTE $02 "
+        << "table = $12 "                   // defined after its use, so LDA keeps the absolute form
+        ;
+
+    AssemblyStatus as = parseStream(prog, "");
+    REQUIRE(as.errors.empty());
+    MemBlocks ref({{0xC000, {0xBD, 0x12, 0x00, 0xF5, 0x12, 0x6C, 0x12, 0x00, 0xD0, 0xF6, 0x02}}});
+    REQUIRE(as.assembledProgram == ref);
+
+    std::string source = Disassembler(false).disassemble(as.assembledProgram);
+    REQUIRE(source ==
+        "            .ORG $C000\n"
+        "L_C000:     LDA A_0012,X\n"
+        "            SBC $12,X\n"
+        "            JMP [$0012]\n"
+        "            BNE L_C000\n"
+        "            .BYTE $02\n"
+        "A_0012 = $12\n");
+    REQUIRE(checkRoundTrip(as.assembledProgram, AssemblyOptions()) == std::nullopt);
+}
+
+}
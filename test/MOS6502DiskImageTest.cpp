@@ -0,0 +1,88 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+
+#include "MOS6502TestHelper.h"
+#include "listener/D64Image.h"
+
+namespace asm6502
+{
+// programs written into .D64 disk images
+
+static auto readSector(std::string const &image, uint32_t track, uint32_t sector) -> std::string
+{
+    return image.substr(D64Image::getSectorNumber(track, sector) * D64Image::SECTOR_SIZE, D64Image::SECTOR_SIZE);
+}
+
+// follows the sector chain of the file starting at track/sector
+static auto readFile(std::string const &image, uint32_t track, uint32_t sector) -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> ret;
+    std::string data = readSector(image, track, sector);
+
+    while (data[0] != 0)
+    {
+        ret.insert(end(ret), begin(data) + 2, end(data));
+        data = readSector(image, static_cast<uint8_t>(data[0]), static_cast<uint8_t>(data[1]));
+    }
+    ret.insert(end(ret), begin(data) + 2, begin(data) + static_cast<uint8_t>(data[1]) + 1);
+
+    return ret;
+}
+
+TEST_CASE( "disk image holds the programs with their exact length", "6502 Disk Image" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $C000 "
+        << "            .GENBYTE idx, 600, idx % 251 "
+        << "            RTS "
+        ;
+
+    AssemblyStatus as = parseStream(prog, "");
+    REQUIRE(as.errors.empty());
+    std::vector<uint8_t> bytes = as.assembledProgram.getProgramBytes();
+    REQUIRE(bytes.size() == 2 + 601);
+
+    D64Image diskImage("demo", "01");
+    REQUIRE(diskImage.addFile("intro", bytes));
+    REQUIRE(diskImage.addFile("main", {0x00, 0xC0}));
+    std::stringstream strm;
+    diskImage.write(strm);
+    std::string image = strm.str();
+    REQUIRE(image.size() == 683 * D64Image::SECTOR_SIZE);
+
+    // the BAM lists the 3 + 1 sectors of the files as used, the directory track is not counted
+    std::string bam = readSector(image, D64Image::DIRECTORY_TRACK, 0);
+    REQUIRE(bam.substr(0x90, 4) == "DEMO");
+    REQUIRE(diskImage.getFreeBlocks() == 664 - 4);
+    REQUIRE(static_cast<uint8_t>(bam[4 + (17 - 1) * 4]) == 21 - 4);
+
+    std::string directory = readSector(image, D64Image::DIRECTORY_TRACK, 1);
+    REQUIRE(static_cast<uint8_t>(directory[1]) == 0xFF);
+    REQUIRE(static_cast<uint8_t>(directory[0x02]) == 0x82);
+    REQUIRE(directory.substr(0x05, 6) == "INTRO\xA0");
+    REQUIRE(directory[0x1E] == 3);
+    REQUIRE(directory.substr(0x25, 5) == "MAIN\xA0");
+
+    REQUIRE(readFile(image, directory[0x03], directory[0x04]) == bytes);
+    REQUIRE(readFile(image, directory[0x23], directory[0x24]) == std::vector<uint8_t>({0x00, 0xC0}));
+}
+
+TEST_CASE( "disk image directory holds 144 files", "6502 Disk Image" )
+{
+    D64Image diskImage("full", "01");
+
+    for (uint32_t idx = 0; idx < D64Image::MAX_FILES; idx++)
+    {
+        REQUIRE(diskImage.addFile("f" + std::to_string(idx), {0x01, 0x08}));
+    }
+    REQUIRE(!diskImage.addFile("one more", {0x01, 0x08}));
+
+    // a file larger than the free sectors is rejected
+    D64Image small("small", "01");
+    REQUIRE(!small.addFile("huge", std::vector<uint8_t>(665 * D64Image::SECTOR_DATA_BYTES)));
+    REQUIRE(small.getFreeBlocks() == 664);
+}
+
+}
@@ -136,4 +136,146 @@ TEST_CASE( "resolved operands too large", "6502 Assembler" )
     testErrors(prog, {2, 3, 4});
 }
 
-}
\ No newline at end of file
+TEST_CASE( "generated table values out of range or unresolved", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 " << std::endl
+        << "            .GENBYTE i, 4, i * 100 " << std::endl      // 300 does not fit into a byte
+        << "            .GENWORD i, 4, i * 100 " << std::endl
+        << "            .GENBYTE i, 4, later + i " << std::endl    // no forward references
+        << "later:      RTS " << std::endl
+    ;
+
+    testErrors(prog, {2, 4});
+}
+
+TEST_CASE( "missing binary files and ranges outside of them detected", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 " << std::endl
+        << "            .INCBIN \"does/not/exist.bin\" " << std::endl
+        << "            .INCBIN \"does/not/exist.bin\", 1, 2 " << std::endl
+    ;
+
+    testErrors(prog, {2, 3});
+}
+
+TEST_CASE( "unresolved or too large forward references in data", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 " << std::endl
+        << "            .WORD later, missing " << std::endl
+        << "            .BYTE later " << std::endl        // $1005 does not fit into a byte
+        << "            .BYTE LO(later) " << std::endl
+        << "later:      RTS " << std::endl
+    ;
+
+    testErrors(prog, {2, 3});
+}
+
+TEST_CASE( "circular and unresolvable assignments detected", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            A1 = B1 + 1 " << std::endl
+        << "            B1 = A1 - 1 " << std::endl
+        << "            C1 = UNDEFINED " << std::endl
+        << "            D1 = C1 " << std::endl
+        << "            E1 = E1 " << std::endl
+        << "            .ORG $1000 " << std::endl
+        << "            RTS " << std::endl
+    ;
+
+    testErrors(prog, {1, 2, 3, 4, 5});
+}
+
+TEST_CASE( "overlapping blocks detected", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 " << std::endl
+        << "            LDA #0 " << std::endl
+        << "            RTS " << std::endl
+        << "            .ORG $1002 " << std::endl
+        << "            NOP " << std::endl
+        << "            .SEGMENT DATA " << std::endl
+        << "buffer:     .RES 4 " << std::endl
+        << "            .ORG $2000 " << std::endl
+        << "            RTS " << std::endl
+    ;
+
+    testErrors(prog, {4, 6});
+}
+
+TEST_CASE( "characters the lexer does not know detected", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 " << std::endl
+        << "            NOP ` " << std::endl
+        << "            RTS ; no newline at the end"
+    ;
+
+    testErrors(prog, {2});
+}
+
+TEST_CASE( "assembling stops at the error limit", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog << "            .ORG $1000 " << std::endl;
+    for (int idx = 0; idx < 10; idx++)
+    {
+        prog << "            LDA undefined" << idx << std::endl;
+    }
+
+    AssemblyOptions options;
+    options.errorLimit = 3;
+    AssemblyStatus as;
+    assembleStream(prog, "limit.asm", options, as);
+
+    REQUIRE(as.errors.size() == 4);
+    REQUIRE(as.errors.errors[0].getCode() == ErrorCode::MissingSymbol);
+    REQUIRE(as.errors.errors[3].getCode() == ErrorCode::ErrorLimit);
+    REQUIRE(as.errors.getMessages()[0] == "limit.asm:2:12: error: Symbol or expression \"undefined0\" could not be resolved.\n");
+}
+
+TEST_CASE( "errors are written as JSON", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 " << std::endl
+        << "            LDA missing " << std::endl
+    ;
+    AssemblyStatus as;
+    assembleStream(prog, "dir\\main.asm", as);
+
+    std::stringstream json;
+    as.errors.writeJson(json);
+    REQUIRE(json.str() ==
+        "{\"file\": \"dir\\\\main.asm\", \"line\": 2, \"column\": 12, \"code\": \"missing-symbol\", "
+        "\"message\": \"Symbol or expression \\\"missing\\\" could not be resolved.\"}\n");
+}
+
+TEST_CASE( "expressions nested deeper than the limit detected", "6502 Assembler" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 " << std::endl
+        << "            LDA 1+(2+(3+4)) " << std::endl
+        << "            LDA 1+2+3+4+5+6+7+8 " << std::endl
+    ;
+    AssemblyOptions options;
+    options.expressionDepthLimit = 3;
+    AssemblyStatus as;
+    assembleStream(prog, "deep.asm", options, as);
+
+    // left-associative chains of any length need a depth of 2
+    REQUIRE(as.errors.size() == 1);
+    REQUIRE(as.errors.errors[0].getCode() == ErrorCode::ExpressionTooDeep);
+    REQUIRE(as.errors.errors[0].getLine() == 2);
+}
+
+}
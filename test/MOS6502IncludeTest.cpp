@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+#include "listener/IncludeTokenSource.h"
+
+namespace asm6502
+{
+// .INCLUDE of source files, and the cache of tokenized include files
+
+static auto makeIncludeDir() -> std::filesystem::path
+{
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "asm6502_include_test";
+    std::filesystem::create_directories(dir / "lib");
+
+    std::ofstream(dir / "hw.inc", std::ios::trunc)
+        << "BORDER = $D020" << std::endl
+        << ".INCLUDE \"colors.inc\"" << std::endl;
+    std::ofstream(dir / "lib" / "colors.inc", std::ios::trunc)
+        << "BLACK = 0" << std::endl
+        << "WHITE = 1" << std::endl;
+    std::ofstream(dir / "broken.inc", std::ios::trunc)
+        << "NOP" << std::endl
+        << "LDA #UNDEFINED" << std::endl;
+
+    return dir;
+}
+
+static auto assembleWithIncludes(std::string const &prog, std::filesystem::path const &dir) -> AssemblyStatus
+{
+    std::stringstream strm(prog);
+    std::string fileName = (dir / "main.asm").string();
+    AssemblyStatus as;
+    AssemblyOptions options;
+    options.includePaths.push_back((dir / "lib").string());
+
+    assembleStream(strm, fileName.c_str(), options, as);
+    return as;
+}
+
+TEST_CASE( "included files are assembled in place", "6502 Include" )
+{
+    std::filesystem::path dir = makeIncludeDir();
+    std::string prog
+    {
+        "            .INCLUDE \"hw.inc\" "
+        "            .ORG $C000 "
+        "            LDA #WHITE "
+        "            STA BORDER "
+        "            RTS "
+    };
+
+    AssemblyStatus as = assembleWithIncludes(prog, dir);
+    REQUIRE(as.errors.empty());
+    REQUIRE(as.assembledProgram == MemBlocks({{0xC000, { 0xa9, 0x01, 0x8d, 0x20, 0xd0, 0x60 }}}));
+
+    // the second run takes the tokens from the cache
+    size_t numTokenizations = IncludeCache::getInstance().getNumTokenizations();
+    AssemblyStatus again = assembleWithIncludes(prog, dir);
+    REQUIRE(again.assembledProgram == as.assembledProgram);
+    REQUIRE(IncludeCache::getInstance().getNumTokenizations() == numTokenizations);
+}
+
+TEST_CASE( "errors in included files name the included file", "6502 Include" )
+{
+    std::filesystem::path dir = makeIncludeDir();
+    std::string prog
+    {
+        "            .ORG $C000 \n"
+        "            .INCLUDE \"broken.inc\" \n"
+        "            .INCLUDE \"missing.inc\" \n"
+    };
+
+    AssemblyStatus as = assembleWithIncludes(prog, dir);
+    REQUIRE(as.errors.size() == 2);
+
+    std::vector<std::string> errors = as.errors.getMessages();
+    bool brokenReported = std::any_of(begin(errors), end(errors),
+        [](std::string const &err) { return err.find("broken.inc:2:") != std::string::npos; });
+    bool missingReported = std::any_of(begin(errors), end(errors),
+        [](std::string const &err) { return (err.find("main.asm:3:") != std::string::npos) && (err.find("missing.inc") != std::string::npos); });
+
+    REQUIRE(brokenReported);
+    REQUIRE(missingReported);
+}
+
+} // namespace
@@ -0,0 +1,148 @@
+#include <sstream>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+#include "linker/Linker.h"
+
+namespace asm6502
+{
+// object files and their linking
+
+static auto assembleObject(char const *source, char const *fileName) -> ObjectModule
+{
+    std::stringstream prog(source);
+    AssemblyOptions options;
+    options.objectMode = true;
+
+    AssemblyStatus as;
+    assembleStream(prog, fileName, options, as);
+    REQUIRE(as.errors.empty());
+
+    return as.object;
+}
+
+static char const *const MAIN_MODULE =
+    "            .ORG $C000 \n"
+    "            .EXPORT start \n"
+    "start:      JSR clear \n"
+    "            LDA #<table \n"
+    "            .WORD table + 1 \n"
+    "            RTS \n";
+
+static char const *const LIB_MODULE =
+    "            .EXPORT clear, table \n"
+    "clear:      LDX #0 \n"
+    "loop:       DEX \n"
+    "            BNE loop \n"
+    "            RTS \n"
+    "table:      .BYTE 1, 2 \n";
+
+TEST_CASE( "modules are linked", "6502 Linker" )
+{
+    ObjectModule mainModule = assembleObject(MAIN_MODULE, "main.asm");
+    ObjectModule libModule = assembleObject(LIB_MODULE, "lib.asm");
+    REQUIRE(mainModule.relocatableSections.empty());
+    REQUIRE(libModule.relocatableSections.size() == 1);
+
+    Linker linker(0xC008);
+    linker.addModule(mainModule, "main.o");
+    linker.addModule(libModule, "lib.o");
+    LinkStatus ls = linker.link();
+
+    REQUIRE(ls.errors.empty());
+    REQUIRE(ls.sectionBases == std::vector<std::vector<uint32_t>>{{}, {0xC008}});
+    REQUIRE(ls.symbols.resolveSymbol("table").value().val == 0xC00E);
+    REQUIRE(ls.linkedProgram == MemBlocks({
+        {0xC000, { 0x20, 0x08, 0xc0, 0xa9, 0x0e, 0x0f, 0xc0, 0x60,
+                   0xa2, 0x00, 0xca, 0xd0, 0xfd, 0x60, 0x01, 0x02 }}}));
+}
+
+TEST_CASE( "sections are placed into their segments", "6502 Linker" )
+{
+    ObjectModule module = assembleObject(
+        "            .SEGMENT ZEROPAGE \n"
+        "ptr:        .RES 2 \n"
+        "            .SEGMENT CODE \n"
+        "            LDA #<buffer \n"
+        "            STA ptr \n"
+        "            RTS \n"
+        "            .SEGMENT BSS \n"
+        "buffer:     .RES $100 \n"
+        "            .ORG $C000 \n"
+        "            JMP $C003 \n", "sections.asm");
+    REQUIRE(module.relocatableSections.size() == 3);
+    REQUIRE(module.relocatableSections[2].size == 0x100);
+    REQUIRE(module.relocatableSections[2].bytes.empty());
+
+    // the code section fills the gap after the absolute code
+    Linker linker(0xC000);
+    linker.addModule(module, "sections.o");
+    LinkStatus ls = linker.link();
+
+    REQUIRE(ls.errors.empty());
+    REQUIRE(ls.sectionBases == std::vector<std::vector<uint32_t>>{{0x02, 0xC003, 0xC009}});
+    REQUIRE(ls.linkedProgram == MemBlocks({
+        {0xC000, { 0x4c, 0x03, 0xc0, 0xa9, 0x09, 0x8d, 0x02, 0x00, 0x60 }}}));
+
+    Linker tooSmall(0xC000);
+    tooSmall.addSegment(Segment{"BSS", 0xC000, 0xC100});
+    tooSmall.addModule(module, "sections.o");
+    REQUIRE(tooSmall.link().errors.size() == 1);
+}
+
+TEST_CASE( "relocatable branches to absolute labels are patched", "6502 Linker" )
+{
+    // the file ends in an absolute block, the branch is relocatable nevertheless
+    ObjectModule module = assembleObject(
+        "            .SEGMENT CODE \n"
+        "            BNE target \n"
+        "            RTS \n"
+        "            .ORG $C000 \n"
+        "target:     RTS \n", "branch.asm");
+    REQUIRE(module.patches.size() == 1);
+
+    Linker linker(0xC000);
+    linker.addModule(module, "branch.o");
+    LinkStatus ls = linker.link();
+
+    REQUIRE(ls.errors.empty());
+    REQUIRE(ls.linkedProgram == MemBlocks({{0xC000, { 0x60, 0xd0, 0xfd, 0x60 }}}));
+}
+
+TEST_CASE( "object modules are written and read", "6502 Linker" )
+{
+    ObjectModule module = assembleObject(LIB_MODULE, "lib.asm");
+
+    std::stringstream objectFile;
+    writeObjectModule(objectFile, module);
+    std::optional<ObjectModule> optModule = readObjectModule(objectFile);
+
+    REQUIRE(optModule != std::nullopt);
+    REQUIRE(optModule.value().relocatableSections.size() == 1);
+    REQUIRE(optModule.value().relocatableSections[0].bytes == module.relocatableSections[0].bytes);
+    REQUIRE(optModule.value().symbols.size() == 2);
+    REQUIRE(optModule.value().patches.size() == module.patches.size());
+    REQUIRE(optModule.value().sourceFiles == std::vector<std::string>{"lib.asm"});
+
+    std::stringstream truncated(objectFile.str().substr(0, 20));
+    REQUIRE(readObjectModule(truncated) == std::nullopt);
+}
+
+TEST_CASE( "link errors", "6502 Linker" )
+{
+    Linker unresolved(0xC100);
+    unresolved.addModule(assembleObject(MAIN_MODULE, "main.asm"), "main.o");
+    LinkStatus ls = unresolved.link();
+    REQUIRE(ls.errors.size() == 3);
+    REQUIRE(ls.errors[0].find("main.asm:3:") == 0);
+
+    Linker duplicate(0xC100);
+    duplicate.addModule(assembleObject(LIB_MODULE, "lib.asm"), "lib.o");
+    duplicate.addModule(assembleObject(LIB_MODULE, "lib2.asm"), "lib2.o");
+    ls = duplicate.link();
+    REQUIRE(ls.errors.size() == 2);
+    REQUIRE(ls.errors[0].find("is exported by lib.o already") != std::string::npos);
+}
+
+} // namespace
@@ -0,0 +1,82 @@
+#include <sstream>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+
+namespace asm6502
+{
+// .MACRO and .REPT expansion
+
+TEST_CASE( "macros are expanded with their arguments", "6502 Macro" )
+{
+    std::stringstream prog(
+        ".MACRO COPY16 src, dst \n"
+        "            LDA src \n"
+        "            STA dst \n"
+        "            LDA src + 1 \n"
+        "            STA dst + 1 \n"
+        ".ENDM \n"
+        "            .ORG $C000 \n"
+        "            COPY16 $C100, $C200 \n"
+        "            RTS \n");
+
+    AssemblyStatus as = parseStream(prog, "");
+    REQUIRE(as.errors.empty());
+    REQUIRE(as.assembledProgram == MemBlocks({{0xC000, {
+        0xad, 0x00, 0xc1, 0x8d, 0x00, 0xc2, 0xad, 0x01, 0xc1, 0x8d, 0x01, 0xc2, 0x60 }}}));
+
+    // the listing names the macro of the expanded lines
+    REQUIRE(as.assembledProgram.getMachineCode(true).find("expanded from COPY16") != std::string::npos);
+}
+
+TEST_CASE( "repetitions have local labels", "6502 Macro" )
+{
+    std::stringstream prog(
+        "N = 2 \n"
+        "            .ORG $C000 \n"
+        ".REPT N \n"
+        "wait:       DEX \n"
+        "            BNE wait \n"
+        ".ENDR \n"
+        "            RTS \n");
+
+    testAssembly(prog, MemBlocks({{0xC000, { 0xca, 0xd0, 0xfd, 0xca, 0xd0, 0xfd, 0x60 }}}));
+}
+
+TEST_CASE( "macros may contain repetitions", "6502 Macro" )
+{
+    std::stringstream prog(
+        ".MACRO SHIFT n \n"
+        ".REPT n \n"
+        "            ASL \n"
+        ".ENDR \n"
+        ".ENDM \n"
+        "            .ORG $C000 \n"
+        "start:      SHIFT 3 \n"
+        "            JMP start \n");
+
+    testAssembly(prog, MemBlocks({{0xC000, { 0x0a, 0x0a, 0x0a, 0x4c, 0x00, 0xc0 }}}));
+}
+
+TEST_CASE( "macro errors", "6502 Macro" )
+{
+    std::stringstream prog(
+        "            .ORG $C000 \n"
+        ".MACRO TWO a, b \n"
+        "            NOP \n"
+        ".ENDM \n"
+        "            TWO 1 \n"
+        ".REPT COUNT \n"
+        "            NOP \n"
+        ".ENDR \n"
+        ".ENDM \n"
+        ".MACRO SELF \n"
+        "            SELF \n"
+        ".ENDM \n"
+        "            SELF \n");
+
+    testErrors(prog, {5, 6, 9, 11});
+}
+
+} // namespace
@@ -0,0 +1,146 @@
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+#include "sim/MOS6502Sim.h"
+
+namespace asm6502
+{
+// peephole optimizations, applied with the -O option
+
+static auto assembleOptimized(std::string const &prog, bool optimize) -> AssemblyStatus
+{
+    std::stringstream strm(prog);
+    AssemblyStatus as;
+    AssemblyOptions options;
+    options.optimize = optimize;
+
+    assembleStream(strm, "", options, as);
+    REQUIRE(as.errors.empty());
+
+    return as;
+}
+
+// the bytes the reported optimizations claim to save
+static auto getBytesSaved(AssemblyStatus const &as) -> size_t
+{
+    size_t ret = 0;
+
+    for (auto const &optimization : as.optimizations)
+    {
+        size_t pos = optimization.find(", saves ");
+        REQUIRE(pos != std::string::npos);
+        ret += std::stoul(optimization.substr(pos + 8));
+    }
+
+    return ret;
+}
+
+static std::string const incrementLoop
+{
+    "            .ORG $C000 "
+    "            LDX #0 "
+    "            LDY #10 "
+    "loop:       TXA "
+    "            CLC "
+    "            ADC #1 "
+    "            TAX "
+    "            CLC "
+    "            LDA $20 "
+    "            ADC #2 "
+    "            STA $20 "
+    "            DEY "
+    "            BNE loop "
+    "            STX $10 "
+    "            RTS "
+};
+
+TEST_CASE( "tail calls, redundant loads and reloads are removed", "6502 Optimizer" )
+{
+    std::string prog
+    {
+        "            .ORG $C000 "
+        "start:      LDA #0 "
+        "            STA $D020 "
+        "            LDA #0 "
+        "            STA $D021 "
+        "            JSR sub "
+        "            RTS "
+        "sub:        LDX #5 "
+        "            STX $10 "
+        "            LDX $10 "
+        "            RTS "
+    };
+
+    AssemblyStatus as = assembleOptimized(prog, true);
+
+    // the subroutine moved down by 4 bytes, the JMP follows it
+    MemBlocks ref({{0xC000, {0xA9, 0x00, 0x8D, 0x20, 0xD0, 0x8D, 0x21, 0xD0, 0x4C, 0x0B, 0xC0, 0xA2, 0x05, 0x86, 0x10, 0x60}}});
+    REQUIRE(as.assembledProgram == ref);
+    REQUIRE(as.optimizations.size() == 3);
+    REQUIRE(getBytesSaved(as) == 21 - 16);
+
+    // the listing shows the opcode which was emitted
+    REQUIRE(as.assembledProgram.getMachineCode(true).find("JMP sub    ; optimized from JSR") != std::string::npos);
+
+    // without the option, nothing changes
+    AssemblyStatus unoptimized = assembleOptimized(prog, false);
+    REQUIRE(unoptimized.assembledProgram.getMemBlockAt(0).getLengthBytes() == 21);
+    REQUIRE(unoptimized.optimizations.empty());
+}
+
+TEST_CASE( "index increments behave the same, but are faster", "6502 Optimizer" )
+{
+    AssemblyStatus original = assembleOptimized(incrementLoop, false);
+    AssemblyStatus optimized = assembleOptimized(incrementLoop, true);
+    REQUIRE(optimized.optimizations.size() == 1);
+    REQUIRE(optimized.optimizations[0].find("saves 3 byte(s), 4 cycle(s)") != std::string::npos);
+    REQUIRE(getBytesSaved(optimized) ==
+            original.assembledProgram.getMemBlockAt(0).getLengthBytes() - optimized.assembledProgram.getMemBlockAt(0).getLengthBytes());
+
+    MOS6502Sim sim;
+    sim.loadMemBlocks(original.assembledProgram);
+    RunResult originalResult = sim.run(0xC000, 10000);
+    REQUIRE(sim.readByte(0x10) == 10);
+    REQUIRE(sim.readByte(0x20) == 20);
+
+    sim.clearMemory();
+    sim.loadMemBlocks(optimized.assembledProgram);
+    RunResult optimizedResult = sim.run(0xC000, 10000);
+    REQUIRE(sim.readByte(0x10) == 10);
+    REQUIRE(sim.readByte(0x20) == 20);
+
+    REQUIRE(optimizedResult.stopReason == StopReason::Rts);
+    REQUIRE(originalResult.cycles - optimizedResult.cycles == 10 * 4);
+}
+
+TEST_CASE( "decimal mode programs keep their arithmetic", "6502 Optimizer" )
+{
+    AssemblyStatus as = assembleOptimized("            SED " + incrementLoop, true);
+
+    REQUIRE(as.optimizations.empty());
+
+    // N and Z after ADC and SBC do not reflect the decimal result, only the reload sets them
+    std::string reload
+    {
+        "            .ORG $C000 "
+        "            SED "
+        "            ADC #$15 "
+        "            STA $10 "
+        "            LDA $10 "
+        "            SBC #$01 "
+        "            STA $11 "
+        "            LDA $11 "
+        "            LDX #1 "
+        "            STX $12 "
+        "            LDX $12 "
+        "            RTS "
+    };
+
+    AssemblyStatus decimal = assembleOptimized(reload, true);
+    REQUIRE(decimal.optimizations.size() == 1);
+    REQUIRE(decimal.optimizations[0].find("STX $12 / LDX $12 -> STX $12") != std::string::npos);
+}
+
+} // namespace
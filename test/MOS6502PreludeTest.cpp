@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <sstream>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+#include "listener/SymbolSnapshot.h"
+
+namespace asm6502
+{
+// symbol snapshots, and their use as prelude of an assembled program
+
+static auto makePrelude() -> SymbolTable
+{
+    std::stringstream equates(
+        "BORDER = $D020 \n"
+        "BACKGROUND = $D021 \n"
+        "WHITE = 1 \n");
+    AssemblyStatus as;
+    assembleStream(equates, "hw.asm", as);
+    REQUIRE(as.errors.empty());
+
+    std::stringstream snapshot;
+    writeSymbolSnapshot(snapshot, as.symbols);
+    std::optional<SymbolTable> optPrelude = readSymbolSnapshot(snapshot);
+    REQUIRE(optPrelude != std::nullopt);
+
+    return optPrelude.value();
+}
+
+TEST_CASE( "symbol snapshots keep the symbols", "6502 Prelude" )
+{
+    SymbolTable prelude = makePrelude();
+
+    REQUIRE(prelude.getSymbols().size() == 3);
+    REQUIRE(prelude.resolveSymbol("BORDER").value().val == 0xD020);
+    REQUIRE(prelude.resolveSymbol("BORDER").value().line == 1);
+    REQUIRE(prelude.resolveSymbol("BORDER").value().fileId == Sym::PRELUDE_FILE_ID);
+    REQUIRE(prelude.resolveSymbol("WHITE").value().val == 1);
+    REQUIRE(prelude.resolveSymbol("BLACK") == std::nullopt);
+
+    // copies share the prelude symbols, but not the symbols added later
+    SymbolTable copy = prelude;
+    copy.addSymbol("BLACK", 1, 0, 0);
+    REQUIRE(copy.resolveSymbol("BORDER").value().val == 0xD020);
+    REQUIRE(prelude.resolveSymbol("BLACK") == std::nullopt);
+}
+
+TEST_CASE( "invalid symbol snapshots are rejected", "6502 Prelude" )
+{
+    std::stringstream snapshot;
+    writeSymbolSnapshot(snapshot, makePrelude());
+    std::string data = snapshot.str();
+
+    std::stringstream truncated(data.substr(0, data.size() - 1));
+    REQUIRE(readSymbolSnapshot(truncated) == std::nullopt);
+
+    std::stringstream wrongMagic("X" + data.substr(1));
+    REQUIRE(readSymbolSnapshot(wrongMagic) == std::nullopt);
+}
+
+TEST_CASE( "programs are assembled with the prelude symbols", "6502 Prelude" )
+{
+    AssemblyOptions options;
+    options.prelude = makePrelude();
+    options.preludeName = "hw.sym";
+
+    std::stringstream prog(
+        "            .ORG $C000 \n"
+        "            LDA #WHITE \n"
+        "            STA BORDER \n"
+        "            RTS \n");
+    AssemblyStatus as;
+    assembleStream(prog, "main.asm", options, as);
+    REQUIRE(as.errors.empty());
+    REQUIRE(as.assembledProgram == MemBlocks({{0xC000, { 0xa9, 0x01, 0x8d, 0x20, 0xd0, 0x60 }}}));
+
+    std::stringstream redefinition(
+        "            .ORG $C000 \n"
+        "WHITE = 2 \n");
+    AssemblyStatus redefined;
+    assembleStream(redefinition, "main.asm", options, redefined);
+    REQUIRE(redefined.errors.size() == 1);
+    REQUIRE(redefined.errors.getMessages()[0].find("hw.sym:3:") != std::string::npos);
+}
+
+} // namespace
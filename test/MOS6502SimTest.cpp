@@ -0,0 +1,345 @@
+#include <limits>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+#include "listener/LzPacker.h"
+#include "sim/MOS6502Sim.h"
+#include "sim/MOS6502Profiler.h"
+
+namespace asm6502
+{
+// execute assembled programs in the simulator
+
+static auto assembleForSim(std::istream &prog) -> MemBlocks
+{
+    AssemblyStatus as = parseStream(prog, "");
+    REQUIRE(as.errors.empty());
+    return as.assembledProgram;
+}
+
+TEST_CASE( "loop cycles are counted", "6502 Simulator" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $C000 "
+        << "            LDY #0 "
+        << "label:      STY $D020 "
+        << "            INY "
+        << "            BNE label "
+        << "            RTS "
+        ;
+
+    MOS6502Sim sim;
+    sim.loadMemBlocks(assembleForSim(prog));
+    RunResult result = sim.run(0xC000, 100000);
+
+    REQUIRE(result.stopReason == StopReason::Rts);
+    // LDY + 256 * (STY + INY) + 255 taken BNE + 1 BNE not taken + RTS
+    REQUIRE(result.cycles == 2 + 256 * (4 + 2) + 255 * 3 + 2 + 6);
+    REQUIRE(result.instructions == 1 + 256 * 3 + 1);
+    REQUIRE(sim.readByte(0xD020) == 0xff);
+    REQUIRE(sim.getRegisters().sp == 0xff);
+}
+
+TEST_CASE( "multiplication routine", "6502 Simulator" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $2200 "
+        << "x8:         .BYTE $00 "
+        << "y8:         .BYTE $00 "
+        << "result16:   .WORD $0000 "
+        << "            .ORG $2000 "
+        << "            LDX #8 "
+        << "            LDA #0 "
+        << "            STA result16 "
+        << "            STA result16 + 1 "
+        << "startloop:  ASL result16 "
+        << "            ROL result16 + 1 "
+        << "            ASL y8 "
+        << "            BCC endloop "
+        << "            CLC "
+        << "            LDA x8 "
+        << "            ADC result16 "
+        << "            STA result16 "
+        << "            BCC endloop "
+        << "            INC result16 + 1 "
+        << "endloop:    DEX "
+        << "            BNE startloop "
+        << "            RTS "
+        ;
+
+    MOS6502Sim sim;
+    sim.loadMemBlocks(assembleForSim(prog));
+
+    for (uint16_t x : {0, 1, 0x20, 0x7f, 0xff})
+    {
+        for (uint16_t y : {0, 1, 0x21, 0x80, 0xff})
+        {
+            sim.writeByte(0x2200, static_cast<uint8_t>(x));
+            sim.writeByte(0x2201, static_cast<uint8_t>(y));
+            RunResult result = sim.run(0x2000, 10000);
+
+            REQUIRE(result.stopReason == StopReason::Rts);
+            REQUIRE(sim.readWord(0x2202) == x * y);
+        }
+    }
+}
+
+TEST_CASE( "decimal mode arithmetic", "6502 Simulator" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 "
+        << "            SED "
+        << "            CLC "
+        << "            LDA #$19 "
+        << "            ADC #$28 "
+        << "            STA $10 "
+        << "            SEC "
+        << "            SBC #$48 "
+        << "            STA $11 "
+        << "            CLD "
+        << "            RTS "
+        ;
+
+    MOS6502Sim sim;
+    sim.loadMemBlocks(assembleForSim(prog));
+    RunResult result = sim.run(0x1000, 1000);
+
+    REQUIRE(result.stopReason == StopReason::Rts);
+    REQUIRE(sim.readByte(0x10) == 0x47);
+    REQUIRE(sim.readByte(0x11) == 0x99);
+    REQUIRE((sim.getRegisters().p & FLAG_C) == 0); // borrow
+}
+
+TEST_CASE( "run stops at BRK and at the cycle limit", "6502 Simulator" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $1000 "
+        << "            NOP "
+        << "            BRK "
+        << "            .ORG $2000 "
+        << "endless:    JMP endless "
+        ;
+
+    MOS6502Sim sim;
+    sim.loadMemBlocks(assembleForSim(prog));
+
+    RunResult brkResult = sim.run(0x1000, 1000);
+    REQUIRE(brkResult.stopReason == StopReason::Brk);
+    REQUIRE(sim.getRegisters().pc == 0x1001);
+
+    RunResult loopResult = sim.run(0x2000, 300);
+    REQUIRE(loopResult.stopReason == StopReason::CycleLimit);
+    REQUIRE(loopResult.cycles == 300);
+
+    // the largest count is no limit, also after the cycles of earlier runs
+    RunResult unlimitedResult = sim.run(0x1000, std::numeric_limits<uint64_t>::max());
+    REQUIRE(unlimitedResult.stopReason == StopReason::Brk);
+}
+
+TEST_CASE( "profile attributes cycles to lines and labels", "6502 Simulator" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $C000 "
+        << "main:       LDY #0 "
+        << "loop:       JSR inner "
+        << "            INY "
+        << "            BNE loop "
+        << "            RTS "
+        << "inner:      LDX #3 "
+        << "wait:       DEX "
+        << "            BNE wait "
+        << "            RTS "
+        ;
+
+    AssemblyStatus as = parseStream(prog, "");
+    REQUIRE(as.errors.empty());
+
+    MOS6502Sim sim;
+    sim.loadMemBlocks(as.assembledProgram);
+    sim.enableProfiling(true);
+    RunResult result = sim.run(0xC000, 1000000);
+    REQUIRE(result.stopReason == StopReason::Rts);
+
+    MOS6502Profiler profiler(as.assembledProgram, as.symbols);
+    profiler.attribute(sim);
+
+    REQUIRE(profiler.getTotalCycles() == result.cycles);
+    REQUIRE(profiler.getTotalInstructions() == result.instructions);
+
+    // the delay loop dominates: 256 calls * (3 DEX, 2 taken BNE, 1 BNE not taken, RTS)
+    std::vector<ProfileEntry> labels = profiler.getLabelHotSpots();
+    REQUIRE(labels.size() == 4);
+    REQUIRE(labels[0].name == "wait");
+    REQUIRE(labels[0].cycles == 256 * (3 * 2 + 2 * 3 + 2 + 6));
+    REQUIRE(labels[0].instructions == 256 * 7);
+
+    std::vector<ProfileEntry> lines = profiler.getLineHotSpots();
+    REQUIRE(lines[0].address == 0xC00C); // BNE wait
+    REQUIRE(lines[0].cycles == 256 * (3 + 3 + 2));
+}
+
+TEST_CASE( "profile attributes cycles to the code label, not to a symbol of the same address", "6502 Simulator" )
+{
+    std::stringstream prog;
+    prog
+        << "PATCH = $C002" << std::endl
+        << "            .ORG $C000" << std::endl
+        << "main:       LDX #3" << std::endl
+        << "            DEX" << std::endl
+        << "            BNE PATCH" << std::endl
+        << "            RTS" << std::endl
+        ;
+
+    AssemblyStatus as = parseStream(prog, "");
+    REQUIRE(as.errors.empty());
+
+    MOS6502Sim sim;
+    sim.loadMemBlocks(as.assembledProgram);
+    sim.enableProfiling(true);
+    RunResult result = sim.run(0xC000, 1000);
+    REQUIRE(result.stopReason == StopReason::Rts);
+
+    MOS6502Profiler profiler(as.assembledProgram, as.symbols);
+    profiler.attribute(sim);
+
+    std::vector<ProfileEntry> labels = profiler.getLabelHotSpots();
+    REQUIRE(labels.size() == 1);
+    REQUIRE(labels[0].name == "main");
+    REQUIRE(labels[0].cycles == result.cycles);
+    REQUIRE(profiler.getAnnotatedListing().find("main:") != std::string::npos);
+}
+
+TEST_CASE( "undocumented opcodes", "6502 Simulator" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $C000 "
+        << "            LDA #$F0 "
+        << "            LDX #$3C "
+        << "            SAX $10 "       // $30
+        << "            LAX $10 "
+        << "            LDA #$FF "
+        << "            SBX #$01 "      // X = $2F, carry set
+        << "            DCP $10 "       // $2F, compared to $FF
+        << "            ISC $11 "       // $01, A = $FE
+        << "            ARR #$FF "      // A = $FF, C from bit 6
+        << "            RTS "
+        ;
+
+    AssemblyStatus as;
+    AssemblyOptions options;
+    options.undocumentedOpcodes = true;
+    assembleStream(prog, "", options, as);
+    REQUIRE(as.errors.empty());
+
+    MOS6502Sim sim;
+    sim.loadMemBlocks(as.assembledProgram);
+    RunResult result = sim.run(0xC000, 1000);
+
+    REQUIRE(result.stopReason == StopReason::Rts);
+    REQUIRE(result.cycles == 2 + 2 + 3 + 3 + 2 + 2 + 5 + 5 + 2 + 6);
+    REQUIRE(sim.getRegisters().a == 0xFF);
+    REQUIRE(sim.getRegisters().x == 0x2F);
+    REQUIRE(sim.getRegisters().p == (FLAG_N | FLAG_U | FLAG_I | FLAG_C));
+    REQUIRE(sim.readByte(0x10) == 0x2F);
+    REQUIRE(sim.readByte(0x11) == 0x01);
+}
+
+TEST_CASE( "loader program copies the mem blocks into place", "6502 Simulator" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $0400 "        // moves down, below the loader
+        << "screen:     .GENBYTE idx, 300, idx % 7 "
+        << "            .ORG $0900 "        // moves up, overlapping the loaded bytes
+        << "table:      .GENBYTE idx, 600, idx % 251 "
+        << "            .ORG $C000 "
+        << "start:      LDA screen + 299 "
+        << "            STA $D020 "
+        << "            RTS "
+        ;
+
+    MemBlocks program = assembleForSim(prog);
+    std::optional<std::vector<uint8_t>> optLoader = program.getLoaderProgram(0xC000);
+    REQUIRE(optLoader != std::nullopt);
+
+    // load the .PRG at its load address, then run what "10 SYS 2061" calls
+    std::vector<uint8_t> const &loader = optLoader.value();
+    REQUIRE(loader.size() > 2);
+    MOS6502Sim sim;
+    sim.clearMemory();
+    sim.loadMemBlocks(MemBlocks({{static_cast<uint32_t>(loader[0] | (loader[1] << 8U)), std::vector<uint8_t>(begin(loader) + 2, end(loader))}}));
+    RunResult result = sim.run(2061, 1000000);
+
+    REQUIRE(result.stopReason == StopReason::Rts);
+    for (uint32_t blockIdx = 0; blockIdx < program.getNumMemBlocks(); blockIdx++)
+    {
+        MemBlock const &memBlock = program.getMemBlockAt(blockIdx);
+        for (uint32_t idx = 0; idx < memBlock.getLengthBytes(); idx++)
+        {
+            REQUIRE(sim.readByte(memBlock.getStartAddress() + idx) == memBlock.getByteAt(idx));
+        }
+    }
+    REQUIRE(sim.readByte(0xD020) == 299 % 7);
+
+    // a block overlapping the loader
+    MemBlocks overlapping({{0x0810, {0x60}}});
+    REQUIRE(overlapping.getLoaderProgram(0x0810) == std::nullopt);
+}
+
+TEST_CASE( "packed program unpacks the mem blocks", "6502 Simulator" )
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $0400 "
+        << "screen:     .GENBYTE idx, 1000, idx % 40 "
+        << "            .ORG $4000 "
+        << "table:      .GENBYTE idx, 20000, (idx / 3) % 17 "
+        << "            .ORG $C000 "
+        << "start:      LDA table + 19999 "
+        << "            STA $D020 "
+        << "            RTS "
+        ;
+
+    MemBlocks program = assembleForSim(prog);
+    std::optional<PackedProgram> optPacked = LzPacker(2).getPackedProgram(program, 0xC000);
+    REQUIRE(optPacked != std::nullopt);
+
+    // the chunks are the same with any number of threads
+    PackedProgram const &packed = optPacked.value();
+    REQUIRE(packed.prg == LzPacker(1).getPackedProgram(program, 0xC000).value().prg);
+    REQUIRE(packed.unpackedBytes == 2 + 0xC007 - 0x0400);
+    REQUIRE(packed.prg.size() < 2000);
+
+    MOS6502Sim sim;
+    sim.clearMemory();
+    sim.loadMemBlocks(MemBlocks({{static_cast<uint32_t>(packed.prg[0] | (packed.prg[1] << 8U)), std::vector<uint8_t>(begin(packed.prg) + 2, end(packed.prg))}}));
+    RunResult result = sim.run(2061, 10000000);
+
+    REQUIRE(result.stopReason == StopReason::Rts);
+    for (uint32_t blockIdx = 0; blockIdx < program.getNumMemBlocks(); blockIdx++)
+    {
+        MemBlock const &memBlock = program.getMemBlockAt(blockIdx);
+        for (uint32_t idx = 0; idx < memBlock.getLengthBytes(); idx++)
+        {
+            REQUIRE(sim.readByte(memBlock.getStartAddress() + idx) == memBlock.getByteAt(idx));
+        }
+    }
+    REQUIRE(sim.readByte(0xD020) == (19999 / 3) % 17);
+
+    // the estimate ignores page crossings and the final RTS
+    REQUIRE(packed.depackCycles <= result.cycles);
+    REQUIRE(packed.depackCycles * 100 >= result.cycles * 95);
+
+    // a block in the zero page would end the packed stream
+    MemBlocks zeroPage({{0x0010, {0x60}}});
+    REQUIRE(LzPacker(1).getPackedProgram(zeroPage, 0x0010) == std::nullopt);
+}
+
+} // namespace
@@ -138,7 +138,7 @@ auto testErrors(std::istream &prog, std::vector<size_t> expectedErrorLinesSorted
 
     if (!expectedErrorLinesSorted.empty())
     {
-        std::vector<size_t> errMsgLinesSorted = getErrorMsgLineNumbersSorted(as.errors);
+        std::vector<size_t> errMsgLinesSorted = getErrorMsgLineNumbersSorted(as.errors.getMessages());
 
         if (errMsgLinesSorted != expectedErrorLinesSorted)
         {
@@ -0,0 +1,128 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+#include "testrunner/TestRunner.h"
+
+namespace asm6502
+{
+// routines run against test files
+
+static auto assembleRoutines() -> AssemblyStatus
+{
+    std::stringstream prog;
+    prog
+        << "            .ORG $C000 "
+        << "add16:      CLC "               // result = arg1 + arg2
+        << "            LDA arg1 "
+        << "            ADC arg2 "
+        << "            STA result "
+        << "            LDA arg1 + 1 "
+        << "            ADC arg2 + 1 "
+        << "            STA result + 1 "
+        << "            RTS "
+        << "countdown:  DEX "
+        << "            BNE countdown "
+        << "            RTS "
+        << "arg1:       .WORD 0 "
+        << "arg2:       .WORD 0 "
+        << "result:     .WORD 0 "
+        ;
+
+    AssemblyStatus as = parseStream(prog, "");
+    REQUIRE(as.errors.empty());
+    return as;
+}
+
+TEST_CASE( "tests set memory and registers and check them after the routine returns", "6502 Test Runner" )
+{
+    AssemblyStatus as = assembleRoutines();
+    std::stringstream tests(
+        "; carry from the low into the high byte\n"
+        "TEST add_carry add16\n"
+        "    SET arg1 $FF $01\n"
+        "    SET arg2 1 0\n"
+        "    EXPECT result 0 2\n"
+        "    EXPECT C 0\n"
+        "END\n"
+        "TEST add_wrong add16\n"
+        "    SET arg1 <$1234 >$1234\n"
+        "    EXPECT result+1 $13\n"
+        "END\n"
+        "TEST countdown countdown\n"
+        "    SET X 10\n"
+        "    EXPECT X 0\n"
+        "    EXPECT Z 1\n"
+        "END\n"
+        "TEST too_slow countdown\n"
+        "    SET X 0\n"
+        "    MAXCYCLES 1000\n"
+        "END\n");
+
+    TestFile testFile = parseTestFile(tests, "routines.test", as.symbols);
+    REQUIRE(testFile.errors.empty());
+    REQUIRE(testFile.tests.size() == 4);
+
+    std::vector<RoutineTestResult> results = TestRunner(as.assembledProgram, 4).run(testFile.tests);
+    REQUIRE(results.size() == 4);
+    REQUIRE(results[0].passed);
+    REQUIRE(!results[1].passed);
+    REQUIRE(results[1].failures.size() == 1);
+    REQUIRE(results[1].failures[0] == "$c01d is $12, expected $13");
+    REQUIRE(results[2].passed);
+    // DEX and BNE 10 times, the last branch not taken, and RTS
+    REQUIRE(results[2].cycles == 10 * 2 + 9 * 3 + 2 + 6);
+    REQUIRE(!results[3].passed);
+}
+
+TEST_CASE( "cycle limits may exceed 16 bit", "6502 Test Runner" )
+{
+    AssemblyStatus as = assembleRoutines();
+    std::stringstream tests(
+        "TEST patient countdown\n"
+        "    SET X 0\n"
+        "    MAXCYCLES 100000\n"
+        "END\n"
+        "TEST too_large countdown\n"
+        "    SET $10000 0\n"
+        "END\n");
+
+    TestFile testFile = parseTestFile(tests, "routines.test", as.symbols);
+    REQUIRE(testFile.errors.size() == 1);
+    REQUIRE(testFile.errors[0] == "routines.test:6:1: error: Cannot resolve $10000.\n");
+    REQUIRE(testFile.tests.size() == 2);
+    REQUIRE(testFile.tests[0].maxCycles == 100000);
+
+    std::vector<RoutineTestResult> results = TestRunner(as.assembledProgram, 1).run({testFile.tests[0]});
+    REQUIRE(results[0].passed);
+}
+
+TEST_CASE( "test file errors", "6502 Test Runner" )
+{
+    AssemblyStatus as = assembleRoutines();
+    std::stringstream tests(
+        "TEST first nowhere\n"
+        "END\n"
+        "SET A 1\n"
+        "TEST second add16\n"
+        "    SET C 2\n"
+        "    EXPECT arg1 $100\n"
+        "    JUMP\n");
+
+    TestFile testFile = parseTestFile(tests, "routines.test", as.symbols);
+    REQUIRE(testFile.errors.size() == 7);
+    REQUIRE(testFile.errors[0] == "routines.test:1:1: error: Cannot resolve nowhere.\n");
+
+    // commands without operands
+    std::stringstream bare(
+        "TEST third add16\n"
+        "    SET\n"
+        "    EXPECT\n"
+        "END\n");
+    testFile = parseTestFile(bare, "routines.test", as.symbols);
+    REQUIRE(testFile.errors.size() == 2);
+    REQUIRE(testFile.errors[0] == "routines.test:2:1: error: SET takes a register or an address and values.\n");
+    REQUIRE(testFile.errors[1] == "routines.test:3:1: error: EXPECT takes a register or an address and values.\n");
+    REQUIRE(testFile.tests.size() == 1);
+}
+
+}
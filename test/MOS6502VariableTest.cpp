@@ -0,0 +1,72 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "MOS6502TestHelper.h"
+
+namespace asm6502
+{
+// zero page allocation of the variables declared by .VAR
+
+static auto assembleVariables(std::string const &prog) -> AssemblyStatus
+{
+    std::stringstream strm(prog);
+    AssemblyStatus as;
+
+    assembleStream(strm, "", AssemblyOptions(), as);
+
+    return as;
+}
+
+TEST_CASE( "variables in loops get the zero page, the others are placed at their declaration", "6502 Variables" )
+{
+    std::string prog
+    {
+        "            .ZPPOOL $FB, $FB "
+        "            .ORG $C000 "
+        "            LDA once "
+        "            LDX #10 "
+        "loop:       INC counter "
+        "            DEX "
+        "            BNE loop "
+        "            RTS "
+        "            .VAR once "
+        "            .VAR counter "
+    };
+
+    AssemblyStatus as = assembleVariables(prog);
+    REQUIRE(as.errors.empty());
+
+    MemBlocks ref({{0xC000, {0xAD, 0x0B, 0xC0, 0xA2, 0x0A, 0xE6, 0xFB, 0xCA, 0xD0, 0xFB, 0x60}}});
+    REQUIRE(as.assembledProgram == ref);
+    REQUIRE(as.symbols.resolveSymbol("counter").value().val == 0xFB);
+    REQUIRE(as.symbols.resolveSymbol("once").value().val == 0xC00B);
+
+    // one message per variable and the total
+    REQUIRE(as.variables.size() == 3);
+    REQUIRE(as.variables[1].find("zero page $fb") != std::string::npos);
+    REQUIRE(as.variables[2].find("saves 1 byte(s), 1 cycle(s)") != std::string::npos);
+}
+
+TEST_CASE( "variables used with indirect addressing require the zero page", "6502 Variables" )
+{
+    std::string prog
+    {
+        "            .VAR ptr, 2 "
+        "            .VAR count "
+        "            .ORG $C000 "
+        "            LDY count "
+        "            LDA [ptr],Y "
+        "            RTS "
+    };
+
+    // the pointer goes first, the default pool $FB-$FE holds both
+    AssemblyStatus as = assembleVariables(prog);
+    REQUIRE(as.errors.empty());
+    MemBlocks ref({{0xC000, {0xA4, 0xFD, 0xB1, 0xFB, 0x60}}});
+    REQUIRE(as.assembledProgram == ref);
+
+    AssemblyStatus exhausted = assembleVariables("            .ZPPOOL $FB, $FB " + prog);
+    REQUIRE(exhausted.errors.size() == 1);
+    REQUIRE(exhausted.errors.getMessages()[0].find("ptr") != std::string::npos);
+}
+
+}